@@ -57,6 +57,7 @@ static gboolean set_power_state_off_flag;
 static gboolean reset_flag;
 static gchar *factory_reset_str;
 static gchar *command_str;
+static gboolean port_statistics_flag;
 static gchar *create_bearer_str;
 static gchar *delete_bearer_str;
 static gchar *set_current_capabilities_str;
@@ -102,6 +103,10 @@ static GOptionEntry entries[] = {
       "Send an AT command to the modem",
       "[COMMAND]"
     },
+    { "port-statistics", 0, 0, G_OPTION_ARG_NONE, &port_statistics_flag,
+      "Show traffic statistics of each port of the modem",
+      NULL
+    },
     { "create-bearer", 0, 0, G_OPTION_ARG_STRING, &create_bearer_str,
       "Create a new packet data bearer in a given modem",
       "[\"key=value,...\"]"
@@ -169,6 +174,7 @@ mmcli_modem_options_enabled (void)
                  !!delete_bearer_str +
                  !!factory_reset_str +
                  !!command_str +
+                 port_statistics_flag +
                  !!set_current_capabilities_str +
                  !!set_allowed_modes_str +
                  !!set_preferred_mode_str +
@@ -658,6 +664,100 @@ command_ready (MMModem      *modem,
     mmcli_async_operation_done ();
 }
 
+static void
+port_statistics_print_latencies (GVariant *latencies)
+{
+    GVariantIter  iter;
+    const gchar  *key;
+    GVariant     *buckets;
+
+    g_variant_iter_init (&iter, latencies);
+    while (g_variant_iter_next (&iter, "(&s@au)", &key, &buckets)) {
+        GString      *str;
+        const guint32 *counts;
+        gsize         n_counts;
+        gsize         i;
+
+        str = g_string_new (NULL);
+        counts = g_variant_get_fixed_array (buckets, &n_counts, sizeof (guint32));
+        for (i = 0; i < n_counts; i++) {
+            if (!counts[i])
+                continue;
+            if (str->len)
+                g_string_append (str, ", ");
+            if (i == 0)
+                g_string_append_printf (str, "<1ms: %u", counts[i]);
+            else if (i == n_counts - 1)
+                g_string_append_printf (str, ">=%ums: %u", 1 << (i - 1), counts[i]);
+            else
+                g_string_append_printf (str, "%u-%ums: %u", 1 << (i - 1), 1 << i, counts[i]);
+        }
+        g_print ("\t    %s: %s\n", key, str->len ? str->str : "none");
+        g_string_free (str, TRUE);
+        g_variant_unref (buckets);
+    }
+}
+
+static void
+port_statistics_process_reply (GVariant     *result,
+                               const GError *error)
+{
+    GVariantIter  iter;
+    GVariant     *dictionary;
+
+    if (!result) {
+        g_printerr ("error: couldn't get port statistics: '%s'\n",
+                    error ? error->message : "unknown error");
+        exit (EXIT_FAILURE);
+    }
+
+    g_variant_iter_init (&iter, result);
+    while ((dictionary = g_variant_iter_next_value (&iter)) != NULL) {
+        const gchar  *port = NULL;
+        guint64       commands = 0;
+        guint64       bytes_in = 0;
+        guint64       bytes_out = 0;
+        guint64       timeouts = 0;
+        guint64       cache_hits = 0;
+        GVariant     *latencies;
+
+        g_variant_lookup (dictionary, "port",       "&s", &port);
+        g_variant_lookup (dictionary, "commands",   "t",  &commands);
+        g_variant_lookup (dictionary, "bytes-in",   "t",  &bytes_in);
+        g_variant_lookup (dictionary, "bytes-out",  "t",  &bytes_out);
+        g_variant_lookup (dictionary, "timeouts",   "t",  &timeouts);
+        g_variant_lookup (dictionary, "cache-hits", "t",  &cache_hits);
+
+        g_print ("\t%s: %" G_GUINT64_FORMAT " commands, %" G_GUINT64_FORMAT " timeouts, %" G_GUINT64_FORMAT " cache hits, "
+                 "%" G_GUINT64_FORMAT " bytes in, %" G_GUINT64_FORMAT " bytes out\n",
+                 port ? port : "unknown", commands, timeouts, cache_hits, bytes_in, bytes_out);
+
+        latencies = g_variant_lookup_value (dictionary, "latencies", G_VARIANT_TYPE ("a(sau)"));
+        if (latencies) {
+            port_statistics_print_latencies (latencies);
+            g_variant_unref (latencies);
+        }
+
+        g_variant_unref (dictionary);
+    }
+
+    g_variant_unref (result);
+}
+
+static void
+port_statistics_ready (MMModem      *modem,
+                       GAsyncResult *result,
+                       gpointer      nothing)
+{
+    GVariant *operation_result;
+    GError *error = NULL;
+
+    operation_result = mm_modem_get_port_statistics_finish (modem, result, &error);
+    port_statistics_process_reply (operation_result, error);
+
+    mmcli_async_operation_done ();
+}
+
 static guint
 command_get_timeout (MMModem *modem)
 {
@@ -1055,6 +1155,16 @@ get_modem_ready (GObject      *source,
         return;
     }
 
+    /* Request to get port statistics? */
+    if (port_statistics_flag) {
+        g_debug ("Asynchronously getting port statistics...");
+        mm_modem_get_port_statistics (ctx->modem,
+                                      ctx->cancellable,
+                                      (GAsyncReadyCallback)port_statistics_ready,
+                                      NULL);
+        return;
+    }
+
     /* Request to create a new bearer? */
     if (create_bearer_str) {
         GError *error = NULL;
@@ -1291,6 +1401,16 @@ mmcli_modem_run_synchronous (GDBusConnection *connection)
         return;
     }
 
+    /* Request to get port statistics? */
+    if (port_statistics_flag) {
+        GVariant *result;
+
+        g_debug ("Synchronously getting port statistics...");
+        result = mm_modem_get_port_statistics_sync (ctx->modem, NULL, &error);
+        port_statistics_process_reply (result, error);
+        return;
+    }
+
     /* Request to create a new bearer? */
     if (create_bearer_str) {
         MMBearer *bearer;
@@ -245,4 +245,20 @@
  */
 #define ID_MM_TTY_FLOW_CONTROL "ID_MM_TTY_FLOW_CONTROL"
 
+/**
+ * ID_MM_TTY_AT_PIPELINE_DEPTH:
+ *
+ * This is a port-specific tag applied to AT TTYs that are known to
+ * reply in order to several commands written at once, without waiting
+ * for the reply of each one before sending the next.
+ *
+ * The value of the tag should be the maximum number of commands to
+ * have in flight at once, e.g. "4". Only read-only queries known to be
+ * safe, like the ones loading the modem identity, are ever sent this
+ * way. If not given, commands are sent one by one.
+ *
+ * Since: 1.14
+ */
+#define ID_MM_TTY_AT_PIPELINE_DEPTH "ID_MM_TTY_AT_PIPELINE_DEPTH"
+
 #endif /* MM_TAGS_H */
@@ -270,6 +270,11 @@ mm_location_3gpp_reset (MMLocation3gpp *self)
 
 /**
  * mm_location_3gpp_get_string_variant: (skip)
+ * @self: a #MMLocation3gpp.
+ *
+ * Returns: (transfer full): a string #GVariant with the 3GPP location, or
+ * %NULL if not available. The returned value should be freed with
+ * g_variant_unref().
  */
 GVariant *
 mm_location_3gpp_get_string_variant (MMLocation3gpp *self)
@@ -291,7 +296,7 @@ mm_location_3gpp_get_string_variant (MMLocation3gpp *self)
                                self->priv->cell_id,
                                self->priv->tracking_area_code);
 
-        variant = g_variant_new_string (str);
+        variant = g_variant_ref_sink (g_variant_new_string (str));
         g_free (str);
     }
 
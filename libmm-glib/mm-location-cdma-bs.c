@@ -116,6 +116,11 @@ mm_location_cdma_bs_set (MMLocationCdmaBs *self,
 
 /**
  * mm_location_cdma_bs_get_dictionary: (skip)
+ * @self: a #MMLocationCdmaBs.
+ *
+ * Returns: (transfer full): a dictionary #GVariant with the CDMA base station
+ * location, or %NULL if not available. The returned value should be freed with
+ * g_variant_unref().
  */
 GVariant *
 mm_location_cdma_bs_get_dictionary (MMLocationCdmaBs *self)
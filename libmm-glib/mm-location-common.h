@@ -51,4 +51,24 @@
  */
 #define MM_LOCATION_ALTITUDE_UNKNOWN  -G_MAXDOUBLE
 
+/**
+ * MM_LOCATION_SPEED_UNKNOWN:
+ *
+ * Identifier for an unknown speed value.
+ *
+ * Since: 1.14
+ */
+#define MM_LOCATION_SPEED_UNKNOWN     -G_MAXDOUBLE
+
+/**
+ * MM_LOCATION_COURSE_UNKNOWN:
+ *
+ * Identifier for an unknown course value.
+ *
+ * Proper course values fall in the [0,360) range.
+ *
+ * Since: 1.14
+ */
+#define MM_LOCATION_COURSE_UNKNOWN    -G_MAXDOUBLE
+
 #endif /* MM_LOCATION_COMMON_H */
@@ -36,13 +36,105 @@
 
 G_DEFINE_TYPE (MMLocationGpsNmea, mm_location_gps_nmea, G_TYPE_OBJECT)
 
+/* Every trace type has its own segment in the snapshot of all the traces,
+ * which is kept up to date as traces are added, so that it can be given
+ * right away. Segments are kept in the order in which their trace types
+ * were first found, and always end with <CR><LF>. */
+typedef struct {
+    gchar *trace;
+    guint  index;
+    gsize  offset;
+    gsize  len;
+} TraceEntry;
+
 struct _MMLocationGpsNmeaPrivate {
+    /* trace type -> TraceEntry */
     GHashTable *traces;
+    /* TraceEntry, in snapshot order */
+    GPtrArray *entries;
+    GString *snapshot;
+    /* Built from the snapshot when first needed */
+    GVariant *variant;
     GRegex *sequence_regex;
 };
 
 /*****************************************************************************/
 
+static void
+trace_entry_free (TraceEntry *entry)
+{
+    g_free (entry->trace);
+    g_slice_free (TraceEntry, entry);
+}
+
+static void
+trace_entry_take_trace (MMLocationGpsNmea *self,
+                        TraceEntry *entry,
+                        gchar *trace)
+{
+    gsize len;
+    gsize segment_len;
+    gboolean terminated;
+    guint i;
+
+    len = strlen (trace);
+    terminated = g_str_has_suffix (trace, "\r\n");
+    segment_len = len + (terminated ? 0 : 2);
+
+    g_free (entry->trace);
+    entry->trace = trace;
+
+    if (segment_len == entry->len) {
+        gchar *segment;
+
+        /* Nothing to do if the same trace is given again */
+        segment = &self->priv->snapshot->str[entry->offset];
+        if (memcmp (segment, trace, len) == 0 &&
+            (terminated || memcmp (&segment[len], "\r\n", 2) == 0))
+            return;
+
+        memcpy (segment, trace, len);
+        if (!terminated)
+            memcpy (&segment[len], "\r\n", 2);
+    } else {
+        g_string_erase (self->priv->snapshot, entry->offset, entry->len);
+        g_string_insert_len (self->priv->snapshot, entry->offset, trace, len);
+        if (!terminated)
+            g_string_insert_len (self->priv->snapshot, entry->offset + len, "\r\n", 2);
+
+        /* Move the segments after this one */
+        for (i = entry->index + 1; i < self->priv->entries->len; i++) {
+            TraceEntry *next;
+
+            next = g_ptr_array_index (self->priv->entries, i);
+            next->offset = next->offset - entry->len + segment_len;
+        }
+        entry->len = segment_len;
+    }
+
+    if (self->priv->variant) {
+        g_variant_unref (self->priv->variant);
+        self->priv->variant = NULL;
+    }
+}
+
+/* The <CR><LF> of the last segment is not given if its trace didn't have it */
+static gsize
+snapshot_get_len (MMLocationGpsNmea *self)
+{
+    TraceEntry *last;
+
+    if (!self->priv->entries->len)
+        return 0;
+
+    last = g_ptr_array_index (self->priv->entries, self->priv->entries->len - 1);
+    if (g_str_has_suffix (last->trace, "\r\n"))
+        return self->priv->snapshot->len;
+    return self->priv->snapshot->len - 2;
+}
+
+/*****************************************************************************/
+
 static gboolean
 check_append_or_replace (MMLocationGpsNmea *self,
                          const gchar *trace)
@@ -75,6 +167,7 @@ location_gps_nmea_take_trace (MMLocationGpsNmea *self,
 {
     gchar *i;
     gchar *trace_type;
+    TraceEntry *entry;
 
     i = strchr (trace, ',');
     if (!i || i == trace) {
@@ -86,36 +179,44 @@ location_gps_nmea_take_trace (MMLocationGpsNmea *self,
     memcpy (trace_type, trace, i - trace);
     trace_type[i - trace] = '\0';
 
+    entry = g_hash_table_lookup (self->priv->traces, trace_type);
+
     /* Some traces are part of a SEQUENCE; so we need to decide whether we
      * completely replace the previous trace, or we append the new one to
      * the already existing list */
-    if (check_append_or_replace (self, trace)) {
+    if (entry && check_append_or_replace (self, trace)) {
         /* Append */
         const gchar *previous;
+        gchar *sequence;
 
-        previous = g_hash_table_lookup (self->priv->traces, trace_type);
-        if (previous) {
-            gchar *sequence;
-
-            /* Skip the trace if we already have it there */
-            if (strstr (previous, trace)) {
-                g_free (trace_type);
-                g_free (trace);
-                return TRUE;
-            }
-
-            sequence = g_strdup_printf ("%s%s%s",
-                                        previous,
-                                        g_str_has_suffix (previous, "\r\n") ? "" : "\r\n",
-                                        trace);
+        previous = entry->trace;
+
+        /* Skip the trace if we already have it there */
+        if (strstr (previous, trace)) {
+            g_free (trace_type);
             g_free (trace);
-            trace = sequence;
+            return TRUE;
         }
+
+        sequence = g_strdup_printf ("%s%s%s",
+                                    previous,
+                                    g_str_has_suffix (previous, "\r\n") ? "" : "\r\n",
+                                    trace);
+        g_free (trace);
+        trace = sequence;
+    }
+
+    if (entry)
+        g_free (trace_type);
+    else {
+        entry = g_slice_new0 (TraceEntry);
+        entry->index = self->priv->entries->len;
+        entry->offset = self->priv->snapshot->len;
+        g_ptr_array_add (self->priv->entries, entry);
+        g_hash_table_insert (self->priv->traces, trace_type, entry);
     }
 
-    g_hash_table_replace (self->priv->traces,
-                          trace_type,
-                          trace);
+    trace_entry_take_trace (self, entry, trace);
     return TRUE;
 }
 
@@ -147,22 +248,14 @@ const gchar *
 mm_location_gps_nmea_get_trace (MMLocationGpsNmea *self,
                                 const gchar *trace_type)
 {
-    return (const gchar *)g_hash_table_lookup (self->priv->traces, trace_type);
+    TraceEntry *entry;
+
+    entry = g_hash_table_lookup (self->priv->traces, trace_type);
+    return entry ? entry->trace : NULL;
 }
 
 /*****************************************************************************/
 
-static void
-build_full_foreach (const gchar *trace_type,
-                    const gchar *trace,
-                    GString **built)
-{
-    if ((*built)->len == 0 || g_str_has_suffix ((*built)->str, "\r\n"))
-        g_string_append (*built, trace);
-    else
-        g_string_append_printf (*built, "\r\n%s", trace);
-}
-
 /**
  * mm_location_gps_nmea_build_full:
  * @self: a #MMLocationGpsNmea.
@@ -177,33 +270,36 @@ build_full_foreach (const gchar *trace_type,
 gchar *
 mm_location_gps_nmea_build_full (MMLocationGpsNmea *self)
 {
-    GString *built;
-
-    built = g_string_new ("");
-    g_hash_table_foreach (self->priv->traces,
-                          (GHFunc)build_full_foreach,
-                          &built);
-    return g_string_free (built, FALSE);
+    return g_strndup (self->priv->snapshot->str, snapshot_get_len (self));
 }
 
 /*****************************************************************************/
 
 /**
  * mm_location_gps_nmea_get_string_variant: (skip)
+ * @self: a #MMLocationGpsNmea.
+ *
+ * Returns: (transfer full): a string #GVariant with all the NMEA traces. The
+ * returned value should be freed with g_variant_unref().
  */
 GVariant *
 mm_location_gps_nmea_get_string_variant (MMLocationGpsNmea *self)
 {
-    GVariant *variant = NULL;
-    gchar *built;
-
     g_return_val_if_fail (MM_IS_LOCATION_GPS_NMEA (self), NULL);
 
-    built = mm_location_gps_nmea_build_full (self);
-    variant = g_variant_new_string (built);
-    g_free (built);
+    /* Built only once for every set of changes in the traces */
+    if (!self->priv->variant) {
+        gsize len;
+        gchar saved;
+
+        len = snapshot_get_len (self);
+        saved = self->priv->snapshot->str[len];
+        self->priv->snapshot->str[len] = '\0';
+        self->priv->variant = g_variant_ref_sink (g_variant_new_string (self->priv->snapshot->str));
+        self->priv->snapshot->str[len] = saved;
+    }
 
-    return variant;
+    return g_variant_ref (self->priv->variant);
 }
 
 /*****************************************************************************/
@@ -274,7 +370,9 @@ mm_location_gps_nmea_init (MMLocationGpsNmea *self)
     self->priv->traces = g_hash_table_new_full (g_str_hash,
                                                 g_str_equal,
                                                 g_free,
-                                                g_free);
+                                                NULL);
+    self->priv->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) trace_entry_free);
+    self->priv->snapshot = g_string_new ("");
 }
 
 static void
@@ -283,6 +381,10 @@ finalize (GObject *object)
     MMLocationGpsNmea *self = MM_LOCATION_GPS_NMEA (object);
 
     g_hash_table_destroy (self->priv->traces);
+    g_ptr_array_unref (self->priv->entries);
+    g_string_free (self->priv->snapshot, TRUE);
+    if (self->priv->variant)
+        g_variant_unref (self->priv->variant);
     if (self->priv->sequence_regex)
         g_regex_unref (self->priv->sequence_regex);
 
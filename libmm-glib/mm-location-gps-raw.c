@@ -16,6 +16,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
+#include <errno.h>
 
 #include "mm-common-helpers.h"
 #include "mm-errors-types.h"
@@ -40,15 +41,19 @@ G_DEFINE_TYPE (MMLocationGpsRaw, mm_location_gps_raw, G_TYPE_OBJECT)
 #define PROPERTY_LATITUDE  "latitude"
 #define PROPERTY_LONGITUDE "longitude"
 #define PROPERTY_ALTITUDE  "altitude"
+#define PROPERTY_SPEED     "speed"
+#define PROPERTY_COURSE    "course"
 
 struct _MMLocationGpsRawPrivate {
-    GRegex   *gga_regex;
     gboolean  prefer_gngga;
+    gboolean  prefer_gnrmc;
 
     gchar   *utc_time;
     gdouble  latitude;
     gdouble  longitude;
     gdouble  altitude;
+    gdouble  speed;
+    gdouble  course;
 };
 
 /*****************************************************************************/
@@ -137,43 +142,249 @@ mm_location_gps_raw_get_altitude (MMLocationGpsRaw *self)
 
 /*****************************************************************************/
 
+/**
+ * mm_location_gps_raw_get_speed:
+ * @self: a #MMLocationGpsRaw.
+ *
+ * Gets the speed over ground, in knots.
+ *
+ * Returns: the speed, or %MM_LOCATION_SPEED_UNKNOWN if unknown.
+ *
+ * Since: 1.14
+ */
+gdouble
+mm_location_gps_raw_get_speed (MMLocationGpsRaw *self)
+{
+    g_return_val_if_fail (MM_IS_LOCATION_GPS_RAW (self),
+                          MM_LOCATION_SPEED_UNKNOWN);
+
+    return self->priv->speed;
+}
+
+/*****************************************************************************/
+
+/**
+ * mm_location_gps_raw_get_course:
+ * @self: a #MMLocationGpsRaw.
+ *
+ * Gets the course over ground, in degrees from true north.
+ *
+ * Returns: the course, or %MM_LOCATION_COURSE_UNKNOWN if unknown.
+ *
+ * Since: 1.14
+ */
+gdouble
+mm_location_gps_raw_get_course (MMLocationGpsRaw *self)
+{
+    g_return_val_if_fail (MM_IS_LOCATION_GPS_RAW (self),
+                          MM_LOCATION_COURSE_UNKNOWN);
+
+    return self->priv->course;
+}
+
+/*****************************************************************************/
+
+/* NMEA sentences are split in place into their comma separated fields, so
+ * that they can be parsed without allocating a string for each of them.
+ * Field 0 is the address (e.g. "GPGGA"), and the last field ends at the
+ * checksum delimiter or at the end of the trace. */
+
+#define NMEA_MAX_FIELDS 20
+
+typedef struct {
+    const gchar *str;
+    guint        len;
+} NmeaField;
+
+static guint
+nmea_split_fields (const gchar *trace,
+                   NmeaField   *fields)
+{
+    const gchar *p;
+    guint        n_fields = 0;
+
+    /* Skip the leading '$' */
+    p = trace + 1;
+    while (n_fields < NMEA_MAX_FIELDS) {
+        fields[n_fields].str = p;
+        while (*p && *p != ',' && *p != '*' && *p != '\r' && *p != '\n')
+            p++;
+        fields[n_fields].len = p - fields[n_fields].str;
+        n_fields++;
+        if (*p != ',')
+            break;
+        p++;
+    }
+
+    return n_fields;
+}
+
+/* Same as mm_get_double_from_str(), on a field which isn't NUL-terminated */
 static gboolean
-get_longitude_or_latitude_from_match_info (GMatchInfo *match_info,
-                                           guint32 match_index,
-                                           gdouble *out)
+nmea_field_get_double (const gchar *str,
+                       guint        len,
+                       gdouble     *out)
 {
-    gchar *aux;
-    gchar *s;
-    gboolean ret = FALSE;
-    gdouble minutes;
-    gdouble degrees;
+    gchar   buf[G_ASCII_DTOSTR_BUF_SIZE];
+    gdouble num;
+    guint   i;
 
-    s = g_match_info_fetch (match_info, match_index);
-    if (!s)
-        goto out;
+    if (!len || len >= sizeof (buf))
+        return FALSE;
+
+    for (i = 0; i < len; i++) {
+        if (str[i] != '-' &&
+            str[i] != '.' &&
+            !g_ascii_isdigit (str[i]))
+            return FALSE;
+    }
+
+    memcpy (buf, str, len);
+    buf[len] = '\0';
+
+    errno = 0;
+    num = strtod (buf, NULL);
+    if (errno)
+        return FALSE;
+
+    *out = num;
+    return TRUE;
+}
+
+static gboolean
+nmea_field_get_degrees (const NmeaField *field,
+                        gdouble         *out)
+{
+    const gchar *aux;
+    gdouble      minutes;
+    gdouble      degrees;
 
     /* 4533.35 is 45 degrees and 33.35 minutes */
 
-    aux = strchr (s, '.');
-    if (!aux || ((aux - s) < 3))
-        goto out;
+    aux = memchr (field->str, '.', field->len);
+    if (!aux || ((aux - field->str) < 3))
+        return FALSE;
 
     aux -= 2;
-    if (!mm_get_double_from_str (aux, &minutes))
-        goto out;
-
-    aux[0] = '\0';
-    if (!mm_get_double_from_str (s, &degrees))
-        goto out;
+    if (!nmea_field_get_double (aux, field->len - (aux - field->str), &minutes) ||
+        !nmea_field_get_double (field->str, aux - field->str, &degrees))
+        return FALSE;
 
     /* Include the minutes as part of the degrees */
     *out = degrees + (minutes / 60.0);
-    ret = TRUE;
+    return TRUE;
+}
+
+static void
+nmea_field_set_string (const NmeaField  *field,
+                       gchar           **str)
+{
+    /* Reuse the current string if it's of the same length, which is always
+     * the case with the fixed-format fields */
+    if (*str && strlen (*str) == field->len) {
+        memcpy (*str, field->str, field->len);
+        return;
+    }
+
+    g_free (*str);
+    *str = g_strndup (field->str, field->len);
+}
+
+/*
+ * $GPGGA,hhmmss.ss,llll.ll,a,yyyyy.yy,a,x,xx,x.x,x.x,M,x.x,M,x.x,xxxx*hh
+ * 1    = UTC of Position
+ * 2    = Latitude
+ * 3    = N or S
+ * 4    = Longitude
+ * 5    = E or W
+ * 6    = GPS quality indicator (0=invalid; 1=GPS fix; 2=Diff. GPS fix)
+ * 7    = Number of satellites in use [not those in view]
+ * 8    = Horizontal dilution of position
+ * 9    = Antenna altitude above/below mean sea level (geoid)
+ * 10   = Meters  (Antenna height unit)
+ * 11   = Geoidal separation (Diff. between WGS-84 earth ellipsoid and
+ *        mean sea level.  -=geoid is below WGS-84 ellipsoid)
+ * 12   = Meters  (Units of geoidal separation)
+ * 13   = Age in seconds since last update from diff. reference station
+ * 14   = Diff. reference station ID#
+ */
+#define GGA_N_FIELDS 15
+
+static void
+parse_gga (MMLocationGpsRaw *self,
+           const NmeaField  *fields,
+           guint             n_fields)
+{
+    if (n_fields < GGA_N_FIELDS)
+        return;
 
-out:
-    g_free (s);
+    /* UTC time */
+    nmea_field_set_string (&fields[1], &self->priv->utc_time);
 
-    return ret;
+    /* Latitude */
+    self->priv->latitude = MM_LOCATION_LATITUDE_UNKNOWN;
+    if (nmea_field_get_degrees (&fields[2], &self->priv->latitude)) {
+        /* N/S */
+        if (fields[3].len && fields[3].str[0] == 'S')
+            self->priv->latitude *= -1;
+    }
+
+    /* Longitude */
+    self->priv->longitude = MM_LOCATION_LONGITUDE_UNKNOWN;
+    if (nmea_field_get_degrees (&fields[4], &self->priv->longitude)) {
+        /* E/W */
+        if (fields[5].len && fields[5].str[0] == 'W')
+            self->priv->longitude *= -1;
+    }
+
+    /* Altitude */
+    self->priv->altitude = MM_LOCATION_ALTITUDE_UNKNOWN;
+    nmea_field_get_double (fields[9].str, fields[9].len, &self->priv->altitude);
+}
+
+/*
+ * $GPRMC,hhmmss.ss,A,llll.ll,a,yyyyy.yy,a,x.x,x.x,ddmmyy,x.x,a*hh
+ * 1    = UTC of Position
+ * 2    = Status (A=valid; V=warning)
+ * 3-6  = Latitude, N or S, Longitude, E or W
+ * 7    = Speed over ground, in knots
+ * 8    = Course over ground, in degrees from true north
+ * 9    = Date
+ * 10   = Magnetic variation
+ * 11   = E or W
+ *
+ * Position and time are taken from GGA traces, which also have the altitude.
+ */
+#define RMC_N_FIELDS 10
+
+static void
+parse_rmc (MMLocationGpsRaw *self,
+           const NmeaField  *fields,
+           guint             n_fields)
+{
+    if (n_fields < RMC_N_FIELDS)
+        return;
+
+    self->priv->speed = MM_LOCATION_SPEED_UNKNOWN;
+    self->priv->course = MM_LOCATION_COURSE_UNKNOWN;
+    if (fields[2].len != 1 || fields[2].str[0] != 'A')
+        return;
+
+    nmea_field_get_double (fields[7].str, fields[7].len, &self->priv->speed);
+    nmea_field_get_double (fields[8].str, fields[8].len, &self->priv->course);
+}
+
+/* GPS-only (GP) traces are ignored as soon as combined GNSS (GN) ones are
+ * received */
+static gboolean
+prefer_talker (const gchar *trace,
+               gboolean    *prefer_gn)
+{
+    if (trace[2] == 'N') {
+        *prefer_gn = TRUE;
+        return TRUE;
+    }
+    return !*prefer_gn;
 }
 
 /**
@@ -183,93 +394,43 @@ gboolean
 mm_location_gps_raw_add_trace (MMLocationGpsRaw *self,
                                const gchar *trace)
 {
-    GMatchInfo *match_info = NULL;
-
-    /* Current implementation works only with $GPGGA and $GNGGA traces */
-    do {
-        if (g_str_has_prefix (trace, "$GPGGA")) {
-            if (self->priv->prefer_gngga)
-                /* Ignore GPGGA, prefer GNGGA */
-                return FALSE;
-            break;
-        }
-        if (g_str_has_prefix (trace, "$GNGGA")) {
-            if (!self->priv->prefer_gngga)
-                self->priv->prefer_gngga = TRUE;
-            break;
-        }
-        /* Otherwise, ignore trace */
+    NmeaField fields[NMEA_MAX_FIELDS];
+    guint     n_fields;
+
+    /* Current implementation works only with $GPGGA/$GNGGA and $GPRMC/$GNRMC
+     * traces */
+    if (trace[0] != '$' || trace[1] != 'G' || (trace[2] != 'P' && trace[2] != 'N'))
         return FALSE;
-    } while (0);
-
-    /*
-     * $GPGGA,hhmmss.ss,llll.ll,a,yyyyy.yy,a,x,xx,x.x,x.x,M,x.x,M,x.x,xxxx*hh
-     * 1    = UTC of Position
-     * 2    = Latitude
-     * 3    = N or S
-     * 4    = Longitude
-     * 5    = E or W
-     * 6    = GPS quality indicator (0=invalid; 1=GPS fix; 2=Diff. GPS fix)
-     * 7    = Number of satellites in use [not those in view]
-     * 8    = Horizontal dilution of position
-     * 9    = Antenna altitude above/below mean sea level (geoid)
-     * 10   = Meters  (Antenna height unit)
-     * 11   = Geoidal separation (Diff. between WGS-84 earth ellipsoid and
-     *        mean sea level.  -=geoid is below WGS-84 ellipsoid)
-     * 12   = Meters  (Units of geoidal separation)
-     * 13   = Age in seconds since last update from diff. reference station
-     * 14   = Diff. reference station ID#
-     * 15   = Checksum
-     */
-    if (G_UNLIKELY (!self->priv->gga_regex))
-        self->priv->gga_regex = g_regex_new ("\\$G(?:P|N)GGA,(.*),(.*),(.*),(.*),(.*),(.*),(.*),(.*),(.*),(.*),(.*),(.*),(.*),(.*)\\*(.*).*",
-                                             G_REGEX_RAW | G_REGEX_OPTIMIZE,
-                                             0,
-                                             NULL);
-
-    if (g_regex_match (self->priv->gga_regex, trace, 0, &match_info)) {
-        /* UTC time */
-        g_free (self->priv->utc_time);
-        self->priv->utc_time = g_match_info_fetch (match_info, 1);
-
-        /* Latitude */
-        self->priv->latitude = MM_LOCATION_LATITUDE_UNKNOWN;
-        if (get_longitude_or_latitude_from_match_info (match_info, 2, &self->priv->latitude)) {
-            gchar *str;
-
-            /* N/S */
-            str = g_match_info_fetch (match_info, 3);
-            if (str && str[0] == 'S')
-                self->priv->latitude *= -1;
-            g_free (str);
-        }
-
-        /* Longitude */
-        self->priv->longitude = MM_LOCATION_LONGITUDE_UNKNOWN;
-        if (get_longitude_or_latitude_from_match_info (match_info, 4, &self->priv->longitude)) {
-            gchar *str;
-
-            /* N/S */
-            str = g_match_info_fetch (match_info, 5);
-            if (str && str[0] == 'W')
-                self->priv->longitude *= -1;
-            g_free (str);
-        }
-
-        /* Altitude */
-        self->priv->altitude = MM_LOCATION_ALTITUDE_UNKNOWN;
-        mm_get_double_from_match_info (match_info, 9, &self->priv->altitude);
+
+    if (strncmp (&trace[3], "GGA", 3) == 0) {
+        if (!prefer_talker (trace, &self->priv->prefer_gngga))
+            return FALSE;
+        n_fields = nmea_split_fields (trace, fields);
+        parse_gga (self, fields, n_fields);
+        return TRUE;
     }
 
-    g_match_info_free (match_info);
+    if (strncmp (&trace[3], "RMC", 3) == 0) {
+        if (!prefer_talker (trace, &self->priv->prefer_gnrmc))
+            return FALSE;
+        n_fields = nmea_split_fields (trace, fields);
+        parse_rmc (self, fields, n_fields);
+        return TRUE;
+    }
 
-    return TRUE;
+    /* Otherwise, ignore trace */
+    return FALSE;
 }
 
 /*****************************************************************************/
 
 /**
  * mm_location_gps_raw_get_dictionary: (skip)
+ * @self: a #MMLocationGpsRaw.
+ *
+ * Returns: (transfer full): a dictionary #GVariant with the GPS location, or
+ * %NULL if not available. The returned value should be freed with
+ * g_variant_unref().
  */
 GVariant *
 mm_location_gps_raw_get_dictionary (MMLocationGpsRaw *self)
@@ -309,6 +470,18 @@ mm_location_gps_raw_get_dictionary (MMLocationGpsRaw *self)
                                PROPERTY_ALTITUDE,
                                g_variant_new_double (self->priv->altitude));
 
+    /* Speed and course are optional */
+    if (self->priv->speed != MM_LOCATION_SPEED_UNKNOWN)
+        g_variant_builder_add (&builder,
+                               "{sv}",
+                               PROPERTY_SPEED,
+                               g_variant_new_double (self->priv->speed));
+    if (self->priv->course != MM_LOCATION_COURSE_UNKNOWN)
+        g_variant_builder_add (&builder,
+                               "{sv}",
+                               PROPERTY_COURSE,
+                               g_variant_new_double (self->priv->course));
+
     return g_variant_ref_sink (g_variant_builder_end (&builder));
 }
 
@@ -352,6 +525,10 @@ mm_location_gps_raw_new_from_dictionary (GVariant *dictionary,
             self->priv->latitude = g_variant_get_double (value);
         else if (g_str_equal (key, PROPERTY_ALTITUDE))
             self->priv->altitude = g_variant_get_double (value);
+        else if (g_str_equal (key, PROPERTY_SPEED))
+            self->priv->speed = g_variant_get_double (value);
+        else if (g_str_equal (key, PROPERTY_COURSE))
+            self->priv->course = g_variant_get_double (value);
         g_free (key);
         g_variant_unref (value);
     }
@@ -398,6 +575,8 @@ mm_location_gps_raw_init (MMLocationGpsRaw *self)
     self->priv->latitude = MM_LOCATION_LATITUDE_UNKNOWN;
     self->priv->longitude = MM_LOCATION_LONGITUDE_UNKNOWN;
     self->priv->altitude = MM_LOCATION_ALTITUDE_UNKNOWN;
+    self->priv->speed = MM_LOCATION_SPEED_UNKNOWN;
+    self->priv->course = MM_LOCATION_COURSE_UNKNOWN;
 }
 
 static void
@@ -405,9 +584,6 @@ finalize (GObject *object)
 {
     MMLocationGpsRaw *self = MM_LOCATION_GPS_RAW (object);
 
-    if (self->priv->gga_regex)
-        g_regex_unref (self->priv->gga_regex);
-
     g_free (self->priv->utc_time);
 
     G_OBJECT_CLASS (mm_location_gps_raw_parent_class)->finalize (object);
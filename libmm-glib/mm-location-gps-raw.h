@@ -65,6 +65,8 @@ const gchar *mm_location_gps_raw_get_utc_time  (MMLocationGpsRaw *self);
 gdouble      mm_location_gps_raw_get_longitude (MMLocationGpsRaw *self);
 gdouble      mm_location_gps_raw_get_latitude  (MMLocationGpsRaw *self);
 gdouble      mm_location_gps_raw_get_altitude  (MMLocationGpsRaw *self);
+gdouble      mm_location_gps_raw_get_speed     (MMLocationGpsRaw *self);
+gdouble      mm_location_gps_raw_get_course    (MMLocationGpsRaw *self);
 
 /*****************************************************************************/
 /* ModemManager/libmm-glib/mmcli specific methods */
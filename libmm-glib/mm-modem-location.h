@@ -88,7 +88,8 @@ gchar       *mm_modem_location_dup_supl_server (MMModemLocation *self);
 const gchar **mm_modem_location_get_assistance_data_servers (MMModemLocation *self);
 gchar       **mm_modem_location_dup_assistance_data_servers (MMModemLocation *self);
 
-guint mm_modem_location_get_gps_refresh_rate (MMModemLocation *self);
+guint mm_modem_location_get_gps_refresh_rate    (MMModemLocation *self);
+guint mm_modem_location_get_gps_refresh_rate_ms (MMModemLocation *self);
 
 void     mm_modem_location_setup        (MMModemLocation *self,
                                          MMModemLocationSource sources,
@@ -146,6 +147,19 @@ gboolean mm_modem_location_set_gps_refresh_rate_sync   (MMModemLocation *self,
                                                         GCancellable *cancellable,
                                                         GError **error);
 
+void     mm_modem_location_set_gps_refresh_rate_ms        (MMModemLocation *self,
+                                                           guint rate,
+                                                           GCancellable *cancellable,
+                                                           GAsyncReadyCallback callback,
+                                                           gpointer user_data);
+gboolean mm_modem_location_set_gps_refresh_rate_ms_finish (MMModemLocation *self,
+                                                           GAsyncResult *res,
+                                                           GError **error);
+gboolean mm_modem_location_set_gps_refresh_rate_ms_sync   (MMModemLocation *self,
+                                                           guint rate,
+                                                           GCancellable *cancellable,
+                                                           GError **error);
+
 void            mm_modem_location_get_3gpp        (MMModemLocation *self,
                                                    GCancellable *cancellable,
                                                    GAsyncReadyCallback callback,
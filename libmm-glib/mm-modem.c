@@ -2841,6 +2841,104 @@ mm_modem_command_sync (MMModem *self,
 
 /*****************************************************************************/
 
+/**
+ * mm_modem_get_port_statistics_finish:
+ * @self: A #MMModem.
+ * @res: The #GAsyncResult obtained from the #GAsyncReadyCallback passed to
+ *  mm_modem_get_port_statistics().
+ * @error: Return location for error or %NULL.
+ *
+ * Finishes an operation started with mm_modem_get_port_statistics().
+ *
+ * Returns: (transfer full): A #GVariant of type <literal>aa{sv}</literal> with
+ * the statistics of each port, or #NULL if @error is set. The returned value
+ * should be freed with g_variant_unref().
+ *
+ * Since: 1.14
+ */
+GVariant *
+mm_modem_get_port_statistics_finish (MMModem *self,
+                                     GAsyncResult *res,
+                                     GError **error)
+{
+    GVariant *result;
+
+    g_return_val_if_fail (MM_IS_MODEM (self), NULL);
+
+    if (!mm_gdbus_modem_call_get_port_statistics_finish (MM_GDBUS_MODEM (self), &result, res, error))
+        return NULL;
+
+    return result;
+}
+
+/**
+ * mm_modem_get_port_statistics:
+ * @self: A #MMModem.
+ * @cancellable: (allow-none): A #GCancellable or %NULL.
+ * @callback: A #GAsyncReadyCallback to call when the request is satisfied or
+ *  %NULL.
+ * @user_data: User data to pass to @callback.
+ *
+ * Asynchronously gets the traffic statistics of each of the ports of the
+ * modem, as explained in the <literal>GetPortStatistics()</literal> method of
+ * the <literal>org.freedesktop.ModemManager1.Modem</literal> interface.
+ *
+ * When the operation is finished, @callback will be invoked in the
+ * <link linkend="g-main-context-push-thread-default">thread-default main loop</link>
+ * of the thread you are calling this method from. You can then call
+ * mm_modem_get_port_statistics_finish() to get the result of the operation.
+ *
+ * See mm_modem_get_port_statistics_sync() for the synchronous, blocking
+ * version of this method.
+ *
+ * Since: 1.14
+ */
+void
+mm_modem_get_port_statistics (MMModem *self,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data)
+{
+    g_return_if_fail (MM_IS_MODEM (self));
+
+    mm_gdbus_modem_call_get_port_statistics (MM_GDBUS_MODEM (self), cancellable, callback, user_data);
+}
+
+/**
+ * mm_modem_get_port_statistics_sync:
+ * @self: A #MMModem.
+ * @cancellable: (allow-none): A #GCancellable or %NULL.
+ * @error: Return location for error or %NULL.
+ *
+ * Synchronously gets the traffic statistics of each of the ports of the
+ * modem.
+ *
+ * The calling thread is blocked until a reply is received. See
+ * mm_modem_get_port_statistics() for the asynchronous version of this method.
+ *
+ * Returns: (transfer full): A #GVariant of type <literal>aa{sv}</literal> with
+ * the statistics of each port, or #NULL if @error is set. The returned value
+ * should be freed with g_variant_unref().
+ *
+ * Since: 1.14
+ */
+GVariant *
+mm_modem_get_port_statistics_sync (MMModem *self,
+                                   GCancellable *cancellable,
+                                   GError **error)
+{
+    GVariant *result;
+
+    g_return_val_if_fail (MM_IS_MODEM (self), NULL);
+
+    if (!mm_gdbus_modem_call_get_port_statistics_sync (MM_GDBUS_MODEM (self), &result, cancellable, error))
+        return NULL;
+
+    return result;
+}
+
+/*****************************************************************************/
+
 /**
  * mm_modem_set_power_state_finish:
  * @self: A #MMModem.
@@ -0,0 +1,131 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <glib.h>
+#include <libmm-glib.h>
+#include <string.h>
+
+#define GPGGA   "$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76\r\n"
+#define GPGGA_2 "$GPGGA,092751.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*77\r\n"
+#define GPRMC   "$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43\r\n"
+#define GPGSV_1 "$GPGSV,3,1,11,10,63,137,17,07,61,098,15,05,59,290,20,08,54,157,30*70\r\n"
+#define GPGSV_2 "$GPGSV,3,2,11,02,39,223,19,13,28,070,17,26,23,252,,04,14,186,14*79\r\n"
+#define GPGSV_3 "$GPGSV,3,3,11,29,09,301,24,16,09,020,,36,,,*76\r\n"
+#define GPVTG   "$GPVTG,31.66,T,,M,0.02,N,0.04,K,A*09\r\n"
+
+static void
+check_snapshot (MMLocationGpsNmea *location,
+                const gchar       *expected)
+{
+    GVariant *variant;
+    gchar    *built;
+
+    built = mm_location_gps_nmea_build_full (location);
+    g_assert_cmpstr (built, ==, expected);
+    g_free (built);
+
+    variant = mm_location_gps_nmea_get_string_variant (location);
+    g_assert_cmpstr (g_variant_get_string (variant, NULL), ==, expected);
+    g_variant_unref (variant);
+}
+
+static void
+test_snapshot (void)
+{
+    MMLocationGpsNmea *location;
+    GVariant          *variant;
+    GVariant          *other;
+
+    location = mm_location_gps_nmea_new ();
+    check_snapshot (location, "");
+
+    g_assert (mm_location_gps_nmea_add_trace (location, GPGGA));
+    g_assert (mm_location_gps_nmea_add_trace (location, GPGSV_1));
+    g_assert (mm_location_gps_nmea_add_trace (location, GPRMC));
+    check_snapshot (location, GPGGA GPGSV_1 GPRMC);
+
+    /* Sequences are appended, and the next traces moved */
+    g_assert (mm_location_gps_nmea_add_trace (location, GPGSV_2));
+    g_assert (mm_location_gps_nmea_add_trace (location, GPGSV_3));
+    g_assert (mm_location_gps_nmea_add_trace (location, GPGSV_3));
+    check_snapshot (location, GPGGA GPGSV_1 GPGSV_2 GPGSV_3 GPRMC);
+    g_assert_cmpstr (mm_location_gps_nmea_get_trace (location, "$GPGSV"), ==, GPGSV_1 GPGSV_2 GPGSV_3);
+
+    /* A new sequence replaces the previous one */
+    g_assert (mm_location_gps_nmea_add_trace (location, GPGSV_1));
+    check_snapshot (location, GPGGA GPGSV_1 GPRMC);
+
+    /* Traces of the same length are replaced in place */
+    g_assert (mm_location_gps_nmea_add_trace (location, GPGGA_2));
+    g_assert (mm_location_gps_nmea_add_trace (location, GPVTG));
+    check_snapshot (location, GPGGA_2 GPGSV_1 GPRMC GPVTG);
+    g_assert_cmpstr (mm_location_gps_nmea_get_trace (location, "$GPGGA"), ==, GPGGA_2);
+
+    /* The same variant is given until the traces change */
+    variant = mm_location_gps_nmea_get_string_variant (location);
+    other = mm_location_gps_nmea_get_string_variant (location);
+    g_assert (variant == other);
+    g_variant_unref (other);
+    g_assert (mm_location_gps_nmea_add_trace (location, GPVTG));
+    other = mm_location_gps_nmea_get_string_variant (location);
+    g_assert (variant == other);
+    g_variant_unref (other);
+    g_assert (mm_location_gps_nmea_add_trace (location, GPGGA));
+    other = mm_location_gps_nmea_get_string_variant (location);
+    g_assert (variant != other);
+    g_assert_cmpstr (g_variant_get_string (other, NULL), ==, GPGGA GPGSV_1 GPRMC GPVTG);
+    g_variant_unref (other);
+    g_variant_unref (variant);
+
+    g_object_unref (location);
+}
+
+static void
+test_string_variant (void)
+{
+    MMLocationGpsNmea *location;
+    MMLocationGpsNmea *copy;
+    GVariant          *variant;
+    GError            *error = NULL;
+
+    location = mm_location_gps_nmea_new ();
+    g_assert (mm_location_gps_nmea_add_trace (location, GPGGA));
+    g_assert (mm_location_gps_nmea_add_trace (location, GPRMC));
+    variant = mm_location_gps_nmea_get_string_variant (location);
+
+    /* Traces split from the string have no <CR><LF>, and the last one
+     * isn't given with it */
+    copy = mm_location_gps_nmea_new_from_string_variant (variant, &error);
+    g_assert_no_error (error);
+    g_assert_cmpstr (mm_location_gps_nmea_get_trace (copy, "$GPRMC"), ==,
+                     "$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43");
+    check_snapshot (copy,
+                    "$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76\r\n"
+                    "$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43");
+
+    g_object_unref (copy);
+    g_variant_unref (variant);
+    g_object_unref (location);
+}
+
+/**************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/LocationGpsNmea/snapshot",       test_snapshot);
+    g_test_add_func ("/MM/LocationGpsNmea/string-variant", test_string_variant);
+
+    return g_test_run ();
+}
@@ -0,0 +1,144 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <glib.h>
+#include <libmm-glib.h>
+#include <string.h>
+
+#define GPGGA "$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76\r\n"
+#define GNGGA "$GNGGA,092751.000,5321.6803,S,00630.3373,E,1,8,1.03,,M,55.2,M,,*78\r\n"
+#define GPRMC "$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43\r\n"
+#define GPRMC_VOID "$GPRMC,092750.000,V,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*54\r\n"
+#define GPGSA "$GPGSA,A,3,10,07,05,02,29,04,08,13,,,,,1.72,1.03,1.38*0A\r\n"
+
+static void
+check_dictionary (MMLocationGpsRaw *location)
+{
+    GVariantBuilder   builder;
+    GVariant         *expected;
+    GVariant         *dictionary;
+    MMLocationGpsRaw *copy;
+    GError           *error = NULL;
+
+    /* Same keys, in the same order as the ones always given */
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+    g_variant_builder_add (&builder, "{sv}", "utc-time",  g_variant_new_string (mm_location_gps_raw_get_utc_time (location)));
+    g_variant_builder_add (&builder, "{sv}", "longitude", g_variant_new_double (mm_location_gps_raw_get_longitude (location)));
+    g_variant_builder_add (&builder, "{sv}", "latitude",  g_variant_new_double (mm_location_gps_raw_get_latitude (location)));
+    if (mm_location_gps_raw_get_altitude (location) != MM_LOCATION_ALTITUDE_UNKNOWN)
+        g_variant_builder_add (&builder, "{sv}", "altitude", g_variant_new_double (mm_location_gps_raw_get_altitude (location)));
+    if (mm_location_gps_raw_get_speed (location) != MM_LOCATION_SPEED_UNKNOWN)
+        g_variant_builder_add (&builder, "{sv}", "speed", g_variant_new_double (mm_location_gps_raw_get_speed (location)));
+    if (mm_location_gps_raw_get_course (location) != MM_LOCATION_COURSE_UNKNOWN)
+        g_variant_builder_add (&builder, "{sv}", "course", g_variant_new_double (mm_location_gps_raw_get_course (location)));
+    expected = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+    dictionary = mm_location_gps_raw_get_dictionary (location);
+    g_assert (dictionary);
+    g_assert (g_variant_equal (dictionary, expected));
+
+    copy = mm_location_gps_raw_new_from_dictionary (dictionary, &error);
+    g_assert_no_error (error);
+    g_assert_cmpstr (mm_location_gps_raw_get_utc_time (copy), ==, mm_location_gps_raw_get_utc_time (location));
+    g_assert_cmpfloat (mm_location_gps_raw_get_latitude (copy),  ==, mm_location_gps_raw_get_latitude (location));
+    g_assert_cmpfloat (mm_location_gps_raw_get_longitude (copy), ==, mm_location_gps_raw_get_longitude (location));
+    g_assert_cmpfloat (mm_location_gps_raw_get_altitude (copy),  ==, mm_location_gps_raw_get_altitude (location));
+    g_assert_cmpfloat (mm_location_gps_raw_get_speed (copy),     ==, mm_location_gps_raw_get_speed (location));
+    g_assert_cmpfloat (mm_location_gps_raw_get_course (copy),    ==, mm_location_gps_raw_get_course (location));
+
+    g_object_unref (copy);
+    g_variant_unref (dictionary);
+    g_variant_unref (expected);
+}
+
+static void
+test_gga (void)
+{
+    MMLocationGpsRaw *location;
+
+    location = mm_location_gps_raw_new ();
+    g_assert (mm_location_gps_raw_get_dictionary (location) == NULL);
+
+    g_assert (mm_location_gps_raw_add_trace (location, GPGGA));
+    g_assert_cmpstr (mm_location_gps_raw_get_utc_time (location), ==, "092750.000");
+    g_assert_cmpfloat (mm_location_gps_raw_get_latitude (location),  ==, 53.0 + 21.6802 / 60.0);
+    g_assert_cmpfloat (mm_location_gps_raw_get_longitude (location), ==, -(6.0 + 30.3372 / 60.0));
+    g_assert_cmpfloat (mm_location_gps_raw_get_altitude (location),  ==, 61.7);
+    g_assert_cmpfloat (mm_location_gps_raw_get_speed (location),     ==, MM_LOCATION_SPEED_UNKNOWN);
+    g_assert_cmpfloat (mm_location_gps_raw_get_course (location),    ==, MM_LOCATION_COURSE_UNKNOWN);
+    check_dictionary (location);
+
+    /* Once GNSS traces are found, GPS ones are ignored */
+    g_assert (mm_location_gps_raw_add_trace (location, GNGGA));
+    g_assert (!mm_location_gps_raw_add_trace (location, GPGGA));
+    g_assert_cmpstr (mm_location_gps_raw_get_utc_time (location), ==, "092751.000");
+    g_assert_cmpfloat (mm_location_gps_raw_get_latitude (location),  ==, -(53.0 + 21.6803 / 60.0));
+    g_assert_cmpfloat (mm_location_gps_raw_get_longitude (location), ==, 6.0 + 30.3373 / 60.0);
+    g_assert_cmpfloat (mm_location_gps_raw_get_altitude (location),  ==, MM_LOCATION_ALTITUDE_UNKNOWN);
+    check_dictionary (location);
+
+    g_object_unref (location);
+}
+
+static void
+test_rmc (void)
+{
+    MMLocationGpsRaw *location;
+
+    location = mm_location_gps_raw_new ();
+
+    /* Speed and course alone aren't a location */
+    g_assert (mm_location_gps_raw_add_trace (location, GPRMC));
+    g_assert_cmpfloat (mm_location_gps_raw_get_speed (location),  ==, 0.02);
+    g_assert_cmpfloat (mm_location_gps_raw_get_course (location), ==, 31.66);
+    g_assert (mm_location_gps_raw_get_utc_time (location) == NULL);
+    g_assert (mm_location_gps_raw_get_dictionary (location) == NULL);
+
+    g_assert (mm_location_gps_raw_add_trace (location, GPGGA));
+    check_dictionary (location);
+
+    /* No speed and course when the fix isn't valid */
+    g_assert (mm_location_gps_raw_add_trace (location, GPRMC_VOID));
+    g_assert_cmpfloat (mm_location_gps_raw_get_speed (location),  ==, MM_LOCATION_SPEED_UNKNOWN);
+    g_assert_cmpfloat (mm_location_gps_raw_get_course (location), ==, MM_LOCATION_COURSE_UNKNOWN);
+    check_dictionary (location);
+
+    g_object_unref (location);
+}
+
+static void
+test_ignored (void)
+{
+    MMLocationGpsRaw *location;
+
+    location = mm_location_gps_raw_new ();
+    g_assert (!mm_location_gps_raw_add_trace (location, GPGSA));
+    g_assert (!mm_location_gps_raw_add_trace (location, "$GPGSV,3,1,11,10,63,137,17,07,61,098,15,05,59,290,20,08,54,157,30*70\r\n"));
+    g_assert (!mm_location_gps_raw_add_trace (location, "garbage"));
+    g_assert (!mm_location_gps_raw_add_trace (location, ""));
+    g_assert (mm_location_gps_raw_get_dictionary (location) == NULL);
+    g_object_unref (location);
+}
+
+/**************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/LocationGpsRaw/gga",     test_gga);
+    g_test_add_func ("/MM/LocationGpsRaw/rmc",     test_rmc);
+    g_test_add_func ("/MM/LocationGpsRaw/ignored", test_ignored);
+
+    return g_test_run ();
+}
@@ -63,3 +63,64 @@ test_crc16_1 (void *f, void *data)
     g_assert (crc == expected);
 }
 
+static guint16
+crc16_bytewise (const char *buf, gsize len)
+{
+    guint16 crc = 0xffff;
+    guint i;
+
+    /* Reflected CCITT polynomial, one bit at a time */
+    while (len--) {
+        crc ^= (guint8) *buf++;
+        for (i = 0; i < 8; i++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : (crc >> 1);
+    }
+    return ~crc;
+}
+
+void
+test_crc16_lengths (void *f, void *data)
+{
+    char buf[80];
+    gsize offset, len, i;
+
+    /* Data is processed in 8-byte blocks, so check every length around the
+     * block size, starting at every alignment */
+    for (i = 0; i < sizeof (buf); i++)
+        buf[i] = (i * 37 + 11) & 0xff;
+
+    for (offset = 0; offset < 8; offset++) {
+        for (len = 0; len <= sizeof (buf) - offset; len++)
+            g_assert_cmpuint (dm_crc16 (&buf[offset], len), ==, crc16_bytewise (&buf[offset], len));
+    }
+}
+
+void
+test_crc16_throughput (void *f, void *data)
+{
+    char *buf;
+    gsize buf_len = 64 * 1024;
+    guint iterations = 2000;
+    guint16 crc = 0;
+    gsize i;
+    GTimer *timer;
+
+    if (!g_test_perf ())
+        return;
+
+    buf = g_malloc (buf_len);
+    for (i = 0; i < buf_len; i++)
+        buf[i] = i & 0xff;
+
+    timer = g_timer_new ();
+    for (i = 0; i < iterations; i++)
+        crc = dm_crc16 (buf, buf_len);
+    g_test_maximized_result ((buf_len * iterations) / g_timer_elapsed (timer, NULL) / (1024 * 1024),
+                             "crc16: %.1f MB/s",
+                             (buf_len * iterations) / g_timer_elapsed (timer, NULL) / (1024 * 1024));
+
+    g_assert_cmpuint (crc, ==, crc16_bytewise (buf, buf_len));
+
+    g_timer_destroy (timer);
+    g_free (buf);
+}
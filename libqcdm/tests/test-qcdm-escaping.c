@@ -122,3 +122,86 @@ test_escape_unescape (void *f, void *data)
     g_assert (memcmp (unescaped, data1, unlen) == 0);
 }
 
+void
+test_escape_unescape_boundaries (void *f, void *data)
+{
+    char buf[40];
+    char escaped[2 * sizeof (buf) + 1];
+    char unescaped[sizeof (escaped)];
+    gsize len, unlen, split, i, pos;
+    qcdmbool escaping;
+
+    /* Place a byte needing escaping at every position around the word size
+     * boundaries, and unescape the result split at every offset, so that the
+     * escape sequence is also found split between calls.
+     */
+    for (i = 0; i < sizeof (buf); i++)
+        buf[i] = 0x40 + i;
+
+    for (pos = 0; pos < sizeof (buf); pos++) {
+        buf[pos] = (pos % 2) ? 0x7e : 0x7d;
+
+        len = dm_escape (buf, sizeof (buf), escaped, sizeof (escaped));
+        g_assert_cmpuint (len, ==, sizeof (buf) + 1);
+        g_assert (memcmp (escaped, buf, pos) == 0);
+        g_assert (escaped[pos] == 0x7d);
+        g_assert (escaped[pos + 1] == (buf[pos] ^ 0x20));
+        g_assert (memcmp (&escaped[pos + 2], &buf[pos + 1], sizeof (buf) - pos - 1) == 0);
+
+        for (split = 1; split < len; split++) {
+            escaping = FALSE;
+            unlen = dm_unescape (escaped, split, unescaped, sizeof (unescaped), &escaping);
+            g_assert (escaping == (split == pos + 1));
+            unlen += dm_unescape (&escaped[split], len - split, &unescaped[unlen], sizeof (unescaped) - unlen, &escaping);
+            g_assert (!escaping);
+            g_assert_cmpuint (unlen, ==, sizeof (buf));
+            g_assert (memcmp (unescaped, buf, unlen) == 0);
+        }
+
+        buf[pos] = 0x40 + pos;
+    }
+}
+
+void
+test_escape_unescape_throughput (void *f, void *data)
+{
+    char *buf, *escaped, *unescaped;
+    gsize buf_len = 64 * 1024;
+    gsize len = 0, unlen = 0, i;
+    guint iterations = 2000;
+    qcdmbool escaping = FALSE;
+    GTimer *timer;
+
+    if (!g_test_perf ())
+        return;
+
+    /* Mostly clean data, with a byte needing escaping once in a while, as
+     * found in log packets */
+    buf = g_malloc (buf_len);
+    escaped = g_malloc (2 * buf_len + 1);
+    unescaped = g_malloc (2 * buf_len + 1);
+    for (i = 0; i < buf_len; i++)
+        buf[i] = (i % 97 == 0) ? 0x7e : (i & 0x3f);
+
+    timer = g_timer_new ();
+    for (i = 0; i < iterations; i++)
+        len = dm_escape (buf, buf_len, escaped, 2 * buf_len + 1);
+    g_test_maximized_result ((buf_len * iterations) / g_timer_elapsed (timer, NULL) / (1024 * 1024),
+                             "escape: %.1f MB/s",
+                             (buf_len * iterations) / g_timer_elapsed (timer, NULL) / (1024 * 1024));
+
+    g_timer_start (timer);
+    for (i = 0; i < iterations; i++)
+        unlen = dm_unescape (escaped, len, unescaped, 2 * buf_len + 1, &escaping);
+    g_test_maximized_result ((len * iterations) / g_timer_elapsed (timer, NULL) / (1024 * 1024),
+                             "unescape: %.1f MB/s",
+                             (len * iterations) / g_timer_elapsed (timer, NULL) / (1024 * 1024));
+
+    g_assert_cmpuint (unlen, ==, buf_len);
+    g_assert (memcmp (unescaped, buf, buf_len) == 0);
+
+    g_timer_destroy (timer);
+    g_free (unescaped);
+    g_free (escaped);
+    g_free (buf);
+}
@@ -1263,6 +1263,7 @@ gps_enabled_ready (MMBaseModem *self,
                                     buf,
                                     3,
                                     FALSE, /* never cached */
+                                    0,
                                     FALSE, /* always queued last */
                                     NULL,
                                     NULL,
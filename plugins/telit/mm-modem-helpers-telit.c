@@ -554,7 +554,7 @@ common_parse_bnd_response (const gchar    *response,
         [LOAD_BANDS_TYPE_CURRENT]   = "#BND:\\s*(?P<Bands2G>\\d+)(,\\s*(?P<Bands3G>\\d+))?(,\\s*(?P<Bands4G>\\d+))?",
     };
 
-    r = g_regex_new (load_bands_regex[load_type], G_REGEX_RAW, 0, NULL);
+    r = mm_regex_cache_get (load_bands_regex[load_type], G_REGEX_RAW, 0, NULL);
     g_assert (r);
 
     if (!g_regex_match (r, response, 0, &match_info)) {
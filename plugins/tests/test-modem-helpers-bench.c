@@ -0,0 +1,169 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <stdarg.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <ModemManager.h>
+#define _LIBMM_INSIDE_MM
+#include <libmm-glib.h>
+
+#include "mm-log.h"
+#include "mm-modem-helpers.h"
+#include "mm-modem-helpers-huawei.h"
+#include "mm-modem-helpers-cinterion.h"
+#include "mm-modem-helpers-ublox.h"
+#include "mm-modem-helpers-xmm.h"
+#include "test-bench.h"
+
+/* Sample responses, taken from the plugin test fixtures */
+
+/*****************************************************************************/
+/* Huawei */
+
+static void
+bench_huawei_sysinfoex (gconstpointer data)
+{
+    guint srv_status;
+    guint srv_domain;
+    guint roam_status;
+    guint sim_state;
+    guint sys_mode;
+    guint sys_submode;
+
+    g_assert (mm_huawei_parse_sysinfoex_response ((const gchar *) data,
+                                                  &srv_status, &srv_domain, &roam_status,
+                                                  &sim_state, &sys_mode, &sys_submode,
+                                                  NULL));
+}
+
+static void
+bench_huawei_hcsq (gconstpointer data)
+{
+    MMModemAccessTechnology act;
+    guint                   value1;
+    guint                   value2;
+    guint                   value3;
+    guint                   value4;
+    guint                   value5;
+
+    g_assert (mm_huawei_parse_hcsq_response ((const gchar *) data,
+                                             &act, &value1, &value2, &value3, &value4, &value5,
+                                             NULL));
+}
+
+static void
+bench_huawei_nwtime (gconstpointer data)
+{
+    gchar             *iso8601 = NULL;
+    MMNetworkTimezone *tz = NULL;
+
+    g_assert (mm_huawei_parse_nwtime_response ((const gchar *) data, &iso8601, &tz, NULL));
+    g_free (iso8601);
+    g_object_unref (tz);
+}
+
+/*****************************************************************************/
+/* Cinterion */
+
+static void
+bench_cinterion_swwan (gconstpointer data)
+{
+    g_assert_cmpuint (mm_cinterion_parse_swwan_response ((const gchar *) data, 3, NULL), ==,
+                      MM_BEARER_CONNECTION_STATUS_CONNECTED);
+}
+
+static void
+bench_cinterion_sind (gconstpointer data)
+{
+    gchar *description = NULL;
+    guint  mode;
+    guint  value;
+
+    g_assert (mm_cinterion_parse_sind_response ((const gchar *) data, &description, &mode, &value, NULL));
+    g_free (description);
+}
+
+/*****************************************************************************/
+/* u-blox */
+
+static void
+bench_ublox_uact (gconstpointer data)
+{
+    GArray *bands;
+
+    bands = mm_ublox_parse_uact_response ((const gchar *) data, NULL);
+    g_assert (bands);
+    g_array_unref (bands);
+}
+
+/*****************************************************************************/
+/* XMM */
+
+static void
+bench_xmm_xcesq (gconstpointer data)
+{
+    guint rxlev;
+    guint ber;
+    guint rscp;
+    guint ecn0;
+    guint rsrq;
+    guint rsrp;
+    gint  rssnr;
+
+    g_assert (mm_xmm_parse_xcesq_query_response ((const gchar *) data,
+                                                 &rxlev, &ber, &rscp, &ecn0, &rsrq, &rsrp, &rssnr,
+                                                 NULL));
+}
+
+/*****************************************************************************/
+
+void
+_mm_log (const char *loc,
+         const char *func,
+         guint32 level,
+         const char *fmt,
+         ...)
+{
+    va_list args;
+    gchar *msg;
+
+    if (!g_test_verbose ())
+        return;
+
+    va_start (args, fmt);
+    msg = g_strdup_vprintf (fmt, args);
+    va_end (args);
+    g_print ("%s\n", msg);
+    g_free (msg);
+}
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    mm_test_bench_add ("/MM/bench/huawei/sysinfoex", bench_huawei_sysinfoex, "^SYSINFOEX: 2,4,5,1,0,3,\"WCDMA\",41,\"HSPA+\"");
+    mm_test_bench_add ("/MM/bench/huawei/hcsq",      bench_huawei_hcsq,      "^HCSQ:\"LTE\",30,19,66,0\r\n");
+    mm_test_bench_add ("/MM/bench/huawei/nwtime",    bench_huawei_nwtime,    "^NWTIME: 14/08/05,04:00:21+40,00");
+
+    mm_test_bench_add ("/MM/bench/cinterion/swwan",  bench_cinterion_swwan,  "^SWWAN: 3,1\r\n");
+    mm_test_bench_add ("/MM/bench/cinterion/sind",   bench_cinterion_sind,   "^SIND: simstatus,1,5");
+
+    mm_test_bench_add ("/MM/bench/ublox/uact",       bench_ublox_uact,       "+UACT: ,,,900,1800,1900,850\r\n");
+
+    mm_test_bench_add ("/MM/bench/xmm/xcesq",        bench_xmm_xcesq,        "+XCESQ: 0,99,99,255,255,19,46,32");
+
+    return g_test_run ();
+}
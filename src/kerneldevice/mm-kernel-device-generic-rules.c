@@ -27,16 +27,49 @@
 #include "mm-log.h"
 #include "mm-kernel-device-generic-rules.h"
 
+/* Blocks of rules requiring a vendor id shorter than this aren't indexed */
+#define MIN_VENDOR_INDEX_RULES 4
+
+struct _MMUdevRuleVendorIndex {
+    volatile gint  ref_count;
+    /* First rule after the block */
+    guint          end;
+    /* Vendor id -> GArray of indices of the rules requiring it */
+    GHashTable    *rules;
+};
+
+static MMUdevRuleVendorIndex *
+vendor_index_ref (MMUdevRuleVendorIndex *vendor_index)
+{
+    g_atomic_int_inc (&vendor_index->ref_count);
+    return vendor_index;
+}
+
+static void
+vendor_index_unref (MMUdevRuleVendorIndex *vendor_index)
+{
+    if (g_atomic_int_dec_and_test (&vendor_index->ref_count)) {
+        g_hash_table_unref (vendor_index->rules);
+        g_slice_free (MMUdevRuleVendorIndex, vendor_index);
+    }
+}
+
 static void
 udev_rule_match_clear (MMUdevRuleMatch *rule_match)
 {
     g_free (rule_match->parameter);
     g_free (rule_match->value);
+    g_free (rule_match->property);
+    g_free (rule_match->pattern.str);
+    g_free (rule_match->prefix_pattern.str);
 }
 
 static void
 udev_rule_clear (MMUdevRule *rule)
 {
+    if (rule->vendor_index)
+        vendor_index_unref (rule->vendor_index);
+
     switch (rule->result.type) {
     case MM_UDEV_RULE_RESULT_TYPE_PROPERTY:
         g_free (rule->result.content.property.name);
@@ -152,6 +185,14 @@ load_rule_result (MMUdevRuleResult  *rule_result,
     if (g_str_has_prefix (left, "ENV{") && left[left_len - 1] == '}') {
         rule_result->type = MM_UDEV_RULE_RESULT_TYPE_PROPERTY;
         rule_result->content.property.name = g_strndup (left + 4, left_len - 5);
+        if (g_str_equal (right, "$attr{bInterfaceClass}"))
+            rule_result->content.property.attribute = MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_CLASS;
+        else if (g_str_equal (right, "$attr{bInterfaceSubClass}"))
+            rule_result->content.property.attribute = MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_SUBCLASS;
+        else if (g_str_equal (right, "$attr{bInterfaceProtocol}"))
+            rule_result->content.property.attribute = MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_PROTOCOL;
+        else if (g_str_equal (right, "$attr{bInterfaceNumber}"))
+            rule_result->content.property.attribute = MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_NUMBER;
         rule_result->content.property.value = right;
         right = NULL;
         goto out;
@@ -173,6 +214,130 @@ out:
     return TRUE;
 }
 
+/*****************************************************************************/
+/* Condition compilation */
+
+static void
+compile_pattern (MMUdevRulePattern *pattern,
+                 const gchar       *value)
+{
+    gboolean open_prefix = FALSE;
+    gboolean open_suffix = FALSE;
+    gsize    len;
+
+    len = strlen (value);
+    if (len > 0 && value[0] == '*') {
+        open_prefix = TRUE;
+        value++;
+        len--;
+    }
+    if (len > 0 && value[len - 1] == '*') {
+        open_suffix = TRUE;
+        len--;
+    }
+
+    pattern->str = g_strndup (value, len);
+    if (open_suffix && !open_prefix)
+        pattern->type = MM_UDEV_RULE_PATTERN_TYPE_PREFIX;
+    else if (!open_suffix && open_prefix)
+        pattern->type = MM_UDEV_RULE_PATTERN_TYPE_SUFFIX;
+    else if (open_suffix && open_prefix)
+        pattern->type = MM_UDEV_RULE_PATTERN_TYPE_SUBSTRING;
+    else
+        pattern->type = MM_UDEV_RULE_PATTERN_TYPE_EXACT;
+}
+
+static gboolean
+pattern_match (const MMUdevRulePattern *pattern,
+               const gchar             *str)
+{
+    switch (pattern->type) {
+    case MM_UDEV_RULE_PATTERN_TYPE_PREFIX:
+        return g_str_has_prefix (str, pattern->str);
+    case MM_UDEV_RULE_PATTERN_TYPE_SUFFIX:
+        return g_str_has_suffix (str, pattern->str);
+    case MM_UDEV_RULE_PATTERN_TYPE_SUBSTRING:
+        return !!strstr (str, pattern->str);
+    case MM_UDEV_RULE_PATTERN_TYPE_EXACT:
+    default:
+        return g_str_equal (str, pattern->str);
+    }
+}
+
+static void
+compile_attribute_match (MMUdevRuleMatch *rule_match)
+{
+    gchar *attribute;
+
+    attribute = g_strdup (&rule_match->parameter[5]);
+    g_strdelimit (attribute, "{}", ' ');
+    g_strstrip (attribute);
+
+    if (g_str_equal (attribute, "idVendor"))
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_VENDOR_ID;
+    else if (g_str_equal (attribute, "idProduct"))
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_PRODUCT_ID;
+    else if (g_str_equal (attribute, "manufacturer"))
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_MANUFACTURER;
+    else if (g_str_equal (attribute, "product"))
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_PRODUCT;
+    else if (g_str_equal (attribute, "bInterfaceClass"))
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_CLASS;
+    else if (g_str_equal (attribute, "bInterfaceSubClass"))
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_SUBCLASS;
+    else if (g_str_equal (attribute, "bInterfaceProtocol"))
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_PROTOCOL;
+    else if (g_str_equal (attribute, "bInterfaceNumber"))
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_NUMBER;
+    else
+        mm_warn ("Unknown attribute: %s", attribute);
+
+    /* Numeric values are given in hex */
+    rule_match->any_value = g_str_equal (rule_match->value, "?*");
+    rule_match->uint_valid = mm_get_uint_from_hex_str (rule_match->value, &rule_match->uint_value);
+
+    g_free (attribute);
+}
+
+static void
+compile_rule_match (MMUdevRuleMatch *rule_match)
+{
+    if (g_str_equal (rule_match->parameter, "ACTION"))
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_ACTION;
+    /* Note that we're not really making a difference between "SUBSYSTEMS"
+     * (where the whole device tree is checked) and "SUBSYSTEM" (where just one
+     * single device is checked), see mm_kernel_device_generic_rules_apply() */
+    else if (g_str_equal (rule_match->parameter, "SUBSYSTEMS") || g_str_equal (rule_match->parameter, "SUBSYSTEM"))
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_SUBSYSTEM;
+    else if (g_str_equal (rule_match->parameter, "DRIVER") || g_str_equal (rule_match->parameter, "DRIVERS"))
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_DRIVER;
+    else if (g_str_equal (rule_match->parameter, "KERNEL")) {
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_KERNEL;
+        compile_pattern (&rule_match->pattern, rule_match->value);
+    } else if (g_str_equal (rule_match->parameter, "DEVPATH")) {
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_DEVPATH;
+        compile_pattern (&rule_match->pattern, rule_match->value);
+        /* If not already doing a prefix match, do an implicit one. This is so that
+         * we can add properties to the usb_device owning all ports, and then apply
+         * the property to all ports individually processed. */
+        if (rule_match->value[0] && rule_match->value[strlen (rule_match->value) - 1] != '*') {
+            gchar *prefix;
+
+            prefix = g_strdup_printf ("%s/*", rule_match->value);
+            compile_pattern (&rule_match->prefix_pattern, prefix);
+            g_free (prefix);
+        }
+    } else if (g_str_has_prefix (rule_match->parameter, "ATTRS"))
+        compile_attribute_match (rule_match);
+    else if (g_str_has_prefix (rule_match->parameter, "ENV")) {
+        rule_match->parameter_id = MM_UDEV_RULE_MATCH_PARAMETER_PROPERTY;
+        rule_match->property = g_strdup (&rule_match->parameter[3]);
+        g_strdelimit (rule_match->property, "{}", ' ');
+        g_strstrip (rule_match->property);
+    } else
+        mm_warn ("Unknown match condition parameter: %s", rule_match->parameter);
+}
+
 static gboolean
 load_rule_match (MMUdevRuleMatch  *rule_match,
                  const gchar      *item,
@@ -202,6 +367,7 @@ load_rule_match (MMUdevRuleMatch  *rule_match,
     g_free (operator);
     rule_match->parameter = left;
     rule_match->value     = right;
+    compile_rule_match (rule_match);
     return TRUE;
 }
 
@@ -361,6 +527,363 @@ out:
     return TRUE;
 }
 
+/*****************************************************************************/
+/* Rule compilation */
+
+/* We only apply 'add' rules */
+static gboolean
+action_match (const MMUdevRuleMatch *match)
+{
+    return ((!!strstr (match->value, "add")) == (match->type == MM_UDEV_RULE_MATCH_TYPE_EQUAL));
+}
+
+/* Relative cost of checking each condition, so that the cheapest ones
+ * are checked first */
+static gint
+rule_match_cost (const MMUdevRuleMatch *match)
+{
+    switch (match->parameter_id) {
+    case MM_UDEV_RULE_MATCH_PARAMETER_VENDOR_ID:
+        return 0;
+    case MM_UDEV_RULE_MATCH_PARAMETER_PRODUCT_ID:
+    case MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_CLASS:
+    case MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_SUBCLASS:
+    case MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_PROTOCOL:
+    case MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_NUMBER:
+        return 1;
+    case MM_UDEV_RULE_MATCH_PARAMETER_DRIVER:
+    case MM_UDEV_RULE_MATCH_PARAMETER_KERNEL:
+    case MM_UDEV_RULE_MATCH_PARAMETER_MANUFACTURER:
+    case MM_UDEV_RULE_MATCH_PARAMETER_PRODUCT:
+        return 2;
+    case MM_UDEV_RULE_MATCH_PARAMETER_SUBSYSTEM:
+    case MM_UDEV_RULE_MATCH_PARAMETER_PROPERTY:
+        return 3;
+    case MM_UDEV_RULE_MATCH_PARAMETER_DEVPATH:
+        return 4;
+    case MM_UDEV_RULE_MATCH_PARAMETER_ACTION:
+    case MM_UDEV_RULE_MATCH_PARAMETER_UNKNOWN:
+    default:
+        return 5;
+    }
+}
+
+static gint
+rule_match_cmp (const MMUdevRuleMatch *a,
+                const MMUdevRuleMatch *b)
+{
+    return rule_match_cost (a) - rule_match_cost (b);
+}
+
+static void
+compile_rule (MMUdevRule *rule)
+{
+    guint i;
+
+    rule->vendor_id = -1;
+    if (!rule->conditions)
+        return;
+
+    for (i = 0; i < rule->conditions->len; i++) {
+        MMUdevRuleMatch *match;
+
+        match = &g_array_index (rule->conditions, MMUdevRuleMatch, i);
+        switch (match->parameter_id) {
+        case MM_UDEV_RULE_MATCH_PARAMETER_ACTION:
+            /* Doesn't depend on the device, so resolved right away */
+            if (!action_match (match))
+                rule->never_applies = TRUE;
+            break;
+        case MM_UDEV_RULE_MATCH_PARAMETER_UNKNOWN:
+            rule->never_applies = TRUE;
+            break;
+        case MM_UDEV_RULE_MATCH_PARAMETER_VENDOR_ID:
+            if (match->type != MM_UDEV_RULE_MATCH_TYPE_EQUAL)
+                break;
+            if (!match->uint_valid || match->uint_value > G_MAXUINT16)
+                rule->never_applies = TRUE;
+            else if (rule->vendor_id < 0)
+                rule->vendor_id = (gint) match->uint_value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    /* Checking conditions has no side effects, so they can be reordered */
+    g_array_sort (rule->conditions, (GCompareFunc) rule_match_cmp);
+}
+
+static void
+build_vendor_index (GArray *rules,
+                    guint   start,
+                    guint   end)
+{
+    MMUdevRuleVendorIndex *vendor_index;
+    guint                  i;
+
+    vendor_index = g_slice_new0 (MMUdevRuleVendorIndex);
+    vendor_index->ref_count = 1;
+    vendor_index->end = end;
+    vendor_index->rules = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_array_unref);
+
+    for (i = start; i < end; i++) {
+        MMUdevRule *rule;
+        GArray     *indices;
+
+        rule = &g_array_index (rules, MMUdevRule, i);
+        rule->vendor_index = vendor_index_ref (vendor_index);
+        if (rule->never_applies)
+            continue;
+
+        indices = g_hash_table_lookup (vendor_index->rules, GINT_TO_POINTER (rule->vendor_id));
+        if (!indices) {
+            indices = g_array_new (FALSE, FALSE, sizeof (guint));
+            g_hash_table_insert (vendor_index->rules, GINT_TO_POINTER (rule->vendor_id), indices);
+        }
+        g_array_append_val (indices, i);
+    }
+
+    mm_dbg ("[rules] indexed %u rules for %u vendors", end - start, g_hash_table_size (vendor_index->rules));
+    vendor_index_unref (vendor_index);
+}
+
+static void
+compile_rules (GArray *rules)
+{
+    guint i;
+    guint block_start = 0;
+    guint block_len = 0;
+
+    for (i = 0; i < rules->len; i++)
+        compile_rule (&g_array_index (rules, MMUdevRule, i));
+
+    /* Index blocks of consecutive rules that require a vendor id (e.g. the
+     * blacklists), rules that never apply may be part of them as well */
+    for (i = 0; i <= rules->len; i++) {
+        MMUdevRule *rule = NULL;
+
+        if (i < rules->len)
+            rule = &g_array_index (rules, MMUdevRule, i);
+
+        if (rule && (rule->never_applies || rule->vendor_id >= 0)) {
+            if (!block_len)
+                block_start = i;
+            block_len++;
+            continue;
+        }
+
+        if (block_len >= MIN_VENDOR_INDEX_RULES)
+            build_vendor_index (rules, block_start, i);
+        block_len = 0;
+    }
+}
+
+static guint
+vendor_index_next (MMUdevRuleVendorIndex *vendor_index,
+                   guint16                vendor_id,
+                   guint                  rule_i)
+{
+    GArray *indices;
+    guint   i;
+
+    indices = g_hash_table_lookup (vendor_index->rules, GINT_TO_POINTER ((gint) vendor_id));
+    if (indices) {
+        for (i = 0; i < indices->len; i++) {
+            guint index;
+
+            index = g_array_index (indices, guint, i);
+            if (index >= rule_i)
+                return index;
+        }
+    }
+    return vendor_index->end;
+}
+
+/*****************************************************************************/
+/* Rule matching */
+
+static gboolean
+check_uint_condition (const MMUdevRuleMatch *match,
+                      guint                  value)
+{
+    return (match->uint_valid && ((value == match->uint_value) == (match->type == MM_UDEV_RULE_MATCH_TYPE_EQUAL)));
+}
+
+static gboolean
+check_condition (const MMUdevRuleMatch      *match,
+                 const MMUdevRulesDevice    *device,
+                 MMUdevRulesGetPropertyFunc  get_property,
+                 gpointer                    user_data)
+{
+    gboolean condition_equal;
+
+    condition_equal = (match->type == MM_UDEV_RULE_MATCH_TYPE_EQUAL);
+
+    switch (match->parameter_id) {
+    case MM_UDEV_RULE_MATCH_PARAMETER_ACTION:
+        return action_match (match);
+
+    /* We look for the subsystem string in the whole sysfs path, because a lot of
+     * the MM udev rules are meant to just tag the physical device (e.g. with
+     * ID_MM_DEVICE_IGNORE) instead of the single ports. In our case with the
+     * custom parsing, we do tag all independent ports. */
+    case MM_UDEV_RULE_MATCH_PARAMETER_SUBSYSTEM:
+        return ((device->sysfs_path && !!strstr (device->sysfs_path, match->value)) == condition_equal);
+
+    /* Exact DRIVER match? We also include the check for DRIVERS, even if we
+     * only apply it to this port driver. */
+    case MM_UDEV_RULE_MATCH_PARAMETER_DRIVER:
+        return ((!g_strcmp0 (match->value, device->driver)) == condition_equal);
+
+    case MM_UDEV_RULE_MATCH_PARAMETER_KERNEL:
+        return (pattern_match (&match->pattern, device->name) == condition_equal);
+
+    /* Device sysfs path checks; we allow both a direct match and a prefix patch */
+    case MM_UDEV_RULE_MATCH_PARAMETER_DEVPATH:
+        /* If sysfs path invalid (e.g. path doesn't exist), no match */
+        if (!device->sysfs_path)
+            return FALSE;
+        if (pattern_match (&match->pattern, device->sysfs_path) == condition_equal)
+            return TRUE;
+        if (match->prefix_pattern.str && pattern_match (&match->prefix_pattern, device->sysfs_path) == condition_equal)
+            return TRUE;
+        if (g_str_has_prefix (device->sysfs_path, "/sys")) {
+            if (pattern_match (&match->pattern, &device->sysfs_path[4]) == condition_equal)
+                return TRUE;
+            if (match->prefix_pattern.str && pattern_match (&match->prefix_pattern, &device->sysfs_path[4]) == condition_equal)
+                return TRUE;
+        }
+        return FALSE;
+
+    case MM_UDEV_RULE_MATCH_PARAMETER_VENDOR_ID:
+        return check_uint_condition (match, device->physdev_vid);
+    case MM_UDEV_RULE_MATCH_PARAMETER_PRODUCT_ID:
+        return check_uint_condition (match, device->physdev_pid);
+    case MM_UDEV_RULE_MATCH_PARAMETER_MANUFACTURER:
+        return ((device->physdev_manufacturer && g_str_equal (device->physdev_manufacturer, match->value)) == condition_equal);
+    case MM_UDEV_RULE_MATCH_PARAMETER_PRODUCT:
+        return ((device->physdev_product && g_str_equal (device->physdev_product, match->value)) == condition_equal);
+    case MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_CLASS:
+        return (match->any_value || check_uint_condition (match, device->interface_class));
+    case MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_SUBCLASS:
+        return (match->any_value || check_uint_condition (match, device->interface_subclass));
+    case MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_PROTOCOL:
+        return (match->any_value || check_uint_condition (match, device->interface_protocol));
+    case MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_NUMBER:
+        return (match->any_value || check_uint_condition (match, device->interface_number));
+
+    /* Previously set property checks */
+    case MM_UDEV_RULE_MATCH_PARAMETER_PROPERTY:
+        return ((!g_strcmp0 (get_property (match->property, user_data), match->value)) == condition_equal);
+
+    case MM_UDEV_RULE_MATCH_PARAMETER_UNKNOWN:
+    default:
+        return FALSE;
+    }
+}
+
+static guint
+apply_rule (GArray                     *rules,
+            guint                       rule_i,
+            const MMUdevRulesDevice    *device,
+            MMUdevRulesGetPropertyFunc  get_property,
+            MMUdevRulesSetPropertyFunc  set_property,
+            gpointer                    user_data)
+{
+    MMUdevRule *rule;
+
+    rule = &g_array_index (rules, MMUdevRule, rule_i);
+    if (rule->never_applies)
+        return rule_i + 1;
+
+    if (rule->conditions) {
+        guint condition_i;
+
+        for (condition_i = 0; condition_i < rule->conditions->len; condition_i++) {
+            if (!check_condition (&g_array_index (rule->conditions, MMUdevRuleMatch, condition_i),
+                                  device, get_property, user_data))
+                return rule_i + 1;
+        }
+    }
+
+    switch (rule->result.type) {
+    case MM_UDEV_RULE_RESULT_TYPE_PROPERTY: {
+        gchar attribute_value[3];
+
+        switch (rule->result.content.property.attribute) {
+        case MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_CLASS:
+            g_snprintf (attribute_value, sizeof (attribute_value), "%02x", device->interface_class);
+            break;
+        case MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_SUBCLASS:
+            g_snprintf (attribute_value, sizeof (attribute_value), "%02x", device->interface_subclass);
+            break;
+        case MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_PROTOCOL:
+            g_snprintf (attribute_value, sizeof (attribute_value), "%02x", device->interface_protocol);
+            break;
+        case MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_NUMBER:
+            g_snprintf (attribute_value, sizeof (attribute_value), "%02x", device->interface_number);
+            break;
+        case MM_UDEV_RULE_RESULT_ATTRIBUTE_NONE:
+        default:
+            set_property (rule->result.content.property.name, rule->result.content.property.value, TRUE, user_data);
+            return rule_i + 1;
+        }
+        set_property (rule->result.content.property.name, attribute_value, FALSE, user_data);
+        break;
+    }
+
+    case MM_UDEV_RULE_RESULT_TYPE_LABEL:
+        /* noop */
+        break;
+
+    case MM_UDEV_RULE_RESULT_TYPE_GOTO_INDEX:
+        /* Jump to a new index */
+        return rule->result.content.index;
+
+    case MM_UDEV_RULE_RESULT_TYPE_GOTO_TAG:
+    case MM_UDEV_RULE_RESULT_TYPE_UNKNOWN:
+    default:
+        g_assert_not_reached ();
+    }
+
+    /* Go to the next rule */
+    return rule_i + 1;
+}
+
+void
+mm_kernel_device_generic_rules_apply (GArray                     *rules,
+                                      const MMUdevRulesDevice    *device,
+                                      MMUdevRulesGetPropertyFunc  get_property,
+                                      MMUdevRulesSetPropertyFunc  set_property,
+                                      gpointer                    user_data)
+{
+    guint i = 0;
+
+    g_assert (rules);
+    g_assert (device && device->name);
+
+    while (i < rules->len) {
+        MMUdevRule *rule;
+
+        /* Skip right away all the rules for other vendors */
+        rule = &g_array_index (rules, MMUdevRule, i);
+        if (rule->vendor_index) {
+            guint next;
+
+            next = vendor_index_next (rule->vendor_index, device->physdev_vid, i);
+            if (next != i) {
+                i = next;
+                continue;
+            }
+        }
+
+        i = apply_rule (rules, i, device, get_property, set_property, user_data);
+    }
+}
+
+/*****************************************************************************/
+
 static GList *
 list_rule_files (const gchar *rules_dir_path)
 {
@@ -431,6 +954,7 @@ mm_kernel_device_generic_rules_load (const gchar  *rules_dir,
     }
 
     mm_dbg ("[rules] %u loaded", rules->len);
+    compile_rules (rules);
 
 out:
     if (rule_files)
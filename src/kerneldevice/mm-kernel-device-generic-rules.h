@@ -23,10 +23,51 @@ typedef enum {
     MM_UDEV_RULE_MATCH_TYPE_NOT_EQUAL,
 } MMUdevRuleMatchType;
 
+/* Parameters supported in match conditions, resolved when loading the rules */
+typedef enum {
+    MM_UDEV_RULE_MATCH_PARAMETER_UNKNOWN,
+    MM_UDEV_RULE_MATCH_PARAMETER_ACTION,
+    MM_UDEV_RULE_MATCH_PARAMETER_SUBSYSTEM,
+    MM_UDEV_RULE_MATCH_PARAMETER_DRIVER,
+    MM_UDEV_RULE_MATCH_PARAMETER_KERNEL,
+    MM_UDEV_RULE_MATCH_PARAMETER_DEVPATH,
+    MM_UDEV_RULE_MATCH_PARAMETER_VENDOR_ID,
+    MM_UDEV_RULE_MATCH_PARAMETER_PRODUCT_ID,
+    MM_UDEV_RULE_MATCH_PARAMETER_MANUFACTURER,
+    MM_UDEV_RULE_MATCH_PARAMETER_PRODUCT,
+    MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_CLASS,
+    MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_SUBCLASS,
+    MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_PROTOCOL,
+    MM_UDEV_RULE_MATCH_PARAMETER_INTERFACE_NUMBER,
+    MM_UDEV_RULE_MATCH_PARAMETER_PROPERTY,
+} MMUdevRuleMatchParameter;
+
+/* Glob patterns, with the leading and trailing '*' already split */
+typedef enum {
+    MM_UDEV_RULE_PATTERN_TYPE_EXACT,
+    MM_UDEV_RULE_PATTERN_TYPE_PREFIX,
+    MM_UDEV_RULE_PATTERN_TYPE_SUFFIX,
+    MM_UDEV_RULE_PATTERN_TYPE_SUBSTRING,
+} MMUdevRulePatternType;
+
+typedef struct {
+    MMUdevRulePatternType  type;
+    gchar                 *str;
+} MMUdevRulePattern;
+
 typedef struct {
     MMUdevRuleMatchType  type;
     gchar               *parameter;
     gchar               *value;
+
+    /* Compiled condition */
+    MMUdevRuleMatchParameter  parameter_id;
+    gchar                    *property;       /* ENV{} name */
+    MMUdevRulePattern         pattern;        /* KERNEL and DEVPATH */
+    MMUdevRulePattern         prefix_pattern; /* DEVPATH implicit prefix match */
+    gboolean                  any_value;      /* ATTRS{} given as "?*" */
+    gboolean                  uint_valid;
+    guint                     uint_value;
 } MMUdevRuleMatch;
 
 typedef enum {
@@ -37,9 +78,19 @@ typedef enum {
     MM_UDEV_RULE_RESULT_TYPE_GOTO_TAG, /* internal use only */
 } MMUdevRuleResultType;
 
+/* Property values read from the device instead of given in the rule */
+typedef enum {
+    MM_UDEV_RULE_RESULT_ATTRIBUTE_NONE,
+    MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_CLASS,
+    MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_SUBCLASS,
+    MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_PROTOCOL,
+    MM_UDEV_RULE_RESULT_ATTRIBUTE_INTERFACE_NUMBER,
+} MMUdevRuleResultAttribute;
+
 typedef struct {
-    gchar *name;
-    gchar *value;
+    gchar                     *name;
+    gchar                     *value;
+    MMUdevRuleResultAttribute  attribute;
 } MMUdevRuleResultProperty;
 
 typedef struct {
@@ -51,12 +102,51 @@ typedef struct {
     } content;
 } MMUdevRuleResult;
 
+/* Index of a block of consecutive rules which all require a specific vendor
+ * id, so that the ones for other vendors can be skipped */
+typedef struct _MMUdevRuleVendorIndex MMUdevRuleVendorIndex;
+
 typedef struct {
     GArray           *conditions;
     MMUdevRuleResult  result;
+
+    /* Compiled rule */
+    gboolean               never_applies;
+    gint                   vendor_id; /* -1 if not required */
+    MMUdevRuleVendorIndex *vendor_index;
 } MMUdevRule;
 
+/* Device contents the rules are applied to */
+typedef struct {
+    const gchar *name;
+    const gchar *driver;
+    const gchar *sysfs_path;
+    guint16      physdev_vid;
+    guint16      physdev_pid;
+    const gchar *physdev_manufacturer;
+    const gchar *physdev_product;
+    guint8       interface_class;
+    guint8       interface_subclass;
+    guint8       interface_protocol;
+    guint8       interface_number;
+} MMUdevRulesDevice;
+
+/* Property accessors. Values given to the setter are owned by the rules when
+ * 'static_value' is TRUE, and only valid during the call otherwise. */
+typedef const gchar * (* MMUdevRulesGetPropertyFunc) (const gchar *name,
+                                                      gpointer     user_data);
+typedef void          (* MMUdevRulesSetPropertyFunc) (const gchar *name,
+                                                      const gchar *value,
+                                                      gboolean     static_value,
+                                                      gpointer     user_data);
+
 GArray *mm_kernel_device_generic_rules_load (const gchar  *rules_dir,
                                              GError      **error);
 
+void    mm_kernel_device_generic_rules_apply (GArray                     *rules,
+                                              const MMUdevRulesDevice    *device,
+                                              MMUdevRulesGetPropertyFunc  get_property,
+                                              MMUdevRulesSetPropertyFunc  set_property,
+                                              gpointer                    user_data);
+
 G_END_DECLS
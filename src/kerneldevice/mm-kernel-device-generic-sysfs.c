@@ -0,0 +1,257 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModemManager.h>
+#define _LIBMM_INSIDE_MM
+#include <libmm-glib.h>
+
+#include "mm-log.h"
+#include "mm-kernel-device-generic-sysfs.h"
+
+/*****************************************************************************/
+/* Batched sysfs attribute reads */
+
+void
+mm_kernel_device_generic_sysfs_read (const gchar      *path,
+                                     MMSysfsAttribute *attributes,
+                                     guint             n_attributes)
+{
+    GString *filepath;
+    gsize    path_len;
+    guint    i;
+
+    /* Reuse the same path buffer for all attributes */
+    filepath = g_string_new (path);
+    g_string_append_c (filepath, G_DIR_SEPARATOR);
+    path_len = filepath->len;
+
+    for (i = 0; i < n_attributes; i++) {
+        gchar *contents = NULL;
+
+        g_string_truncate (filepath, path_len);
+        g_string_append (filepath, attributes[i].name);
+        if (g_file_get_contents (filepath->str, &contents, NULL, NULL)) {
+            g_strdelimit (contents, "\r\n", ' ');
+            g_strstrip (contents);
+        }
+        attributes[i].value = contents;
+    }
+
+    g_string_free (filepath, TRUE);
+}
+
+void
+mm_kernel_device_generic_sysfs_clear (MMSysfsAttribute *attributes,
+                                      guint             n_attributes)
+{
+    guint i;
+
+    for (i = 0; i < n_attributes; i++)
+        g_clear_pointer (&attributes[i].value, g_free);
+}
+
+guint
+mm_sysfs_attribute_as_hex (const MMSysfsAttribute *attribute)
+{
+    guint val = 0;
+
+    if (attribute->value)
+        mm_get_uint_from_hex_str (attribute->value, &val);
+    return val;
+}
+
+guint16
+mm_sysfs_attribute_as_hex16 (const MMSysfsAttribute *attribute)
+{
+    guint val;
+
+    val = mm_sysfs_attribute_as_hex (attribute);
+    return (val <= G_MAXUINT16 ? val : 0);
+}
+
+static guint
+sysfs_attribute_as_uint (const MMSysfsAttribute *attribute)
+{
+    guint val = 0;
+
+    if (attribute->value)
+        mm_get_uint_from_str (attribute->value, &val);
+    return val;
+}
+
+/*****************************************************************************/
+/* Physical device attributes cache */
+
+/* physdev sysfs path -> MMPhysdevAttributes */
+static GHashTable *physdev_attributes;
+/* "subsystem/name" of each port -> MMPhysdevAttributes (not owned) */
+static GHashTable *port_physdev_attributes;
+
+static void
+physdev_attributes_clear (MMPhysdevAttributes *attributes)
+{
+    g_clear_pointer (&attributes->subsystem,    g_free);
+    g_clear_pointer (&attributes->manufacturer, g_free);
+    g_clear_pointer (&attributes->product,      g_free);
+}
+
+static void
+physdev_attributes_free (MMPhysdevAttributes *attributes)
+{
+    physdev_attributes_clear (attributes);
+    g_slice_free (MMPhysdevAttributes, attributes);
+}
+
+static void
+physdev_attributes_read_device_number (const gchar *physdev_sysfs_path,
+                                       guint       *busnum,
+                                       guint       *devnum)
+{
+    MMSysfsAttribute sysfs_attributes[] = {
+        { "busnum", NULL },
+        { "devnum", NULL },
+    };
+
+    mm_kernel_device_generic_sysfs_read (physdev_sysfs_path, sysfs_attributes, G_N_ELEMENTS (sysfs_attributes));
+    *busnum = sysfs_attribute_as_uint (&sysfs_attributes[0]);
+    *devnum = sysfs_attribute_as_uint (&sysfs_attributes[1]);
+    mm_kernel_device_generic_sysfs_clear (sysfs_attributes, G_N_ELEMENTS (sysfs_attributes));
+}
+
+static void
+physdev_attributes_read (const gchar         *physdev_sysfs_path,
+                         MMPhysdevAttributes *attributes)
+{
+    MMSysfsAttribute sysfs_attributes[] = {
+        { "busnum",       NULL },
+        { "devnum",       NULL },
+        { "idVendor",     NULL },
+        { "idProduct",    NULL },
+        { "bcdDevice",    NULL },
+        { "manufacturer", NULL },
+        { "product",      NULL },
+    };
+    gchar *aux;
+    gchar *subsyspath;
+
+    mm_kernel_device_generic_sysfs_read (physdev_sysfs_path, sysfs_attributes, G_N_ELEMENTS (sysfs_attributes));
+
+    attributes->busnum       = sysfs_attribute_as_uint (&sysfs_attributes[0]);
+    attributes->devnum       = sysfs_attribute_as_uint (&sysfs_attributes[1]);
+    attributes->vid          = mm_sysfs_attribute_as_hex16 (&sysfs_attributes[2]);
+    attributes->pid          = mm_sysfs_attribute_as_hex16 (&sysfs_attributes[3]);
+    attributes->revision     = mm_sysfs_attribute_as_hex16 (&sysfs_attributes[4]);
+    attributes->manufacturer = sysfs_attributes[5].value;
+    attributes->product      = sysfs_attributes[6].value;
+    sysfs_attributes[5].value = NULL;
+    sysfs_attributes[6].value = NULL;
+    mm_kernel_device_generic_sysfs_clear (sysfs_attributes, G_N_ELEMENTS (sysfs_attributes));
+
+    aux = g_strdup_printf ("%s/subsystem", physdev_sysfs_path);
+    subsyspath = realpath (aux, NULL);
+    attributes->subsystem = (subsyspath ? g_path_get_dirname (subsyspath) : NULL);
+    g_free (subsyspath);
+    g_free (aux);
+}
+
+static gboolean
+physdev_attributes_match (gpointer key,
+                          gpointer value,
+                          gpointer user_data)
+{
+    return value == user_data;
+}
+
+const MMPhysdevAttributes *
+mm_kernel_device_generic_physdev_get (const gchar *physdev_sysfs_path,
+                                      const gchar *subsystem,
+                                      const gchar *name)
+{
+    MMPhysdevAttributes *attributes;
+    MMPhysdevAttributes *previous;
+    gchar               *port_key;
+
+    if (G_UNLIKELY (!physdev_attributes)) {
+        physdev_attributes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) physdev_attributes_free);
+        port_physdev_attributes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    }
+
+    attributes = g_hash_table_lookup (physdev_attributes, physdev_sysfs_path);
+    if (!attributes) {
+        attributes = g_slice_new0 (MMPhysdevAttributes);
+        physdev_attributes_read (physdev_sysfs_path, attributes);
+        g_hash_table_insert (physdev_attributes, g_strdup (physdev_sysfs_path), attributes);
+    } else {
+        guint busnum;
+        guint devnum;
+
+        physdev_attributes_read_device_number (physdev_sysfs_path, &busnum, &devnum);
+        if (busnum == attributes->busnum && devnum == attributes->devnum)
+            mm_dbg ("(%s/%s) physdev attributes already cached", subsystem, name);
+        else {
+            mm_dbg ("(%s/%s) physdev re-enumerated (%u-%u, was %u-%u), reading attributes again",
+                    subsystem, name, busnum, devnum, attributes->busnum, attributes->devnum);
+            physdev_attributes_clear (attributes);
+            physdev_attributes_read (physdev_sysfs_path, attributes);
+        }
+    }
+
+    /* Track which ports are in the physical device, so that the attributes
+     * are dropped when all of them are gone */
+    port_key = g_strdup_printf ("%s/%s", subsystem, name);
+    previous = g_hash_table_lookup (port_physdev_attributes, port_key);
+    if (previous == attributes) {
+        g_free (port_key);
+        return attributes;
+    }
+
+    if (previous) {
+        g_assert (previous->n_ports > 0);
+        previous->n_ports--;
+    }
+    attributes->n_ports++;
+    g_hash_table_insert (port_physdev_attributes, port_key, attributes);
+
+    /* If the port moved to a different physdev, the previous one may be unused */
+    if (previous && !previous->n_ports)
+        g_hash_table_foreach_remove (physdev_attributes, physdev_attributes_match, previous);
+
+    return attributes;
+}
+
+void
+mm_kernel_device_generic_physdev_release_port (const gchar *subsystem,
+                                               const gchar *name)
+{
+    MMPhysdevAttributes *attributes;
+    gchar               *port_key;
+
+    if (!port_physdev_attributes)
+        return;
+
+    port_key = g_strdup_printf ("%s/%s", subsystem, name);
+    attributes = g_hash_table_lookup (port_physdev_attributes, port_key);
+    if (attributes) {
+        g_hash_table_remove (port_physdev_attributes, port_key);
+        g_assert (attributes->n_ports > 0);
+        if (!--attributes->n_ports) {
+            mm_dbg ("(%s/%s) last port in physdev removed, dropping cached attributes", subsystem, name);
+            g_hash_table_foreach_remove (physdev_attributes, physdev_attributes_match, attributes);
+        }
+    }
+    g_free (port_key);
+}
@@ -0,0 +1,68 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*****************************************************************************/
+/* Batched sysfs attribute reads */
+
+typedef struct {
+    const gchar *name;
+    gchar       *value;
+} MMSysfsAttribute;
+
+/* Reads all the requested attributes of the same sysfs directory in one
+ * pass; attributes which can't be read are left NULL */
+void    mm_kernel_device_generic_sysfs_read  (const gchar      *path,
+                                              MMSysfsAttribute *attributes,
+                                              guint             n_attributes);
+void    mm_kernel_device_generic_sysfs_clear (MMSysfsAttribute *attributes,
+                                              guint             n_attributes);
+
+guint   mm_sysfs_attribute_as_hex   (const MMSysfsAttribute *attribute);
+guint16 mm_sysfs_attribute_as_hex16 (const MMSysfsAttribute *attribute);
+
+/*****************************************************************************/
+/* Physical device attributes cache
+ *
+ * All ports of the same physical device share the physdev sysfs attributes,
+ * so these are read once when the first port of the device is preloaded, and
+ * kept until the last port known in the device is removed.
+ *
+ * The physdev sysfs path identifies the USB port topology, not the device
+ * plugged in it, so the USB bus and device numbers are read again on every
+ * lookup; the device number changes on each enumeration, so if they differ,
+ * the entry is stale (e.g. a remove event was missed) and it's read again.
+ */
+
+typedef struct {
+    guint    n_ports;
+    guint    busnum;
+    guint    devnum;
+    guint16  vid;
+    guint16  pid;
+    guint16  revision;
+    gchar   *subsystem;
+    gchar   *manufacturer;
+    gchar   *product;
+} MMPhysdevAttributes;
+
+const MMPhysdevAttributes *mm_kernel_device_generic_physdev_get          (const gchar *physdev_sysfs_path,
+                                                                          const gchar *subsystem,
+                                                                          const gchar *name);
+void                       mm_kernel_device_generic_physdev_release_port (const gchar *subsystem,
+                                                                          const gchar *name);
+
+G_END_DECLS
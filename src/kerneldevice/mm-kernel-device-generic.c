@@ -25,6 +25,7 @@
 
 #include "mm-kernel-device-generic.h"
 #include "mm-kernel-device-generic-rules.h"
+#include "mm-kernel-device-generic-sysfs.h"
 #include "mm-log.h"
 
 #if !defined UDEVRULESDIR
@@ -68,41 +69,6 @@ struct _MMKernelDeviceGenericPrivate {
     gchar   *physdev_product;
 };
 
-static guint
-read_sysfs_property_as_hex (const gchar *path,
-                            const gchar *property)
-{
-    gchar *aux;
-    gchar *contents = NULL;
-    guint val = 0;
-
-    aux = g_strdup_printf ("%s/%s", path, property);
-    if (g_file_get_contents (aux, &contents, NULL, NULL)) {
-        g_strdelimit (contents, "\r\n", ' ');
-        g_strstrip (contents);
-        mm_get_uint_from_hex_str (contents, &val);
-    }
-    g_free (contents);
-    g_free (aux);
-    return val;
-}
-
-static gchar *
-read_sysfs_property_as_string (const gchar *path,
-                               const gchar *property)
-{
-    gchar *aux;
-    gchar *contents = NULL;
-
-    aux = g_strdup_printf ("%s/%s", path, property);
-    if (g_file_get_contents (aux, &contents, NULL, NULL)) {
-        g_strdelimit (contents, "\r\n", ' ');
-        g_strstrip (contents);
-    }
-    g_free (aux);
-    return contents;
-}
-
 /*****************************************************************************/
 /* Load contents */
 
@@ -257,16 +223,34 @@ preload_driver (MMKernelDeviceGeneric *self)
 }
 
 static void
-preload_physdev_vid (MMKernelDeviceGeneric *self)
+preload_physdev_attributes (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_vid && self->priv->physdev_sysfs_path) {
-        guint val;
+    const MMPhysdevAttributes *attributes;
 
-        val = read_sysfs_property_as_hex (self->priv->physdev_sysfs_path, "idVendor");
-        if (val && val <= G_MAXUINT16)
-            self->priv->physdev_vid = val;
-    }
+    if (!self->priv->physdev_sysfs_path)
+        return;
+
+    attributes = mm_kernel_device_generic_physdev_get (self->priv->physdev_sysfs_path,
+                                                       mm_kernel_event_properties_get_subsystem (self->priv->properties),
+                                                       mm_kernel_event_properties_get_name      (self->priv->properties));
+
+    if (!self->priv->physdev_vid)
+        self->priv->physdev_vid = attributes->vid;
+    if (!self->priv->physdev_pid)
+        self->priv->physdev_pid = attributes->pid;
+    if (!self->priv->physdev_revision)
+        self->priv->physdev_revision = attributes->revision;
+    if (!self->priv->physdev_subsystem)
+        self->priv->physdev_subsystem = g_strdup (attributes->subsystem);
+    if (!self->priv->physdev_manufacturer)
+        self->priv->physdev_manufacturer = g_strdup (attributes->manufacturer);
+    if (!self->priv->physdev_product)
+        self->priv->physdev_product = g_strdup (attributes->product);
+}
 
+static void
+preload_physdev_vid (MMKernelDeviceGeneric *self)
+{
     if (self->priv->physdev_vid) {
         mm_dbg ("(%s/%s) vid (ID_VENDOR_ID): 0x%04x",
                 mm_kernel_event_properties_get_subsystem (self->priv->properties),
@@ -283,14 +267,6 @@ preload_physdev_vid (MMKernelDeviceGeneric *self)
 static void
 preload_physdev_pid (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_pid && self->priv->physdev_sysfs_path) {
-        guint val;
-
-        val = read_sysfs_property_as_hex (self->priv->physdev_sysfs_path, "idProduct");
-        if (val && val <= G_MAXUINT16)
-            self->priv->physdev_pid = val;
-    }
-
     if (self->priv->physdev_pid) {
         mm_dbg ("(%s/%s) pid (ID_MODEL_ID): 0x%04x",
                 mm_kernel_event_properties_get_subsystem (self->priv->properties),
@@ -306,14 +282,6 @@ preload_physdev_pid (MMKernelDeviceGeneric *self)
 static void
 preload_physdev_revision (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_revision && self->priv->physdev_sysfs_path) {
-        guint val;
-
-        val = read_sysfs_property_as_hex (self->priv->physdev_sysfs_path, "bcdDevice");
-        if (val && val <= G_MAXUINT16)
-            self->priv->physdev_revision = val;
-    }
-
     if (self->priv->physdev_revision) {
         mm_dbg ("(%s/%s) revision (ID_REVISION): 0x%04x",
                 mm_kernel_event_properties_get_subsystem (self->priv->properties),
@@ -329,17 +297,6 @@ preload_physdev_revision (MMKernelDeviceGeneric *self)
 static void
 preload_physdev_subsystem (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_subsystem && self->priv->physdev_sysfs_path) {
-        gchar *aux;
-        gchar *subsyspath;
-
-        aux = g_strdup_printf ("%s/subsystem", self->priv->physdev_sysfs_path);
-        subsyspath = realpath (aux, NULL);
-        self->priv->physdev_subsystem = g_path_get_dirname (subsyspath);
-        g_free (subsyspath);
-        g_free (aux);
-    }
-
     mm_dbg ("(%s/%s) subsystem: %s",
             mm_kernel_event_properties_get_subsystem (self->priv->properties),
             mm_kernel_event_properties_get_name      (self->priv->properties),
@@ -349,9 +306,6 @@ preload_physdev_subsystem (MMKernelDeviceGeneric *self)
 static void
 preload_manufacturer (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_manufacturer)
-        self->priv->physdev_manufacturer = (self->priv->physdev_sysfs_path ? read_sysfs_property_as_string (self->priv->physdev_sysfs_path, "manufacturer") : NULL);
-
     if (self->priv->physdev_manufacturer) {
         mm_dbg ("(%s/%s) manufacturer (ID_VENDOR): %s",
                 mm_kernel_event_properties_get_subsystem (self->priv->properties),
@@ -367,9 +321,6 @@ preload_manufacturer (MMKernelDeviceGeneric *self)
 static void
 preload_product (MMKernelDeviceGeneric *self)
 {
-    if (!self->priv->physdev_product)
-        self->priv->physdev_product = (self->priv->physdev_sysfs_path ? read_sysfs_property_as_string (self->priv->physdev_sysfs_path, "product") : NULL);
-
     if (self->priv->physdev_product) {
         mm_dbg ("(%s/%s) product (ID_MODEL): %s",
                 mm_kernel_event_properties_get_subsystem (self->priv->properties),
@@ -383,10 +334,30 @@ preload_product (MMKernelDeviceGeneric *self)
 
 }
 
+static void
+preload_interface_attributes (MMKernelDeviceGeneric *self)
+{
+    MMSysfsAttribute sysfs_attributes[] = {
+        { "bInterfaceClass",    NULL },
+        { "bInterfaceSubClass", NULL },
+        { "bInterfaceProtocol", NULL },
+        { "bInterfaceNumber",   NULL },
+    };
+
+    if (!self->priv->interface_sysfs_path)
+        return;
+
+    mm_kernel_device_generic_sysfs_read (self->priv->interface_sysfs_path, sysfs_attributes, G_N_ELEMENTS (sysfs_attributes));
+    self->priv->interface_class    = mm_sysfs_attribute_as_hex (&sysfs_attributes[0]);
+    self->priv->interface_subclass = mm_sysfs_attribute_as_hex (&sysfs_attributes[1]);
+    self->priv->interface_protocol = mm_sysfs_attribute_as_hex (&sysfs_attributes[2]);
+    self->priv->interface_number   = mm_sysfs_attribute_as_hex (&sysfs_attributes[3]);
+    mm_kernel_device_generic_sysfs_clear (sysfs_attributes, G_N_ELEMENTS (sysfs_attributes));
+}
+
 static void
 preload_interface_class (MMKernelDeviceGeneric *self)
 {
-    self->priv->interface_class = (self->priv->interface_sysfs_path ? read_sysfs_property_as_hex (self->priv->interface_sysfs_path, "bInterfaceClass") : 0x00);
     mm_dbg ("(%s/%s) interface class: 0x%02x",
                 mm_kernel_event_properties_get_subsystem (self->priv->properties),
                 mm_kernel_event_properties_get_name      (self->priv->properties),
@@ -396,7 +367,6 @@ preload_interface_class (MMKernelDeviceGeneric *self)
 static void
 preload_interface_subclass (MMKernelDeviceGeneric *self)
 {
-    self->priv->interface_subclass = (self->priv->interface_sysfs_path ? read_sysfs_property_as_hex (self->priv->interface_sysfs_path, "bInterfaceSubClass") : 0x00);
     mm_dbg ("(%s/%s) interface subclass: 0x%02x",
                 mm_kernel_event_properties_get_subsystem (self->priv->properties),
                 mm_kernel_event_properties_get_name      (self->priv->properties),
@@ -406,7 +376,6 @@ preload_interface_subclass (MMKernelDeviceGeneric *self)
 static void
 preload_interface_protocol (MMKernelDeviceGeneric *self)
 {
-    self->priv->interface_protocol = (self->priv->interface_sysfs_path ? read_sysfs_property_as_hex (self->priv->interface_sysfs_path, "bInterfaceProtocol") : 0x00);
     mm_dbg ("(%s/%s) interface protocol: 0x%02x",
             mm_kernel_event_properties_get_subsystem (self->priv->properties),
             mm_kernel_event_properties_get_name      (self->priv->properties),
@@ -416,7 +385,6 @@ preload_interface_protocol (MMKernelDeviceGeneric *self)
 static void
 preload_interface_number (MMKernelDeviceGeneric *self)
 {
-    self->priv->interface_number = (self->priv->interface_sysfs_path ? read_sysfs_property_as_hex (self->priv->interface_sysfs_path, "bInterfaceNumber") : 0x00);
     mm_dbg ("(%s/%s) interface number (ID_USB_INTERFACE_NUM): 0x%02x",
             mm_kernel_event_properties_get_subsystem (self->priv->properties),
             mm_kernel_event_properties_get_name      (self->priv->properties),
@@ -429,11 +397,13 @@ preload_contents (MMKernelDeviceGeneric *self)
 {
     preload_sysfs_path           (self);
     preload_interface_sysfs_path (self);
+    preload_interface_attributes (self);
     preload_interface_class      (self);
     preload_interface_subclass   (self);
     preload_interface_protocol   (self);
     preload_interface_number     (self);
     preload_physdev_sysfs_path   (self);
+    preload_physdev_attributes   (self);
     preload_manufacturer         (self);
     preload_product              (self);
     preload_driver               (self);
@@ -601,273 +571,63 @@ kernel_device_cmp (MMKernelDevice *a,
 
 /*****************************************************************************/
 
-static gboolean
-string_match (const gchar *str,
-              const gchar *original_pattern)
-{
-    gchar    *pattern;
-    gchar    *start;
-    gboolean  open_prefix = FALSE;
-    gboolean  open_suffix = FALSE;
-    gboolean  match;
-
-    pattern = g_strdup (original_pattern);
-    start = pattern;
-
-    if (start[0] == '*') {
-        open_prefix = TRUE;
-        start++;
-    }
-
-    if (start[strlen (start) - 1] == '*') {
-        open_suffix = TRUE;
-        start[strlen (start) - 1] = '\0';
-    }
-
-    if (open_suffix && !open_prefix)
-        match = g_str_has_prefix (str, start);
-    else if (!open_suffix && open_prefix)
-        match = g_str_has_suffix (str, start);
-    else if (open_suffix && open_prefix)
-        match = !!strstr (str, start);
-    else
-        match = g_str_equal (str, start);
-
-    g_free (pattern);
-    return match;
-}
-
-static gboolean
-check_condition (MMKernelDeviceGeneric *self,
-                 MMUdevRuleMatch       *match)
+static const gchar *
+rules_get_property (const gchar *name,
+                    gpointer     user_data)
 {
-    gboolean condition_equal;
-
-    condition_equal = (match->type == MM_UDEV_RULE_MATCH_TYPE_EQUAL);
-
-    /* We only apply 'add' rules */
-    if (g_str_equal (match->parameter, "ACTION"))
-        return ((!!strstr (match->value, "add")) == condition_equal);
-
-    /* We look for the subsystem string in the whole sysfs path.
-     *
-     * Note that we're not really making a difference between "SUBSYSTEMS"
-     * (where the whole device tree is checked) and "SUBSYSTEM" (where just one
-     * single device is checked), because a lot of the MM udev rules are meant
-     * to just tag the physical device (e.g. with ID_MM_DEVICE_IGNORE) instead
-     * of the single ports. In our case with the custom parsing, we do tag all
-     * independent ports.
-     */
-    if (g_str_equal (match->parameter, "SUBSYSTEMS") || g_str_equal (match->parameter, "SUBSYSTEM"))
-        return ((self->priv->sysfs_path && !!strstr (self->priv->sysfs_path, match->value)) == condition_equal);
-
-    /* Exact DRIVER match? We also include the check for DRIVERS, even if we
-     * only apply it to this port driver. */
-    if (g_str_equal (match->parameter, "DRIVER") || g_str_equal (match->parameter, "DRIVERS"))
-        return ((!g_strcmp0 (match->value, mm_kernel_device_get_driver (MM_KERNEL_DEVICE (self)))) == condition_equal);
-
-    /* Device name checks */
-    if (g_str_equal (match->parameter, "KERNEL"))
-        return (string_match (mm_kernel_device_get_name (MM_KERNEL_DEVICE (self)), match->value) == condition_equal);
-
-    /* Device sysfs path checks; we allow both a direct match and a prefix patch */
-    if (g_str_equal (match->parameter, "DEVPATH")) {
-        gchar    *prefix_match = NULL;
-        gboolean  result = FALSE;
-
-        /* If sysfs path invalid (e.g. path doesn't exist), no match */
-        if (!self->priv->sysfs_path)
-            return FALSE;
-
-        /* If not already doing a prefix match, do an implicit one. This is so that
-         * we can add properties to the usb_device owning all ports, and then apply
-         * the property to all ports individually processed here. */
-        if (match->value[0] && match->value[strlen (match->value) - 1] != '*')
-            prefix_match = g_strdup_printf ("%s/*", match->value);
-
-        if (string_match (self->priv->sysfs_path, match->value) == condition_equal) {
-            result = TRUE;
-            goto out;
-        }
-
-        if (prefix_match && string_match (self->priv->sysfs_path, prefix_match) == condition_equal) {
-            result = TRUE;
-            goto out;
-        }
-
-        if (g_str_has_prefix (self->priv->sysfs_path, "/sys")) {
-            if (string_match (&self->priv->sysfs_path[4], match->value) == condition_equal) {
-                result = TRUE;
-                goto out;
-            }
-            if (prefix_match && string_match (&self->priv->sysfs_path[4], prefix_match) == condition_equal) {
-                result = TRUE;
-                goto out;
-            }
-        }
-    out:
-        g_free (prefix_match);
-        return result;
-    }
-
-    /* Attributes checks */
-    if (g_str_has_prefix (match->parameter, "ATTRS")) {
-        gchar    *attribute;
-        gchar    *contents = NULL;
-        gboolean  result = FALSE;
-        guint     val;
-
-        attribute = g_strdup (&match->parameter[5]);
-        g_strdelimit (attribute, "{}", ' ');
-        g_strstrip (attribute);
-
-        /* VID/PID directly from our API */
-        if (g_str_equal (attribute, "idVendor"))
-            result = ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                      ((mm_kernel_device_get_physdev_vid (MM_KERNEL_DEVICE (self)) == val) == condition_equal));
-        else if (g_str_equal (attribute, "idProduct"))
-            result = ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                      ((mm_kernel_device_get_physdev_pid (MM_KERNEL_DEVICE (self)) == val) == condition_equal));
-        /* manufacturer in the physdev */
-        else if (g_str_equal (attribute, "manufacturer"))
-            result = ((self->priv->physdev_manufacturer && g_str_equal (self->priv->physdev_manufacturer, match->value)) == condition_equal);
-        /* product in the physdev */
-        else if (g_str_equal (attribute, "product"))
-            result = ((self->priv->physdev_product && g_str_equal (self->priv->physdev_product, match->value)) == condition_equal);
-        /* interface class/subclass/protocol/number in the interface */
-        else if (g_str_equal (attribute, "bInterfaceClass"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_class == val) == condition_equal)));
-        else if (g_str_equal (attribute, "bInterfaceSubClass"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_subclass == val) == condition_equal)));
-        else if (g_str_equal (attribute, "bInterfaceProtocol"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_protocol == val) == condition_equal)));
-        else if (g_str_equal (attribute, "bInterfaceNumber"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_number == val) == condition_equal)));
-        else
-            mm_warn ("Unknown attribute: %s", attribute);
-
-        g_free (contents);
-        g_free (attribute);
-        return result;
-    }
-
-    /* Previously set property checks */
-    if (g_str_has_prefix (match->parameter, "ENV")) {
-        gchar    *property;
-        gboolean  result = FALSE;
-
-        property = g_strdup (&match->parameter[3]);
-        g_strdelimit (property, "{}", ' ');
-        g_strstrip (property);
-
-        result = ((!g_strcmp0 ((const gchar *) g_object_get_data (G_OBJECT (self), property), match->value)) == condition_equal);
-
-        g_free (property);
-        return result;
-    }
-
-    mm_warn ("Unknown match condition parameter: %s", match->parameter);
-    return FALSE;
+    return (const gchar *) g_object_get_data (G_OBJECT (user_data), name);
 }
 
-static guint
-check_rule (MMKernelDeviceGeneric *self,
-            guint                  rule_i)
+static void
+rules_set_property (const gchar *name,
+                    const gchar *value,
+                    gboolean     static_value,
+                    gpointer     user_data)
 {
-    MMUdevRule *rule;
-    gboolean    apply = TRUE;
-
-    g_assert (rule_i < self->priv->rules->len);
-
-    rule = &g_array_index (self->priv->rules, MMUdevRule, rule_i);
-    if (rule->conditions) {
-        guint condition_i;
-
-        for (condition_i = 0; condition_i < rule->conditions->len; condition_i++) {
-            MMUdevRuleMatch *match;
-
-            match = &g_array_index (rule->conditions, MMUdevRuleMatch, condition_i);
-            if (!check_condition (self, match)) {
-                apply = FALSE;
-                break;
-            }
-        }
-    }
-
-    if (apply) {
-        switch (rule->result.type) {
-        case MM_UDEV_RULE_RESULT_TYPE_PROPERTY: {
-            gchar *property_value_read = NULL;
-
-            if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceClass}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_class);
-            else if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceSubClass}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_subclass);
-            else if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceProtocol}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_protocol);
-            else if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceNumber}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_number);
-
-            /* add new property */
-            mm_dbg ("(%s/%s) property added: %s=%s",
-                    mm_kernel_event_properties_get_subsystem (self->priv->properties),
-                    mm_kernel_event_properties_get_name      (self->priv->properties),
-                    rule->result.content.property.name,
-                    property_value_read ? property_value_read : rule->result.content.property.value);
-
-            if (!property_value_read)
-                /* NOTE: we keep a reference to the list of rules ourselves, so it isn't
-                 * an issue if we re-use the same string (i.e. without g_strdup-ing it)
-                 * as a property value. */
-                g_object_set_data (G_OBJECT (self),
-                                   rule->result.content.property.name,
-                                   rule->result.content.property.value);
-            else
-                g_object_set_data_full (G_OBJECT (self),
-                                        rule->result.content.property.name,
-                                        property_value_read,
-                                        g_free);
-            break;
-        }
-
-        case MM_UDEV_RULE_RESULT_TYPE_LABEL:
-            /* noop */
-            break;
+    MMKernelDeviceGeneric *self;
 
-        case MM_UDEV_RULE_RESULT_TYPE_GOTO_INDEX:
-            /* Jump to a new index */
-            return rule->result.content.index;
+    self = MM_KERNEL_DEVICE_GENERIC (user_data);
 
-        case MM_UDEV_RULE_RESULT_TYPE_GOTO_TAG:
-        case MM_UDEV_RULE_RESULT_TYPE_UNKNOWN:
-            g_assert_not_reached ();
-        }
-    }
+    /* add new property */
+    mm_dbg ("(%s/%s) property added: %s=%s",
+            mm_kernel_event_properties_get_subsystem (self->priv->properties),
+            mm_kernel_event_properties_get_name      (self->priv->properties),
+            name, value);
 
-    /* Go to the next rule */
-    return rule_i + 1;
+    if (static_value)
+        /* NOTE: we keep a reference to the list of rules ourselves, so it isn't
+         * an issue if we re-use the same string (i.e. without g_strdup-ing it)
+         * as a property value. */
+        g_object_set_data (G_OBJECT (self), name, (gpointer) value);
+    else
+        g_object_set_data_full (G_OBJECT (self), name, g_strdup (value), g_free);
 }
 
 static void
 preload_properties (MMKernelDeviceGeneric *self)
 {
-    guint i;
+    MMUdevRulesDevice device = { 0 };
 
     g_assert (self->priv->rules);
     g_assert (self->priv->rules->len > 0);
 
-    /* Start to process rules */
-    i = 0;
-    while (i < self->priv->rules->len) {
-        guint next_rule;
-
-        next_rule = check_rule (self, i);
-        i = next_rule;
-    }
+    device.name                 = mm_kernel_device_get_name (MM_KERNEL_DEVICE (self));
+    device.driver               = self->priv->driver;
+    device.sysfs_path           = self->priv->sysfs_path;
+    device.physdev_vid          = self->priv->physdev_vid;
+    device.physdev_pid          = self->priv->physdev_pid;
+    device.physdev_manufacturer = self->priv->physdev_manufacturer;
+    device.physdev_product      = self->priv->physdev_product;
+    device.interface_class      = self->priv->interface_class;
+    device.interface_subclass   = self->priv->interface_subclass;
+    device.interface_protocol   = self->priv->interface_protocol;
+    device.interface_number     = self->priv->interface_number;
+
+    mm_kernel_device_generic_rules_apply (self->priv->rules,
+                                          &device,
+                                          rules_get_property,
+                                          rules_set_property,
+                                          self);
 }
 
 static void
@@ -878,8 +638,11 @@ check_preload (MMKernelDeviceGeneric *self)
         return;
 
     /* Don't preload on "remove" actions, where we don't have the device any more */
-    if (g_strcmp0 (mm_kernel_event_properties_get_action (self->priv->properties), "remove") == 0)
+    if (g_strcmp0 (mm_kernel_event_properties_get_action (self->priv->properties), "remove") == 0) {
+        mm_kernel_device_generic_physdev_release_port (mm_kernel_event_properties_get_subsystem (self->priv->properties),
+                                                       mm_kernel_event_properties_get_name      (self->priv->properties));
         return;
+    }
 
     /* Don't preload for devices in the 'virtual' subsystem */
     if (g_strcmp0 (mm_kernel_event_properties_get_subsystem (self->priv->properties), "virtual") == 0)
@@ -1085,6 +848,7 @@ dispose (GObject *object)
     MMKernelDeviceGeneric *self = MM_KERNEL_DEVICE_GENERIC (object);
 
     g_clear_pointer (&self->priv->physdev_product,      g_free);
+    g_clear_pointer (&self->priv->physdev_subsystem,    g_free);
     g_clear_pointer (&self->priv->physdev_manufacturer, g_free);
     g_clear_pointer (&self->priv->physdev_sysfs_path,   g_free);
     g_clear_pointer (&self->priv->interface_sysfs_path, g_free);
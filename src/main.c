@@ -29,6 +29,8 @@
 #include "mm-base-manager.h"
 #include "mm-log.h"
 #include "mm-context.h"
+#include "mm-probe-cache.h"
+#include "mm-port-capture.h"
 
 #if defined WITH_SYSTEMD_SUSPEND_RESUME
 # include "mm-sleep-monitor.h"
@@ -167,12 +169,21 @@ main (int argc, char *argv[])
                        mm_context_get_log_journal (),
                        mm_context_get_log_timestamps (),
                        mm_context_get_log_relative_timestamps (),
+                       mm_context_get_log_async (),
                        &err)) {
         g_warning ("Failed to set up logging: %s", err->message);
         g_error_free (err);
         exit (1);
     }
 
+    if (mm_context_get_log_capture () && !mm_port_capture_start (mm_context_get_log_capture (), &err)) {
+        mm_warn ("Couldn't enable port capture: %s", err->message);
+        g_clear_error (&err);
+    }
+
+    if (mm_context_get_probe_cache ())
+        mm_probe_cache_init (mm_context_get_probe_cache ());
+
     g_unix_signal_add (SIGTERM, quit_cb, NULL);
     g_unix_signal_add (SIGINT, quit_cb, NULL);
 
@@ -242,6 +253,10 @@ main (int argc, char *argv[])
 
     mm_info ("ModemManager is shut down");
 
+    mm_probe_cache_shutdown ();
+
+    mm_port_capture_stop ();
+
     mm_log_shutdown ();
 
     return 0;
@@ -44,6 +44,7 @@
 #include "mm-auth.h"
 #include "mm-plugin.h"
 #include "mm-filter.h"
+#include "mm-port-capture.h"
 #include "mm-log.h"
 
 static void initable_iface_init (GInitableIface *iface);
@@ -744,6 +745,35 @@ set_logging_context_free (SetLoggingContext *ctx)
     g_free (ctx);
 }
 
+/* Besides the log levels, the CAPTURE and NOCAPTURE pseudo levels switch the
+ * port traffic capture, always to the file given in the command line */
+static gboolean
+set_logging (const gchar  *level,
+             GError      **error)
+{
+    const gchar *path;
+
+    if (!g_ascii_strcasecmp (level, "NOCAPTURE")) {
+        mm_port_capture_stop ();
+        return TRUE;
+    }
+
+    if (g_ascii_strcasecmp (level, "CAPTURE"))
+        return mm_log_set_level (level, error);
+
+    if (mm_port_capture_is_enabled ())
+        return TRUE;
+
+    path = mm_context_get_log_capture ();
+    if (!path) {
+        g_set_error_literal (error, MM_CORE_ERROR, MM_CORE_ERROR_UNSUPPORTED,
+                             "No port capture file configured");
+        return FALSE;
+    }
+
+    return mm_port_capture_start (path, error);
+}
+
 static void
 set_logging_auth_ready (MMAuthProvider *authp,
                         GAsyncResult *res,
@@ -753,7 +783,7 @@ set_logging_auth_ready (MMAuthProvider *authp,
 
     if (!mm_auth_provider_authorize_finish (authp, res, &error))
         g_dbus_method_invocation_take_error (ctx->invocation, error);
-    else if (!mm_log_set_level (ctx->level, &error))
+    else if (!set_logging (ctx->level, &error))
         g_dbus_method_invocation_take_error (ctx->invocation, error);
     else {
         mm_info ("logging: level '%s'", ctx->level);
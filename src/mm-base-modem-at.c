@@ -213,12 +213,13 @@ at_sequence_parse_response (MMPortSerialAt *port,
         ctx->current++;
         if (ctx->current->command) {
             /* Schedule the next command in the probing group */
-            mm_port_serial_at_command (
+            mm_port_serial_at_command_full (
                 ctx->port,
                 ctx->current->command,
                 ctx->current->timeout,
                 FALSE,
                 ctx->current->allow_cached,
+                ctx->current->cache_ttl,
                 ctx->cancellable,
                 (GAsyncReadyCallback)at_sequence_parse_response,
                 ctx);
@@ -294,12 +295,13 @@ mm_base_modem_at_sequence_full (MMBaseModem *self,
     }
 
     /* Go on with the first one in the sequence */
-    mm_port_serial_at_command (
+    mm_port_serial_at_command_full (
         ctx->port,
         ctx->current->command,
         ctx->current->timeout,
         FALSE,
         ctx->current->allow_cached,
+        ctx->current->cache_ttl,
         ctx->cancellable,
         (GAsyncReadyCallback)at_sequence_parse_response,
         ctx);
@@ -500,16 +502,17 @@ at_command_ready (MMPortSerialAt *port,
     at_command_context_free (ctx);
 }
 
-void
-mm_base_modem_at_command_full (MMBaseModem *self,
-                               MMPortSerialAt *port,
-                               const gchar *command,
-                               guint timeout,
-                               gboolean allow_cached,
-                               gboolean is_raw,
-                               GCancellable *cancellable,
-                               GAsyncReadyCallback callback,
-                               gpointer user_data)
+static void
+at_command_full (MMBaseModem *self,
+                 MMPortSerialAt *port,
+                 const gchar *command,
+                 guint timeout,
+                 gboolean allow_cached,
+                 guint cache_ttl,
+                 gboolean is_raw,
+                 GCancellable *cancellable,
+                 GAsyncReadyCallback callback,
+                 gpointer user_data)
 {
     AtCommandContext *ctx;
 
@@ -542,17 +545,32 @@ mm_base_modem_at_command_full (MMBaseModem *self,
     }
 
     /* Go on with the command */
-    mm_port_serial_at_command (
+    mm_port_serial_at_command_full (
         port,
         command,
         timeout,
         is_raw,
         allow_cached,
+        cache_ttl,
         ctx->cancellable,
         (GAsyncReadyCallback)at_command_ready,
         ctx);
 }
 
+void
+mm_base_modem_at_command_full (MMBaseModem *self,
+                               MMPortSerialAt *port,
+                               const gchar *command,
+                               guint timeout,
+                               gboolean allow_cached,
+                               gboolean is_raw,
+                               GCancellable *cancellable,
+                               GAsyncReadyCallback callback,
+                               gpointer user_data)
+{
+    at_command_full (self, port, command, timeout, allow_cached, 0, is_raw, cancellable, callback, user_data);
+}
+
 const gchar *
 mm_base_modem_at_command_finish (MMBaseModem *self,
                                  GAsyncResult *res,
@@ -566,6 +584,7 @@ _at_command (MMBaseModem *self,
              const gchar *command,
              guint timeout,
              gboolean allow_cached,
+             guint cache_ttl,
              gboolean is_raw,
              GAsyncReadyCallback callback,
              gpointer user_data)
@@ -584,15 +603,16 @@ _at_command (MMBaseModem *self,
         return;
     }
 
-    mm_base_modem_at_command_full (self,
-                                   port,
-                                   command,
-                                   timeout,
-                                   allow_cached,
-                                   is_raw,
-                                   NULL,
-                                   callback,
-                                   user_data);
+    at_command_full (self,
+                     port,
+                     command,
+                     timeout,
+                     allow_cached,
+                     cache_ttl,
+                     is_raw,
+                     NULL,
+                     callback,
+                     user_data);
 }
 
 void
@@ -603,7 +623,18 @@ mm_base_modem_at_command (MMBaseModem *self,
                           GAsyncReadyCallback callback,
                           gpointer user_data)
 {
-    _at_command (self, command, timeout, allow_cached, FALSE, callback, user_data);
+    _at_command (self, command, timeout, allow_cached, 0, FALSE, callback, user_data);
+}
+
+void
+mm_base_modem_at_command_cached (MMBaseModem *self,
+                                 const gchar *command,
+                                 guint timeout,
+                                 guint cache_ttl,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data)
+{
+    _at_command (self, command, timeout, TRUE, cache_ttl, FALSE, callback, user_data);
 }
 
 void
@@ -614,5 +645,5 @@ mm_base_modem_at_command_raw (MMBaseModem *self,
                               GAsyncReadyCallback callback,
                               gpointer user_data)
 {
-    _at_command (self, command, timeout, allow_cached, TRUE, callback, user_data);
+    _at_command (self, command, timeout, allow_cached, 0, TRUE, callback, user_data);
 }
@@ -61,6 +61,8 @@ typedef struct {
     gboolean allow_cached;
     /* The response processor */
     MMBaseModemAtResponseProcessor response_processor;
+    /* Seconds a cached reply is valid for, 0 for no expiry */
+    guint cache_ttl;
 } MMBaseModemAtCommand;
 
 /* Generic AT sequence handling, using the best AT port available and without
@@ -138,6 +140,14 @@ void mm_base_modem_at_command                (MMBaseModem *self,
                                               gboolean allow_cached,
                                               GAsyncReadyCallback callback,
                                               gpointer user_data);
+/* Like mm_base_modem_at_command() allowing cached replies, but the reply is
+ * only cached for @cache_ttl seconds */
+void mm_base_modem_at_command_cached         (MMBaseModem *self,
+                                              const gchar *command,
+                                              guint timeout,
+                                              guint cache_ttl,
+                                              GAsyncReadyCallback callback,
+                                              gpointer user_data);
 /* Like mm_base_modem_at_command() except does not prefix with AT */
 void mm_base_modem_at_command_raw            (MMBaseModem *self,
                                               const gchar *command,
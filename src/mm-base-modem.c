@@ -232,6 +232,20 @@ mm_base_modem_grab_port (MMBaseModem         *self,
                 }
             }
             mm_port_serial_at_set_flags (MM_PORT_SERIAL_AT (port), at_pflags);
+
+            /* Optionally pipeline the commands known to be safe */
+            if (mm_kernel_device_has_property (kernel_device, ID_MM_TTY_AT_PIPELINE_DEPTH)) {
+                gint depth;
+
+                depth = mm_kernel_device_get_property_as_int (kernel_device, ID_MM_TTY_AT_PIPELINE_DEPTH);
+                if (depth < 1 || depth > MM_PORT_SERIAL_PIPELINE_DEPTH_MAX)
+                    mm_warn ("(%s/%s) unsupported AT pipeline depth in port: %d",
+                             subsys, name, depth);
+                else
+                    g_object_set (port,
+                                  MM_PORT_SERIAL_PIPELINE_DEPTH, (guint) depth,
+                                  NULL);
+            }
         } else if (ptype == MM_PORT_TYPE_GPS) {
             /* Raw GPS port */
             port = MM_PORT (mm_port_serial_gps_new (name));
@@ -126,6 +126,7 @@ enum {
     PROP_MODEM_CARRIER_CONFIG_MAPPING,
     PROP_FLOW_CONTROL,
     PROP_INDICATORS_DISABLED,
+    PROP_COMPOUND_IDENTITY_DISABLED,
     PROP_LAST
 };
 
@@ -135,6 +136,13 @@ static GParamSpec *properties[PROP_LAST];
 #define CIND_INDICATOR_INVALID 255
 #define CIND_INDICATOR_IS_VALID(u) (u != CIND_INDICATOR_INVALID)
 
+/* The lock status is queried several times while initializing; replies are
+ * reused for a few seconds, and dropped as soon as a PIN is sent (+CPIN=).
+ * Only if sent through the same port, though: a PIN sent e.g. through the
+ * secondary port leaves the reply cached in the primary one stale for up to
+ * this long. */
+#define CPIN_QUERY_CACHE_TTL 5
+
 typedef struct _PortsContext PortsContext;
 
 struct _MMBroadbandModemPrivate {
@@ -171,6 +179,7 @@ struct _MMBroadbandModemPrivate {
     gboolean modem_cgerep_support_checked;
     gboolean modem_cgerep_supported;
     MMFlowControl flow_control;
+    gboolean modem_compound_identity_disabled;
 
     /*<--- Modem 3GPP interface --->*/
     /* Properties */
@@ -180,7 +189,6 @@ struct _MMBroadbandModemPrivate {
     gboolean modem_3gpp_ps_network_supported;
     gboolean modem_3gpp_eps_network_supported;
     /* Implementation helpers */
-    GPtrArray *modem_3gpp_registration_regex;
     MMModem3gppFacility modem_3gpp_ignored_facility_locks;
     MMBaseBearer *modem_3gpp_initial_eps_bearer;
 
@@ -677,7 +685,7 @@ parse_caps_cgmm (MMBaseModem *self,
 static const MMBaseModemAtCommand capabilities[] = {
     { "+GCAP",  2, TRUE,  parse_caps_gcap },
     { "I",      1, TRUE,  parse_caps_gcap }, /* yes, really parse as +GCAP */
-    { "+CPIN?", 1, FALSE, parse_caps_cpin },
+    { "+CPIN?", 1, TRUE,  parse_caps_cpin, CPIN_QUERY_CACHE_TTL },
     { "+CGMM",  1, TRUE,  parse_caps_cgmm },
     { NULL }
 };
@@ -925,7 +933,56 @@ modem_load_manufacturer_finish (MMIfaceModem *self,
     return manufacturer;
 }
 
+/* Commands run in a single compound command line before loading the
+ * manufacturer, in this same order. If the compound command line fails once,
+ * it isn't tried again. */
+static const gchar *identity_commands[] = { "+CGMI", "+CGMM", "+CGMR", "+CGSN" };
+
+static gboolean
+response_processor_identity (MMBaseModem *self,
+                             gpointer none,
+                             const gchar *command,
+                             const gchar *response,
+                             gboolean last_command,
+                             const GError *error,
+                             GVariant **result,
+                             GError **result_error)
+{
+    MMPortSerialAt *port;
+    gchar **replies;
+    guint i;
+
+    /* Not all modems support compound command lines, or all the commands in
+     * them; in any case, just go on with the per-property commands, and
+     * don't waste another round trip on it in the next loadings */
+    if (error) {
+        mm_dbg ("couldn't load identity in a single command: %s", error->message);
+        MM_BROADBAND_MODEM (self)->priv->modem_compound_identity_disabled = TRUE;
+        return FALSE;
+    }
+
+    replies = mm_split_compound_response (response, G_N_ELEMENTS (identity_commands));
+    if (!replies) {
+        mm_dbg ("couldn't split identity reply: '%s'", response);
+        MM_BROADBAND_MODEM (self)->priv->modem_compound_identity_disabled = TRUE;
+        return FALSE;
+    }
+
+    /* Cache the reply to each command in the port used by the sequences, so
+     * that the manufacturer, model, revision and equipment identifier
+     * loading get them without any further round trip. */
+    port = mm_base_modem_peek_best_at_port (self, NULL);
+    if (port) {
+        for (i = 0; i < G_N_ELEMENTS (identity_commands); i++)
+            mm_port_serial_at_set_cached_reply (port, identity_commands[i], replies[i]);
+    }
+    g_strfreev (replies);
+
+    return FALSE;
+}
+
 static const MMBaseModemAtCommand manufacturers[] = {
+    { "+CGMI;+CGMM;+CGMR;+CGSN", 3, TRUE, response_processor_identity },
     { "+CGMI",  3, TRUE, response_processor_string_ignore_at_errors },
     { "+GMI",   3, TRUE, response_processor_string_ignore_at_errors },
     { NULL }
@@ -936,10 +993,20 @@ modem_load_manufacturer (MMIfaceModem *self,
                          GAsyncReadyCallback callback,
                          gpointer user_data)
 {
+    const MMBaseModemAtCommand *commands = manufacturers;
+
     mm_dbg ("loading manufacturer...");
+
+    /* On CDMA-only (non-3GPP) modems, +CGSN may not be supported, so don't
+     * load the whole identity at once; same if the plugin says so, or if it
+     * already failed */
+    if (mm_iface_modem_is_cdma_only (self) ||
+        MM_BROADBAND_MODEM (self)->priv->modem_compound_identity_disabled)
+        commands++;
+
     mm_base_modem_at_sequence (
         MM_BASE_MODEM (self),
-        manufacturers,
+        commands,
         NULL, /* response_processor_context */
         NULL, /* response_processor_context_free */
         callback,
@@ -1455,12 +1522,12 @@ modem_load_unlock_required (MMIfaceModem *self,
     }
 
     mm_dbg ("checking if unlock required...");
-    mm_base_modem_at_command (MM_BASE_MODEM (self),
-                              "+CPIN?",
-                              10,
-                              FALSE,
-                              (GAsyncReadyCallback)cpin_query_ready,
-                              task);
+    mm_base_modem_at_command_cached (MM_BASE_MODEM (self),
+                                     "+CPIN?",
+                                     10,
+                                     CPIN_QUERY_CACHE_TTL,
+                                     (GAsyncReadyCallback)cpin_query_ready,
+                                     task);
 }
 
 /*****************************************************************************/
@@ -4492,56 +4559,33 @@ registration_state_changed (MMPortSerialAt *port,
                             GMatchInfo *match_info,
                             MMBroadbandModem *self)
 {
-    MMModem3gppRegistrationState state = MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN;
-    gulong lac = 0, tac = 0, cell_id = 0;
-    MMModemAccessTechnology act = MM_MODEM_ACCESS_TECHNOLOGY_UNKNOWN;
-    gboolean cgreg = FALSE;
-    gboolean cereg = FALSE;
+    MM3gppCregResult result;
     GError *error = NULL;
+    gint start = 0;
+    gint end = 0;
 
-    if (!mm_3gpp_parse_creg_response (match_info,
-                                      &state,
-                                      &lac,
-                                      &cell_id,
-                                      &act,
-                                      &cgreg,
-                                      &cereg,
-                                      &error)) {
+    g_match_info_fetch_pos (match_info, 0, &start, &end);
+    if (!mm_3gpp_parse_creg_line (g_match_info_get_string (match_info) + start,
+                                  end - start,
+                                  FALSE,
+                                  &result,
+                                  &error)) {
         mm_warn ("error parsing unsolicited registration: %s",
                  error && error->message ? error->message : "(unknown)");
         g_clear_error (&error);
         return;
     }
 
-    /* Report new registration state and fix LAC/TAC.
-     * According to 3GPP TS 27.007:
-     *  - If CREG reports <AcT> 7 (LTE) then the <lac> field contains TAC
-     *  - CEREG always reports TAC
-     */
-    if (cgreg)
-        mm_iface_modem_3gpp_update_ps_registration_state (MM_IFACE_MODEM_3GPP (self), state);
-    else if (cereg) {
-        tac = lac;
-        lac = 0;
-        mm_iface_modem_3gpp_update_eps_registration_state (MM_IFACE_MODEM_3GPP (self), state);
-    } else {
-        if (act == MM_MODEM_ACCESS_TECHNOLOGY_LTE) {
-            tac = lac;
-            lac = 0;
-        }
-        mm_iface_modem_3gpp_update_cs_registration_state (MM_IFACE_MODEM_3GPP (self), state);
-    }
-
     /* Only update access technologies from CREG/CGREG response if the modem
      * doesn't have custom commands for access technology loading, otherwise
      * we fight with the custom commands.  Plus CREG/CGREG access technologies
      * don't have fine-grained distinction between HSxPA or GPRS/EDGE, etc.
      */
-    if (MM_IFACE_MODEM_GET_INTERFACE (self)->load_access_technologies == modem_load_access_technologies ||
-        MM_IFACE_MODEM_GET_INTERFACE (self)->load_access_technologies == NULL)
-        mm_iface_modem_3gpp_update_access_technologies (MM_IFACE_MODEM_3GPP (self), act);
-
-    mm_iface_modem_3gpp_update_location (MM_IFACE_MODEM_3GPP (self), lac, tac, cell_id);
+    mm_iface_modem_3gpp_update_registration (
+        MM_IFACE_MODEM_3GPP (self),
+        &result,
+        (MM_IFACE_MODEM_GET_INTERFACE (self)->load_access_technologies == modem_load_access_technologies ||
+         MM_IFACE_MODEM_GET_INTERFACE (self)->load_access_technologies == NULL));
 }
 
 static void
@@ -4559,7 +4603,7 @@ modem_3gpp_setup_unsolicited_registration_events (MMIfaceModem3gpp *self,
     ports[1] = mm_base_modem_peek_port_secondary (MM_BASE_MODEM (self));
 
     /* Set up CREG unsolicited message handlers in both ports */
-    array = mm_3gpp_creg_regex_get (FALSE);
+    array = mm_3gpp_creg_line_regex_get ();
     for (i = 0; i < 2; i++) {
         if (!ports[i])
             continue;
@@ -4608,7 +4652,7 @@ modem_3gpp_cleanup_unsolicited_registration_events (MMIfaceModem3gpp *self,
     ports[1] = mm_base_modem_peek_port_secondary (MM_BASE_MODEM (self));
 
     /* Set up CREG unsolicited message handlers in both ports */
-    array = mm_3gpp_creg_regex_get (FALSE);
+    array = mm_3gpp_creg_line_regex_get ();
     for (i = 0; i < 2; i++) {
         if (!ports[i])
             continue;
@@ -4754,16 +4798,7 @@ registration_status_check_ready (MMBroadbandModem *self,
     RunRegistrationChecksContext *ctx;
     const gchar *response;
     GError *error = NULL;
-    GMatchInfo *match_info = NULL;
-    guint i;
-    gboolean parsed;
-    gboolean cgreg;
-    gboolean cereg;
-    MMModem3gppRegistrationState state;
-    MMModemAccessTechnology act;
-    gulong lac;
-    gulong tac;
-    gulong cid;
+    MM3gppCregResult result;
 
     ctx = g_task_get_task_data (task);
 
@@ -4795,102 +4830,45 @@ registration_status_check_ready (MMBroadbandModem *self,
         return;
     }
 
-    /* Try to match the response */
-    for (i = 0;
-         i < self->priv->modem_3gpp_registration_regex->len;
-         i++) {
-        if (g_regex_match ((GRegex *)g_ptr_array_index (
-                               self->priv->modem_3gpp_registration_regex, i),
-                           response,
-                           0,
-                           &match_info))
-            break;
-        g_match_info_free (match_info);
-        match_info = NULL;
-    }
-
-    if (!match_info) {
-        error = g_error_new (MM_CORE_ERROR,
-                             MM_CORE_ERROR_FAILED,
-                             "Unknown registration status response: '%s'",
-                             response);
+    if (!mm_3gpp_parse_creg_line (response, -1, TRUE, &result, &error)) {
+        g_prefix_error (&error, "Unknown registration status response: '%s': ", response);
         if (ctx->running_cs)
             ctx->cs_error = error;
         else if (ctx->running_ps)
             ctx->ps_error = error;
         else
             ctx->eps_error = error;
-
         run_registration_checks_context_step (task);
         return;
     }
 
-    cgreg = FALSE;
-    cereg = FALSE;
-    state = MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN;
-    act = MM_MODEM_ACCESS_TECHNOLOGY_UNKNOWN;
-    tac = 0;
-    lac = 0;
-    cid = 0;
-    parsed = mm_3gpp_parse_creg_response (match_info,
-                                          &state,
-                                          &lac,
-                                          &cid,
-                                          &act,
-                                          &cgreg,
-                                          &cereg,
-                                          &error);
-    g_match_info_free (match_info);
-
-    if (!parsed) {
-        if (!error)
-            error = g_error_new (MM_CORE_ERROR,
-                                 MM_CORE_ERROR_FAILED,
-                                 "Error parsing registration response: '%s'",
-                                 response);
-        if (ctx->running_cs)
-            ctx->cs_error = error;
-        else if (ctx->running_ps)
-            ctx->ps_error = error;
-        else
-            ctx->eps_error = error;
-        run_registration_checks_context_step (task);
-        return;
-    }
-
-    /* Report new registration state and fix LAC/TAC.
-     * According to 3GPP TS 27.007:
-     *  - If CREG reports <AcT> 7 (LTE) then the <lac> field contains TAC
-     *  - CEREG always reports TAC
-     */
-    if (cgreg) {
+    switch (result.domain) {
+    case MM_3GPP_CREG_DOMAIN_PS:
         if (ctx->running_cs)
             mm_dbg ("Got PS registration state when checking CS registration state");
         else if (ctx->running_eps)
             mm_dbg ("Got PS registration state when checking EPS registration state");
-        mm_iface_modem_3gpp_update_ps_registration_state (MM_IFACE_MODEM_3GPP (self), state);
-    } else if (cereg) {
-        tac = lac;
-        lac = 0;
+        break;
+    case MM_3GPP_CREG_DOMAIN_EPS:
         if (ctx->running_cs)
             mm_dbg ("Got EPS registration state when checking CS registration state");
         else if (ctx->running_ps)
             mm_dbg ("Got EPS registration state when checking PS registration state");
-        mm_iface_modem_3gpp_update_eps_registration_state (MM_IFACE_MODEM_3GPP (self), state);
-    } else {
-        if (act == MM_MODEM_ACCESS_TECHNOLOGY_LTE) {
-            tac = lac;
-            lac = 0;
-        }
+        break;
+    case MM_3GPP_CREG_DOMAIN_5GS:
+        mm_dbg ("Got 5GS registration state when checking %s registration state",
+                ctx->running_cs ? "CS" : ctx->running_ps ? "PS" : "EPS");
+        break;
+    case MM_3GPP_CREG_DOMAIN_CS:
+    default:
         if (ctx->running_ps)
             mm_dbg ("Got CS registration state when checking PS registration state");
         else if (ctx->running_eps)
             mm_dbg ("Got CS registration state when checking EPS registration state");
-        mm_iface_modem_3gpp_update_cs_registration_state (MM_IFACE_MODEM_3GPP (self), state);
+        break;
     }
 
-    mm_iface_modem_3gpp_update_access_technologies (MM_IFACE_MODEM_3GPP (self), act);
-    mm_iface_modem_3gpp_update_location (MM_IFACE_MODEM_3GPP (self), lac, tac, cid);
+    mm_iface_modem_3gpp_update_registration (MM_IFACE_MODEM_3GPP (self), &result, TRUE);
 
     run_registration_checks_context_step (task);
 }
@@ -9888,7 +9866,7 @@ setup_ports (MMBroadbandModem *self)
     /* Cleanup all unsolicited message handlers in all AT ports */
 
     /* Set up CREG unsolicited message handlers, with NULL callbacks */
-    array = mm_3gpp_creg_regex_get (FALSE);
+    array = mm_3gpp_creg_line_regex_get ();
     for (i = 0; i < 2; i++) {
         if (!ports[i])
             continue;
@@ -11840,6 +11818,9 @@ set_property (GObject *object,
     case PROP_INDICATORS_DISABLED:
         self->priv->modem_cind_disabled = g_value_get_boolean (value);
         break;
+    case PROP_COMPOUND_IDENTITY_DISABLED:
+        self->priv->modem_compound_identity_disabled = g_value_get_boolean (value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -11972,6 +11953,9 @@ get_property (GObject *object,
     case PROP_INDICATORS_DISABLED:
         g_value_set_boolean (value, self->priv->modem_cind_disabled);
         break;
+    case PROP_COMPOUND_IDENTITY_DISABLED:
+        g_value_set_boolean (value, self->priv->modem_compound_identity_disabled);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -11986,7 +11970,6 @@ mm_broadband_modem_init (MMBroadbandModem *self)
                                               MM_TYPE_BROADBAND_MODEM,
                                               MMBroadbandModemPrivate);
     self->priv->modem_state = MM_MODEM_STATE_UNKNOWN;
-    self->priv->modem_3gpp_registration_regex = mm_3gpp_creg_regex_get (TRUE);
     self->priv->modem_current_charset = MM_MODEM_CHARSET_UNKNOWN;
     self->priv->modem_3gpp_registration_state = MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN;
     self->priv->modem_3gpp_cs_network_supported = TRUE;
@@ -12024,9 +12007,6 @@ finalize (GObject *object)
     if (self->priv->in_call_ports_ctx)
         ports_context_unref (self->priv->in_call_ports_ctx);
 
-    if (self->priv->modem_3gpp_registration_regex)
-        mm_3gpp_creg_regex_destroy (self->priv->modem_3gpp_registration_regex);
-
     g_free (self->priv->carrier_config_mapping);
 
     G_OBJECT_CLASS (mm_broadband_modem_parent_class)->finalize (object);
@@ -12567,4 +12547,12 @@ mm_broadband_modem_class_init (MMBroadbandModemClass *klass)
                               FALSE,
                               G_PARAM_READWRITE);
     g_object_class_install_property (object_class, PROP_INDICATORS_DISABLED, properties[PROP_INDICATORS_DISABLED]);
+
+    properties[PROP_COMPOUND_IDENTITY_DISABLED] =
+        g_param_spec_boolean (MM_BROADBAND_MODEM_COMPOUND_IDENTITY_DISABLED,
+                              "Disable compound identity loading",
+                              "Avoid loading manufacturer, model, revision and IMEI in a single command line",
+                              FALSE,
+                              G_PARAM_READWRITE);
+    g_object_class_install_property (object_class, PROP_COMPOUND_IDENTITY_DISABLED, properties[PROP_COMPOUND_IDENTITY_DISABLED]);
 }
@@ -39,8 +39,9 @@ typedef struct _MMBroadbandModem MMBroadbandModem;
 typedef struct _MMBroadbandModemClass MMBroadbandModemClass;
 typedef struct _MMBroadbandModemPrivate MMBroadbandModemPrivate;
 
-#define MM_BROADBAND_MODEM_FLOW_CONTROL        "broadband-modem-flow-control"
-#define MM_BROADBAND_MODEM_INDICATORS_DISABLED "broadband-modem-indicators-disabled"
+#define MM_BROADBAND_MODEM_FLOW_CONTROL                "broadband-modem-flow-control"
+#define MM_BROADBAND_MODEM_INDICATORS_DISABLED         "broadband-modem-indicators-disabled"
+#define MM_BROADBAND_MODEM_COMPOUND_IDENTITY_DISABLED  "broadband-modem-compound-identity-disabled"
 
 struct _MMBroadbandModem {
     MMBaseModem parent;
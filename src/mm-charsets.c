@@ -173,6 +173,72 @@ mm_modem_charset_byte_array_to_utf8 (GByteArray     *array,
     return converted;
 }
 
+/* UCS-2 is transcoded directly, as it is used for operator names, USSD
+ * replies and SMS texts, and going through iconv would need an iconv_open()
+ * for each of them. The results are the ones of the UCS-2BE iconv
+ * conversions, which also reject surrogates and characters outside the
+ * BMP. */
+
+static const gchar hex_digits[] = "0123456789ABCDEF";
+
+static gchar *
+ucs2_to_utf8 (const guint8 *ucs2,
+              gsize         len)
+{
+    gchar *utf8;
+    gchar *p;
+    gsize i;
+
+    if (len % 2)
+        return NULL;
+
+    /* Each UCS-2 char needs at most 3 bytes in UTF-8 */
+    p = utf8 = g_malloc ((len / 2) * 3 + 1);
+    for (i = 0; i < len; i += 2) {
+        gunichar c;
+
+        c = (ucs2[i] << 8) | ucs2[i + 1];
+        if (c < 0x80)
+            *p++ = (gchar) c;
+        else if (c >= 0xD800 && c < 0xE000) {
+            g_free (utf8);
+            return NULL;
+        } else
+            p += g_unichar_to_utf8 (c, p);
+    }
+    *p = '\0';
+    return utf8;
+}
+
+static gchar *
+utf8_to_ucs2_hex (const gchar *utf8)
+{
+    const gchar *p;
+    gchar *hex;
+    gchar *h;
+
+    if (!g_utf8_validate (utf8, -1, NULL))
+        return NULL;
+
+    /* Each UTF-8 byte ends up in at most one UCS-2 char, 4 hex digits */
+    h = hex = g_malloc (strlen (utf8) * 4 + 1);
+    for (p = utf8; *p; p = g_utf8_next_char (p)) {
+        gunichar c;
+
+        c = ((guchar) *p < 0x80 ? (gunichar) *p : g_utf8_get_char (p));
+        if (c > 0xFFFF) {
+            g_free (hex);
+            return NULL;
+        }
+        *h++ = hex_digits[(c >> 12) & 0xF];
+        *h++ = hex_digits[(c >> 8) & 0xF];
+        *h++ = hex_digits[(c >> 4) & 0xF];
+        *h++ = hex_digits[c & 0xF];
+    }
+    *h = '\0';
+    return hex;
+}
+
 char *
 mm_modem_charset_hex_to_utf8 (const char *src, MMModemCharset charset)
 {
@@ -194,6 +260,12 @@ mm_modem_charset_hex_to_utf8 (const char *src, MMModemCharset charset)
     if (charset == MM_MODEM_CHARSET_UTF8 || charset == MM_MODEM_CHARSET_IRA)
         return unconverted;
 
+    if (charset == MM_MODEM_CHARSET_UCS2) {
+        converted = ucs2_to_utf8 ((const guint8 *) unconverted, unconverted_len);
+        g_free (unconverted);
+        return converted;
+    }
+
     converted = g_convert (unconverted, unconverted_len,
                            "UTF-8//TRANSLIT", iconv_from,
                            NULL, NULL, &error);
@@ -225,6 +297,9 @@ mm_modem_charset_utf8_to_hex (const char *src, MMModemCharset charset)
     if (charset == MM_MODEM_CHARSET_UTF8 || charset == MM_MODEM_CHARSET_IRA)
         return g_strdup (src);
 
+    if (charset == MM_MODEM_CHARSET_UCS2)
+        return utf8_to_ucs2_hex (src);
+
     converted = g_convert (src, strlen (src),
                            iconv_to, "UTF-8//TRANSLIT",
                            NULL, &converted_len, &error);
@@ -329,14 +404,6 @@ static const GsmUtf8Mapping gsm_def_utf8_alphabet[GSM_DEF_ALPHABET_SIZE] = {
     TWO(0xc3, 0xb6), TWO(0xc3, 0xb1), TWO(0xc3, 0xbc), TWO(0xc3, 0xa0)
 };
 
-static guint8
-gsm_def_char_to_utf8 (const guint8 gsm, guint8 out_utf8[2])
-{
-    g_return_val_if_fail (gsm < GSM_DEF_ALPHABET_SIZE, 0);
-    memcpy (&out_utf8[0], &gsm_def_utf8_alphabet[gsm].chars[0], gsm_def_utf8_alphabet[gsm].len);
-    return gsm_def_utf8_alphabet[gsm].len;
-}
-
 static gboolean
 utf8_to_gsm_def_char (const char *utf8, guint32 len, guint8 *out_gsm)
 {
@@ -411,37 +478,47 @@ utf8_to_gsm_ext_char (const char *utf8, guint32 len, guint8 *out_gsm)
 guint8 *
 mm_charset_gsm_unpacked_to_utf8 (const guint8 *gsm, guint32 len)
 {
-    int i;
-    GByteArray *utf8;
+    guint32 i;
+    guint8 *utf8;
+    guint8 *p;
 
     g_return_val_if_fail (gsm != NULL, NULL);
     g_return_val_if_fail (len < 4096, NULL);
 
-    /* worst case initial length */
-    utf8 = g_byte_array_sized_new (len * 2 + 1);
+    /* Default alphabet chars take at most 2 bytes in UTF-8, and extended
+     * ones at most 3 for the 2 bytes of their escape sequence */
+    p = utf8 = g_malloc (len * 2 + 1);
 
     for (i = 0; i < len; i++) {
-        guint8 uchars[4];
-        guint8 ulen;
+        const GsmUtf8Mapping *mapping;
 
         if (gsm[i] == GSM_ESCAPE_CHAR) {
+            guint8 ulen;
+
             /* Extended alphabet, decode next char */
-            ulen = gsm_ext_char_to_utf8 (gsm[i+1], uchars);
-            if (ulen)
-                i += 1;
-        } else {
-            /* Default alphabet */
-            ulen = gsm_def_char_to_utf8 (gsm[i], uchars);
+            ulen = (i + 1 < len ? gsm_ext_char_to_utf8 (gsm[i + 1], p) : 0);
+            if (ulen) {
+                p += ulen;
+                i++;
+            } else
+                *p++ = '?';
+            continue;
         }
 
-        if (ulen)
-            g_byte_array_append (utf8, &uchars[0], ulen);
-        else
-            g_byte_array_append (utf8, (guint8 *) "?", 1);
+        /* Default alphabet, straight from the table */
+        if (G_UNLIKELY (gsm[i] >= GSM_DEF_ALPHABET_SIZE)) {
+            *p++ = '?';
+            continue;
+        }
+        mapping = &gsm_def_utf8_alphabet[gsm[i]];
+        p[0] = mapping->chars[0];
+        if (mapping->len > 1)
+            p[1] = mapping->chars[1];
+        p += mapping->len;
     }
 
-    g_byte_array_append (utf8, (guint8 *) "\0", 1);  /* NULL terminator */
-    return g_byte_array_free (utf8, FALSE);
+    *p = '\0';
+    return utf8;
 }
 
 guint8 *
@@ -643,18 +720,48 @@ mm_charset_can_convert_to (const char *utf8,
     return TRUE;
 }
 
+/* Septets are packed and unpacked in groups of 8, which take exactly 7 bytes
+ * (56 bits). Wherever a group starts within a byte, the group and its
+ * leading bits fit in a 64-bit word, so each group is converted with a
+ * single load or store of the bytes it spans. */
+#define SEPTETS_PER_GROUP 8
+
+/* Number of bytes spanned by a group starting at the given bit of a byte */
+#define GROUP_BYTES(bit) (((bit) + (SEPTETS_PER_GROUP * 7) + 7) / 8)
+
 guint8 *
 mm_charset_gsm_unpack (const guint8 *gsm,
                        guint32 num_septets,
                        guint8 start_offset,  /* in _bits_ */
                        guint32 *out_unpacked_len)
 {
-    GByteArray *unpacked;
-    int i;
+    guint8 *unpacked;
+    guint32 i = 0;
 
-    unpacked = g_byte_array_sized_new (num_septets + 1);
+    unpacked = g_malloc (num_septets + 1);
 
-    for (i = 0; i < num_septets; i++) {
+    for (; i + SEPTETS_PER_GROUP <= num_septets; i += SEPTETS_PER_GROUP) {
+        const guint8 *octets;
+        guint64 word = 0;
+        guint32 start_bit;
+        guint offset;
+        guint j;
+
+        start_bit = start_offset + (i * 7); /* Overall bit offset of the group in buffer */
+        offset = start_bit % 8;
+        octets = &gsm[start_bit / 8];
+
+        /* Little-endian load of just the bytes spanned by the group */
+        for (j = GROUP_BYTES (offset); j > 0; j--)
+            word = (word << 8) | octets[j - 1];
+        word >>= offset;
+
+        for (j = 0; j < SEPTETS_PER_GROUP; j++, word >>= 7)
+            unpacked[i + j] = word & 0x7F;
+    }
+
+    /* Trailing septets, one by one */
+    for (; i < num_septets; i++) {
         guint8 bits_here, bits_in_next, octet, offset, c;
         guint32 start_bit;
 
@@ -672,11 +779,11 @@ mm_charset_gsm_unpack (const guint8 *gsm,
             octet = gsm[(start_bit / 8) + 1];
             c |= (octet & (0xFF >> (8 - bits_in_next))) << bits_here;
         }
-        g_byte_array_append (unpacked, &c, 1);
+        unpacked[i] = c;
     }
 
-    *out_unpacked_len = unpacked->len;
-    return g_byte_array_free (unpacked, FALSE);
+    *out_unpacked_len = num_septets;
+    return unpacked;
 }
 
 guint8 *
@@ -686,8 +793,8 @@ mm_charset_gsm_pack (const guint8 *src,
                      guint32 *out_packed_len)
 {
     guint8 *packed;
-    guint octet = 0, lshift, plen;
-    int i = 0;
+    guint octet, lshift, plen;
+    guint32 i = 0;
 
     g_return_val_if_fail (start_offset < 8, NULL);
 
@@ -698,7 +805,27 @@ mm_charset_gsm_pack (const guint8 *src,
 
     packed = g_malloc0 (plen);
 
-    for (i = 0, lshift = start_offset; i < src_len; i++) {
+    /* All groups start at start_offset within their first byte, as each one
+     * takes 7 whole bytes */
+    for (; i + SEPTETS_PER_GROUP <= src_len; i += SEPTETS_PER_GROUP) {
+        guint8 *octets;
+        guint64 word = 0;
+        guint j;
+
+        for (j = SEPTETS_PER_GROUP; j > 0; j--)
+            word = (word << 7) | (src[i + j - 1] & 0x7F);
+        word <<= start_offset;
+
+        /* Little-endian store of the bytes spanned by the group; the first
+         * one may already have the last bits of the previous group */
+        octets = &packed[(i / SEPTETS_PER_GROUP) * 7];
+        for (j = 0; j < GROUP_BYTES (start_offset); j++, word >>= 8)
+            octets[j] |= word & 0xFF;
+    }
+
+    /* Trailing septets, one by one */
+    octet = (i / SEPTETS_PER_GROUP) * 7;
+    for (lshift = start_offset; i < src_len; i++) {
         packed[octet] |= (src[i] & 0x7F) << lshift;
         if (lshift > 1) {
             /* Grab the lost bits and add to next octet */
@@ -881,28 +1008,11 @@ mm_utf8_take_and_convert_to_charset (gchar *str,
         break;
     }
 
-    case MM_MODEM_CHARSET_UCS2: {
-        const gchar *iconv_to;
-        gsize encoded_len = 0;
-        GError *error = NULL;
-        gchar *hex;
-
-        iconv_to = charset_iconv_from (charset);
-        encoded = g_convert (str, strlen (str),
-                             iconv_to, "UTF-8",
-                             NULL, &encoded_len, &error);
-        if (!encoded || error) {
-            g_clear_error (&error);
-            encoded = NULL;
-        }
-
+    case MM_MODEM_CHARSET_UCS2:
         /* Get hex representation of the string */
-        hex = mm_utils_bin2hexstr ((guint8 *)encoded, encoded_len);
-        g_free (encoded);
-        encoded = hex;
+        encoded = utf8_to_ucs2_hex (str);
         g_free (str);
         break;
-    }
 
     /* If the given charset is ASCII or UTF8, we really expect the final string
      * already here. */
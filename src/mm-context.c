@@ -41,6 +41,7 @@ static gboolean      debug;
 static MMFilterRule  filter_policy = MM_FILTER_POLICY_DEFAULT;
 static gboolean      no_auto_scan = NO_AUTO_SCAN_DEFAULT;
 static const gchar  *initial_kernel_events;
+static const gchar  *probe_cache;
 
 static gboolean
 filter_policy_option_arg (const gchar  *option_name,
@@ -90,6 +91,11 @@ static const GOptionEntry entries[] = {
         "Path to initial kernel events file",
         "[PATH]"
     },
+    {
+        "probe-cache", 0, 0, G_OPTION_ARG_FILENAME, &probe_cache,
+        "Path to persistent cache of port probing results",
+        "[PATH]"
+    },
     {
         "debug", 0, 0, G_OPTION_ARG_NONE, &debug,
         "Run with extended debugging capabilities",
@@ -120,6 +126,12 @@ mm_context_get_initial_kernel_events (void)
     return initial_kernel_events;
 }
 
+const gchar *
+mm_context_get_probe_cache (void)
+{
+    return probe_cache;
+}
+
 gboolean
 mm_context_get_no_auto_scan (void)
 {
@@ -140,6 +152,8 @@ static const gchar *log_file;
 static gboolean     log_journal;
 static gboolean     log_show_ts;
 static gboolean     log_rel_ts;
+static const gchar *log_async;
+static const gchar *log_capture;
 
 static const GOptionEntry log_entries[] = {
     {
@@ -169,6 +183,16 @@ static const GOptionEntry log_entries[] = {
         "Use relative timestamps (from MM start)",
         NULL
     },
+    {
+        "log-async", 0, 0, G_OPTION_ARG_STRING, &log_async,
+        "Write logs from a background thread; when the buffer is full, either block or drop new messages",
+        "[block|drop]"
+    },
+    {
+        "log-capture", 0, 0, G_OPTION_ARG_FILENAME, &log_capture,
+        "Capture the raw serial port traffic in binary format to the given file",
+        "[PATH]"
+    },
     { NULL }
 };
 
@@ -216,6 +240,18 @@ mm_context_get_log_relative_timestamps (void)
     return log_rel_ts;
 }
 
+const gchar *
+mm_context_get_log_async (void)
+{
+    return log_async;
+}
+
+const gchar *
+mm_context_get_log_capture (void)
+{
+    return log_capture;
+}
+
 /*****************************************************************************/
 /* Test context */
 
@@ -30,6 +30,7 @@ void mm_context_init (gint    argc,
 
 gboolean     mm_context_get_debug                 (void);
 const gchar *mm_context_get_initial_kernel_events (void);
+const gchar *mm_context_get_probe_cache           (void);
 gboolean     mm_context_get_no_auto_scan          (void);
 
 /* Filter support */
@@ -41,6 +42,8 @@ const gchar *mm_context_get_log_file                (void);
 gboolean     mm_context_get_log_journal             (void);
 gboolean     mm_context_get_log_timestamps          (void);
 gboolean     mm_context_get_log_relative_timestamps (void);
+const gchar *mm_context_get_log_async               (void);
+const gchar *mm_context_get_log_capture             (void);
 
 /* Testing support */
 gboolean     mm_context_get_test_session    (void);
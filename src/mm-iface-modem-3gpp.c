@@ -1542,6 +1542,52 @@ mm_iface_modem_3gpp_update_eps_registration_state (MMIfaceModem3gpp *self,
     update_registration_state (self, get_consolidated_reg_state (ctx), TRUE);
 }
 
+void
+mm_iface_modem_3gpp_update_registration (MMIfaceModem3gpp *self,
+                                         const MM3gppCregResult *result,
+                                         gboolean update_access_technologies)
+{
+    gulong lac = 0;
+    gulong tac = 0;
+
+    /* Report new registration state and fix LAC/TAC.
+     * According to 3GPP TS 27.007:
+     *  - If CREG reports <AcT> 7 (LTE) then the <lac> field contains TAC
+     *  - CEREG and C5GREG always report TAC
+     */
+    switch (result->domain) {
+    case MM_3GPP_CREG_DOMAIN_CS:
+        if (result->act == MM_MODEM_ACCESS_TECHNOLOGY_LTE)
+            tac = result->lac;
+        else
+            lac = result->lac;
+        mm_iface_modem_3gpp_update_cs_registration_state (self, result->state);
+        break;
+    case MM_3GPP_CREG_DOMAIN_PS:
+        lac = result->lac;
+        mm_iface_modem_3gpp_update_ps_registration_state (self, result->state);
+        break;
+    case MM_3GPP_CREG_DOMAIN_EPS:
+        tac = result->lac;
+        mm_iface_modem_3gpp_update_eps_registration_state (self, result->state);
+        break;
+    case MM_3GPP_CREG_DOMAIN_5GS:
+        /* There is no 5GS registration state to consolidate yet, only
+         * location and access technology are reported */
+        tac = result->lac;
+        mm_dbg ("Modem %s: ignoring 5GS registration state (%s)",
+                g_dbus_object_get_object_path (G_DBUS_OBJECT (self)),
+                mm_modem_3gpp_registration_state_get_string (result->state));
+        break;
+    default:
+        g_assert_not_reached ();
+    }
+
+    if (update_access_technologies)
+        mm_iface_modem_3gpp_update_access_technologies (self, result->act);
+    mm_iface_modem_3gpp_update_location (self, lac, tac, result->ci);
+}
+
 /*****************************************************************************/
 
 typedef struct {
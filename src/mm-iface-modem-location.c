@@ -44,10 +44,16 @@ typedef struct {
     /* 3GPP location */
     MMLocation3gpp *location_3gpp;
     /* GPS location */
-    time_t location_gps_nmea_last_time;
     MMLocationGpsNmea *location_gps_nmea;
-    time_t location_gps_raw_last_time;
     MMLocationGpsRaw *location_gps_raw;
+    /* GPS location updates not yet published */
+    gboolean gps_update_nmea;
+    gboolean gps_update_raw;
+    guint gps_update_id;
+    gint64 gps_last_trace_time;
+    gint64 gps_last_update_time;
+    /* UTC time reported in the current fix cycle */
+    gchar gps_epoch[MM_GPS_EPOCH_MAX_LEN + 1];
     /* CDMA BS location */
     MMLocationCdmaBs *location_cdma_bs;
 } LocationContext;
@@ -55,6 +61,8 @@ typedef struct {
 static void
 location_context_free (LocationContext *ctx)
 {
+    if (ctx->gps_update_id)
+        g_source_remove (ctx->gps_update_id);
     if (ctx->location_3gpp)
         g_object_unref (ctx->location_3gpp);
     if (ctx->location_gps_nmea)
@@ -167,6 +175,7 @@ build_location_dictionary (GVariant *previous,
                                "{uv}",
                                MM_MODEM_LOCATION_SOURCE_3GPP_LAC_CI,
                                location_3gpp_value);
+        g_variant_unref (location_3gpp_value);
     }
 
     /* If a new one given, use it */
@@ -176,11 +185,13 @@ build_location_dictionary (GVariant *previous,
         location_gps_nmea_value = mm_location_gps_nmea_get_string_variant (location_gps_nmea);
     }
 
-    if (location_gps_nmea_value)
+    if (location_gps_nmea_value) {
         g_variant_builder_add (&builder,
                                "{uv}",
                                MM_MODEM_LOCATION_SOURCE_GPS_NMEA,
                                location_gps_nmea_value);
+        g_variant_unref (location_gps_nmea_value);
+    }
 
     /* If a new one given, use it */
     if (location_gps_raw) {
@@ -189,11 +200,13 @@ build_location_dictionary (GVariant *previous,
         location_gps_raw_value = mm_location_gps_raw_get_dictionary (location_gps_raw);
     }
 
-    if (location_gps_raw_value)
+    if (location_gps_raw_value) {
         g_variant_builder_add (&builder,
                                "{uv}",
                                MM_MODEM_LOCATION_SOURCE_GPS_RAW,
                                location_gps_raw_value);
+        g_variant_unref (location_gps_raw_value);
+    }
 
     /* If a new one given, use it */
     if (location_cdma_bs) {
@@ -202,11 +215,13 @@ build_location_dictionary (GVariant *previous,
         location_cdma_bs_value = mm_location_cdma_bs_get_dictionary (location_cdma_bs);
     }
 
-    if (location_cdma_bs_value)
+    if (location_cdma_bs_value) {
         g_variant_builder_add (&builder,
                                "{uv}",
                                MM_MODEM_LOCATION_SOURCE_CDMA_BS,
                                location_cdma_bs_value);
+        g_variant_unref (location_cdma_bs_value);
+    }
 
     return g_variant_builder_end (&builder);
 }
@@ -237,14 +252,110 @@ notify_gps_location_update (MMIfaceModemLocation *self,
                                        NULL));
 }
 
+static gboolean gps_update_timeout (MMIfaceModemLocation *self);
+
+static void
+gps_update_schedule (MMIfaceModemLocation *self,
+                     LocationContext *ctx,
+                     gint64 delay_us)
+{
+    if (ctx->gps_update_id)
+        return;
+
+    ctx->gps_update_id = g_timeout_add ((guint) ((delay_us + 999) / 1000),
+                                        (GSourceFunc) gps_update_timeout,
+                                        self);
+}
+
+/* Drops the pending GPS location update of the disabled source. The fix
+ * cycle state and the refresh rate limit are kept as long as the other GPS
+ * source is still enabled. */
+static void
+gps_update_reset (LocationContext *ctx,
+                  MMModemLocationSource disabled,
+                  MMModemLocationSource enabled)
+{
+    if (disabled & MM_MODEM_LOCATION_SOURCE_GPS_NMEA)
+        ctx->gps_update_nmea = FALSE;
+    if (disabled & MM_MODEM_LOCATION_SOURCE_GPS_RAW)
+        ctx->gps_update_raw = FALSE;
+
+    if (enabled & (MM_MODEM_LOCATION_SOURCE_GPS_NMEA | MM_MODEM_LOCATION_SOURCE_GPS_RAW))
+        return;
+
+    if (ctx->gps_update_id) {
+        g_source_remove (ctx->gps_update_id);
+        ctx->gps_update_id = 0;
+    }
+    ctx->gps_last_trace_time = 0;
+    ctx->gps_last_update_time = 0;
+    ctx->gps_epoch[0] = '\0';
+}
+
+/* Publishes the pending GPS location updates once the fix cycle is complete
+ * and the refresh rate allows it, or schedules it for later */
+static void
+gps_update_flush (MMIfaceModemLocation *self,
+                  LocationContext *ctx,
+                  gboolean cycle_complete)
+{
+    MmGdbusModemLocation *skeleton = NULL;
+    gint64 now;
+    gint64 delay_us;
+
+    if (!ctx->gps_update_nmea && !ctx->gps_update_raw)
+        return;
+
+    g_object_get (self,
+                  MM_IFACE_MODEM_LOCATION_DBUS_SKELETON, &skeleton,
+                  NULL);
+    if (!skeleton) {
+        ctx->gps_update_nmea = FALSE;
+        ctx->gps_update_raw = FALSE;
+        return;
+    }
+
+    now = g_get_monotonic_time ();
+    if (!mm_gps_update_ready (now,
+                              cycle_complete,
+                              ctx->gps_last_trace_time,
+                              ctx->gps_last_update_time,
+                              mm_gdbus_modem_location_get_gps_refresh_rate_ms (skeleton),
+                              &delay_us)) {
+        gps_update_schedule (self, ctx, delay_us);
+        g_object_unref (skeleton);
+        return;
+    }
+
+    ctx->gps_last_update_time = now;
+    notify_gps_location_update (self,
+                                skeleton,
+                                ctx->gps_update_nmea ? ctx->location_gps_nmea : NULL,
+                                ctx->gps_update_raw ? ctx->location_gps_raw : NULL);
+    ctx->gps_update_nmea = FALSE;
+    ctx->gps_update_raw = FALSE;
+    g_object_unref (skeleton);
+}
+
+static gboolean
+gps_update_timeout (MMIfaceModemLocation *self)
+{
+    LocationContext *ctx;
+
+    ctx = get_location_context (self);
+    ctx->gps_update_id = 0;
+    gps_update_flush (self, ctx, FALSE);
+
+    return G_SOURCE_REMOVE;
+}
+
 void
 mm_iface_modem_location_gps_update (MMIfaceModemLocation *self,
                                     const gchar *nmea_trace)
 {
     MmGdbusModemLocation *skeleton;
     LocationContext *ctx;
-    gboolean update_nmea = FALSE;
-    gboolean update_raw = FALSE;
+    MMModemLocationSource enabled;
 
     ctx = get_location_context (self);
     g_object_get (self,
@@ -252,34 +363,31 @@ mm_iface_modem_location_gps_update (MMIfaceModemLocation *self,
                   NULL);
     if (!skeleton)
         return;
+    enabled = mm_gdbus_modem_location_get_enabled (skeleton);
+    g_object_unref (skeleton);
 
-    if (mm_gdbus_modem_location_get_enabled (skeleton) & MM_MODEM_LOCATION_SOURCE_GPS_NMEA) {
+    /* The first trace of a new fix cycle completes the previous one, so
+     * publish it before the new trace is added */
+    if (mm_gps_trace_update_epoch (nmea_trace, ctx->gps_epoch))
+        gps_update_flush (self, ctx, TRUE);
+
+    if (enabled & MM_MODEM_LOCATION_SOURCE_GPS_NMEA) {
         g_assert (ctx->location_gps_nmea != NULL);
-        if (mm_location_gps_nmea_add_trace (ctx->location_gps_nmea, nmea_trace) &&
-            (ctx->location_gps_nmea_last_time == 0 ||
-             time (NULL) - ctx->location_gps_nmea_last_time >= mm_gdbus_modem_location_get_gps_refresh_rate (skeleton))) {
-            ctx->location_gps_nmea_last_time = time (NULL);
-            update_nmea = TRUE;
-        }
+        if (mm_location_gps_nmea_add_trace (ctx->location_gps_nmea, nmea_trace))
+            ctx->gps_update_nmea = TRUE;
     }
 
-    if (mm_gdbus_modem_location_get_enabled (skeleton) & MM_MODEM_LOCATION_SOURCE_GPS_RAW) {
+    if (enabled & MM_MODEM_LOCATION_SOURCE_GPS_RAW) {
         g_assert (ctx->location_gps_raw != NULL);
-        if (mm_location_gps_raw_add_trace (ctx->location_gps_raw, nmea_trace) &&
-            (ctx->location_gps_raw_last_time == 0 ||
-             time (NULL) - ctx->location_gps_raw_last_time >= mm_gdbus_modem_location_get_gps_refresh_rate (skeleton))) {
-            ctx->location_gps_raw_last_time = time (NULL);
-            update_raw = TRUE;
-        }
+        if (mm_location_gps_raw_add_trace (ctx->location_gps_raw, nmea_trace))
+            ctx->gps_update_raw = TRUE;
     }
 
-    if (update_nmea || update_raw)
-        notify_gps_location_update (self,
-                                    skeleton,
-                                    update_nmea ? ctx->location_gps_nmea : NULL,
-                                    update_raw ? ctx->location_gps_raw : NULL);
-
-    g_object_unref (skeleton);
+    /* Otherwise, publish once the traces of the cycle stop coming */
+    if (ctx->gps_update_nmea || ctx->gps_update_raw) {
+        ctx->gps_last_trace_time = g_get_monotonic_time ();
+        gps_update_schedule (self, ctx, MM_GPS_UPDATE_COALESCE_MS * 1000);
+    }
 }
 
 /*****************************************************************************/
@@ -491,15 +599,19 @@ update_location_source_status (MMIfaceModemLocation *self,
         if (enabled) {
             if (!ctx->location_gps_nmea)
                 ctx->location_gps_nmea = mm_location_gps_nmea_new ();
-        } else
+        } else {
+            gps_update_reset (ctx, source, mask);
             g_clear_object (&ctx->location_gps_nmea);
+        }
         break;
     case MM_MODEM_LOCATION_SOURCE_GPS_RAW:
         if (enabled) {
             if (!ctx->location_gps_raw)
                 ctx->location_gps_raw = mm_location_gps_raw_new ();
-        } else
+        } else {
+            gps_update_reset (ctx, source, mask);
             g_clear_object (&ctx->location_gps_raw);
+        }
         break;
     case MM_MODEM_LOCATION_SOURCE_CDMA_BS:
         if (enabled) {
@@ -1166,6 +1278,8 @@ typedef struct {
     GDBusMethodInvocation *invocation;
     MMIfaceModemLocation *self;
     guint rate;
+    /* Whether the rate is given in milliseconds */
+    gboolean ms;
 } HandleSetGpsRefreshRateContext;
 
 static void
@@ -1184,6 +1298,8 @@ handle_set_gps_refresh_rate_auth_ready (MMBaseModem *self,
 {
     GError *error = NULL;
     MMModemState modem_state;
+    guint rate_secs;
+    guint rate_ms;
 
     if (!mm_base_modem_authorize_finish (self, res, &error)) {
         g_dbus_method_invocation_take_error (ctx->invocation, error);
@@ -1216,17 +1332,23 @@ handle_set_gps_refresh_rate_auth_ready (MMBaseModem *self,
         return;
     }
 
-    /* Set the new rate in the interface */
-    mm_gdbus_modem_location_set_gps_refresh_rate (ctx->skeleton, ctx->rate);
-    mm_gdbus_modem_location_complete_set_gps_refresh_rate (ctx->skeleton, ctx->invocation);
+    /* Set the new rate in the interface, in both resolutions */
+    mm_gps_refresh_rate_normalize (ctx->rate, ctx->ms, &rate_secs, &rate_ms);
+    mm_gdbus_modem_location_set_gps_refresh_rate_ms (ctx->skeleton, rate_ms);
+    mm_gdbus_modem_location_set_gps_refresh_rate (ctx->skeleton, rate_secs);
+    if (ctx->ms)
+        mm_gdbus_modem_location_complete_set_gps_refresh_rate_ms (ctx->skeleton, ctx->invocation);
+    else
+        mm_gdbus_modem_location_complete_set_gps_refresh_rate (ctx->skeleton, ctx->invocation);
     handle_set_gps_refresh_rate_context_free (ctx);
 }
 
-static gboolean
-handle_set_gps_refresh_rate (MmGdbusModemLocation *skeleton,
-                             GDBusMethodInvocation *invocation,
-                             guint rate,
-                             MMIfaceModemLocation *self)
+static void
+set_gps_refresh_rate (MmGdbusModemLocation *skeleton,
+                      GDBusMethodInvocation *invocation,
+                      guint rate,
+                      gboolean ms,
+                      MMIfaceModemLocation *self)
 {
     HandleSetGpsRefreshRateContext *ctx;
 
@@ -1235,12 +1357,32 @@ handle_set_gps_refresh_rate (MmGdbusModemLocation *skeleton,
     ctx->invocation = g_object_ref (invocation);
     ctx->self = g_object_ref (self);
     ctx->rate = rate;
+    ctx->ms = ms;
 
     mm_base_modem_authorize (MM_BASE_MODEM (self),
                              invocation,
                              MM_AUTHORIZATION_DEVICE_CONTROL,
                              (GAsyncReadyCallback)handle_set_gps_refresh_rate_auth_ready,
                              ctx);
+}
+
+static gboolean
+handle_set_gps_refresh_rate (MmGdbusModemLocation *skeleton,
+                             GDBusMethodInvocation *invocation,
+                             guint rate,
+                             MMIfaceModemLocation *self)
+{
+    set_gps_refresh_rate (skeleton, invocation, rate, FALSE, self);
+    return TRUE;
+}
+
+static gboolean
+handle_set_gps_refresh_rate_ms (MmGdbusModemLocation *skeleton,
+                                GDBusMethodInvocation *invocation,
+                                guint rate,
+                                MMIfaceModemLocation *self)
+{
+    set_gps_refresh_rate (skeleton, invocation, rate, TRUE, self);
     return TRUE;
 }
 
@@ -1790,9 +1932,11 @@ interface_initialization_step (GTask *task)
     case INITIALIZATION_STEP_GPS_REFRESH_RATE:
         /* If we have GPS capabilities, expose the GPS refresh rate */
         if (ctx->capabilities & ((MM_MODEM_LOCATION_SOURCE_GPS_RAW |
-                                  MM_MODEM_LOCATION_SOURCE_GPS_NMEA)))
+                                  MM_MODEM_LOCATION_SOURCE_GPS_NMEA))) {
             /* Set the default rate in the interface */
             mm_gdbus_modem_location_set_gps_refresh_rate (ctx->skeleton, MM_LOCATION_GPS_REFRESH_TIME_SECS);
+            mm_gdbus_modem_location_set_gps_refresh_rate_ms (ctx->skeleton, MM_LOCATION_GPS_REFRESH_TIME_SECS * 1000);
+        }
 
         /* Fall down to next step */
         ctx->step++;
@@ -1817,6 +1961,10 @@ interface_initialization_step (GTask *task)
                           "handle-set-gps-refresh-rate",
                           G_CALLBACK (handle_set_gps_refresh_rate),
                           self);
+        g_signal_connect (ctx->skeleton,
+                          "handle-set-gps-refresh-rate-ms",
+                          G_CALLBACK (handle_set_gps_refresh_rate_ms),
+                          self);
         g_signal_connect (ctx->skeleton,
                           "handle-get-location",
                           G_CALLBACK (handle_get_location),
@@ -28,6 +28,7 @@
 #include "mm-bearer-list.h"
 #include "mm-log.h"
 #include "mm-context.h"
+#include "mm-probe-cache.h"
 
 #define SIGNAL_QUALITY_RECENT_TIMEOUT_SEC 60
 
@@ -960,6 +961,95 @@ handle_list_bearers (MmGdbusModem *skeleton,
 
 /*****************************************************************************/
 
+static gint
+port_name_cmp (MMPort *a,
+               MMPort *b)
+{
+    return g_strcmp0 (mm_port_get_device (a), mm_port_get_device (b));
+}
+
+typedef struct {
+    MmGdbusModem *skeleton;
+    GDBusMethodInvocation *invocation;
+    MMIfaceModem *self;
+} HandleGetPortStatisticsContext;
+
+static void
+handle_get_port_statistics_context_free (HandleGetPortStatisticsContext *ctx)
+{
+    g_object_unref (ctx->skeleton);
+    g_object_unref (ctx->invocation);
+    g_object_unref (ctx->self);
+    g_free (ctx);
+}
+
+static void
+handle_get_port_statistics_auth_ready (MMBaseModem *self,
+                                       GAsyncResult *res,
+                                       HandleGetPortStatisticsContext *ctx)
+{
+    GVariantBuilder builder;
+    GError *error = NULL;
+    GList *ports;
+    GList *l;
+
+    if (!mm_base_modem_authorize_finish (self, res, &error)) {
+        g_dbus_method_invocation_take_error (ctx->invocation, error);
+        handle_get_port_statistics_context_free (ctx);
+        return;
+    }
+
+    ports = mm_base_modem_find_ports (self,
+                                      MM_PORT_SUBSYS_UNKNOWN,
+                                      MM_PORT_TYPE_UNKNOWN,
+                                      NULL);
+    ports = g_list_sort (ports, (GCompareFunc) port_name_cmp);
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+    for (l = ports; l; l = g_list_next (l)) {
+        MMPort *port = MM_PORT (l->data);
+
+        /* Only serial ports go through our own I/O, and so only them keep
+         * statistics; QMI or MBIM ports would just report zeros */
+        if (!MM_IS_PORT_SERIAL (port))
+            continue;
+
+        g_variant_builder_add_value (&builder,
+                                     mm_port_stats_get_dictionary (mm_port_peek_stats (port),
+                                                                   mm_port_get_device (port)));
+    }
+    g_list_free_full (ports, g_object_unref);
+
+    mm_gdbus_modem_complete_get_port_statistics (ctx->skeleton,
+                                                 ctx->invocation,
+                                                 g_variant_builder_end (&builder));
+    handle_get_port_statistics_context_free (ctx);
+}
+
+static gboolean
+handle_get_port_statistics (MmGdbusModem *skeleton,
+                            GDBusMethodInvocation *invocation,
+                            MMIfaceModem *self)
+{
+    HandleGetPortStatisticsContext *ctx;
+
+    ctx = g_new (HandleGetPortStatisticsContext, 1);
+    ctx->skeleton = g_object_ref (skeleton);
+    ctx->invocation = g_object_ref (invocation);
+    ctx->self = g_object_ref (self);
+
+    /* The statistics tell which commands are sent to the modem, so they are
+     * as sensitive as the traffic itself */
+    mm_base_modem_authorize (MM_BASE_MODEM (self),
+                             invocation,
+                             MM_AUTHORIZATION_DEVICE_CONTROL,
+                             (GAsyncReadyCallback)handle_get_port_statistics_auth_ready,
+                             ctx);
+    return TRUE;
+}
+
+/*****************************************************************************/
+
 void
 mm_iface_modem_update_access_technologies (MMIfaceModem *self,
                                            MMModemAccessTechnology new_access_tech,
@@ -4326,11 +4416,42 @@ load_supported_capabilities_ready (MMIfaceModem *self,
 
 STR_REPLY_READY_FN (manufacturer, "Manufacturer")
 STR_REPLY_READY_FN (model, "Model")
-STR_REPLY_READY_FN (revision, "Revision")
 STR_REPLY_READY_FN (hardware_revision, "HardwareRevision")
 STR_REPLY_READY_FN (equipment_identifier, "Equipment Identifier")
 STR_REPLY_READY_FN (device_identifier, "Device Identifier")
 
+static void
+load_revision_ready (MMIfaceModem *self,
+                     GAsyncResult *res,
+                     GTask *task)
+{
+    InitializationContext *ctx;
+    GError *error = NULL;
+    gchar *val;
+
+    ctx = g_task_get_task_data (task);
+
+    val = MM_IFACE_MODEM_GET_INTERFACE (self)->load_revision_finish (self, res, &error);
+    mm_gdbus_modem_set_revision (ctx->skeleton, val);
+
+    if (error) {
+        mm_warn ("couldn't load Revision: '%s'", error->message);
+        g_error_free (error);
+    } else {
+        /* Lazily validate the cached probing results of the device */
+        mm_probe_cache_validate_revision (mm_base_modem_get_device (MM_BASE_MODEM (self)),
+                                          mm_base_modem_get_vendor_id (MM_BASE_MODEM (self)),
+                                          mm_base_modem_get_product_id (MM_BASE_MODEM (self)),
+                                          mm_base_modem_get_plugin (MM_BASE_MODEM (self)),
+                                          val);
+    }
+    g_free (val);
+
+    /* Go on to next step */
+    ctx->step++;
+    interface_initialization_step (task);
+}
+
 static void
 load_supported_modes_ready (MMIfaceModem *self,
                             GAsyncResult *res,
@@ -5269,6 +5390,7 @@ interface_initialization_step (GTask *task)
                           "signal::handle-command",                  G_CALLBACK (handle_command),                  self,
                           "signal::handle-delete-bearer",            G_CALLBACK (handle_delete_bearer),            self,
                           "signal::handle-list-bearers",             G_CALLBACK (handle_list_bearers),             self,
+                          "signal::handle-get-port-statistics",      G_CALLBACK (handle_get_port_statistics),      self,
                           "signal::handle-enable",                   G_CALLBACK (handle_enable),                   self,
                           "signal::handle-set-current-bands",        G_CALLBACK (handle_set_current_bands),        self,
                           "signal::handle-set-current-modes",        G_CALLBACK (handle_set_current_modes),        self,
@@ -23,6 +23,7 @@
 #include <sys/stat.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/uio.h>
 
 #include <ModemManager.h>
 #include <mm-errors-types.h>
@@ -74,7 +75,34 @@ static const LogDesc level_descs[] = {
 };
 
 static GString *msgbuf = NULL;
-static volatile gsize msgbuf_once = 0;
+static GMutex msgbuf_lock;
+
+/* Asynchronous logging (see below) */
+#define LOG_ASYNC_SLOTS 1024 /* must be a power of 2 */
+#define LOG_ASYNC_BATCH 64
+
+typedef struct {
+    const char *loc;
+    const char *func;
+    int syslog_level;
+    GString *message;
+} LogSlot;
+
+/* Only set or cleared with the producer lock held */
+static GThread *async_thread = NULL;
+static gboolean async_drop = FALSE;
+static LogSlot async_slots[LOG_ASYNC_SLOTS];
+/* Free running counters, only updated by producers and by the writer respectively */
+static volatile gint async_head = 0;
+static volatile gint async_tail = 0;
+static volatile gint async_stop = 0;
+static volatile gint async_dropped = 0;
+static GMutex async_producer_lock;
+static GMutex async_wait_lock;
+static GCond async_writer_cond;
+static GCond async_producer_cond;
+static volatile gint async_writer_waiting = 0;
+static volatile gint async_producer_waiting = 0;
 
 static int
 mm_to_syslog_priority (MMLogLevel level)
@@ -190,31 +218,237 @@ log_backend_systemd_journal (const char *loc,
 }
 #endif
 
-void
-_mm_log (const char *loc,
-         const char *func,
-         MMLogLevel level,
-         const char *fmt,
-         ...)
+/*****************************************************************************/
+/* Asynchronous logging
+ *
+ * Messages are formatted by the logging thread directly into the slots of a
+ * ring buffer, and written out in batches by a dedicated writer thread. The
+ * ring counters are only updated atomically, so the writer never holds a lock
+ * that the logging threads need; these are just serialized among themselves.
+ * When the ring is full, new messages are either dropped (and accounted) or
+ * the logging thread blocks until the writer frees some slot, depending on the
+ * configured policy.
+ */
+
+static void
+log_async_wake (volatile gint *waiting,
+                GCond *cond)
 {
-    va_list args;
-    GTimeVal tv;
+    if (g_atomic_int_get (waiting)) {
+        g_mutex_lock (&async_wait_lock);
+        g_cond_signal (cond);
+        g_mutex_unlock (&async_wait_lock);
+    }
+}
 
-    if (!(log_level & level))
+/* Returns FALSE if asynchronous logging isn't running, so that the message
+ * is logged synchronously instead. Otherwise, returns TRUE and the slot to
+ * fill in and commit, or NULL if the message is dropped. */
+static gboolean
+log_async_reserve (LogSlot **out_slot)
+{
+    guint head;
+
+    g_mutex_lock (&async_producer_lock);
+
+    /* It may have been stopped since the caller looked */
+    if (!async_thread) {
+        g_mutex_unlock (&async_producer_lock);
+        return FALSE;
+    }
+
+    head = (guint) g_atomic_int_get (&async_head);
+    while (head - (guint) g_atomic_int_get (&async_tail) >= LOG_ASYNC_SLOTS) {
+        if (async_drop) {
+            g_atomic_int_inc (&async_dropped);
+            g_mutex_unlock (&async_producer_lock);
+            *out_slot = NULL;
+            return TRUE;
+        }
+
+        g_mutex_lock (&async_wait_lock);
+        g_atomic_int_set (&async_producer_waiting, 1);
+        if (head - (guint) g_atomic_int_get (&async_tail) >= LOG_ASYNC_SLOTS)
+            g_cond_wait (&async_producer_cond, &async_wait_lock);
+        g_atomic_int_set (&async_producer_waiting, 0);
+        g_mutex_unlock (&async_wait_lock);
+    }
+
+    *out_slot = &async_slots[head & (LOG_ASYNC_SLOTS - 1)];
+    return TRUE;
+}
+
+static void
+log_async_commit (void)
+{
+    g_atomic_int_inc (&async_head);
+    g_mutex_unlock (&async_producer_lock);
+
+    log_async_wake (&async_writer_waiting, &async_writer_cond);
+}
+
+static void
+log_async_write_batch (guint first,
+                       guint n)
+{
+    guint i;
+
+    /* A single write (and sync) for all the messages in the batch */
+    if (log_backend == log_backend_file) {
+        struct iovec iov[LOG_ASYNC_BATCH];
+        ssize_t ign;
+
+        for (i = 0; i < n; i++) {
+            LogSlot *slot = &async_slots[(first + i) & (LOG_ASYNC_SLOTS - 1)];
+
+            iov[i].iov_base = slot->message->str;
+            iov[i].iov_len = slot->message->len;
+        }
+        ign = writev (logfd, iov, n);
+        if (ign) {} /* whatever; really shut up about unused result */
+
+        fsync (logfd);
         return;
+    }
 
-    if (g_once_init_enter (&msgbuf_once)) {
-        msgbuf = g_string_sized_new (512);
-        g_once_init_leave (&msgbuf_once, 1);
-    } else
-        g_string_truncate (msgbuf, 0);
+    for (i = 0; i < n; i++) {
+        LogSlot *slot = &async_slots[(first + i) & (LOG_ASYNC_SLOTS - 1)];
+
+        log_backend (slot->loc, slot->func, slot->syslog_level, slot->message->str, slot->message->len);
+    }
+}
+
+static void
+log_async_report_dropped (guint n_dropped)
+{
+    gchar *message;
+
+    message = g_strdup_printf ("%s%u log messages dropped\n",
+                               append_log_level_text ? "<warn>  " : "",
+                               n_dropped);
+    log_backend (NULL, NULL, LOG_WARNING, message, strlen (message));
+    g_free (message);
+}
+
+static gpointer
+log_async_writer (gpointer unused)
+{
+    guint reported_dropped;
+
+    /* Drops of previous runs were already reported */
+    reported_dropped = (guint) g_atomic_int_get (&async_dropped);
+
+    while (TRUE) {
+        guint head;
+        guint tail;
+        guint dropped;
+        guint n;
+
+        /* Let the gaps in the log be known */
+        dropped = (guint) g_atomic_int_get (&async_dropped);
+        if (dropped != reported_dropped) {
+            log_async_report_dropped (dropped - reported_dropped);
+            reported_dropped = dropped;
+        }
+
+        tail = (guint) g_atomic_int_get (&async_tail);
+        head = (guint) g_atomic_int_get (&async_head);
+        if (head == tail) {
+            /* Only exit once everything is written */
+            if (g_atomic_int_get (&async_stop))
+                break;
+
+            g_mutex_lock (&async_wait_lock);
+            g_atomic_int_set (&async_writer_waiting, 1);
+            if ((guint) g_atomic_int_get (&async_head) == tail && !g_atomic_int_get (&async_stop))
+                g_cond_wait (&async_writer_cond, &async_wait_lock);
+            g_atomic_int_set (&async_writer_waiting, 0);
+            g_mutex_unlock (&async_wait_lock);
+            continue;
+        }
+
+        n = MIN (head - tail, LOG_ASYNC_BATCH);
+        log_async_write_batch (tail, n);
+        g_atomic_int_add (&async_tail, n);
+
+        log_async_wake (&async_producer_waiting, &async_producer_cond);
+    }
+
+    return NULL;
+}
+
+static void
+log_async_start (gboolean drop)
+{
+    GThread *thread;
+    guint i;
+
+    if (g_atomic_pointer_get (&async_thread))
+        return;
+
+    for (i = 0; i < LOG_ASYNC_SLOTS; i++)
+        async_slots[i].message = g_string_sized_new (256);
+
+    async_drop = drop;
+    g_atomic_int_set (&async_stop, 0);
+    thread = g_thread_new ("mm-log", log_async_writer, NULL);
+
+    g_mutex_lock (&async_producer_lock);
+    g_atomic_pointer_set (&async_thread, thread);
+    g_mutex_unlock (&async_producer_lock);
+}
+
+/* Writes all pending messages and goes back to synchronous logging. The
+ * producer lock is held all along, so that no message can be written
+ * synchronously before the pending ones, and so that logging threads only
+ * look at the slots while they're valid. */
+static void
+log_async_stop (void)
+{
+    GThread *thread;
+    guint i;
+
+    g_mutex_lock (&async_producer_lock);
+
+    thread = async_thread;
+    if (!thread) {
+        g_mutex_unlock (&async_producer_lock);
+        return;
+    }
+
+    g_mutex_lock (&async_wait_lock);
+    g_atomic_int_set (&async_stop, 1);
+    g_cond_signal (&async_writer_cond);
+    g_mutex_unlock (&async_wait_lock);
+    g_thread_join (thread);
+
+    for (i = 0; i < LOG_ASYNC_SLOTS; i++) {
+        g_string_free (async_slots[i].message, TRUE);
+        async_slots[i].message = NULL;
+    }
+
+    g_atomic_pointer_set (&async_thread, NULL);
+    g_mutex_unlock (&async_producer_lock);
+}
+
+/*****************************************************************************/
+
+static void
+log_append_message (GString *buffer,
+                    MMLogLevel level,
+                    const char *loc,
+                    const char *func,
+                    const char *fmt,
+                    va_list args)
+{
+    GTimeVal tv;
 
     if (append_log_level_text)
-        g_string_append_printf (msgbuf, "%s ", log_level_description (level));
+        g_string_append_printf (buffer, "%s ", log_level_description (level));
 
     if (ts_flags == TS_FLAG_WALL) {
         g_get_current_time (&tv);
-        g_string_append_printf (msgbuf, "[%09ld.%06ld] ", tv.tv_sec, tv.tv_usec);
+        g_string_append_printf (buffer, "[%09ld.%06ld] ", tv.tv_sec, tv.tv_usec);
     } else if (ts_flags == TS_FLAG_REL) {
         glong secs;
         glong usecs;
@@ -227,20 +461,64 @@ _mm_log (const char *loc,
             usecs += 1000000;
         }
 
-        g_string_append_printf (msgbuf, "[%06ld.%06ld] ", secs, usecs);
+        g_string_append_printf (buffer, "[%06ld.%06ld] ", secs, usecs);
     }
 
 #if defined MM_LOG_FUNC_LOC
-    g_string_append_printf (msgbuf, "[%s] %s(): ", loc, func);
+    g_string_append_printf (buffer, "[%s] %s(): ", loc, func);
 #endif
 
+    g_string_append_vprintf (buffer, fmt, args);
+
+    g_string_append_c (buffer, '\n');
+}
+
+void
+_mm_log (const char *loc,
+         const char *func,
+         MMLogLevel level,
+         const char *fmt,
+         ...)
+{
+    va_list args;
+
+    if (!(log_level & level))
+        return;
+
+    if (g_atomic_pointer_get (&async_thread)) {
+        LogSlot *slot;
+
+        if (log_async_reserve (&slot)) {
+            /* Dropped if the ring is full */
+            if (!slot)
+                return;
+
+            g_string_truncate (slot->message, 0);
+            va_start (args, fmt);
+            log_append_message (slot->message, level, loc, func, fmt, args);
+            va_end (args);
+            slot->loc = loc;
+            slot->func = func;
+            slot->syslog_level = mm_to_syslog_priority (level);
+            log_async_commit ();
+            return;
+        }
+    }
+
+    /* Logging threads may end up here as well once asynchronous logging is
+     * stopped */
+    g_mutex_lock (&msgbuf_lock);
+    if (!msgbuf)
+        msgbuf = g_string_sized_new (512);
+    else
+        g_string_truncate (msgbuf, 0);
+
     va_start (args, fmt);
-    g_string_append_vprintf (msgbuf, fmt, args);
+    log_append_message (msgbuf, level, loc, func, fmt, args);
     va_end (args);
 
-    g_string_append_c (msgbuf, '\n');
-
     log_backend (loc, func, mm_to_syslog_priority (level), msgbuf->str, msgbuf->len);
+    g_mutex_unlock (&msgbuf_lock);
 }
 
 static void
@@ -249,6 +527,24 @@ log_handler (const gchar *log_domain,
              const gchar *message,
              gpointer ignored)
 {
+    if (g_atomic_pointer_get (&async_thread)) {
+        LogSlot *slot;
+
+        /* Make sure everything is written out before aborting */
+        if (level & G_LOG_FLAG_FATAL)
+            log_async_stop ();
+        else if (log_async_reserve (&slot)) {
+            if (slot) {
+                g_string_assign (slot->message, message);
+                slot->loc = NULL;
+                slot->func = NULL;
+                slot->syslog_level = glib_to_syslog_priority (level);
+                log_async_commit ();
+            }
+            return;
+        }
+    }
+
     log_backend (NULL, NULL, glib_to_syslog_priority (level), message, strlen (message));
 }
 
@@ -281,18 +577,62 @@ mm_log_set_level (const char *level, GError **error)
     return found;
 }
 
+static gboolean
+parse_async_policy (const char *async_policy,
+                    gboolean *drop,
+                    GError **error)
+{
+    if (!strcasecmp (async_policy, "block"))
+        *drop = FALSE;
+    else if (!strcasecmp (async_policy, "drop"))
+        *drop = TRUE;
+    else {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
+                     "Unknown async log policy '%s'", async_policy);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean
+mm_log_set_async_policy (const char *async_policy,
+                         GError **error)
+{
+    gboolean drop;
+
+    if (!async_policy) {
+        log_async_stop ();
+        return TRUE;
+    }
+
+    if (!parse_async_policy (async_policy, &drop, error))
+        return FALSE;
+
+    /* Restart it if already running, so that the new policy applies */
+    log_async_stop ();
+    log_async_start (drop);
+    return TRUE;
+}
+
 gboolean
 mm_log_setup (const char *level,
               const char *log_file,
               gboolean log_journal,
               gboolean show_timestamps,
               gboolean rel_timestamps,
+              const char *async_policy,
               GError **error)
 {
+    gboolean async_drop_policy = FALSE;
+
     /* levels */
     if (level && strlen (level) && !mm_log_set_level (level, error))
         return FALSE;
 
+    /* asynchronous logging */
+    if (async_policy && !parse_async_policy (async_policy, &async_drop_policy, error))
+        return FALSE;
+
     if (show_timestamps)
         ts_flags = TS_FLAG_WALL;
     else if (rel_timestamps)
@@ -342,12 +682,23 @@ mm_log_setup (const char *level,
                        NULL);
 #endif
 
+    if (async_policy)
+        log_async_start (async_drop_policy);
+
     return TRUE;
 }
 
 void
 mm_log_shutdown (void)
 {
+    guint dropped;
+
+    log_async_stop ();
+
+    dropped = (guint) g_atomic_int_get (&async_dropped);
+    if (dropped)
+        mm_warn ("%u log messages dropped in total", dropped);
+
     if (logfd < 0)
         closelog ();
     else
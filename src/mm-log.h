@@ -54,8 +54,14 @@ gboolean mm_log_setup (const char *level,
                        gboolean log_journal,
                        gboolean show_ts,
                        gboolean rel_ts,
+                       const char *async_policy,
                        GError **error);
 
+/* Switches to asynchronous logging with the given policy ("block" or "drop"),
+ * or back to synchronous logging if NULL. Not to be called concurrently. */
+gboolean mm_log_set_async_policy (const char *async_policy,
+                                  GError **error);
+
 void mm_log_shutdown (void);
 
 #endif  /* MM_LOG_H */
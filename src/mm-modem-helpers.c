@@ -35,6 +35,90 @@
 
 /*****************************************************************************/
 
+typedef struct {
+    gchar              *pattern;
+    GRegexCompileFlags  compile_options;
+    GRegexMatchFlags    match_options;
+} RegexCacheKey;
+
+G_LOCK_DEFINE_STATIC (regex_cache);
+static GHashTable *regex_cache;
+
+static guint
+regex_cache_key_hash (gconstpointer v)
+{
+    const RegexCacheKey *key = v;
+
+    return g_str_hash (key->pattern) ^ (key->compile_options * 31) ^ key->match_options;
+}
+
+static gboolean
+regex_cache_key_equal (gconstpointer a,
+                       gconstpointer b)
+{
+    const RegexCacheKey *key_a = a;
+    const RegexCacheKey *key_b = b;
+
+    return (key_a->compile_options == key_b->compile_options &&
+            key_a->match_options == key_b->match_options &&
+            g_str_equal (key_a->pattern, key_b->pattern));
+}
+
+GRegex *
+mm_regex_cache_get (const gchar         *pattern,
+                    GRegexCompileFlags   compile_options,
+                    GRegexMatchFlags     match_options,
+                    GError             **error)
+{
+    RegexCacheKey  lookup;
+    GRegex        *regex;
+    GRegex        *existing;
+
+    g_return_val_if_fail (pattern != NULL, NULL);
+
+    lookup.pattern = (gchar *) pattern;
+    lookup.compile_options = compile_options;
+    lookup.match_options = match_options;
+
+    G_LOCK (regex_cache);
+    if (G_UNLIKELY (!regex_cache))
+        regex_cache = g_hash_table_new (regex_cache_key_hash, regex_cache_key_equal);
+    regex = g_hash_table_lookup (regex_cache, &lookup);
+    if (regex)
+        g_regex_ref (regex);
+    G_UNLOCK (regex_cache);
+
+    if (regex)
+        return regex;
+
+    /* Compile without holding the lock */
+    regex = g_regex_new (pattern, compile_options, match_options, error);
+    if (!regex)
+        return NULL;
+
+    /* If some other thread added it in the meantime, keep that one */
+    G_LOCK (regex_cache);
+    existing = g_hash_table_lookup (regex_cache, &lookup);
+    if (existing) {
+        g_regex_unref (regex);
+        regex = existing;
+    } else {
+        RegexCacheKey *key;
+
+        key = g_slice_new (RegexCacheKey);
+        key->pattern = g_strdup (pattern);
+        key->compile_options = compile_options;
+        key->match_options = match_options;
+        g_hash_table_insert (regex_cache, key, regex);
+    }
+    g_regex_ref (regex);
+    G_UNLOCK (regex_cache);
+
+    return regex;
+}
+
+/*****************************************************************************/
+
 gchar *
 mm_strip_quotes (gchar *str)
 {
@@ -132,6 +216,57 @@ mm_split_string_groups (const gchar *str)
 
 /*****************************************************************************/
 
+gchar **
+mm_split_compound_response (const gchar *str,
+                            guint        n_commands)
+{
+    GPtrArray *array;
+    const gchar *start;
+    const gchar *end;
+
+    g_return_val_if_fail (n_commands > 0, NULL);
+
+    if (!str)
+        return NULL;
+
+    /* The information response of each command in a compound command line
+     * comes in its own <CR><LF>text<CR><LF> block, so consecutive ones are
+     * separated by an empty line. The leading and trailing <CR><LF> of the
+     * whole reply are already removed by the response parser. */
+    array = g_ptr_array_new_with_free_func (g_free);
+    for (start = str; start; start = (end ? end + 4 : NULL)) {
+        const gchar *item_start = start;
+        const gchar *item_end;
+
+        end = strstr (start, "\r\n\r\n");
+        item_end = (end ? end : start + strlen (start));
+
+        while (item_start < item_end && (*item_start == '\r' || *item_start == '\n'))
+            item_start++;
+        while (item_end > item_start && (item_end[-1] == '\r' || item_end[-1] == '\n'))
+            item_end--;
+
+        /* Commands without information response can't be told apart */
+        if (item_start == item_end || array->len == n_commands) {
+            g_ptr_array_unref (array);
+            return NULL;
+        }
+
+        g_ptr_array_add (array, g_strndup (item_start, item_end - item_start));
+    }
+
+    if (array->len != n_commands) {
+        g_ptr_array_unref (array);
+        return NULL;
+    }
+
+    g_ptr_array_set_free_func (array, NULL);
+    g_ptr_array_add (array, NULL);
+    return (gchar **) g_ptr_array_free (array, FALSE);
+}
+
+/*****************************************************************************/
+
 static int uint_compare_func (gconstpointer a, gconstpointer b)
 {
    return (*(guint *)a - *(guint *)b);
@@ -522,10 +657,10 @@ mm_voice_ring_regex_get (void)
     /* Example:
      * <CR><LF>RING<CR><LF>
      */
-    return g_regex_new ("\\r\\nRING\\r\\n",
-                        G_REGEX_RAW | G_REGEX_OPTIMIZE,
-                        0,
-                        NULL);
+    return mm_regex_cache_get ("\\r\\nRING\\r\\n",
+                               G_REGEX_RAW | G_REGEX_OPTIMIZE,
+                               0,
+                               NULL);
 }
 
 GRegex *
@@ -535,10 +670,10 @@ mm_voice_cring_regex_get (void)
      * <CR><LF>+CRING: VOICE<CR><LF>
      * <CR><LF>+CRING: DATA<CR><LF>
      */
-    return g_regex_new ("\\r\\n\\+CRING:\\s*(\\S+)\\r\\n",
-                        G_REGEX_RAW | G_REGEX_OPTIMIZE,
-                        0,
-                        NULL);
+    return mm_regex_cache_get ("\\r\\n\\+CRING:\\s*(\\S+)\\r\\n",
+                               G_REGEX_RAW | G_REGEX_OPTIMIZE,
+                               0,
+                               NULL);
 }
 
 GRegex *
@@ -552,10 +687,10 @@ mm_voice_clip_regex_get (void)
      *   <CR><LF>+CLIP: "+393351391306",145,,,,0<CR><LF>
      *                   \_ Number      \_ Type
      */
-    return g_regex_new ("\\r\\n\\+CLIP:\\s*([^,\\s]*)\\s*,\\s*(\\d+)\\s*,?(.*)\\r\\n",
-                        G_REGEX_RAW | G_REGEX_OPTIMIZE,
-                        0,
-                        NULL);
+    return mm_regex_cache_get ("\\r\\n\\+CLIP:\\s*([^,\\s]*)\\s*,\\s*(\\d+)\\s*,?(.*)\\r\\n",
+                               G_REGEX_RAW | G_REGEX_OPTIMIZE,
+                               0,
+                               NULL);
 }
 
 GRegex *
@@ -569,10 +704,10 @@ mm_voice_ccwa_regex_get (void)
      *   <CR><LF>+CCWA: "+393351391306",145,1
      *                   \_ Number      \_ Type
      */
-    return g_regex_new ("\\r\\n\\+CCWA:\\s*([^,\\s]*)\\s*,\\s*(\\d+)\\s*,\\s*(\\d+)\\s*,?(.*)\\r\\n",
-                        G_REGEX_RAW | G_REGEX_OPTIMIZE,
-                        0,
-                        NULL);
+    return mm_regex_cache_get ("\\r\\n\\+CCWA:\\s*([^,\\s]*)\\s*,\\s*(\\d+)\\s*,\\s*(\\d+)\\s*,?(.*)\\r\\n",
+                               G_REGEX_RAW | G_REGEX_OPTIMIZE,
+                               0,
+                               NULL);
 }
 
 static void
@@ -626,15 +761,15 @@ mm_3gpp_parse_clcc_response (const gchar  *str,
      *  ...
      */
 
-    r = g_regex_new ("\\+CLCC:\\s*(\\d+),\\s*(\\d+),\\s*(\\d+),\\s*(\\d+),\\s*(\\d+)" /* mandatory fields */
-                     "(?:,\\s*([^,]*),\\s*(\\d+)"                                     /* number and type */
-                     "(?:,\\s*([^,]*)"                                                /* alpha */
-                     "(?:,\\s*(\\d*)"                                                 /* priority */
-                     "(?:,\\s*(\\d*)"                                                 /* CLI validity */
-                     ")?)?)?)?$",
-                     G_REGEX_RAW | G_REGEX_MULTILINE | G_REGEX_NEWLINE_CRLF,
-                     G_REGEX_MATCH_NEWLINE_CRLF,
-                     NULL);
+    r = mm_regex_cache_get ("\\+CLCC:\\s*(\\d+),\\s*(\\d+),\\s*(\\d+),\\s*(\\d+),\\s*(\\d+)" /* mandatory fields */
+                            "(?:,\\s*([^,]*),\\s*(\\d+)"                                     /* number and type */
+                            "(?:,\\s*([^,]*)"                                                /* alpha */
+                            "(?:,\\s*(\\d*)"                                                 /* priority */
+                            "(?:,\\s*(\\d*)"                                                 /* CLI validity */
+                            ")?)?)?)?$",
+                            G_REGEX_RAW | G_REGEX_MULTILINE | G_REGEX_NEWLINE_CRLF,
+                            G_REGEX_MATCH_NEWLINE_CRLF,
+                            NULL);
     g_assert (r != NULL);
 
     g_regex_match_full (r, str, strlen (str), 0, 0, &match_info, &inner_error);
@@ -778,7 +913,7 @@ mm_parse_ifc_test_response (const gchar  *response,
     MMFlowControl  ta_mask     = MM_FLOW_CONTROL_UNKNOWN;
     MMFlowControl  mask        = MM_FLOW_CONTROL_UNKNOWN;
 
-    r = g_regex_new ("(?:\\+IFC:)?\\s*\\((.*)\\),\\((.*)\\)(?:\\r\\n)?", 0, 0, NULL);
+    r = mm_regex_cache_get ("(?:\\+IFC:)?\\s*\\((.*)\\),\\((.*)\\)(?:\\r\\n)?", 0, 0, NULL);
     g_assert (r != NULL);
 
     g_regex_match_full (r, response, strlen (response), 0, 0, &match_info, &inner_error);
@@ -884,111 +1019,146 @@ mm_3gpp_creg_regex_get (gboolean solicited)
 
     /* #1 */
     if (solicited)
-        regex = g_regex_new (CREG1 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CREG1 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CREG1 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CREG1 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* #2 */
     if (solicited)
-        regex = g_regex_new (CREG2 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CREG2 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CREG2 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CREG2 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* #3 */
     if (solicited)
-        regex = g_regex_new (CREG3 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CREG3 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CREG3 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CREG3 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* #4 */
     if (solicited)
-        regex = g_regex_new (CREG4 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CREG4 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CREG4 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CREG4 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* #5 */
     if (solicited)
-        regex = g_regex_new (CREG5 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CREG5 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CREG5 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CREG5 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* #6 */
     if (solicited)
-        regex = g_regex_new (CREG6 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CREG6 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CREG6 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CREG6 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* #7 */
     if (solicited)
-        regex = g_regex_new (CREG7 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CREG7 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CREG7 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CREG7 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* #8 */
     if (solicited)
-        regex = g_regex_new (CREG8 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CREG8 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CREG8 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CREG8 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* #9 */
     if (solicited)
-        regex = g_regex_new (CREG9 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CREG9 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CREG9 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CREG9 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* #10 */
     if (solicited)
-        regex = g_regex_new (CREG10 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CREG10 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CREG10 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CREG10 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* #11 */
     if (solicited)
-        regex = g_regex_new (CREG11 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CREG11 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CREG11 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CREG11 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* CEREG #1 */
     if (solicited)
-        regex = g_regex_new (CEREG1 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CEREG1 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CEREG1 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CEREG1 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     /* CEREG #2 */
     if (solicited)
-        regex = g_regex_new (CEREG2 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get (CEREG2 "$", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     else
-        regex = g_regex_new ("\\r\\n" CEREG2 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        regex = mm_regex_cache_get ("\\r\\n" CEREG2 "\\r\\n", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (regex);
     g_ptr_array_add (array, regex);
 
     return array;
 }
 
+/* Unlike the ones above, these match any unsolicited registration message
+ * line, so they can be tokenized with mm_3gpp_parse_creg_line(). There is one
+ * per tag so that the serial port can dispatch them by line prefix, which is
+ * also why they can't use alternatives.
+ *
+ * Lines are either a bare <stat> or <stat> followed by at least two more
+ * fields; the <n>,<stat> form is only ever a reply to the read command, so
+ * it is left for the command to get. */
+#define CREG_LINE_FIELD "[ \\t]*(\"[^\"\\r\\n]*\")?[^,\"\\r\\n]*"
+#define CREG_LINE(tag) "\\r\\n\\+" tag ":[ \\t]*[0-9]+[ \\t]*((," CREG_LINE_FIELD "){2,})?\\r\\n"
+
+GPtrArray *
+mm_3gpp_creg_line_regex_get (void)
+{
+    static const gchar *patterns[] = {
+        CREG_LINE ("CREG"),
+        CREG_LINE ("CGREG"),
+        CREG_LINE ("CEREG"),
+        CREG_LINE ("C5GREG"),
+    };
+    GPtrArray *array;
+    guint i;
+
+    array = g_ptr_array_sized_new (G_N_ELEMENTS (patterns));
+    for (i = 0; i < G_N_ELEMENTS (patterns); i++) {
+        GRegex *regex;
+
+        regex = mm_regex_cache_get (patterns[i], G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        g_assert (regex);
+        g_ptr_array_add (array, regex);
+    }
+
+    return array;
+}
+
 void
 mm_3gpp_creg_regex_destroy (GPtrArray *array)
 {
@@ -1001,10 +1171,10 @@ mm_3gpp_creg_regex_destroy (GPtrArray *array)
 GRegex *
 mm_3gpp_ciev_regex_get (void)
 {
-    return g_regex_new ("\\r\\n\\+CIEV: (.*),(\\d)\\r\\n",
-                        G_REGEX_RAW | G_REGEX_OPTIMIZE,
-                        0,
-                        NULL);
+    return mm_regex_cache_get ("\\r\\n\\+CIEV: (.*),(\\d)\\r\\n",
+                               G_REGEX_RAW | G_REGEX_OPTIMIZE,
+                               0,
+                               NULL);
 }
 
 /*************************************************************************/
@@ -1012,10 +1182,10 @@ mm_3gpp_ciev_regex_get (void)
 GRegex *
 mm_3gpp_cgev_regex_get (void)
 {
-    return g_regex_new ("\\r\\n\\+CGEV:\\s*(.*)\\r\\n",
-                        G_REGEX_RAW | G_REGEX_OPTIMIZE,
-                        0,
-                        NULL);
+    return mm_regex_cache_get ("\\r\\n\\+CGEV:\\s*(.*)\\r\\n",
+                               G_REGEX_RAW | G_REGEX_OPTIMIZE,
+                               0,
+                               NULL);
 }
 
 /*************************************************************************/
@@ -1023,10 +1193,10 @@ mm_3gpp_cgev_regex_get (void)
 GRegex *
 mm_3gpp_cusd_regex_get (void)
 {
-    return g_regex_new ("\\r\\n\\+CUSD:\\s*(.*)\\r\\n",
-                        G_REGEX_RAW | G_REGEX_OPTIMIZE,
-                        0,
-                        NULL);
+    return mm_regex_cache_get ("\\r\\n\\+CUSD:\\s*(.*)\\r\\n",
+                               G_REGEX_RAW | G_REGEX_OPTIMIZE,
+                               0,
+                               NULL);
 }
 
 /*************************************************************************/
@@ -1034,10 +1204,10 @@ mm_3gpp_cusd_regex_get (void)
 GRegex *
 mm_3gpp_cmti_regex_get (void)
 {
-    return g_regex_new ("\\r\\n\\+CMTI:\\s*\"(\\S+)\",\\s*(\\d+)\\r\\n",
-                        G_REGEX_RAW | G_REGEX_OPTIMIZE,
-                        0,
-                        NULL);
+    return mm_regex_cache_get ("\\r\\n\\+CMTI:\\s*\"(\\S+)\",\\s*(\\d+)\\r\\n",
+                               G_REGEX_RAW | G_REGEX_OPTIMIZE,
+                               0,
+                               NULL);
 }
 
 GRegex *
@@ -1046,10 +1216,10 @@ mm_3gpp_cds_regex_get (void)
     /* Example:
      * <CR><LF>+CDS: 24<CR><LF>07914356060013F10659098136395339F6219011707193802190117071938030<CR><LF>
      */
-    return g_regex_new ("\\r\\n\\+CDS:\\s*(\\d+)\\r\\n(.*)\\r\\n",
-                        G_REGEX_RAW | G_REGEX_OPTIMIZE,
-                        0,
-                        NULL);
+    return mm_regex_cache_get ("\\r\\n\\+CDS:\\s*(\\d+)\\r\\n(.*)\\r\\n",
+                               G_REGEX_RAW | G_REGEX_OPTIMIZE,
+                               0,
+                               NULL);
 }
 
 /*************************************************************************/
@@ -1104,7 +1274,7 @@ mm_3gpp_parse_ws46_test_response (const gchar  *response,
     gboolean    supported_3g = FALSE;
     gboolean    supported_2g = FALSE;
 
-    r = g_regex_new ("(?:\\+WS46:)?\\s*\\((.*)\\)(?:\\r\\n)?", 0, 0, NULL);
+    r = mm_regex_cache_get ("(?:\\+WS46:)?\\s*\\((.*)\\)(?:\\r\\n)?", 0, 0, NULL);
     g_assert (r != NULL);
 
     g_regex_match_full (r, response, strlen (response), 0, 0, &match_info, &inner_error);
@@ -1304,7 +1474,7 @@ mm_3gpp_parse_cops_test_response (const gchar *reply,
      *       +COPS: (2,"","T-Mobile","31026",0),(1,"AT&T","AT&T","310410"),0)
      */
 
-    r = g_regex_new ("\\((\\d),\"([^\"\\)]*)\",([^,\\)]*),([^,\\)]*)[\\)]?,(\\d)\\)", G_REGEX_UNGREEDY, 0, &inner_error);
+    r = mm_regex_cache_get ("\\((\\d),\"([^\"\\)]*)\",([^,\\)]*),([^,\\)]*)[\\)]?,(\\d)\\)", G_REGEX_UNGREEDY, 0, &inner_error);
     if (inner_error) {
         mm_err ("Invalid regular expression: %s", inner_error->message);
         g_error_free (inner_error);
@@ -1333,7 +1503,7 @@ mm_3gpp_parse_cops_test_response (const gchar *reply,
          *       +COPS: (2,"T - Mobile",,"31026"),(1,"Einstein PCS",,"31064"),(1,"Cingular",,"31041"),,(0,1,3),(0,2)
          */
 
-        r = g_regex_new ("\\((\\d),([^,\\)]*),([^,\\)]*),([^\\)]*)\\)", G_REGEX_UNGREEDY, 0, &inner_error);
+        r = mm_regex_cache_get ("\\((\\d),([^,\\)]*),([^,\\)]*),([^\\)]*)\\)", G_REGEX_UNGREEDY, 0, &inner_error);
         if (inner_error) {
             mm_err ("Invalid regular expression: %s", inner_error->message);
             g_error_free (inner_error);
@@ -1442,7 +1612,7 @@ mm_3gpp_parse_cops_read_response (const gchar              *response,
      * or:
      *   +COPS: <mode>,<format>,<oper>,<AcT>
      */
-    r = g_regex_new ("\\+COPS:\\s*(\\d+),(\\d+),([^,]*)(?:,(\\d+))?(?:\\r\\n)?", 0, 0, NULL);
+    r = mm_regex_cache_get ("\\+COPS:\\s*(\\d+),(\\d+),([^,]*)(?:,(\\d+))?(?:\\r\\n)?", 0, 0, NULL);
     g_assert (r != NULL);
 
     g_regex_match_full (r, response, strlen (response), 0, 0, &match_info, &inner_error);
@@ -1700,9 +1870,9 @@ mm_3gpp_parse_cgdcont_test_response (const gchar *response,
         return NULL;
     }
 
-    r = g_regex_new ("\\+CGDCONT:\\s*\\(\\s*(\\d+)\\s*-?\\s*(\\d+)?[^\\)]*\\)\\s*,\\s*\\(?\"(\\S+)\"",
-                     G_REGEX_DOLLAR_ENDONLY | G_REGEX_RAW,
-                     0, &inner_error);
+    r = mm_regex_cache_get ("\\+CGDCONT:\\s*\\(\\s*(\\d+)\\s*-?\\s*(\\d+)?[^\\)]*\\)\\s*,\\s*\\(?\"(\\S+)\"",
+                            G_REGEX_DOLLAR_ENDONLY | G_REGEX_RAW,
+                            0, &inner_error);
     g_assert (r != NULL);
 
     g_regex_match_full (r, response, strlen (response), 0, 0, &match_info, &inner_error);
@@ -1788,9 +1958,9 @@ mm_3gpp_parse_cgdcont_read_response (const gchar *reply,
         return NULL;
 
     list = NULL;
-    r = g_regex_new ("\\+CGDCONT:\\s*(\\d+)\\s*,([^, \\)]*)\\s*,([^, \\)]*)\\s*,([^, \\)]*)",
-                     G_REGEX_DOLLAR_ENDONLY | G_REGEX_RAW,
-                     0, &inner_error);
+    r = mm_regex_cache_get ("\\+CGDCONT:\\s*(\\d+)\\s*,([^, \\)]*)\\s*,([^, \\)]*)\\s*,([^, \\)]*)",
+                            G_REGEX_DOLLAR_ENDONLY | G_REGEX_RAW,
+                            0, &inner_error);
     if (r) {
         g_regex_match_full (r, reply, strlen (reply), 0, 0, &match_info, &inner_error);
 
@@ -1875,8 +2045,8 @@ mm_3gpp_parse_cgact_read_response (const gchar *reply,
         return NULL;
 
     list = NULL;
-    r = g_regex_new ("\\+CGACT:\\s*(\\d+),(\\d+)",
-                     G_REGEX_DOLLAR_ENDONLY | G_REGEX_RAW, 0, &inner_error);
+    r = mm_regex_cache_get ("\\+CGACT:\\s*(\\d+),(\\d+)",
+                            G_REGEX_DOLLAR_ENDONLY | G_REGEX_RAW, 0, &inner_error);
     g_assert (r);
 
     g_regex_match_full (r, reply, strlen (reply), 0, 0, &match_info, &inner_error);
@@ -1925,198 +2095,305 @@ mm_3gpp_parse_cgact_read_response (const gchar *reply,
 
 /*************************************************************************/
 
-static gulong
-parse_uint (char *str, int base, glong nmin, glong nmax, gboolean *valid)
+/* Registration responses have at most 6 fields (+CEREG: <n>,<stat>,<lac>,<rac>,<ci>,<AcT>),
+ * any other trailing field is ignored */
+#define CREG_MAX_FIELDS 6
+
+typedef struct {
+    const gchar *str;
+    gsize        len;
+    gboolean     quoted;
+} CregField;
+
+static const struct {
+    const gchar      *tag;
+    gsize             len;
+    MM3gppCregDomain  domain;
+} creg_tags[] = {
+    { "+CREG:",   6, MM_3GPP_CREG_DOMAIN_CS  },
+    { "+CGREG:",  7, MM_3GPP_CREG_DOMAIN_PS  },
+    { "+CEREG:",  7, MM_3GPP_CREG_DOMAIN_EPS },
+    { "+C5GREG:", 8, MM_3GPP_CREG_DOMAIN_5GS },
+};
+
+static const gchar *
+creg_find_tag (const gchar      *str,
+               const gchar      *end,
+               MM3gppCregDomain *out_domain)
 {
-    gulong ret = 0;
-    gchar *endquote;
+    const gchar *p;
 
-    *valid = FALSE;
-    if (!str)
-        return 0;
+    for (p = memchr (str, '+', end - str); p; p = memchr (p + 1, '+', end - p - 1)) {
+        guint i;
 
-    /* Strip quotes */
-    if (str[0] == '"')
-        str++;
-    endquote = strchr (str, '"');
-    if (endquote)
-        *endquote = '\0';
+        for (i = 0; i < G_N_ELEMENTS (creg_tags); i++) {
+            if ((gsize) (end - p) >= creg_tags[i].len &&
+                !memcmp (p, creg_tags[i].tag, creg_tags[i].len)) {
+                *out_domain = creg_tags[i].domain;
+                return p + creg_tags[i].len;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Split the comma separated fields of the line, without copying them. Quoted
+ * fields may contain commas (e.g. Thuraya reports a "F0,0F" cell id). */
+static guint
+creg_split_fields (const gchar *p,
+                   const gchar *end,
+                   CregField   *fields)
+{
+    guint n_fields = 0;
+
+    while (TRUE) {
+        CregField field = { NULL, 0, FALSE };
+
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+
+        if (p < end && *p == '"') {
+            field.quoted = TRUE;
+            field.str = ++p;
+            while (p < end && *p != '"')
+                p++;
+            field.len = p - field.str;
+            while (p < end && *p != ',')
+                p++;
+        } else {
+            field.str = p;
+            while (p < end && *p != ',')
+                p++;
+            field.len = p - field.str;
+            while (field.len > 0 && (field.str[field.len - 1] == ' ' || field.str[field.len - 1] == '\t'))
+                field.len--;
+        }
+
+        if (n_fields < CREG_MAX_FIELDS)
+            fields[n_fields] = field;
+        n_fields++;
 
-    if (strlen (str)) {
-        ret = strtol (str, NULL, base);
-        if ((nmin == nmax) || (ret >= nmin && ret <= nmax))
-            *valid = TRUE;
+        if (p >= end)
+            break;
+        p++;
     }
-    return *valid ? (guint) ret : 0;
+
+    return MIN (n_fields, CREG_MAX_FIELDS);
 }
 
+/* Parses the leading digits of the field, as strtol() would do, and
+ * checks the result against the given range */
 static gboolean
-item_is_lac_not_stat (GMatchInfo *info, guint32 item)
+creg_field_to_uint (const CregField *field,
+                    guint            base,
+                    gulong           nmin,
+                    gulong           nmax,
+                    gulong          *out)
 {
-    gchar *str;
-    gboolean is_lac = FALSE;
+    guint64 value = 0;
+    gsize   i;
 
-    /* A <stat> will always be a single digit, without quotes */
-    str = g_match_info_fetch (info, item);
-    g_assert (str);
-    is_lac = (strchr (str, '"') || strlen (str) > 1);
-    g_free (str);
-    return is_lac;
+    *out = 0;
+    if (!field || !field->len)
+        return FALSE;
+
+    for (i = 0; i < field->len; i++) {
+        gint digit;
+
+        digit = (base == 16) ? g_ascii_xdigit_value (field->str[i]) : g_ascii_digit_value (field->str[i]);
+        if (digit < 0)
+            break;
+        value = value * base + digit;
+        if (value > nmax)
+            return FALSE;
+    }
+
+    if (value < nmin)
+        return FALSE;
+
+    *out = (gulong) value;
+    return TRUE;
+}
+
+static gboolean
+creg_field_is_number (const CregField *field)
+{
+    gsize i;
+
+    if (field->quoted || !field->len)
+        return FALSE;
+
+    for (i = 0; i < field->len; i++) {
+        if (!g_ascii_isdigit (field->str[i]))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* Whether an unsolicited line with 4 or more fields starts with <n>,<stat>
+ * (non-standard, but some modems do it) instead of <stat>,<lac>. Quoting tells
+ * them apart when present, as LAC and CI are strings. Lines without any are
+ * ambiguous, so a one-character second field is taken as <stat> there. */
+static gboolean
+creg_fields_start_with_n (const CregField *fields)
+{
+    if (fields[1].quoted)
+        return FALSE;
+    if (fields[2].quoted)
+        return TRUE;
+    return (fields[1].len == 1);
 }
 
 gboolean
-mm_3gpp_parse_creg_response (GMatchInfo *info,
-                             MMModem3gppRegistrationState *out_reg_state,
-                             gulong *out_lac,
-                             gulong *out_ci,
-                             MMModemAccessTechnology *out_act,
-                             gboolean *out_cgreg,
-                             gboolean *out_cereg,
-                             GError **error)
+mm_3gpp_parse_creg_line (const gchar       *line,
+                         gssize             len,
+                         gboolean           solicited,
+                         MM3gppCregResult  *result,
+                         GError           **error)
 {
-    gboolean success = FALSE, foo;
-    gint n_matches, act = -1;
-    gulong stat = 0, lac = 0, ci = 0;
-    guint istat = 0, ilac = 0, ici = 0, iact = 0;
-    gchar *str;
+    CregField        fields[CREG_MAX_FIELDS];
+    const CregField *stat = NULL;
+    const CregField *lac = NULL;
+    const CregField *ci = NULL;
+    const CregField *act = NULL;
+    const gchar     *limit;
+    const gchar     *end;
+    const gchar     *p;
+    guint            n_fields;
+    guint            offset;
+    gulong           value;
+
+    g_return_val_if_fail (line != NULL, FALSE);
+    g_return_val_if_fail (result != NULL, FALSE);
+
+    memset (result, 0, sizeof (MM3gppCregResult));
+
+    limit = line + (len < 0 ? strlen (line) : (gsize) len);
+    p = creg_find_tag (line, limit, &result->domain);
+    if (!p) {
+        g_set_error_literal (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                             "Could not find the registration status response");
+        return FALSE;
+    }
 
-    g_return_val_if_fail (info != NULL, FALSE);
-    g_return_val_if_fail (out_reg_state != NULL, FALSE);
-    g_return_val_if_fail (out_lac != NULL, FALSE);
-    g_return_val_if_fail (out_ci != NULL, FALSE);
-    g_return_val_if_fail (out_act != NULL, FALSE);
-    g_return_val_if_fail (out_cgreg != NULL, FALSE);
-    g_return_val_if_fail (out_cereg != NULL, FALSE);
+    /* Only the first line is parsed */
+    for (end = p; end < limit && *end != '\r' && *end != '\n'; end++);
 
-    str = g_match_info_fetch (info, 1);
-    *out_cgreg = (str && strstr (str, "CGREG")) ? TRUE : FALSE;
-    *out_cereg = (str && strstr (str, "CEREG")) ? TRUE : FALSE;
-    g_free (str);
+    n_fields = creg_split_fields (p, end, fields);
 
-    /* Normally the number of matches could be used to determine what each
-     * item is, but we have overlap in one case.
-     */
-    n_matches = g_match_info_get_match_count (info);
-    if (n_matches == 3) {
+    /* The number of fields is usually enough to know what each one is, but we
+     * have overlap between the solicited response (which starts with <n>) and
+     * the unsolicited message with additional fields in some cases. Field
+     * values are never looked at for this: a LAC may well be a single digit. */
+    switch (n_fields) {
+    case 1:
         /* CREG=1: +CREG: <stat> */
-        istat = 2;
-    } else if (n_matches == 4) {
+        stat = &fields[0];
+        break;
+    case 2:
         /* Solicited response: +CREG: <n>,<stat> */
-        istat = 3;
-    } else if (n_matches == 5) {
+        stat = &fields[1];
+        break;
+    case 3:
         /* CREG=2 (GSM 07.07): +CREG: <stat>,<lac>,<ci> */
-        istat = 2;
-        ilac = 3;
-        ici = 4;
-    } else if (n_matches == 6) {
-        /* CREG=2 (ETSI 27.007): +CREG: <stat>,<lac>,<ci>,<AcT>
-         * CREG=2 (non-standard): +CREG: <n>,<stat>,<lac>,<ci>
-         */
-
-        /* Check if the third item is the LAC to distinguish the two cases */
-        if (item_is_lac_not_stat (info, 3)) {
-            istat = 2;
-            ilac = 3;
-            ici = 4;
-            iact = 5;
-        } else {
-            istat = 3;
-            ilac = 4;
-            ici = 5;
-        }
-    } else if (n_matches == 7) {
-        /* CREG=2 (solicited):            +CREG: <n>,<stat>,<lac>,<ci>,<AcT>
-         * CREG=2 (unsolicited with RAC): +CREG: <stat>,<lac>,<ci>,<AcT>,<RAC>
-         * CEREG=2 (solicited):           +CEREG: <n>,<stat>,<lac>,<ci>,<AcT>
+        stat = &fields[0];
+        lac = &fields[1];
+        ci = &fields[2];
+        break;
+    default:
+        /* CREG=2 (non-standard):          +CREG: <n>,<stat>,<lac>,<ci>
+         * CREG=2 (ETSI 27.007):           +CREG: <stat>,<lac>,<ci>,<AcT>
+         * CREG=2 (solicited):             +CREG: <n>,<stat>,<lac>,<ci>,<AcT>
+         * CREG=2 (unsolicited with RAC):  +CREG: <stat>,<lac>,<ci>,<AcT>,<RAC>
+         * CEREG=2 (solicited):            +CEREG: <n>,<stat>,<lac>,<ci>,<AcT>
          * CEREG=2 (unsolicited with RAC): +CEREG: <stat>,<lac>,<rac>,<ci>,<AcT>
+         * CEREG=2 (solicited with RAC):   +CEREG: <n>,<stat>,<lac>,<rac>,<ci>,<AcT>
+         * C5GREG=2 (unsolicited):         +C5GREG: <stat>,<tac>,<ci>,<AcT>,<NSSAI length>,...
          */
-
-        if (*out_cereg) {
-            /* Check if the third item is the LAC to distinguish the two cases */
-            if (item_is_lac_not_stat (info, 3)) {
-                istat = 2;
-                ilac = 3;
-            } else {
-                istat = 3;
-                ilac = 4;
-            }
-            ici = 5;
-            iact = 6;
+        offset = (solicited || creg_fields_start_with_n (fields)) ? 1 : 0;
+        stat = &fields[offset];
+        lac = &fields[offset + 1];
+        if (result->domain == MM_3GPP_CREG_DOMAIN_EPS && n_fields - offset >= 5) {
+            ci = &fields[offset + 3];
+            act = &fields[offset + 4];
         } else {
-            /* Check if the third item is the LAC to distinguish the two cases */
-            if (item_is_lac_not_stat (info, 3)) {
-                istat = 2;
-                ilac = 3;
-                ici = 4;
-                iact = 5;
-            } else {
-                istat = 3;
-                ilac = 4;
-                ici = 5;
-                iact = 6;
-            }
-        }
-    } else if (n_matches == 8) {
-        /* CEREG=2 (solicited with RAC):  +CEREG: <n>,<stat>,<lac>,<rac>,<ci>,<AcT>
-         */
-        if (*out_cereg) {
-            istat = 3;
-            ilac = 4;
-            ici = 6;
-            iact = 7;
+            ci = &fields[offset + 2];
+            if (offset + 3 < n_fields)
+                act = &fields[offset + 3];
         }
-     }
+        break;
+    }
 
     /* Status */
-    str = g_match_info_fetch (info, istat);
-    stat = parse_uint (str, 10, 0, G_MAXUINT, &success);
-    g_free (str);
-    if (!success) {
-        g_set_error_literal (error,
-                             MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+    if (!creg_field_is_number (stat) || !creg_field_to_uint (stat, 10, 0, G_MAXUINT, &value)) {
+        g_set_error_literal (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
                              "Could not parse the registration status response");
         return FALSE;
     }
 
     /* 'roaming (csfb not preferred)' is the last valid state */
-    if (stat > MM_MODEM_3GPP_REGISTRATION_STATE_ROAMING_CSFB_NOT_PREFERRED) {
-        mm_warn ("Registration State '%lu' is unknown", stat);
-        stat = MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN;
+    if (value > MM_MODEM_3GPP_REGISTRATION_STATE_ROAMING_CSFB_NOT_PREFERRED) {
+        mm_warn ("Registration State '%lu' is unknown", value);
+        value = MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN;
     }
+    result->state = (MMModem3gppRegistrationState) value;
+    result->act = MM_MODEM_ACCESS_TECHNOLOGY_UNKNOWN;
 
-    /* Location Area Code */
-    if (ilac) {
-        /* FIXME: some phones apparently swap the LAC bytes (LG, SonyEricsson,
-         * Sagem).  Need to handle that.
-         */
-        str = g_match_info_fetch (info, ilac);
-        lac = parse_uint (str, 16, 1, 0xFFFF, &foo);
-        g_free (str);
-    }
+    /* Don't fill in lac/ci/act if the device's state is unknown */
+    if (result->state == MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN)
+        return TRUE;
+
+    /* Location Area Code
+     * FIXME: some phones apparently swap the LAC bytes (LG, SonyEricsson,
+     * Sagem).  Need to handle that. */
+    creg_field_to_uint (lac, 16, 1, 0xFFFF, &result->lac);
 
     /* Cell ID */
-    if (ici) {
-        str = g_match_info_fetch (info, ici);
-        ci = parse_uint (str, 16, 1, 0x0FFFFFFE, &foo);
-        g_free (str);
-    }
+    creg_field_to_uint (ci, 16, 1, 0x0FFFFFFE, &result->ci);
 
     /* Access Technology */
-    if (iact) {
-        str = g_match_info_fetch (info, iact);
-        act = (gint) parse_uint (str, 10, 0, 7, &foo);
-        g_free (str);
-        if (!foo)
-            act = -1;
-    }
+    if (creg_field_to_uint (act, 10, 0, 7, &value))
+        result->act = get_mm_access_tech_from_etsi_access_tech (value);
+
+    return TRUE;
+}
+
+gboolean
+mm_3gpp_parse_creg_response (GMatchInfo *info,
+                             MMModem3gppRegistrationState *out_reg_state,
+                             gulong *out_lac,
+                             gulong *out_ci,
+                             MMModemAccessTechnology *out_act,
+                             gboolean *out_cgreg,
+                             gboolean *out_cereg,
+                             GError **error)
+{
+    MM3gppCregResult result;
+    const gchar *line;
+    gint start = 0;
+    gint end = 0;
+
+    g_return_val_if_fail (info != NULL, FALSE);
+    g_return_val_if_fail (out_reg_state != NULL, FALSE);
+    g_return_val_if_fail (out_lac != NULL, FALSE);
+    g_return_val_if_fail (out_ci != NULL, FALSE);
+    g_return_val_if_fail (out_act != NULL, FALSE);
+    g_return_val_if_fail (out_cgreg != NULL, FALSE);
+    g_return_val_if_fail (out_cereg != NULL, FALSE);
 
-    *out_reg_state = (MMModem3gppRegistrationState) stat;
-    if (stat != MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN) {
-        /* Don't fill in lac/ci/act if the device's state is unknown */
-        *out_lac = lac;
-        *out_ci = ci;
+    /* Unsolicited regexes include the leading line break, solicited ones don't */
+    g_match_info_fetch_pos (info, 0, &start, &end);
+    line = g_match_info_get_string (info) + start;
+    if (!mm_3gpp_parse_creg_line (line, end - start, (line[0] != '\r' && line[0] != '\n'), &result, error))
+        return FALSE;
 
-        *out_act = get_mm_access_tech_from_etsi_access_tech (act);
+    *out_cgreg = (result.domain == MM_3GPP_CREG_DOMAIN_PS);
+    *out_cereg = (result.domain == MM_3GPP_CREG_DOMAIN_EPS);
+    *out_reg_state = result.state;
+    if (result.state != MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN) {
+        *out_lac = result.lac;
+        *out_ci = result.ci;
+        *out_act = result.act;
     }
     return TRUE;
 }
@@ -2142,7 +2419,7 @@ mm_3gpp_parse_cmgf_test_response (const gchar *reply,
     while (isspace (*reply))
         reply++;
 
-    r = g_regex_new ("\\(?\\s*(\\d+)\\s*[-,]?\\s*(\\d+)?\\s*\\)?", 0, 0, error);
+    r = mm_regex_cache_get ("\\(?\\s*(\\d+)\\s*[-,]?\\s*(\\d+)?\\s*\\)?", 0, 0, error);
     if (!r)
         return FALSE;
 
@@ -2194,7 +2471,7 @@ mm_3gpp_parse_cmgr_read_response (const gchar *reply,
 
     /* +CMGR: <stat>,<alpha>,<length>(whitespace)<pdu> */
     /* The <alpha> and <length> fields are matched, but not currently used */
-    r = g_regex_new ("\\+CMGR:\\s*(\\d+)\\s*,([^,]*),\\s*(\\d+)\\s*([^\\r\\n]*)", 0, 0, NULL);
+    r = mm_regex_cache_get ("\\+CMGR:\\s*(\\d+)\\s*,([^,]*),\\s*(\\d+)\\s*([^\\r\\n]*)", 0, 0, NULL);
     g_assert (r);
 
     if (!g_regex_match (r, reply, 0, &match_info)) {
@@ -2275,8 +2552,8 @@ mm_3gpp_parse_crsm_response (const gchar *reply,
         return FALSE;
     }
 
-    r = g_regex_new ("\\+CRSM:\\s*(\\d+)\\s*,\\s*(\\d+)\\s*,\\s*\"?([0-9a-fA-F]+)\"?",
-                     G_REGEX_RAW, 0, NULL);
+    r = mm_regex_cache_get ("\\+CRSM:\\s*(\\d+)\\s*,\\s*(\\d+)\\s*,\\s*\"?([0-9a-fA-F]+)\"?",
+                            G_REGEX_RAW, 0, NULL);
     g_assert (r != NULL);
 
     if (g_regex_match (r, reply, 0, &match_info) &&
@@ -2389,16 +2666,16 @@ mm_3gpp_parse_cgcontrdp_response (const gchar  *response,
      * The format of the response changed in TS 27.007 v9.4.0, we try to detect
      * both formats ('a' if >= v9.4.0, 'b' if < v9.4.0) with a single regex here.
      */
-    r = g_regex_new ("\\+CGCONTRDP: "
-                     "(\\d+),(\\d+),([^,]*)" /* cid, bearer id, apn */
-                     "(?:,([^,]*))?" /* (a)ip+mask        or (b)ip */
-                     "(?:,([^,]*))?" /* (a)gateway        or (b)mask */
-                     "(?:,([^,]*))?" /* (a)dns1           or (b)gateway */
-                     "(?:,([^,]*))?" /* (a)dns2           or (b)dns1 */
-                     "(?:,([^,]*))?" /* (a)p-cscf primary or (b)dns2 */
-                     "(?:,(.*))?"    /* others, ignored */
-                     "(?:\\r\\n)?",
-                     0, 0, NULL);
+    r = mm_regex_cache_get ("\\+CGCONTRDP: "
+                            "(\\d+),(\\d+),([^,]*)" /* cid, bearer id, apn */
+                            "(?:,([^,]*))?" /* (a)ip+mask        or (b)ip */
+                            "(?:,([^,]*))?" /* (a)gateway        or (b)mask */
+                            "(?:,([^,]*))?" /* (a)dns1           or (b)gateway */
+                            "(?:,([^,]*))?" /* (a)dns2           or (b)dns1 */
+                            "(?:,([^,]*))?" /* (a)p-cscf primary or (b)dns2 */
+                            "(?:,(.*))?"    /* others, ignored */
+                            "(?:\\r\\n)?",
+                            0, 0, NULL);
     g_assert (r != NULL);
 
     g_regex_match_full (r, response, strlen (response), 0, 0, &match_info, &inner_error);
@@ -2513,7 +2790,7 @@ mm_3gpp_parse_cfun_query_response (const gchar  *response,
      * +CFUN: 1,0
      *   ..but we don't care about the second number
      */
-    r = g_regex_new ("\\+CFUN: (\\d+)(?:,(?:\\d+))?(?:\\r\\n)?", 0, 0, NULL);
+    r = mm_regex_cache_get ("\\+CFUN: (\\d+)(?:,(?:\\d+))?(?:\\r\\n)?", 0, 0, NULL);
     g_assert (r != NULL);
 
     g_regex_match_full (r, response, strlen (response), 0, 0, &match_info, &inner_error);
@@ -2580,7 +2857,7 @@ mm_3gpp_parse_cesq_response (const gchar  *response,
     /* Response may be e.g.:
      * +CESQ: 99,99,255,255,20,80
      */
-    r = g_regex_new ("\\+CESQ: (\\d+),(\\d+),(\\d+),(\\d+),(\\d+),(\\d+)(?:\\r\\n)?", 0, 0, NULL);
+    r = mm_regex_cache_get ("\\+CESQ: (\\d+),(\\d+),(\\d+),(\\d+),(\\d+),(\\d+)(?:\\r\\n)?", 0, 0, NULL);
     g_assert (r != NULL);
 
     g_regex_match_full (r, response, strlen (response), 0, 0, &match_info, &inner_error);
@@ -2881,10 +3158,10 @@ mm_3gpp_parse_ccwa_service_query_response (const gchar  *response,
      *
      * We're only interested in class 1 (voice)
      */
-    r = g_regex_new ("\\+CCWA:\\s*(\\d+),\\s*(\\d+)$",
-                     G_REGEX_RAW | G_REGEX_MULTILINE | G_REGEX_NEWLINE_CRLF,
-                     G_REGEX_MATCH_NEWLINE_CRLF,
-                     NULL);
+    r = mm_regex_cache_get ("\\+CCWA:\\s*(\\d+),\\s*(\\d+)$",
+                            G_REGEX_RAW | G_REGEX_MULTILINE | G_REGEX_NEWLINE_CRLF,
+                            G_REGEX_MATCH_NEWLINE_CRLF,
+                            NULL);
     g_assert (r != NULL);
 
     g_regex_match_full (r, response, strlen (response), 0, 0, &match_info, &inner_error);
@@ -2986,7 +3263,7 @@ mm_3gpp_parse_cpms_test_response (const gchar *reply,
         return FALSE;
     }
 
-    r = g_regex_new ("\\s*\"([^,\\)]+)\"\\s*", 0, 0, NULL);
+    r = mm_regex_cache_get ("\\s*\"([^,\\)]+)\"\\s*", 0, 0, NULL);
     g_assert (r);
 
     for (i = 0; i < N_EXPECTED_GROUPS; i++) {
@@ -3068,7 +3345,7 @@ mm_3gpp_parse_cpms_query_response (const gchar *reply,
     gboolean ret = FALSE;
     GMatchInfo *match_info = NULL;
 
-    r = g_regex_new (CPMS_QUERY_REGEX, G_REGEX_RAW, 0, NULL);
+    r = mm_regex_cache_get (CPMS_QUERY_REGEX, G_REGEX_RAW, 0, NULL);
 
     g_assert (r);
 
@@ -3157,7 +3434,7 @@ mm_3gpp_parse_cscs_test_response (const gchar *reply,
     }
 
     /* Now parse each charset */
-    r = g_regex_new ("\\s*([^,\\)]+)\\s*", 0, 0, NULL);
+    r = mm_regex_cache_get ("\\s*([^,\\)]+)\\s*", 0, 0, NULL);
     if (!r)
         return FALSE;
 
@@ -3199,7 +3476,7 @@ mm_3gpp_parse_clck_test_response (const gchar *reply,
     reply = mm_strip_tag (reply, "+CLCK:");
 
     /* Now parse each facility */
-    r = g_regex_new ("\\s*\"([^,\\)]+)\"\\s*", 0, 0, NULL);
+    r = mm_regex_cache_get ("\\s*\"([^,\\)]+)\"\\s*", 0, 0, NULL);
     g_assert (r != NULL);
 
     *out_facilities = MM_MODEM_3GPP_FACILITY_NONE;
@@ -3237,7 +3514,7 @@ mm_3gpp_parse_clck_write_response (const gchar *reply,
 
     reply = mm_strip_tag (reply, "+CLCK:");
 
-    r = g_regex_new ("\\s*([01])\\s*", 0, 0, NULL);
+    r = mm_regex_cache_get ("\\s*([01])\\s*", 0, 0, NULL);
     g_assert (r != NULL);
 
     if (g_regex_match (r, reply, 0, &match_info)) {
@@ -3277,8 +3554,8 @@ mm_3gpp_parse_cnum_exec_response (const gchar *reply)
     if (!reply || !reply[0])
         return NULL;
 
-    r = g_regex_new ("\\+CNUM:\\s*((\"([^\"]|(\\\"))*\")|([^,]*)),\"(?<num>\\S+)\",\\d",
-                     G_REGEX_UNGREEDY, 0, NULL);
+    r = mm_regex_cache_get ("\\+CNUM:\\s*((\"([^\"]|(\\\"))*\")|([^,]*)),\"(?<num>\\S+)\",\\d",
+                            G_REGEX_UNGREEDY, 0, NULL);
     g_assert (r != NULL);
 
     g_regex_match (r, reply, 0, &match_info);
@@ -3510,7 +3787,7 @@ mm_3gpp_parse_cind_test_response (const gchar *reply,
     while (isspace (*reply))
         reply++;
 
-    r = g_regex_new ("\\(([^,]*),\\((\\d+)[-,](\\d+).*\\)", G_REGEX_UNGREEDY, 0, NULL);
+    r = mm_regex_cache_get ("\\(([^,]*),\\((\\d+)[-,](\\d+).*\\)", G_REGEX_UNGREEDY, 0, NULL);
     if (!r) {
         g_set_error_literal (error,
                              MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
@@ -3574,7 +3851,7 @@ mm_3gpp_parse_cind_read_response (const gchar *reply,
 
     reply = mm_strip_tag (reply, CIND_TAG);
 
-    r = g_regex_new ("(\\d+)[^0-9]+", G_REGEX_UNGREEDY, 0, NULL);
+    r = mm_regex_cache_get ("(\\d+)[^0-9]+", G_REGEX_UNGREEDY, 0, NULL);
     g_assert (r != NULL);
 
     if (!g_regex_match (r, reply, 0, &match_info)) {
@@ -3734,11 +4011,11 @@ mm_3gpp_parse_cgev_indication_pdp (const gchar  *str,
               type == MM_3GPP_CGEV_NW_DEACT_PDP ||
               type == MM_3GPP_CGEV_ME_DEACT_PDP);
 
-    r = g_regex_new ("(?:"
-                     "REJECT|"
-                     "NW REACT|"
-                     "NW DEACT|ME DEACT"
-                     ")\\s*([^,]*),\\s*([^,]*)(?:,\\s*([0-9]+))?", 0, 0, NULL);
+    r = mm_regex_cache_get ("(?:"
+                            "REJECT|"
+                            "NW REACT|"
+                            "NW DEACT|ME DEACT"
+                            ")\\s*([^,]*),\\s*([^,]*)(?:,\\s*([0-9]+))?", 0, 0, NULL);
 
     str = mm_strip_tag (str, "+CGEV:");
     g_regex_match_full (r, str, strlen (str), 0, 0, &match_info, &inner_error);
@@ -3818,10 +4095,10 @@ mm_3gpp_parse_cgev_indication_primary (const gchar  *str,
               (type == MM_3GPP_CGEV_NW_DEACT_PRIMARY) ||
               (type == MM_3GPP_CGEV_ME_DEACT_PRIMARY));
 
-    r = g_regex_new ("(?:"
-                     "NW PDN ACT|ME PDN ACT|"
-                     "NW PDN DEACT|ME PDN DEACT|"
-                     ")\\s*([0-9]+)", 0, 0, NULL);
+    r = mm_regex_cache_get ("(?:"
+                            "NW PDN ACT|ME PDN ACT|"
+                            "NW PDN DEACT|ME PDN DEACT|"
+                            ")\\s*([0-9]+)", 0, 0, NULL);
 
     str = mm_strip_tag (str, "+CGEV:");
     g_regex_match_full (r, str, strlen (str), 0, 0, &match_info, &inner_error);
@@ -3879,10 +4156,10 @@ mm_3gpp_parse_cgev_indication_secondary (const gchar  *str,
               type == MM_3GPP_CGEV_NW_DEACT_SECONDARY ||
               type == MM_3GPP_CGEV_ME_DEACT_SECONDARY);
 
-    r = g_regex_new ("(?:"
-                     "NW ACT|ME ACT|"
-                     "NW DEACT|ME DEACT"
-                     ")\\s*([0-9]+),\\s*([0-9]+),\\s*([0-9]+)", 0, 0, NULL);
+    r = mm_regex_cache_get ("(?:"
+                            "NW ACT|ME ACT|"
+                            "NW DEACT|ME DEACT"
+                            ")\\s*([0-9]+),\\s*([0-9]+),\\s*([0-9]+)", 0, 0, NULL);
 
     str = mm_strip_tag (str, "+CGEV:");
     g_regex_match_full (r, str, strlen (str), 0, 0, &match_info, &inner_error);
@@ -3959,8 +4236,8 @@ mm_3gpp_parse_pdu_cmgl_response (const gchar *str,
      *
      * We just read <index>, <stat> and the PDU itself.
      */
-    r = g_regex_new ("\\+CMGL:\\s*(\\d+)\\s*,\\s*(\\d+)\\s*,(.*)\\r\\n([^\\r\\n]*)(\\r\\n)?",
-                     G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+    r = mm_regex_cache_get ("\\+CMGL:\\s*(\\d+)\\s*,\\s*(\\d+)\\s*,(.*)\\r\\n([^\\r\\n]*)(\\r\\n)?",
+                            G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
     g_assert (r != NULL);
 
     g_regex_match_full (r, str, strlen (str), 0, 0, &match_info, &inner_error);
@@ -4703,9 +4980,9 @@ mm_cdma_parse_crm_test_response (const gchar *reply,
      *   <--- +CRM: (0-2)
      */
 
-    r = g_regex_new ("\\+CRM:\\s*\\((\\d+)-(\\d+)\\)",
-                     G_REGEX_DOLLAR_ENDONLY | G_REGEX_RAW,
-                     0, error);
+    r = mm_regex_cache_get ("\\+CRM:\\s*\\((\\d+)-(\\d+)\\)",
+                            G_REGEX_DOLLAR_ENDONLY | G_REGEX_RAW,
+                            0, error);
     g_assert (r != NULL);
 
     if (g_regex_match_full (r, reply, strlen (reply), 0, 0, &match_info, &match_error)) {
@@ -4991,7 +5268,7 @@ mm_parse_cclk_response (const char *response,
      *  +CCLK: "15/03/05,14:14:26-32"
      *  +CCLK: 17/07/26,11:42:15+01
      */
-    r = g_regex_new ("\\+CCLK:\\s*\"?(\\d+)/(\\d+)/(\\d+),(\\d+):(\\d+):(\\d+)([-+]\\d+)?\"?", 0, 0, NULL);
+    r = mm_regex_cache_get ("\\+CCLK:\\s*\"?(\\d+)/(\\d+)/(\\d+),(\\d+):(\\d+):(\\d+)([-+]\\d+)?\"?", 0, 0, NULL);
     g_assert (r != NULL);
 
     if (!g_regex_match_full (r, response, -1, 0, 0, &match_info, &match_error)) {
@@ -5083,7 +5360,7 @@ mm_parse_csim_response (const gchar *response,
     guint hex_code;
     GError *inner_error = NULL;
 
-    r = g_regex_new ("\\+CSIM:\\s*[0-9]+,\\s*\".*([0-9a-fA-F]{4})\"", G_REGEX_RAW, 0, NULL);
+    r = mm_regex_cache_get ("\\+CSIM:\\s*[0-9]+,\\s*\".*([0-9a-fA-F]{4})\"", G_REGEX_RAW, 0, NULL);
     g_regex_match (r, response, 0, &match_info);
 
     if (!g_match_info_matches (match_info)) {
@@ -5209,3 +5486,81 @@ out:
     g_strfreev (split);
     return valid;
 }
+
+/*****************************************************************************/
+
+gboolean
+mm_gps_trace_update_epoch (const gchar *trace,
+                           gchar        epoch[MM_GPS_EPOCH_MAX_LEN + 1])
+{
+    const gchar *start;
+    const gchar *end;
+    gsize len;
+
+    /* Only GGA and RMC traces are looked at, as those are given in every
+     * cycle */
+    if (trace[0] != '$' || !trace[1] || !trace[2] ||
+        (strncmp (&trace[3], "GGA,", 4) != 0 && strncmp (&trace[3], "RMC,", 4) != 0))
+        return FALSE;
+
+    start = &trace[7];
+    end = strchr (start, ',');
+    if (!end || end == start || end - start > MM_GPS_EPOCH_MAX_LEN)
+        return FALSE;
+
+    len = end - start;
+    if (strlen (epoch) == len && strncmp (epoch, start, len) == 0)
+        return FALSE;
+
+    memcpy (epoch, start, len);
+    epoch[len] = '\0';
+    return TRUE;
+}
+
+gboolean
+mm_gps_update_ready (gint64    now,
+                     gboolean  cycle_complete,
+                     gint64    last_trace_time,
+                     gint64    last_update_time,
+                     guint     refresh_rate_ms,
+                     gint64   *out_delay_us)
+{
+    gint64 next;
+
+    /* Unless a new cycle already started, wait until the traces of the
+     * current one stop coming */
+    if (!cycle_complete) {
+        next = last_trace_time + MM_GPS_UPDATE_COALESCE_MS * 1000;
+        if (now < next) {
+            *out_delay_us = next - now;
+            return FALSE;
+        }
+    }
+
+    /* And don't go above the refresh rate */
+    if (last_update_time) {
+        next = last_update_time + (gint64) refresh_rate_ms * 1000;
+        if (now < next) {
+            *out_delay_us = next - now;
+            return FALSE;
+        }
+    }
+
+    *out_delay_us = 0;
+    return TRUE;
+}
+
+void
+mm_gps_refresh_rate_normalize (guint     rate,
+                               gboolean  rate_in_ms,
+                               guint    *out_rate_secs,
+                               guint    *out_rate_ms)
+{
+    if (rate_in_ms) {
+        *out_rate_secs = rate / 1000;
+        *out_rate_ms = rate;
+    } else {
+        *out_rate_secs = rate;
+        *out_rate_ms = MIN (rate, G_MAXUINT / 1000) * 1000;
+    }
+}
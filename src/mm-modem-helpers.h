@@ -47,12 +47,25 @@
     (MM_MODEM_CAPABILITY_GSM_UMTS |     \
      MM_MODEM_CAPABILITY_3GPP_LTE)
 
+/* Precompiled regexes shared by all parsers, compiled on first use. Returns
+ * a new reference, so it can be used just as g_regex_new(). */
+GRegex *mm_regex_cache_get (const gchar         *pattern,
+                            GRegexCompileFlags   compile_options,
+                            GRegexMatchFlags     match_options,
+                            GError             **error);
+
 gchar       *mm_strip_quotes (gchar *str);
 const gchar *mm_strip_tag    (const gchar *str,
                               const gchar *cmd);
 
 gchar **mm_split_string_groups (const gchar *str);
 
+/* Split the reply to a compound command line (e.g. "+CGMI;+CGMM") into the
+ * information responses of each command. Returns NULL unless exactly
+ * @n_commands non-empty responses are found. */
+gchar **mm_split_compound_response (const gchar *str,
+                                    guint        n_commands);
+
 GArray *mm_parse_uint_list (const gchar  *str,
                             GError      **error);
 
@@ -138,6 +151,7 @@ MMFlowControl mm_flow_control_from_string (const gchar  *str,
 /* Common Regex getters */
 GPtrArray *mm_3gpp_creg_regex_get     (gboolean solicited);
 void       mm_3gpp_creg_regex_destroy (GPtrArray *array);
+GPtrArray *mm_3gpp_creg_line_regex_get (void);
 GRegex    *mm_3gpp_ciev_regex_get (void);
 GRegex    *mm_3gpp_cgev_regex_get (void);
 GRegex    *mm_3gpp_cusd_regex_get (void);
@@ -211,6 +225,28 @@ gint mm_3gpp_pdp_context_active_cmp (MM3gppPdpContextActive *a,
 GList *mm_3gpp_parse_cgact_read_response (const gchar *reply,
                                           GError **error);
 
+/* CREG/CGREG/CEREG/C5GREG response/unsolicited message tokenizer */
+typedef enum {
+    MM_3GPP_CREG_DOMAIN_CS,  /* +CREG */
+    MM_3GPP_CREG_DOMAIN_PS,  /* +CGREG */
+    MM_3GPP_CREG_DOMAIN_EPS, /* +CEREG */
+    MM_3GPP_CREG_DOMAIN_5GS, /* +C5GREG */
+} MM3gppCregDomain;
+
+typedef struct {
+    MM3gppCregDomain             domain;
+    MMModem3gppRegistrationState state;
+    gulong                       lac; /* LAC or TAC, as reported */
+    gulong                       ci;
+    MMModemAccessTechnology      act;
+} MM3gppCregResult;
+
+gboolean mm_3gpp_parse_creg_line (const gchar       *line,
+                                  gssize             len,
+                                  gboolean           solicited,
+                                  MM3gppCregResult  *result,
+                                  GError           **error);
+
 /* CREG/CGREG response/unsolicited message parser */
 gboolean mm_3gpp_parse_creg_response (GMatchInfo *info,
                                       MMModem3gppRegistrationState *out_reg_state,
@@ -503,4 +539,36 @@ gboolean mm_parse_supl_address (const gchar  *supl,
                                 guint16      *out_port,
                                 GError      **error);
 
+/*****************************************************************************/
+/* GPS location update helpers */
+/*****************************************************************************/
+
+/* Time without new GPS traces after which the current fix cycle is taken as
+ * complete, and its location published */
+#define MM_GPS_UPDATE_COALESCE_MS 50
+
+/* Longest UTC time accepted in GGA and RMC traces, e.g. "hhmmss.sss" */
+#define MM_GPS_EPOCH_MAX_LEN 15
+
+/* Traces of the same fix cycle report the same UTC time. Returns TRUE if the
+ * trace starts a new fix cycle, and keeps its UTC time in @epoch. */
+gboolean mm_gps_trace_update_epoch (const gchar *trace,
+                                    gchar        epoch[MM_GPS_EPOCH_MAX_LEN + 1]);
+
+/* Returns TRUE if the pending location updates should be published now, or
+ * FALSE and the time to wait before checking again. Times are monotonic, in
+ * microseconds; @last_update_time is 0 if nothing was published yet. */
+gboolean mm_gps_update_ready (gint64    now,
+                              gboolean  cycle_complete,
+                              gint64    last_trace_time,
+                              gint64    last_update_time,
+                              guint     refresh_rate_ms,
+                              gint64   *out_delay_us);
+
+/* Refresh rate given either in seconds or in milliseconds, in both units */
+void mm_gps_refresh_rate_normalize (guint     rate,
+                                    gboolean  rate_in_ms,
+                                    guint    *out_rate_secs,
+                                    guint    *out_rate_ms);
+
 #endif  /* MM_MODEM_HELPERS_H */
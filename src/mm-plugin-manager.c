@@ -28,6 +28,8 @@
 #include "mm-plugin-manager.h"
 #include "mm-plugin.h"
 #include "mm-log.h"
+#include "mm-probe-cache.h"
+#include "mm-daemon-enums-types.h"
 
 static void initable_iface_init (GInitableIface *iface);
 
@@ -204,6 +206,9 @@ struct _PortContext {
     MMPlugin *best_plugin;
     /* A plugin was suggested for this port. */
     MMPlugin *suggested_plugin;
+    /* Union of the probings needed by all the plugins to test, so that the
+     * port is probed only once. */
+    MMPluginProbeSettings probe_settings;
 
     /* The probe has been deferred */
     guint defer_id;
@@ -526,6 +531,7 @@ port_context_next (PortContext *port_context)
     mm_plugin_supports_port (plugin,
                              port_context->device,
                              port_context->port,
+                             &port_context->probe_settings,
                              port_context->cancellable,
                              (GAsyncReadyCallback) plugin_supports_port_ready,
                              port_context_ref (port_context));
@@ -598,6 +604,22 @@ port_context_run (MMPluginManager     *self,
                      port_context->name, mm_plugin_get_name (suggested));
     }
 
+    /* Gather the probings required by all the plugins that may be tried */
+    {
+        GList *l;
+        gchar *probe_list_str;
+
+        for (l = port_context->current; l; l = g_list_next (l))
+            mm_plugin_merge_probe_settings (MM_PLUGIN (l->data),
+                                            port_context->device,
+                                            port_context->port,
+                                            &port_context->probe_settings);
+        probe_list_str = mm_port_probe_flag_build_string_from_mask (port_context->probe_settings.flags);
+        mm_dbg ("[plugin manager] task %s: probings required by all plugins: '%s'",
+                port_context->name, probe_list_str);
+        g_free (probe_list_str);
+    }
+
     /* Log the list of plugins found and specify which are the ones that are going
      * to be run */
     {
@@ -829,6 +851,15 @@ device_context_complete (DeviceContext *device_context)
     /* Log about the time required to complete the checks */
     mm_dbg ("[plugin manager] task %s: finished in '%lf' seconds",
             device_context->name, g_timer_elapsed (device_context->timer, NULL));
+    {
+        GList *l;
+
+        for (l = mm_device_peek_port_probe_list (device_context->device); l; l = g_list_next (l))
+            mm_dbg ("[plugin manager] task %s: port %s probed in '%lf' seconds",
+                    device_context->name,
+                    mm_port_probe_get_port_name (MM_PORT_PROBE (l->data)),
+                    mm_port_probe_get_probing_time (MM_PORT_PROBE (l->data)));
+    }
 
     /* Remove signal handlers */
     if (device_context->grabbed_id) {
@@ -847,8 +878,10 @@ device_context_complete (DeviceContext *device_context)
     if (!device_context->best_plugin)
         g_task_return_new_error (task, MM_CORE_ERROR, MM_CORE_ERROR_UNSUPPORTED,
                                  "not supported by any plugin");
-    else
+    else {
+        mm_probe_cache_store_device (device_context->device, mm_plugin_get_name (device_context->best_plugin));
         g_task_return_pointer (task, g_object_ref (device_context->best_plugin), g_object_unref);
+    }
     g_object_unref (task);
 }
 
@@ -1095,6 +1128,24 @@ device_context_run_port_context (DeviceContext *device_context,
         !g_str_equal (mm_plugin_get_name (device_context->best_plugin), MM_PLUGIN_GENERIC_NAME)) {
         suggested = device_context->best_plugin;
     }
+    /* Otherwise, if the device is known, suggest the plugin that handled it
+     * the last time, as long as it is among the ones to test */
+    else if (!device_context->best_plugin) {
+        gchar *cached;
+
+        cached = mm_probe_cache_get_plugin (port_context->port);
+        if (cached && !g_str_equal (cached, MM_PLUGIN_GENERIC_NAME)) {
+            MMPlugin *plugin;
+
+            plugin = mm_plugin_manager_peek_plugin (self, cached);
+            if (plugin && g_list_find (plugins, plugin)) {
+                mm_dbg ("[plugin manager] task %s: plugin '%s' suggested by probe cache",
+                        port_context->name, cached);
+                suggested = plugin;
+            }
+        }
+        g_free (cached);
+    }
 
     port_context_run (self,
                       port_context,
@@ -1215,10 +1266,29 @@ device_context_port_grabbed (DeviceContext  *device_context,
 
     /* Îf still waiting the min wait time, store it in the waiting list */
     if (device_context->min_wait_time_id) {
+        guint n_cached_ports;
+
         mm_dbg ("[plugin manager) task %s: deferred until min wait time elapsed",
                 port_context->name);
         /* Store the port reference in the list within the device */
         device_context->wait_port_contexts = g_list_prepend (device_context->wait_port_contexts, port_context);
+
+        /* If the device is known and all the ports it had the last time are
+         * already exposed, there is no point in waiting any longer */
+        n_cached_ports = mm_probe_cache_get_n_ports (port);
+        if (n_cached_ports > 0 && g_list_length (device_context->wait_port_contexts) >= n_cached_ports) {
+            mm_dbg ("[plugin manager] task %s: all %u cached ports available, not waiting any longer",
+                    device_context->name, n_cached_ports);
+            if (device_context->min_probing_time_id) {
+                g_source_remove (device_context->min_probing_time_id);
+                device_context->min_probing_time_id = 0;
+            }
+            g_source_remove (device_context->min_wait_time_id);
+            device_context_min_wait_time_elapsed (device_context);
+            /* All ports may have been filtered */
+            if (!device_context->port_contexts)
+                device_context_continue (device_context);
+        }
         return;
     }
 
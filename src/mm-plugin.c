@@ -36,6 +36,7 @@
 #include "mm-private-boxed-types.h"
 #include "mm-log.h"
 #include "mm-daemon-enums-types.h"
+#include "mm-probe-cache.h"
 
 #if defined WITH_QMI
 # include "mm-broadband-modem-qmi.h"
@@ -214,11 +215,14 @@ apply_subsystem_filter (MMPlugin       *self,
     return FALSE;
 }
 
-/* Returns TRUE if the support check request was filtered out */
+/* Returns TRUE if the support check request was filtered out. The filter
+ * is only logged if @log is TRUE, so that checks run on behalf of other
+ * plugins don't repeat what the plugin's own support check logs. */
 static gboolean
 apply_pre_probing_filters (MMPlugin       *self,
                            MMDevice       *device,
                            MMKernelDevice *port,
+                           gboolean        log,
                            gboolean       *need_vendor_probing,
                            gboolean       *need_product_probing)
 {
@@ -234,9 +238,10 @@ apply_pre_probing_filters (MMPlugin       *self,
     /* The plugin may specify that only some subsystems are supported. If that
      * is the case, filter by subsystem */
     if (apply_subsystem_filter (self, port)) {
-        mm_dbg ("(%s) [%s] filtered by subsystem",
-                self->priv->name,
-                mm_kernel_device_get_name (port));
+        if (log)
+            mm_dbg ("(%s) [%s] filtered by subsystem",
+                    self->priv->name,
+                    mm_kernel_device_get_name (port));
         return TRUE;
     }
 
@@ -265,9 +270,10 @@ apply_pre_probing_filters (MMPlugin       *self,
 
         /* If error retrieving driver: unsupported */
         if (!drivers) {
-            mm_dbg ("(%s) [%s] filtered as couldn't retrieve drivers",
-                    self->priv->name,
-                    mm_kernel_device_get_name (port));
+            if (log)
+                mm_dbg ("(%s) [%s] filtered as couldn't retrieve drivers",
+                        self->priv->name,
+                        mm_kernel_device_get_name (port));
             return TRUE;
         }
 
@@ -286,9 +292,10 @@ apply_pre_probing_filters (MMPlugin       *self,
 
             /* If we didn't match any driver: unsupported */
             if (!found) {
-                mm_dbg ("(%s) [%s] filtered by drivers",
-                        self->priv->name,
-                        mm_kernel_device_get_name (port));
+                if (log)
+                    mm_dbg ("(%s) [%s] filtered by drivers",
+                            self->priv->name,
+                            mm_kernel_device_get_name (port));
                 return TRUE;
             }
         }
@@ -301,9 +308,10 @@ apply_pre_probing_filters (MMPlugin       *self,
                 for (j = 0; drivers[j]; j++) {
                     /* If we match a forbidden driver: unsupported */
                     if (g_str_equal (drivers[j], self->priv->forbidden_drivers[i])) {
-                        mm_dbg ("(%s) [%s] filtered by forbidden drivers",
-                                self->priv->name,
-                                mm_kernel_device_get_name (port));
+                        if (log)
+                            mm_dbg ("(%s) [%s] filtered by forbidden drivers",
+                                    self->priv->name,
+                                    mm_kernel_device_get_name (port));
                         return TRUE;
                     }
                 }
@@ -317,9 +325,10 @@ apply_pre_probing_filters (MMPlugin       *self,
             for (j = 0; drivers[j]; j++) {
                 /* If we match the QMI driver: unsupported */
                 if (g_str_equal (drivers[j], "qmi_wwan")) {
-                    mm_dbg ("(%s) [%s] filtered by implicit QMI driver",
-                            self->priv->name,
-                            mm_kernel_device_get_name (port));
+                    if (log)
+                        mm_dbg ("(%s) [%s] filtered by implicit QMI driver",
+                                self->priv->name,
+                                mm_kernel_device_get_name (port));
                     return TRUE;
                 }
             }
@@ -332,9 +341,10 @@ apply_pre_probing_filters (MMPlugin       *self,
             for (j = 0; drivers[j]; j++) {
                 /* If we match the MBIM driver: unsupported */
                 if (g_str_equal (drivers[j], "cdc_mbim")) {
-                    mm_dbg ("(%s) [%s] filtered by implicit MBIM driver",
-                            self->priv->name,
-                            mm_kernel_device_get_name (port));
+                    if (log)
+                        mm_dbg ("(%s) [%s] filtered by implicit MBIM driver",
+                                self->priv->name,
+                                mm_kernel_device_get_name (port));
                     return TRUE;
                 }
             }
@@ -398,9 +408,10 @@ apply_pre_probing_filters (MMPlugin       *self,
           !self->priv->forbidden_product_strings) ||
          g_str_equal (mm_kernel_device_get_subsystem (port), "net") ||
          g_str_has_prefix (mm_kernel_device_get_name (port), "cdc-wdm"))) {
-        mm_dbg ("(%s) [%s] filtered by vendor/product IDs",
-                self->priv->name,
-                mm_kernel_device_get_name (port));
+        if (log)
+            mm_dbg ("(%s) [%s] filtered by vendor/product IDs",
+                    self->priv->name,
+                    mm_kernel_device_get_name (port));
         return TRUE;
     }
 
@@ -410,9 +421,10 @@ apply_pre_probing_filters (MMPlugin       *self,
         for (i = 0; self->priv->forbidden_product_ids[i].l; i++) {
             if (vendor == self->priv->forbidden_product_ids[i].l &&
                 product == self->priv->forbidden_product_ids[i].r) {
-                mm_dbg ("(%s) [%s] filtered by forbidden vendor/product IDs",
-                        self->priv->name,
-                        mm_kernel_device_get_name (port));
+                if (log)
+                    mm_dbg ("(%s) [%s] filtered by forbidden vendor/product IDs",
+                            self->priv->name,
+                            mm_kernel_device_get_name (port));
                 return TRUE;
             }
         }
@@ -451,9 +463,10 @@ apply_pre_probing_filters (MMPlugin       *self,
 
         /* If we didn't match any udev tag: unsupported */
         if (!self->priv->udev_tags[i]) {
-            mm_dbg ("(%s) [%s] filtered by udev tags",
-                    self->priv->name,
-                    mm_kernel_device_get_name (port));
+            if (log)
+                mm_dbg ("(%s) [%s] filtered by udev tags",
+                        self->priv->name,
+                        mm_kernel_device_get_name (port));
             return TRUE;
         }
     }
@@ -729,11 +742,94 @@ mm_plugin_supports_port_finish (MMPlugin      *self,
     return (MMPluginSupportsResult)value;
 }
 
+static MMPortProbeFlag
+build_probe_run_flags (MMPlugin       *self,
+                       MMKernelDevice *port,
+                       gboolean        need_vendor_probing,
+                       gboolean        need_product_probing)
+{
+    MMPortProbeFlag probe_run_flags;
+
+    probe_run_flags = MM_PORT_PROBE_NONE;
+    if (!g_str_has_prefix (mm_kernel_device_get_name (port), "cdc-wdm")) {
+        /* Serial ports... */
+        if (self->priv->at)
+            probe_run_flags |= MM_PORT_PROBE_AT;
+        else if (self->priv->single_at)
+            probe_run_flags |= MM_PORT_PROBE_AT;
+        if (self->priv->qcdm)
+            probe_run_flags |= MM_PORT_PROBE_QCDM;
+    } else {
+        /* cdc-wdm ports... */
+        if (self->priv->qmi && !g_strcmp0 (mm_kernel_device_get_driver (port), "qmi_wwan"))
+            probe_run_flags |= MM_PORT_PROBE_QMI;
+        else if (self->priv->mbim && !g_strcmp0 (mm_kernel_device_get_driver (port), "cdc_mbim"))
+            probe_run_flags |= MM_PORT_PROBE_MBIM;
+        else
+            probe_run_flags |= MM_PORT_PROBE_AT;
+    }
+
+    /* For potential AT ports, check for more things */
+    if (probe_run_flags & MM_PORT_PROBE_AT) {
+        if (need_vendor_probing)
+            probe_run_flags |= MM_PORT_PROBE_AT_VENDOR;
+        if (need_product_probing)
+            probe_run_flags |= MM_PORT_PROBE_AT_PRODUCT;
+        if (self->priv->icera_probe || self->priv->allowed_icera || self->priv->forbidden_icera)
+            probe_run_flags |= MM_PORT_PROBE_AT_ICERA;
+        if (self->priv->xmm_probe || self->priv->allowed_xmm || self->priv->forbidden_xmm)
+            probe_run_flags |= MM_PORT_PROBE_AT_XMM;
+    }
+
+    return probe_run_flags;
+}
+
+void
+mm_plugin_merge_probe_settings (MMPlugin              *self,
+                                MMDevice              *device,
+                                MMKernelDevice        *port,
+                                MMPluginProbeSettings *settings)
+{
+    MMPortProbeFlag flags;
+    gboolean        need_vendor_probing;
+    gboolean        need_product_probing;
+
+    g_return_if_fail (MM_IS_PLUGIN (self));
+    g_return_if_fail (settings != NULL);
+
+    if (apply_pre_probing_filters (self, device, port, FALSE, &need_vendor_probing, &need_product_probing))
+        return;
+
+    /* Net ports are never probed */
+    if (g_str_equal (mm_kernel_device_get_subsystem (port), "net"))
+        return;
+
+    flags = build_probe_run_flags (self, port, need_vendor_probing, need_product_probing);
+    settings->flags |= flags;
+
+    /* AT probing must work for every plugin needing it */
+    if (flags & MM_PORT_PROBE_AT) {
+        settings->send_delay = MAX (settings->send_delay, self->priv->send_delay);
+        settings->remove_echo |= self->priv->remove_echo;
+        settings->send_lf |= self->priv->send_lf;
+    }
+}
+
+/* Probings that may be run in the same serial port session, when other
+ * plugins will need them anyway */
+#define SHARED_PROBE_FLAGS (MM_PORT_PROBE_AT |          \
+                            MM_PORT_PROBE_AT_VENDOR |   \
+                            MM_PORT_PROBE_AT_PRODUCT |  \
+                            MM_PORT_PROBE_AT_ICERA |    \
+                            MM_PORT_PROBE_AT_XMM |      \
+                            MM_PORT_PROBE_QCDM)
+
 void
-mm_plugin_supports_port (MMPlugin            *self,
-                         MMDevice            *device,
-                         MMKernelDevice      *port,
-                         GCancellable        *cancellable,
+mm_plugin_supports_port (MMPlugin                    *self,
+                         MMDevice                    *device,
+                         MMKernelDevice              *port,
+                         const MMPluginProbeSettings *shared,
+                         GCancellable                *cancellable,
                          GAsyncReadyCallback  callback,
                          gpointer             user_data)
 {
@@ -743,6 +839,10 @@ mm_plugin_supports_port (MMPlugin            *self,
     gboolean need_vendor_probing;
     gboolean need_product_probing;
     MMPortProbeFlag probe_run_flags;
+    MMPortProbeFlag extra_probe_flags = MM_PORT_PROBE_NONE;
+    guint64 send_delay;
+    gboolean remove_echo;
+    gboolean send_lf;
     gchar *probe_list_str;
 
     g_return_if_fail (MM_IS_PLUGIN (self));
@@ -756,6 +856,7 @@ mm_plugin_supports_port (MMPlugin            *self,
     if (apply_pre_probing_filters (self,
                                    device,
                                    port,
+                                   TRUE,
                                    &need_vendor_probing,
                                    &need_product_probing)) {
         /* Filtered! */
@@ -790,36 +891,7 @@ mm_plugin_supports_port (MMPlugin            *self,
     }
 
     /* Build flags depending on what probing needed */
-    probe_run_flags = MM_PORT_PROBE_NONE;
-    if (!g_str_has_prefix (mm_kernel_device_get_name (port), "cdc-wdm")) {
-        /* Serial ports... */
-        if (self->priv->at)
-            probe_run_flags |= MM_PORT_PROBE_AT;
-        else if (self->priv->single_at)
-            probe_run_flags |= MM_PORT_PROBE_AT;
-        if (self->priv->qcdm)
-            probe_run_flags |= MM_PORT_PROBE_QCDM;
-    } else {
-        /* cdc-wdm ports... */
-        if (self->priv->qmi && !g_strcmp0 (mm_kernel_device_get_driver (port), "qmi_wwan"))
-            probe_run_flags |= MM_PORT_PROBE_QMI;
-        else if (self->priv->mbim && !g_strcmp0 (mm_kernel_device_get_driver (port), "cdc_mbim"))
-            probe_run_flags |= MM_PORT_PROBE_MBIM;
-        else
-            probe_run_flags |= MM_PORT_PROBE_AT;
-    }
-
-    /* For potential AT ports, check for more things */
-    if (probe_run_flags & MM_PORT_PROBE_AT) {
-        if (need_vendor_probing)
-            probe_run_flags |= MM_PORT_PROBE_AT_VENDOR;
-        if (need_product_probing)
-            probe_run_flags |= MM_PORT_PROBE_AT_PRODUCT;
-        if (self->priv->icera_probe || self->priv->allowed_icera || self->priv->forbidden_icera)
-            probe_run_flags |= MM_PORT_PROBE_AT_ICERA;
-        if (self->priv->xmm_probe || self->priv->allowed_xmm || self->priv->forbidden_xmm)
-            probe_run_flags |= MM_PORT_PROBE_AT_XMM;
-    }
+    probe_run_flags = build_probe_run_flags (self, port, need_vendor_probing, need_product_probing);
 
     /* If no explicit probing was required, just request to grab it without probing anything.
      * This may happen, e.g. with cdc-wdm ports which do not need QMI/MBIM probing. */
@@ -845,6 +917,15 @@ mm_plugin_supports_port (MMPlugin            *self,
         mm_port_probe_set_result_at (probe, FALSE);
     }
 
+    /* If this plugin handled the device the last time it was seen, reuse the
+     * cached probing results. Plugins with custom init steps still need to
+     * probe, as those may set up plugin-specific info in the probe. */
+    if (!self->priv->custom_init &&
+        mm_probe_cache_load_probe (probe, self->priv->name, probe_run_flags))
+        mm_dbg ("(%s) [%s] probing skipped: results loaded from cache",
+                self->priv->name,
+                mm_kernel_device_get_name (port));
+
     /* Setup async call context */
     ctx = g_slice_new0 (PortProbeRunContext);
     ctx->self   = g_object_ref (self);
@@ -862,11 +943,38 @@ mm_plugin_supports_port (MMPlugin            *self,
             probe_list_str);
     g_free (probe_list_str);
 
+    /* In serial ports, also run the probings that the remaining plugins will
+     * need, so that the port is probed only once. Only the ones requested by
+     * this plugin are used by the post-probing filters. Never open the port
+     * just for the sake of other plugins, though. */
+    send_delay = self->priv->send_delay;
+    remove_echo = self->priv->remove_echo;
+    send_lf = self->priv->send_lf;
+    if (shared &&
+        !g_str_has_prefix (mm_kernel_device_get_name (port), "cdc-wdm") &&
+        (mm_port_probe_get_probed_flags (probe) & probe_run_flags) != probe_run_flags)
+        extra_probe_flags = shared->flags & SHARED_PROBE_FLAGS & ~probe_run_flags;
+    if (extra_probe_flags) {
+        probe_list_str = mm_port_probe_flag_build_string_from_mask (extra_probe_flags);
+        mm_dbg ("(%s) [%s] probe also run for other plugins: '%s'",
+                self->priv->name,
+                mm_kernel_device_get_name (port),
+                probe_list_str);
+        g_free (probe_list_str);
+
+        /* The AT probing settings must then suit the other plugins as well */
+        if (extra_probe_flags & ~MM_PORT_PROBE_QCDM) {
+            send_delay = MAX (send_delay, shared->send_delay);
+            remove_echo |= shared->remove_echo;
+            send_lf |= shared->send_lf;
+        }
+    }
+
     mm_port_probe_run (probe,
-                       ctx->flags,
-                       self->priv->send_delay,
-                       self->priv->remove_echo,
-                       self->priv->send_lf,
+                       ctx->flags | extra_probe_flags,
+                       send_delay,
+                       remove_echo,
+                       send_lf,
                        self->priv->custom_at_probe,
                        self->priv->custom_init,
                        cancellable,
@@ -888,6 +996,7 @@ mm_plugin_discard_port_early (MMPlugin       *self,
     if (apply_pre_probing_filters (self,
                                    device,
                                    port,
+                                   TRUE,
                                    &need_vendor_probing,
                                    &need_product_probing))
         return MM_PLUGIN_SUPPORTS_HINT_UNSUPPORTED;
@@ -134,15 +134,35 @@ MMPluginSupportsHint mm_plugin_discard_port_early (MMPlugin       *self,
                                                    MMDevice       *device,
                                                    MMKernelDevice *port);
 
-void                   mm_plugin_supports_port        (MMPlugin             *self,
-                                                       MMDevice             *device,
-                                                       MMKernelDevice       *port,
-                                                       GCancellable         *cancellable,
-                                                       GAsyncReadyCallback   callback,
-                                                       gpointer              user_data);
-MMPluginSupportsResult mm_plugin_supports_port_finish (MMPlugin             *self,
-                                                       GAsyncResult         *result,
-                                                       GError              **error);
+/* Probings and AT probing settings needed by one or more plugins in a port */
+typedef struct {
+    MMPortProbeFlag flags;
+    guint64         send_delay;
+    gboolean        remove_echo;
+    gboolean        send_lf;
+} MMPluginProbeSettings;
+
+/* Merges the probings needed by this plugin in the given port into @settings,
+ * along with its AT probing settings if it needs AT probing: the largest send
+ * delay is kept and the flags are OR'ed. Nothing is merged if the port is
+ * filtered before probing. */
+void mm_plugin_merge_probe_settings (MMPlugin              *self,
+                                     MMDevice              *device,
+                                     MMKernelDevice        *port,
+                                     MMPluginProbeSettings *settings);
+
+/* Shared settings are the ones merged for all the candidate plugins, whose
+ * probings may be run along with the ones this plugin needs. */
+void                   mm_plugin_supports_port        (MMPlugin                    *self,
+                                                       MMDevice                    *device,
+                                                       MMKernelDevice              *port,
+                                                       const MMPluginProbeSettings *shared,
+                                                       GCancellable                *cancellable,
+                                                       GAsyncReadyCallback          callback,
+                                                       gpointer                     user_data);
+MMPluginSupportsResult mm_plugin_supports_port_finish (MMPlugin                    *self,
+                                                       GAsyncResult                *result,
+                                                       GError                     **error);
 
 MMBaseModem *mm_plugin_create_modem (MMPlugin *self,
                                      MMDevice *device,
@@ -0,0 +1,286 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include <ModemManager.h>
+#include <mm-errors-types.h>
+
+#include "mm-port-capture.h"
+#include "mm-port-capture-decoder.h"
+#include "libqcdm/src/utils.h"
+
+/* Data received from the modem is reassembled per port, so that transcripts
+ * show full lines or frames instead of the chunks given by each read() */
+typedef struct {
+    gchar      *name;
+    MMPortType  type;
+    GByteArray *pending[2]; /* indexed by MMPortCaptureDirection */
+} CapturePort;
+
+static void
+capture_port_free (CapturePort *port)
+{
+    g_free (port->name);
+    g_byte_array_unref (port->pending[MM_PORT_CAPTURE_DIRECTION_OUT]);
+    g_byte_array_unref (port->pending[MM_PORT_CAPTURE_DIRECTION_IN]);
+    g_slice_free (CapturePort, port);
+}
+
+static void
+append_prefix (GString                *transcript,
+               gint64                  timestamp,
+               const CapturePort      *port,
+               MMPortCaptureDirection  direction)
+{
+    g_string_append_printf (transcript,
+                            "[%09" G_GINT64_FORMAT ".%06" G_GINT64_FORMAT "] %s %s ",
+                            timestamp / G_USEC_PER_SEC,
+                            timestamp % G_USEC_PER_SEC,
+                            port->name,
+                            direction == MM_PORT_CAPTURE_DIRECTION_OUT ? "-->" : "<--");
+}
+
+static void
+append_hex (GString      *transcript,
+            const guint8 *data,
+            gsize         len)
+{
+    gsize i;
+
+    for (i = 0; i < len; i++)
+        g_string_append_printf (transcript, "%s%02x", i ? ":" : "", data[i]);
+}
+
+/*****************************************************************************/
+/* AT and NMEA: text lines */
+
+static void
+append_text (GString      *transcript,
+             const guint8 *data,
+             gsize         len)
+{
+    gsize i;
+
+    g_string_append_c (transcript, '\'');
+    for (i = 0; i < len; i++) {
+        if (g_ascii_isprint (data[i]))
+            g_string_append_c (transcript, data[i]);
+        else if (data[i] == '\r')
+            g_string_append (transcript, "<CR>");
+        else if (data[i] == '\n')
+            g_string_append (transcript, "<LF>");
+        else
+            g_string_append_printf (transcript, "\\%u", data[i]);
+    }
+    g_string_append (transcript, "'\n");
+}
+
+static void
+decode_text (GString                *transcript,
+             gint64                  timestamp,
+             CapturePort            *port,
+             MMPortCaptureDirection  direction)
+{
+    GByteArray *pending = port->pending[direction];
+    guint       start = 0;
+    guint       i;
+
+    /* Commands are written in one go */
+    if (direction == MM_PORT_CAPTURE_DIRECTION_OUT) {
+        append_prefix (transcript, timestamp, port, direction);
+        append_text (transcript, pending->data, pending->len);
+        g_byte_array_set_size (pending, 0);
+        return;
+    }
+
+    /* Responses are printed one line at a time, skipping empty lines */
+    for (i = 0; i < pending->len; i++) {
+        if (pending->data[i] != '\n')
+            continue;
+        if (i + 1 - start > 2 || (pending->data[start] != '\r' && pending->data[start] != '\n')) {
+            append_prefix (transcript, timestamp, port, direction);
+            append_text (transcript, &pending->data[start], i + 1 - start);
+        }
+        start = i + 1;
+    }
+    g_byte_array_remove_range (pending, 0, start);
+}
+
+/*****************************************************************************/
+/* QCDM: HDLC-like frames, unescaped and CRC checked by libqcdm */
+
+static void
+decode_qcdm (GString                *transcript,
+             gint64                  timestamp,
+             CapturePort            *port,
+             MMPortCaptureDirection  direction)
+{
+    GByteArray *pending = port->pending[direction];
+    gchar       frame[4096];
+
+    while (pending->len > 0) {
+        size_t   frame_len = 0;
+        size_t   used = 0;
+        qcdmbool more = FALSE;
+        qcdmbool success;
+
+        success = dm_decapsulate_buffer ((const char *) pending->data, pending->len,
+                                         frame, sizeof (frame),
+                                         &frame_len, &used, &more);
+        if (success && more)
+            break;
+
+        if (success) {
+            append_prefix (transcript, timestamp, port, direction);
+            /* The frame ends with the CRC */
+            g_string_append_printf (transcript, "QCDM command %u: ", (guint8) frame[0]);
+            append_hex (transcript, (const guint8 *) frame, frame_len > 2 ? frame_len - 2 : frame_len);
+            g_string_append_c (transcript, '\n');
+        } else if (used > 1) {
+            /* A leading control char is expected, anything else is garbage */
+            append_prefix (transcript, timestamp, port, direction);
+            g_string_append_printf (transcript, "invalid QCDM frame (%u bytes)\n", (guint) used);
+        }
+
+        if (!used)
+            break;
+        g_byte_array_remove_range (pending, 0, MIN (used, pending->len));
+    }
+}
+
+/*****************************************************************************/
+
+/* Only serial ports are captured, so only AT, GPS and QCDM ports are expected
+ * here; anything else is dumped as is */
+static void
+decode_data (GString                *transcript,
+             gboolean                hex,
+             gint64                  timestamp,
+             CapturePort            *port,
+             MMPortCaptureDirection  direction,
+             const guint8           *data,
+             gsize                   len)
+{
+    if (hex) {
+        append_prefix (transcript, timestamp, port, direction);
+        g_string_append (transcript, "raw: ");
+        append_hex (transcript, data, len);
+        g_string_append_c (transcript, '\n');
+    }
+
+    g_byte_array_append (port->pending[direction], data, len);
+
+    switch (port->type) {
+    case MM_PORT_TYPE_AT:
+    case MM_PORT_TYPE_GPS:
+        decode_text (transcript, timestamp, port, direction);
+        break;
+    case MM_PORT_TYPE_QCDM:
+        decode_qcdm (transcript, timestamp, port, direction);
+        break;
+    default:
+        if (!hex) {
+            append_prefix (transcript, timestamp, port, direction);
+            append_hex (transcript, data, len);
+            g_string_append_c (transcript, '\n');
+        }
+        g_byte_array_set_size (port->pending[direction], 0);
+        break;
+    }
+}
+
+gboolean
+mm_port_capture_decode (FILE      *file,
+                        gboolean   hex,
+                        GString   *transcript,
+                        GError   **error)
+{
+    MMPortCaptureFileHeader  file_header;
+    GHashTable              *ports;
+    GByteArray              *payload;
+    gboolean                 success = TRUE;
+
+    if (fread (&file_header, sizeof (file_header), 1, file) != 1 ||
+        memcmp (file_header.magic, MM_PORT_CAPTURE_MAGIC, sizeof (file_header.magic)) != 0) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                     "Not a port capture file");
+        return FALSE;
+    }
+    if (GUINT32_FROM_LE (file_header.version) != MM_PORT_CAPTURE_VERSION) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_UNSUPPORTED,
+                     "Unsupported port capture format version: %u",
+                     GUINT32_FROM_LE (file_header.version));
+        return FALSE;
+    }
+
+    ports = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) capture_port_free);
+    payload = g_byte_array_new ();
+
+    while (TRUE) {
+        MMPortCaptureRecordHeader  header;
+        CapturePort               *port;
+        guint16                    port_id;
+        guint32                    length;
+        gint64                     timestamp;
+
+        if (fread (&header, sizeof (header), 1, file) != 1)
+            break;
+
+        port_id = GUINT16_FROM_LE (header.port_id);
+        length = GUINT32_FROM_LE (header.length);
+        timestamp = GINT64_FROM_LE (header.timestamp);
+
+        g_byte_array_set_size (payload, length);
+        if (length > 0 && fread (payload->data, length, 1, file) != 1) {
+            g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                         "Truncated record");
+            success = FALSE;
+            break;
+        }
+
+        switch (header.type) {
+        case MM_PORT_CAPTURE_RECORD_PORT:
+            /* A new session may reuse the id */
+            port = g_slice_new0 (CapturePort);
+            port->name = g_strndup ((const gchar *) payload->data, length);
+            port->type = (MMPortType) header.flags;
+            port->pending[MM_PORT_CAPTURE_DIRECTION_OUT] = g_byte_array_new ();
+            port->pending[MM_PORT_CAPTURE_DIRECTION_IN] = g_byte_array_new ();
+            g_hash_table_replace (ports, GUINT_TO_POINTER (port_id), port);
+            break;
+
+        case MM_PORT_CAPTURE_RECORD_DATA:
+            port = g_hash_table_lookup (ports, GUINT_TO_POINTER (port_id));
+            if (!port) {
+                g_string_append_printf (transcript, "warning: data for unknown port %u\n", port_id);
+                break;
+            }
+            if (header.flags != MM_PORT_CAPTURE_DIRECTION_OUT && header.flags != MM_PORT_CAPTURE_DIRECTION_IN) {
+                g_string_append_printf (transcript, "warning: unknown direction %u\n", header.flags);
+                break;
+            }
+            decode_data (transcript, hex, timestamp, port, (MMPortCaptureDirection) header.flags, payload->data, length);
+            break;
+
+        default:
+            /* Unknown records are skipped */
+            break;
+        }
+    }
+
+    g_byte_array_unref (payload);
+    g_hash_table_unref (ports);
+    return success;
+}
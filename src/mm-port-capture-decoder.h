@@ -0,0 +1,31 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_PORT_CAPTURE_DECODER_H
+#define MM_PORT_CAPTURE_DECODER_H
+
+#include <stdio.h>
+#include <glib.h>
+
+/* Decodes a whole port capture file into a human readable transcript, one
+ * line per AT or NMEA line and per QCDM frame; traffic of any other port type
+ * is dumped in hex. If 'hex' is given, the raw bytes of every DATA record are
+ * dumped as well.
+ *
+ * On error, the transcript keeps whatever was decoded before the error. */
+gboolean mm_port_capture_decode (FILE      *file,
+                                 gboolean   hex,
+                                 GString   *transcript,
+                                 GError   **error);
+
+#endif /* MM_PORT_CAPTURE_DECODER_H */
@@ -0,0 +1,179 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+
+#include <ModemManager.h>
+#include <mm-errors-types.h>
+
+#include "mm-port-capture.h"
+#include "mm-log.h"
+
+/* Records are buffered and written out at most once per second, unless the
+ * buffer gets full before */
+#define CAPTURE_BUFFER_SIZE    65536
+#define CAPTURE_FLUSH_TIMEOUT  1
+
+static FILE   *capture_file;
+static gchar  *capture_buffer;
+static guint   capture_flush_id;
+static guint16 capture_session;
+static guint16 capture_next_port_id;
+static GQuark  capture_quark;
+
+/*****************************************************************************/
+
+static gboolean
+flush_cb (void)
+{
+    if (capture_file)
+        fflush (capture_file);
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+write_record (MMPortCaptureRecordType  type,
+              guint8                   flags,
+              guint16                  port_id,
+              const guint8            *data,
+              gsize                    len)
+{
+    MMPortCaptureRecordHeader header;
+
+    header.type = type;
+    header.flags = flags;
+    header.port_id = GUINT16_TO_LE (port_id);
+    header.length = GUINT32_TO_LE ((guint32) len);
+    header.timestamp = GINT64_TO_LE (g_get_real_time ());
+
+    if (fwrite (&header, sizeof (header), 1, capture_file) != 1 ||
+        (len > 0 && fwrite (data, len, 1, capture_file) != 1)) {
+        mm_warn ("couldn't write port capture record: %s; capture disabled", g_strerror (errno));
+        mm_port_capture_stop ();
+    }
+}
+
+/* Port ids are kept in the port object, along with the session they were
+ * given in, so that the PORT record is written again in a new session */
+static guint16
+get_port_id (MMPort *port)
+{
+    guint        value;
+    guint16      port_id;
+    const gchar *name;
+
+    value = GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (port), capture_quark));
+    if (value && (value >> 16) == capture_session)
+        return (guint16) (value & 0xFFFF);
+
+    port_id = capture_next_port_id++;
+    g_object_set_qdata (G_OBJECT (port), capture_quark,
+                        GUINT_TO_POINTER (((guint) capture_session << 16) | port_id));
+
+    name = mm_port_get_device (port);
+    write_record (MM_PORT_CAPTURE_RECORD_PORT,
+                  (guint8) mm_port_get_port_type (port),
+                  port_id,
+                  (const guint8 *) name,
+                  strlen (name));
+    return port_id;
+}
+
+void
+mm_port_capture_data (MMPort                 *port,
+                      MMPortCaptureDirection  direction,
+                      const guint8           *data,
+                      gsize                   len)
+{
+    guint16 port_id;
+
+    if (G_LIKELY (!capture_file))
+        return;
+
+    port_id = get_port_id (port);
+    /* Writing the port record may have failed */
+    if (capture_file)
+        write_record (MM_PORT_CAPTURE_RECORD_DATA, (guint8) direction, port_id, data, len);
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_port_capture_is_enabled (void)
+{
+    return !!capture_file;
+}
+
+gboolean
+mm_port_capture_start (const gchar  *path,
+                       GError      **error)
+{
+    if (capture_file) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_IN_PROGRESS,
+                     "Port capture already enabled");
+        return FALSE;
+    }
+
+    capture_file = fopen (path, "ab");
+    if (!capture_file) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                     "Couldn't open port capture file '%s': %s", path, g_strerror (errno));
+        return FALSE;
+    }
+
+    capture_buffer = g_malloc (CAPTURE_BUFFER_SIZE);
+    setvbuf (capture_file, capture_buffer, _IOFBF, CAPTURE_BUFFER_SIZE);
+
+    /* Only new files get the file header, sessions are appended */
+    fseek (capture_file, 0, SEEK_END);
+    if (ftell (capture_file) == 0) {
+        MMPortCaptureFileHeader header;
+
+        memcpy (header.magic, MM_PORT_CAPTURE_MAGIC, sizeof (header.magic));
+        header.version = GUINT32_TO_LE (MM_PORT_CAPTURE_VERSION);
+        fwrite (&header, sizeof (header), 1, capture_file);
+    }
+
+    if (G_UNLIKELY (!capture_quark))
+        capture_quark = g_quark_from_static_string ("mm-port-capture-id");
+
+    /* Session 0 is never used, so that unset qdata is never valid */
+    if (!++capture_session)
+        capture_session++;
+    capture_next_port_id = 0;
+    capture_flush_id = g_timeout_add_seconds (CAPTURE_FLUSH_TIMEOUT, (GSourceFunc) flush_cb, NULL);
+
+    mm_info ("port capture enabled: %s", path);
+    return TRUE;
+}
+
+void
+mm_port_capture_stop (void)
+{
+    if (!capture_file)
+        return;
+
+    if (capture_flush_id) {
+        g_source_remove (capture_flush_id);
+        capture_flush_id = 0;
+    }
+
+    fclose (capture_file);
+    capture_file = NULL;
+    g_clear_pointer (&capture_buffer, g_free);
+
+    mm_info ("port capture disabled");
+}
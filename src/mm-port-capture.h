@@ -0,0 +1,75 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_PORT_CAPTURE_H
+#define MM_PORT_CAPTURE_H
+
+#include <glib.h>
+
+#include "mm-port.h"
+
+/* Binary capture of the raw port traffic.
+ *
+ * The capture file starts with a header made of the 8-byte magic string and
+ * the 32-bit format version, followed by a stream of records. Each record
+ * has a fixed-size header followed by 'length' bytes of payload. All integers
+ * are little endian.
+ *
+ * A PORT record is written the first time each port shows up in a capture
+ * session, giving the id used for the port in the following DATA records;
+ * its 'flags' are the MMPortType of the port and its payload the port name.
+ * The 'flags' of DATA records are the MMPortCaptureDirection, and their
+ * payload the raw bytes as written to or read from the port.
+ *
+ * Ids are only valid within the session where they're given: a new session,
+ * with new PORT records, starts every time capture is (re)enabled.
+ */
+
+#define MM_PORT_CAPTURE_MAGIC   "MMPCAP\r\n"
+#define MM_PORT_CAPTURE_VERSION 1
+
+typedef enum {
+    MM_PORT_CAPTURE_RECORD_PORT = 1,
+    MM_PORT_CAPTURE_RECORD_DATA = 2,
+} MMPortCaptureRecordType;
+
+typedef enum {
+    MM_PORT_CAPTURE_DIRECTION_OUT = 0, /* sent to the modem */
+    MM_PORT_CAPTURE_DIRECTION_IN  = 1, /* received from the modem */
+} MMPortCaptureDirection;
+
+typedef struct {
+    guint8  type;      /* MMPortCaptureRecordType */
+    guint8  flags;
+    guint16 port_id;
+    guint32 length;    /* of the payload */
+    gint64  timestamp; /* wall clock, in microseconds */
+} __attribute__ ((packed)) MMPortCaptureRecordHeader;
+
+typedef struct {
+    gchar   magic[8];
+    guint32 version;
+} __attribute__ ((packed)) MMPortCaptureFileHeader;
+
+gboolean mm_port_capture_start      (const gchar  *path,
+                                     GError      **error);
+void     mm_port_capture_stop       (void);
+gboolean mm_port_capture_is_enabled (void);
+
+/* Capture of one chunk of port traffic; does nothing if capture is disabled */
+void     mm_port_capture_data       (MMPort                 *port,
+                                     MMPortCaptureDirection  direction,
+                                     const guint8           *data,
+                                     gsize                   len);
+
+#endif /* MM_PORT_CAPTURE_H */
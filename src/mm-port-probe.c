@@ -99,6 +99,11 @@ struct _MMPortProbePrivate {
     gboolean maybe_at_ppp;
     gboolean maybe_qcdm;
 
+    /* Probing timing */
+    gint64 probing_start;
+    gdouble probing_time;
+    gdouble at_response_time;
+
     /* Current probing task. Only one can be available at a time */
     GTask *task;
 };
@@ -108,6 +113,19 @@ struct _MMPortProbePrivate {
  * Always make sure that the stored task is NULL when the task is completed.
  */
 
+static void
+port_probe_update_probing_time (MMPortProbe *self)
+{
+    gdouble elapsed;
+
+    elapsed = (gdouble) (g_get_monotonic_time () - self->priv->probing_start) / G_USEC_PER_SEC;
+    self->priv->probing_time += elapsed;
+    mm_dbg ("(%s/%s) port probing took %.3lf seconds",
+            mm_kernel_device_get_subsystem (self->priv->port),
+            mm_kernel_device_get_name (self->priv->port),
+            elapsed);
+}
+
 static gboolean
 port_probe_task_return_error_if_cancelled (MMPortProbe *self)
 {
@@ -117,6 +135,7 @@ port_probe_task_return_error_if_cancelled (MMPortProbe *self)
     self->priv->task = NULL;
 
     if (g_task_return_error_if_cancelled (task)) {
+        port_probe_update_probing_time (self);
         g_object_unref (task);
         return TRUE;
     }
@@ -133,6 +152,7 @@ port_probe_task_return_error (MMPortProbe *self,
 
     task = self->priv->task;
     self->priv->task = NULL;
+    port_probe_update_probing_time (self);
     g_task_return_error (task, error);
     g_object_unref (task);
 }
@@ -145,6 +165,7 @@ port_probe_task_return_boolean (MMPortProbe *self,
 
     task = self->priv->task;
     self->priv->task = NULL;
+    port_probe_update_probing_time (self);
     g_task_return_boolean (task, result);
     g_object_unref (task);
 }
@@ -390,6 +411,8 @@ typedef struct {
     const MMPortProbeAtCommand *at_commands;
     /* Seconds between each AT command sent in the group */
     guint at_commands_wait_secs;
+    /* When the current AT command was sent */
+    gint64 at_command_start;
     /* Current AT Result processor */
     void (* at_result_processor) (MMPortProbe *self,
                                   GVariant *result);
@@ -967,6 +990,55 @@ serial_probe_at_result_processor (MMPortProbe *self,
     mm_port_probe_set_result_at (self, FALSE);
 }
 
+/* Once a port of the device has replied to AT probing, the default AT
+ * probing in the remaining ports uses a timeout based on the latency seen
+ * in that sibling port. It is only given up after a timeout when the sibling
+ * is the primary AT port, as other ports may just take longer to boot. */
+#define AT_PROBING_SIBLING_LATENCY_FACTOR 4
+
+static gboolean
+at_probing_is_default (PortProbeRunContext *ctx)
+{
+    return (ctx->at_result_processor == serial_probe_at_result_processor && !ctx->at_custom_probe);
+}
+
+/* Returns the AT response time of the fastest AT sibling port, or a negative
+ * value if none replied yet */
+static gdouble
+sibling_at_response_time (MMPortProbe *self)
+{
+    GList   *l;
+    gdouble  best = -1.0;
+
+    for (l = mm_device_peek_port_probe_list (self->priv->device); l; l = g_list_next (l)) {
+        MMPortProbe *sibling = MM_PORT_PROBE (l->data);
+
+        if (sibling == self || !sibling->priv->is_at || sibling->priv->at_response_time < 0)
+            continue;
+        if (best < 0 || sibling->priv->at_response_time < best)
+            best = sibling->priv->at_response_time;
+    }
+
+    return best;
+}
+
+/* Whether a sibling port flagged as primary AT port already replied to AT
+ * probing */
+static gboolean
+sibling_is_at_primary (MMPortProbe *self)
+{
+    GList *l;
+
+    for (l = mm_device_peek_port_probe_list (self->priv->device); l; l = g_list_next (l)) {
+        MMPortProbe *sibling = MM_PORT_PROBE (l->data);
+
+        if (sibling != self && sibling->priv->is_at && sibling->priv->maybe_at_primary)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
 static void
 serial_probe_at_parse_response (MMPortSerialAt *port,
                                 GAsyncResult   *res,
@@ -996,6 +1068,8 @@ serial_probe_at_parse_response (MMPortSerialAt *port,
     }
 
     response = mm_port_serial_at_command_finish (port, res, &error);
+    if (response && self->priv->at_response_time < 0)
+        self->priv->at_response_time = (gdouble) (g_get_monotonic_time () - ctx->at_command_start) / G_USEC_PER_SEC;
 
     if (!ctx->at_commands->response_processor (ctx->at_commands->command,
                                                response,
@@ -1015,8 +1089,19 @@ serial_probe_at_parse_response (MMPortSerialAt *port,
             goto out;
         }
 
-        /* Go on to next command */
+        /* Go on to next command, unless the primary AT port was already
+         * found in a sibling port */
         ctx->at_commands++;
+        if (ctx->at_commands->command &&
+            at_probing_is_default (ctx) &&
+            sibling_is_at_primary (self)) {
+            mm_dbg ("(%s/%s) not retrying AT probing: primary AT port already found in sibling",
+                    mm_kernel_device_get_subsystem (self->priv->port),
+                    mm_kernel_device_get_name (self->priv->port));
+            ctx->at_result_processor (self, NULL);
+            serial_probe_schedule (self);
+            goto out;
+        }
         if (!ctx->at_commands->command) {
             /* Was it the last command in the group? If so,
              * end this partial probing */
@@ -1056,6 +1141,7 @@ static gboolean
 serial_probe_at (MMPortProbe *self)
 {
     PortProbeRunContext *ctx;
+    guint                timeout;
 
     g_assert (self->priv->task);
     ctx = g_task_get_task_data (self->priv->task);
@@ -1075,10 +1161,25 @@ serial_probe_at (MMPortProbe *self)
         return G_SOURCE_REMOVE;
     }
 
+    timeout = ctx->at_commands->timeout;
+    if (at_probing_is_default (ctx)) {
+        gdouble sibling_time;
+
+        sibling_time = sibling_at_response_time (self);
+        if (sibling_time >= 0) {
+            timeout = MIN (timeout, (guint) (sibling_time * AT_PROBING_SIBLING_LATENCY_FACTOR) + 1);
+            mm_dbg ("(%s/%s) sibling AT port replied in %.3lf seconds: using %u seconds timeout",
+                    mm_kernel_device_get_subsystem (self->priv->port),
+                    mm_kernel_device_get_name (self->priv->port),
+                    sibling_time, timeout);
+        }
+    }
+
+    ctx->at_command_start = g_get_monotonic_time ();
     mm_port_serial_at_command (
         MM_PORT_SERIAL_AT (ctx->serial),
         ctx->at_commands->command,
-        ctx->at_commands->timeout,
+        timeout,
         FALSE,
         FALSE,
         ctx->at_probing_cancellable,
@@ -1445,6 +1546,7 @@ mm_port_probe_run (MMPortProbe                *self,
     /* Shouldn't schedule more than one probing at a time */
     g_assert (self->priv->task == NULL);
     self->priv->task = g_task_new (self, cancellable, callback, user_data);
+    self->priv->probing_start = g_get_monotonic_time ();
 
     /* Task context */
     ctx = g_slice_new0 (PortProbeRunContext);
@@ -1859,6 +1961,30 @@ mm_port_probe_is_ignored (MMPortProbe *self)
     return self->priv->is_ignored;
 }
 
+MMPortProbeFlag
+mm_port_probe_get_probed_flags (MMPortProbe *self)
+{
+    g_return_val_if_fail (MM_IS_PORT_PROBE (self), MM_PORT_PROBE_NONE);
+
+    return self->priv->flags;
+}
+
+gdouble
+mm_port_probe_get_probing_time (MMPortProbe *self)
+{
+    g_return_val_if_fail (MM_IS_PORT_PROBE (self), 0.0);
+
+    return self->priv->probing_time;
+}
+
+gdouble
+mm_port_probe_get_at_response_time (MMPortProbe *self)
+{
+    g_return_val_if_fail (MM_IS_PORT_PROBE (self), -1.0);
+
+    return self->priv->at_response_time;
+}
+
 const gchar *
 mm_port_probe_get_port_name (MMPortProbe *self)
 {
@@ -1893,6 +2019,7 @@ mm_port_probe_init (MMPortProbe *self)
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
                                               MM_TYPE_PORT_PROBE,
                                               MMPortProbePrivate);
+    self->priv->at_response_time = -1.0;
 }
 
 static void
@@ -137,6 +137,14 @@ gboolean      mm_port_probe_is_icera         (MMPortProbe *self);
 gboolean      mm_port_probe_is_xmm           (MMPortProbe *self);
 gboolean      mm_port_probe_is_ignored       (MMPortProbe *self);
 
+/* Which of the results above are already available */
+MMPortProbeFlag mm_port_probe_get_probed_flags (MMPortProbe *self);
+
+/* Probing timing: overall time spent probing the port, and time the port
+ * took to reply the first AT command (negative if it never did) */
+gdouble mm_port_probe_get_probing_time     (MMPortProbe *self);
+gdouble mm_port_probe_get_at_response_time (MMPortProbe *self);
+
 /* Additional helpers */
 gboolean mm_port_probe_list_has_at_port   (GList *list);
 gboolean mm_port_probe_list_has_qmi_port  (GList *list);
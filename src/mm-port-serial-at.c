@@ -32,9 +32,18 @@ enum {
     PROP_INIT_SEQUENCE_ENABLED,
     PROP_INIT_SEQUENCE,
     PROP_SEND_LF,
+    PROP_PIPELINE_COMMANDS,
     LAST_PROP
 };
 
+/* Read-only queries which modems are known to handle fine when sent right
+ * after each other, without waiting for the previous reply */
+static const gchar *default_pipeline_commands[] = {
+    "+CGMI", "+CGMM", "+CGMR", "+CGSN",
+    "+GMI",  "+GMM",  "+GMR",  "+GSN",
+    NULL
+};
+
 struct _MMPortSerialAtPrivate {
     /* Response parser data */
     MMPortSerialAtResponseParserFn response_parser_fn;
@@ -42,6 +51,10 @@ struct _MMPortSerialAtPrivate {
     GDestroyNotify response_parser_notify;
 
     GSList *unsolicited_msg_handlers;
+    /* Line prefix -> list of handlers which may match lines with it */
+    GHashTable *unsolicited_msg_handlers_index;
+    guint unsolicited_msg_handlers_stamp;
+    GArray *unsolicited_msg_matches;
 
     MMPortSerialAtFlag flags;
 
@@ -50,6 +63,7 @@ struct _MMPortSerialAtPrivate {
     guint init_sequence_enabled;
     gchar **init_sequence;
     gboolean send_lf;
+    gchar **pipeline_commands;
 };
 
 /*****************************************************************************/
@@ -96,24 +110,82 @@ mm_port_serial_at_set_response_parser (MMPortSerialAt *self,
     self->priv->response_parser_notify = notify;
 }
 
-void
-mm_port_serial_at_remove_echo (GByteArray *response)
+static guint
+echo_len (const GByteArray *response)
 {
     guint i;
 
     if (response->len <= 2)
-        return;
+        return 0;
 
     for (i = 0; i < (response->len - 1); i++) {
         /* If there is any content before the first
          * <CR><LF>, assume it's echo or garbage, and skip it */
-        if (response->data[i] == '\r' && response->data[i + 1] == '\n') {
-            if (i > 0)
-                g_byte_array_remove_range (response, 0, i);
-            /* else, good, we're already started with <CR><LF> */
-            break;
-        }
+        if (response->data[i] == '\r' && response->data[i + 1] == '\n')
+            return i;
+    }
+    return 0;
+}
+
+void
+mm_port_serial_at_remove_echo (GByteArray *response)
+{
+    guint len;
+
+    len = echo_len (response);
+    if (len > 0)
+        g_byte_array_remove_range (response, 0, len);
+}
+
+static void
+remove_echo (MMPortSerialAt *self,
+             GByteArray     *response)
+{
+    mm_port_serial_response_release (MM_PORT_SERIAL (self), response, echo_len (response));
+}
+
+gboolean
+mm_port_serial_at_parse_pipelined_response (const GByteArray                *response,
+                                            gsize                            scanned,
+                                            MMPortSerialAtResponseParserFn   parser_fn,
+                                            gpointer                         parser_user_data,
+                                            gsize                           *used,
+                                            GString                        **parsed_response,
+                                            GError                         **error)
+{
+    GString *string;
+    gsize end = 0;
+
+    /* The response parser looks for the final result code at the end of the
+     * string, so when the buffer may hold the replies to several pipelined
+     * commands, try with each complete line as end of the first reply. The
+     * ones ending before @scanned were already tried. */
+    string = g_string_sized_new (response->len + 1);
+    while (end < response->len) {
+        const guint8 *lf;
+        GError *inner_error = NULL;
+
+        lf = memchr (&response->data[end], '\n', response->len - end);
+        end = (lf ? (gsize) (lf - response->data) + 1 : response->len);
+        if (end <= scanned)
+            continue;
+
+        g_string_truncate (string, 0);
+        g_string_append_len (string, (const gchar *) response->data, end);
+        if (!parser_fn (parser_user_data, string, 0, &inner_error))
+            continue;
+
+        *used = end;
+        if (inner_error) {
+            g_string_free (string, TRUE);
+            g_propagate_error (error, inner_error);
+        } else
+            *parsed_response = string;
+        return TRUE;
     }
+
+    g_string_free (string, TRUE);
+    return FALSE;
 }
 
 static MMPortSerialResponseType
@@ -125,36 +197,71 @@ parse_response (MMPortSerial *port,
     MMPortSerialAt *self = MM_PORT_SERIAL_AT (port);
     GString *string;
     gsize parsed_len;
+    gsize scanned;
+    gsize used = 0;
     GError *inner_error = NULL;
 
     g_return_val_if_fail (self->priv->response_parser_fn != NULL, FALSE);
 
     /* Remove echo */
     if (self->priv->remove_echo)
-        mm_port_serial_at_remove_echo (response);
+        remove_echo (self, response);
 
     /* If there's no response to receive, we're done; e.g. if we only got
      * unsolicited messages */
     if (!response->len)
         return MM_PORT_SERIAL_RESPONSE_NONE;
 
+    /* If more pipelined commands are waiting for a reply, only the first
+     * reply in the buffer is for the current one */
+    if (mm_port_serial_get_n_in_flight (port) > 1) {
+        string = NULL;
+        if (!mm_port_serial_at_parse_pipelined_response (response,
+                                                         mm_port_serial_get_response_scanned (port),
+                                                         self->priv->response_parser_fn,
+                                                         self->priv->response_parser_user_data,
+                                                         &used,
+                                                         &string,
+                                                         &inner_error))
+            return MM_PORT_SERIAL_RESPONSE_NONE;
+
+        mm_port_serial_response_release (port, response, used);
+
+        if (inner_error) {
+            g_propagate_error (error, inner_error);
+            return MM_PORT_SERIAL_RESPONSE_ERROR;
+        }
+
+        parsed_len = string->len;
+        *parsed_response = g_byte_array_new_take ((guint8 *) g_string_free (string, FALSE), parsed_len);
+        return MM_PORT_SERIAL_RESPONSE_BUFFER;
+    }
+
     /* Construct the string that AT-parsing functions expect */
     string = g_string_sized_new (response->len + 1);
     g_string_append_len (string, (const char *) response->data, response->len);
 
-    /* Fully cleanup the response array, we'll consider the contents we got
-     * as the full reply that the command may expect. */
-    g_byte_array_remove_range (response, 0, response->len);
-
     /* Parse it; returns FALSE if there is nothing we can do with this
-     * response yet. */
-    if (!self->priv->response_parser_fn (self->priv->response_parser_user_data, string, &inner_error)) {
-        /* Copy what we got back in the response buffer. */
-        g_byte_array_append (response, (const guint8 *) string->str, string->len);
+     * response yet. Only the bytes received since the last attempt need
+     * to be looked at. */
+    scanned = mm_port_serial_get_response_scanned (port);
+    if (!self->priv->response_parser_fn (self->priv->response_parser_user_data, string, scanned, &inner_error)) {
+        /* Copy what we got back in the response buffer, unless the parser
+         * left it untouched. */
+        if (string->len != response->len) {
+            if (string->len > response->len)
+                mm_port_serial_response_reserve (port, response, string->len - response->len);
+            memcpy (response->data, string->str, string->len);
+            response->len = string->len;
+        }
         g_string_free (string, TRUE);
         return MM_PORT_SERIAL_RESPONSE_NONE;
     }
 
+    /* Fully cleanup the response array, we'll consider the contents we got
+     * as the full reply that the command may expect. */
+    mm_port_serial_response_release (port, response, response->len);
+
     /* If we got an error, propagate it without any further response string */
     if (inner_error) {
         g_string_free (string, TRUE);
@@ -176,8 +283,157 @@ typedef struct {
     gboolean enable;
     gpointer user_data;
     GDestroyNotify notify;
+    /* Literal prefix of the lines this handler can match, NULL if unknown */
+    gchar *line_prefix;
+    guint candidate_stamp;
 } MMAtUnsolicitedMsgHandler;
 
+/* Longest URC line prefix that is indexed, e.g. "+CREG" or "^RSSILVL" */
+#define LINE_PREFIX_MAX_LEN 31
+
+/* A line prefix is an optional symbol followed by the alphanumeric name of
+ * the URC. Returns the length of the prefix found in @str, or 0 if none. */
+static gsize
+line_prefix_len (const gchar *str,
+                 gsize        len)
+{
+    gsize i = 0;
+    gsize name_start;
+
+    if (len > 0 && str[0] != '\0' && strchr ("+^*%$#!&@", str[0]))
+        i++;
+
+    name_start = i;
+    while (i < len && (g_ascii_isalnum (str[i]) || str[i] == '_'))
+        i++;
+
+    return (i > name_start ? i : 0);
+}
+
+/* Look for the literal line prefix that any string matched by the regex must
+ * have right after a line break, e.g. "^RSSI" in "\r\n\^RSSI:\s*(\d+)\r\n".
+ * Returns NULL if the pattern is not simple enough to know it for sure, in
+ * which case the handler is tried on every buffer. */
+static gchar *
+regex_get_line_prefix (GRegex *regex)
+{
+    GRegexCompileFlags  flags;
+    const gchar        *p;
+    gchar               literal[LINE_PREFIX_MAX_LEN + 2];
+    gsize               literal_len = 0;
+    gsize               prefix_len;
+    gboolean            line_start = FALSE;
+
+    flags = g_regex_get_compile_flags (regex);
+    if (flags & (G_REGEX_CASELESS | G_REGEX_EXTENDED))
+        return NULL;
+
+    /* Alternatives would make the literal optional */
+    p = g_regex_get_pattern (regex);
+    if (strchr (p, '|'))
+        return NULL;
+
+    if (*p == '^' && !(flags & G_REGEX_MULTILINE)) {
+        line_start = TRUE;
+        p++;
+    }
+
+    while (p[0] == '\\' && (p[1] == 'r' || p[1] == 'n')) {
+        if (p[2] != '\0' && strchr ("?*+{", p[2]))
+            return NULL;
+        line_start = TRUE;
+        p += 2;
+    }
+
+    if (!line_start)
+        return NULL;
+
+    /* Capturing groups don't change the literal */
+    while (p[0] == '(' && p[1] != '?')
+        p++;
+
+    while (*p != '\0' && literal_len < sizeof (literal)) {
+        const gchar *next;
+        gchar        c;
+
+        if (*p == '\\') {
+            if (p[1] == 'r')
+                c = '\r';
+            else if (p[1] == 'n')
+                c = '\n';
+            else if (p[1] == '\0' || g_ascii_isalnum (p[1]))
+                break;
+            else
+                c = p[1];
+            next = p + 2;
+        } else if (strchr ("()[]{}.?*+^$", *p))
+            break;
+        else {
+            c = *p;
+            next = p + 1;
+        }
+
+        /* Stop if the char is optional or repeated */
+        if (*next != '\0' && strchr ("?*+{", *next))
+            break;
+
+        literal[literal_len++] = c;
+        p = next;
+    }
+
+    /* The prefix must be fully delimited within the literal, or the regex
+     * could also match lines with a longer one */
+    prefix_len = line_prefix_len (literal, literal_len);
+    if (!prefix_len || prefix_len == literal_len || prefix_len > LINE_PREFIX_MAX_LEN)
+        return NULL;
+
+    return g_strndup (literal, prefix_len);
+}
+
+/* Mark the handlers that may match any of the lines in the response */
+static void
+unsolicited_msg_handlers_select (MMPortSerialAt *self,
+                                 GByteArray     *response)
+{
+    const gchar *data = (const gchar *) response->data;
+    gchar        prefix[LINE_PREFIX_MAX_LEN + 1];
+    gsize        i;
+
+    self->priv->unsolicited_msg_handlers_stamp++;
+
+    if (!self->priv->unsolicited_msg_handlers_index)
+        return;
+
+    for (i = 0; i < response->len; i++) {
+        GSList *l;
+        gsize   len;
+
+        if (i > 0 && data[i - 1] != '\r' && data[i - 1] != '\n')
+            continue;
+
+        len = line_prefix_len (&data[i], response->len - i);
+        if (!len || len > LINE_PREFIX_MAX_LEN)
+            continue;
+
+        memcpy (prefix, &data[i], len);
+        prefix[len] = '\0';
+        for (l = g_hash_table_lookup (self->priv->unsolicited_msg_handlers_index, prefix); l; l = g_slist_next (l))
+            ((MMAtUnsolicitedMsgHandler *) l->data)->candidate_stamp = self->priv->unsolicited_msg_handlers_stamp;
+        i += len - 1;
+    }
+}
+
+static void
+unsolicited_msg_handler_free (MMAtUnsolicitedMsgHandler *handler)
+{
+    if (handler->notify)
+        handler->notify (handler->user_data);
+
+    g_regex_unref (handler->regex);
+    g_free (handler->line_prefix);
+    g_slice_free (MMAtUnsolicitedMsgHandler, handler);
+}
+
 static gint
 unsolicited_msg_handler_cmp (MMAtUnsolicitedMsgHandler *handler,
                              GRegex *regex)
@@ -211,9 +467,26 @@ mm_port_serial_at_add_unsolicited_msg_handler (MMPortSerialAt *self,
         /* The new handler is always PREPENDED, so that e.g. plugins can provide
          * more specific matches for URCs that are also handled by the generic
          * plugin. */
-        handler = g_slice_new (MMAtUnsolicitedMsgHandler);
+        handler = g_slice_new0 (MMAtUnsolicitedMsgHandler);
         handler->regex = g_regex_ref (regex);
         self->priv->unsolicited_msg_handlers = g_slist_prepend (self->priv->unsolicited_msg_handlers, handler);
+
+        /* Index the handler by line prefix, if known */
+        handler->line_prefix = regex_get_line_prefix (regex);
+        if (handler->line_prefix) {
+            GSList *l;
+
+            if (!self->priv->unsolicited_msg_handlers_index)
+                self->priv->unsolicited_msg_handlers_index = g_hash_table_new_full (g_str_hash,
+                                                                                    g_str_equal,
+                                                                                    NULL,
+                                                                                    (GDestroyNotify) g_slist_free);
+            l = g_hash_table_lookup (self->priv->unsolicited_msg_handlers_index, handler->line_prefix);
+            g_hash_table_steal (self->priv->unsolicited_msg_handlers_index, handler->line_prefix);
+            g_hash_table_insert (self->priv->unsolicited_msg_handlers_index,
+                                 handler->line_prefix,
+                                 g_slist_prepend (l, handler));
+        }
     }
 
     handler->callback = callback;
@@ -242,19 +515,27 @@ mm_port_serial_at_enable_unsolicited_msg_handler (MMPortSerialAt *self,
     }
 }
 
-static gboolean
-remove_eval_cb (const GMatchInfo *match_info,
-                GString *result,
-                gpointer user_data)
+/* Remove in place the [start,end) ranges found in @matches */
+static void
+remove_matches (GByteArray *response,
+                GArray     *matches)
 {
-    int *result_len = (int *) user_data;
-    int start;
-    int end;
-
-    if (g_match_info_fetch_pos  (match_info, 0, &start, &end))
-        *result_len -= (end - start);
-
-    return FALSE;
+    guint  i;
+    gsize  out;
+
+    out = g_array_index (matches, gint, 0);
+    for (i = 0; i < matches->len; i += 2) {
+        gsize end;
+        gsize next;
+
+        end = g_array_index (matches, gint, i + 1);
+        next = (i + 2 < matches->len) ? (gsize) g_array_index (matches, gint, i + 2) : response->len;
+        if (next > end) {
+            memmove (&response->data[out], &response->data[end], next - end);
+            out += next - end;
+        }
+    }
+    response->len = out;
 }
 
 static void
@@ -265,43 +546,50 @@ parse_unsolicited (MMPortSerial *port, GByteArray *response)
 
     /* Remove echo */
     if (self->priv->remove_echo)
-        mm_port_serial_at_remove_echo (response);
+        remove_echo (self, response);
+
+    /* Only handlers for the line prefixes found, plus the ones without a
+     * known prefix, need to run their regex */
+    unsolicited_msg_handlers_select (self, response);
 
     for (iter = self->priv->unsolicited_msg_handlers; iter; iter = iter->next) {
         MMAtUnsolicitedMsgHandler *handler = (MMAtUnsolicitedMsgHandler *) iter->data;
         GMatchInfo *match_info;
-        gboolean matches;
 
         if (!handler->enable)
             continue;
 
-        matches = g_regex_match_full (handler->regex,
-                                      (const char *) response->data,
-                                      response->len,
-                                      0, 0, &match_info, NULL);
-        if (handler->callback) {
-            while (g_match_info_matches (match_info)) {
+        if (handler->line_prefix && handler->candidate_stamp != self->priv->unsolicited_msg_handlers_stamp)
+            continue;
+
+        if (!g_regex_match_full (handler->regex,
+                                 (const char *) response->data,
+                                 response->len,
+                                 0, 0, &match_info, NULL)) {
+            g_match_info_free (match_info);
+            continue;
+        }
+
+        g_array_set_size (self->priv->unsolicited_msg_matches, 0);
+        while (g_match_info_matches (match_info)) {
+            gint pos[2];
+
+            if (g_match_info_fetch_pos (match_info, 0, &pos[0], &pos[1]))
+                g_array_append_vals (self->priv->unsolicited_msg_matches, pos, 2);
+            if (handler->callback)
                 handler->callback (self, match_info, handler->user_data);
-                g_match_info_next (match_info, NULL);
-            }
+            g_match_info_next (match_info, NULL);
         }
 
         g_match_info_free (match_info);
 
-        if (matches) {
-            /* Remove matches */
-            char *str;
-            int result_len = response->len;
+        if (self->priv->unsolicited_msg_matches->len) {
+            /* Matches are removed, so the buffer changes from the first one */
+            mm_port_serial_rewind_response_scanned (port, g_array_index (self->priv->unsolicited_msg_matches, gint, 0));
+            remove_matches (response, self->priv->unsolicited_msg_matches);
 
-            str = g_regex_replace_eval (handler->regex,
-                                        (const char *) response->data,
-                                        response->len,
-                                        0, 0,
-                                        remove_eval_cb, &result_len, NULL);
-
-            g_byte_array_remove_range (response, 0, response->len);
-            g_byte_array_append (response, (const guint8 *) str, result_len);
-            g_free (str);
+            /* Removing the matches may have joined lines */
+            unsolicited_msg_handlers_select (self, response);
         }
     }
 }
@@ -394,15 +682,43 @@ serial_command_ready (MMPortSerial *port,
     g_object_unref (simple);
 }
 
+/* Setting a value (e.g. AT+CFUN=1) makes the cached reply of its query
+ * (e.g. AT+CFUN?) no longer valid. Note that only the cache of this same port
+ * is invalidated; a value set through another port of the modem leaves the
+ * cached reply of this one stale until it expires. */
+static void
+invalidate_cached_query (MMPortSerialAt *self,
+                         const gchar *command)
+{
+    const gchar *p;
+    gchar *query;
+    GByteArray *buf;
+
+    p = strpbrk (command, "=;");
+    if (!p || *p != '=' || p[1] == '?' || p == command)
+        return;
+
+    query = g_strdup_printf ("%.*s?", (gint) (p - command), command);
+    buf = at_command_to_byte_array (query,
+                                    FALSE,
+                                    (mm_port_get_subsys (MM_PORT (self)) == MM_PORT_SUBSYS_TTY ?
+                                     self->priv->send_lf :
+                                     TRUE));
+    mm_port_serial_set_cached_reply (MM_PORT_SERIAL (self), buf, NULL, 0);
+    g_byte_array_unref (buf);
+    g_free (query);
+}
+
 void
-mm_port_serial_at_command (MMPortSerialAt *self,
-                           const char *command,
-                           guint32 timeout_seconds,
-                           gboolean is_raw,
-                           gboolean allow_cached,
-                           GCancellable *cancellable,
-                           GAsyncReadyCallback callback,
-                           gpointer user_data)
+mm_port_serial_at_command_full (MMPortSerialAt *self,
+                                const char *command,
+                                guint32 timeout_seconds,
+                                gboolean is_raw,
+                                gboolean allow_cached,
+                                guint cache_ttl,
+                                GCancellable *cancellable,
+                                GAsyncReadyCallback callback,
+                                gpointer user_data)
 {
     GSimpleAsyncResult *simple;
     GByteArray *buf;
@@ -418,6 +734,9 @@ mm_port_serial_at_command (MMPortSerialAt *self,
                                      TRUE));
     g_return_if_fail (buf != NULL);
 
+    if (!is_raw)
+        invalidate_cached_query (self, command);
+
     simple = g_simple_async_result_new (G_OBJECT (self),
                                         callback,
                                         user_data,
@@ -427,6 +746,7 @@ mm_port_serial_at_command (MMPortSerialAt *self,
                             buf,
                             timeout_seconds,
                             allow_cached,
+                            cache_ttl,
                             is_raw, /* raw commands always run next, never queued last */
                             cancellable,
                             (GAsyncReadyCallback)serial_command_ready,
@@ -434,6 +754,83 @@ mm_port_serial_at_command (MMPortSerialAt *self,
     g_byte_array_unref (buf);
 }
 
+void
+mm_port_serial_at_command (MMPortSerialAt *self,
+                           const char *command,
+                           guint32 timeout_seconds,
+                           gboolean is_raw,
+                           gboolean allow_cached,
+                           GCancellable *cancellable,
+                           GAsyncReadyCallback callback,
+                           gpointer user_data)
+{
+    mm_port_serial_at_command_full (self,
+                                    command,
+                                    timeout_seconds,
+                                    is_raw,
+                                    allow_cached,
+                                    0,
+                                    cancellable,
+                                    callback,
+                                    user_data);
+}
+
+static gboolean
+command_can_pipeline (MMPortSerial     *port,
+                      const GByteArray *command)
+{
+    MMPortSerialAt *self = MM_PORT_SERIAL_AT (port);
+    const gchar *str = (const gchar *) command->data;
+    gsize len = command->len;
+    guint i;
+
+    if (!self->priv->pipeline_commands)
+        return FALSE;
+
+    /* Raw commands are never pipelined */
+    if (len < 2 || g_ascii_strncasecmp (str, "AT", 2) != 0)
+        return FALSE;
+    str += 2;
+    len -= 2;
+
+    while (len > 0 && (str[len - 1] == '\r' || str[len - 1] == '\n'))
+        len--;
+
+    for (i = 0; self->priv->pipeline_commands[i]; i++) {
+        if (strlen (self->priv->pipeline_commands[i]) == len &&
+            !g_ascii_strncasecmp (str, self->priv->pipeline_commands[i], len))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+void
+mm_port_serial_at_set_cached_reply (MMPortSerialAt *self,
+                                    const gchar *command,
+                                    const gchar *reply)
+{
+    GByteArray *buf;
+    GByteArray *response;
+
+    g_return_if_fail (MM_IS_PORT_SERIAL_AT (self));
+    g_return_if_fail (command != NULL);
+    g_return_if_fail (reply != NULL);
+
+    /* Same command bytes as mm_port_serial_at_command() would send */
+    buf = at_command_to_byte_array (command,
+                                    FALSE,
+                                    (mm_port_get_subsys (MM_PORT (self)) == MM_PORT_SUBSYS_TTY ?
+                                     self->priv->send_lf :
+                                     TRUE));
+    response = g_byte_array_sized_new (strlen (reply));
+    g_byte_array_append (response, (const guint8 *) reply, strlen (reply));
+
+    mm_port_serial_set_cached_reply (MM_PORT_SERIAL (self), buf, response, 0);
+
+    g_byte_array_unref (response);
+    g_byte_array_unref (buf);
+}
+
 static void
 debug_log (MMPortSerial *port, const char *prefix, const char *buf, gsize len)
 {
@@ -550,6 +947,11 @@ mm_port_serial_at_init (MMPortSerialAt *self)
 
     /* By default, don't send line feed */
     self->priv->send_lf = FALSE;
+
+    /* Only used if the pipeline depth of the port is set */
+    self->priv->pipeline_commands = g_strdupv ((gchar **) default_pipeline_commands);
+
+    self->priv->unsolicited_msg_matches = g_array_new (FALSE, FALSE, sizeof (gint));
 }
 
 static void
@@ -574,6 +976,10 @@ set_property (GObject *object,
     case PROP_SEND_LF:
         self->priv->send_lf = g_value_get_boolean (value);
         break;
+    case PROP_PIPELINE_COMMANDS:
+        g_strfreev (self->priv->pipeline_commands);
+        self->priv->pipeline_commands = g_value_dup_boxed (value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -601,6 +1007,9 @@ get_property (GObject *object,
     case PROP_SEND_LF:
         g_value_set_boolean (value, self->priv->send_lf);
         break;
+    case PROP_PIPELINE_COMMANDS:
+        g_value_set_boxed (value, self->priv->pipeline_commands);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -612,22 +1021,17 @@ finalize (GObject *object)
 {
     MMPortSerialAt *self = MM_PORT_SERIAL_AT (object);
 
-    while (self->priv->unsolicited_msg_handlers) {
-        MMAtUnsolicitedMsgHandler *handler = (MMAtUnsolicitedMsgHandler *) self->priv->unsolicited_msg_handlers->data;
-
-        if (handler->notify)
-            handler->notify (handler->user_data);
-
-        g_regex_unref (handler->regex);
-        g_slice_free (MMAtUnsolicitedMsgHandler, handler);
-        self->priv->unsolicited_msg_handlers = g_slist_delete_link (self->priv->unsolicited_msg_handlers,
-                                                                    self->priv->unsolicited_msg_handlers);
-    }
+    /* The index keys are owned by the handlers */
+    if (self->priv->unsolicited_msg_handlers_index)
+        g_hash_table_unref (self->priv->unsolicited_msg_handlers_index);
+    g_slist_free_full (self->priv->unsolicited_msg_handlers, (GDestroyNotify) unsolicited_msg_handler_free);
+    g_array_unref (self->priv->unsolicited_msg_matches);
 
     if (self->priv->response_parser_notify)
         self->priv->response_parser_notify (self->priv->response_parser_user_data);
 
     g_strfreev (self->priv->init_sequence);
+    g_strfreev (self->priv->pipeline_commands);
 
     G_OBJECT_CLASS (mm_port_serial_at_parent_class)->finalize (object);
 }
@@ -649,6 +1053,7 @@ mm_port_serial_at_class_init (MMPortSerialAtClass *klass)
     serial_class->parse_response = parse_response;
     serial_class->debug_log = debug_log;
     serial_class->config = config;
+    serial_class->command_can_pipeline = command_can_pipeline;
 
     g_object_class_install_property
         (object_class, PROP_REMOVE_ECHO,
@@ -681,4 +1086,12 @@ mm_port_serial_at_class_init (MMPortSerialAtClass *klass)
                                "Send line-feed at the end of each AT command sent",
                                FALSE,
                                G_PARAM_READWRITE));
+
+    g_object_class_install_property
+        (object_class, PROP_PIPELINE_COMMANDS,
+         g_param_spec_boxed (MM_PORT_SERIAL_AT_PIPELINE_COMMANDS,
+                             "Pipeline commands",
+                             "Commands which may be pipelined, without the AT prefix",
+                             G_TYPE_STRV,
+                             G_PARAM_READWRITE));
 }
@@ -53,8 +53,11 @@ typedef enum { /*< underscore_name=mm_port_serial_at_flag >*/
     MM_PORT_SERIAL_AT_FLAG_GPS_CONTROL = 1 << 3,
 } MMPortSerialAtFlag;
 
+/* @scanned is the number of leading bytes of @response already given to
+ * the parser in a previous call which returned FALSE. */
 typedef gboolean (*MMPortSerialAtResponseParserFn) (gpointer user_data,
                                                     GString *response,
+                                                    gsize scanned,
                                                     GError **error);
 
 typedef void (*MMPortSerialAtUnsolicitedMsgFn) (MMPortSerialAt *port,
@@ -65,6 +68,7 @@ typedef void (*MMPortSerialAtUnsolicitedMsgFn) (MMPortSerialAt *port,
 #define MM_PORT_SERIAL_AT_INIT_SEQUENCE_ENABLED "init-sequence-enabled"
 #define MM_PORT_SERIAL_AT_INIT_SEQUENCE         "init-sequence"
 #define MM_PORT_SERIAL_AT_SEND_LF               "send-lf"
+#define MM_PORT_SERIAL_AT_PIPELINE_COMMANDS     "pipeline-commands"
 
 struct _MMPortSerialAt {
     MMPortSerial parent;
@@ -107,6 +111,26 @@ const gchar *mm_port_serial_at_command_finish (MMPortSerialAt *self,
                                                GAsyncResult *res,
                                                GError **error);
 
+/* Like mm_port_serial_at_command(), but a reply cached because of
+ * @allow_cached is only valid for @cache_ttl seconds; 0 to keep it until the
+ * command is sent again without allowing cached replies. Finish with
+ * mm_port_serial_at_command_finish(). */
+void         mm_port_serial_at_command_full   (MMPortSerialAt *self,
+                                               const char *command,
+                                               guint32 timeout_seconds,
+                                               gboolean is_raw,
+                                               gboolean allow_cached,
+                                               guint cache_ttl,
+                                               GCancellable *cancellable,
+                                               GAsyncReadyCallback callback,
+                                               gpointer user_data);
+
+/* Store the reply to give to @command when run allowing cached replies, e.g.
+ * when it was already received as part of a compound command line */
+void         mm_port_serial_at_set_cached_reply (MMPortSerialAt *self,
+                                                 const gchar *command,
+                                                 const gchar *reply);
+
 /*
  * Convert a string into a quoted and escaped string. Returns a new
  * allocated string. Follows ITU V.250 5.4.2.2 "String constants".
@@ -116,6 +140,18 @@ gchar   *mm_port_serial_at_quote_string (const char *string);
 /* Just for unit tests */
 void     mm_port_serial_at_remove_echo (GByteArray *response);
 
+/* Looks for the first reply in a response buffer with the replies to several
+ * pipelined commands, giving in @used its length, to be removed from the
+ * buffer. Used by the response parsing of AT ports, and exported for the
+ * unit tests. */
+gboolean mm_port_serial_at_parse_pipelined_response (const GByteArray                *response,
+                                                     gsize                            scanned,
+                                                     MMPortSerialAtResponseParserFn   parser_fn,
+                                                     gpointer                         parser_user_data,
+                                                     gsize                           *used,
+                                                     GString                        **parsed_response,
+                                                     GError                         **error);
+
 void     mm_port_serial_at_set_flags (MMPortSerialAt *self,
                                       MMPortSerialAtFlag flags);
 
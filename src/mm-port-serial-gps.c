@@ -29,8 +29,8 @@ struct _MMPortSerialGpsPrivate {
     gpointer user_data;
     GDestroyNotify notify;
 
-    /* Regex for all known traces */
-    GRegex *known_traces_regex;
+    /* Sentences dropped because of a wrong checksum */
+    guint n_checksum_errors;
 };
 
 /*****************************************************************************/
@@ -51,21 +51,56 @@ mm_port_serial_gps_add_trace_handler (MMPortSerialGps *self,
     self->priv->notify = notify;
 }
 
+guint
+mm_port_serial_gps_get_n_checksum_errors (MMPortSerialGps *self)
+{
+    g_return_val_if_fail (MM_IS_PORT_SERIAL_GPS (self), 0);
+
+    return self->priv->n_checksum_errors;
+}
+
 /*****************************************************************************/
+/* NMEA framing
+ *
+ * Traces are the complete lines starting with '$' and ending with <CR><LF>.
+ * They're validated against their '*hh' checksum, if any, and given to the
+ * trace handler in place, right from the response buffer. */
 
+static gint
+hex_digit_value (guint8 c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/* The sentence runs from the '$' up to, and not including, the <CR> */
 static gboolean
-remove_eval_cb (const GMatchInfo *match_info,
-                GString *result,
-                gpointer user_data)
+nmea_checksum_valid (const guint8 *sentence,
+                     guint         len)
 {
-    int *result_len = (int *) user_data;
-    int start;
-    int end;
+    guint8 checksum = 0;
+    guint i;
+    gint high;
+    gint low;
+
+    for (i = 1; i < len && sentence[i] != '*'; i++)
+        checksum ^= sentence[i];
+
+    /* The checksum is optional */
+    if (i == len)
+        return TRUE;
 
-    if (g_match_info_fetch_pos  (match_info, 0, &start, &end))
-        *result_len -= (end - start);
+    if (len - i != 3)
+        return FALSE;
 
-    return FALSE;
+    high = hex_digit_value (sentence[i + 1]);
+    low = hex_digit_value (sentence[i + 2]);
+    return (high >= 0 && low >= 0 && checksum == ((high << 4) | low));
 }
 
 static MMPortSerialResponseType
@@ -75,10 +110,10 @@ parse_response (MMPortSerial *port,
                 GError **error)
 {
     MMPortSerialGps *self = MM_PORT_SERIAL_GPS (port);
-    gboolean matches;
-    GMatchInfo *match_info;
-    gchar *str;
-    gint result_len;
+    GByteArray *other = NULL;
+    gboolean found = FALSE;
+    guint8 *data;
+    guint pos;
     guint i;
 
     for (i = 0; i < response->len; i++) {
@@ -86,50 +121,65 @@ parse_response (MMPortSerial *port,
          * assume it's garbage, and skip it */
         if (response->data[i] == '$') {
             if (i > 0)
-                g_byte_array_remove_range (response, 0, i);
+                mm_port_serial_response_release (port, response, i);
             /* else, good, we're already started with $ */
             break;
         }
     }
 
-    matches = g_regex_match_full (self->priv->known_traces_regex,
-                                  (const gchar *) response->data,
-                                  response->len,
-                                  0, 0, &match_info, NULL);
-
-    if (self->priv->callback) {
-        while (g_match_info_matches (match_info)) {
-            gchar *trace;
-
-            trace = g_match_info_fetch (match_info, 0);
-            if (trace) {
-                self->priv->callback (self, trace, self->priv->user_data);
-                g_free (trace);
-            }
-            g_match_info_next (match_info, NULL);
-        }
-    }
+    /* Make sure there's room for a NUL byte after the last line, so that
+     * every trace can be given as a string without copying it */
+    mm_port_serial_response_reserve (port, response, 1);
+    data = response->data;
 
-    g_match_info_free (match_info);
+    for (pos = 0; pos < response->len; ) {
+        const guint8 *newline;
+        const guint8 *dollar;
+        guint end;
 
-    if (!matches)
-        return MM_PORT_SERIAL_RESPONSE_NONE;
+        newline = memchr (&data[pos], '\n', response->len - pos);
+        if (!newline)
+            break;
+        end = newline - data + 1;
+
+        /* Lines without a trace are given as response */
+        dollar = memchr (&data[pos], '$', end - pos);
+        if (!dollar || end - (dollar - data) < 3 || data[end - 2] != '\r') {
+            if (!other)
+                other = g_byte_array_new ();
+            g_byte_array_append (other, &data[pos], end - pos);
+            pos = end;
+            continue;
+        }
 
-    /* Remove matches */
-    result_len = response->len;
-    str = g_regex_replace_eval (self->priv->known_traces_regex,
-                                (const char *) response->data,
-                                response->len,
-                                0, 0,
-                                remove_eval_cb, &result_len, NULL);
+        found = TRUE;
+        if (!nmea_checksum_valid (dollar, &data[end - 2] - dollar)) {
+            self->priv->n_checksum_errors++;
+            mm_dbg ("(%s) dropped NMEA trace with invalid checksum (%u so far)",
+                    mm_port_get_device (MM_PORT (self)),
+                    self->priv->n_checksum_errors);
+        } else if (self->priv->callback) {
+            guint8 saved;
+
+            saved = data[end];
+            data[end] = '\0';
+            self->priv->callback (self, (const gchar *) dollar, self->priv->user_data);
+            data[end] = saved;
+        }
+        pos = end;
+    }
 
-    /* Cleanup response buffer */
-    g_byte_array_remove_range (response, 0, response->len);
+    if (!found) {
+        if (other)
+            g_byte_array_unref (other);
+        return MM_PORT_SERIAL_RESPONSE_NONE;
+    }
 
-    /* Build parsed response */
-    *parsed_response = g_byte_array_new_take ((guint8 *)str, result_len);
+    /* Only the last incomplete line is left in the response buffer */
+    mm_port_serial_response_release (port, response, pos);
 
-    return TRUE;
+    *parsed_response = (other ? other : g_byte_array_new ());
+    return MM_PORT_SERIAL_RESPONSE_BUFFER;
 }
 
 /*****************************************************************************/
@@ -183,13 +233,6 @@ mm_port_serial_gps_init (MMPortSerialGps *self)
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
                                               MM_TYPE_PORT_SERIAL_GPS,
                                               MMPortSerialGpsPrivate);
-
-    /* We'll assume that all traces start with the dollar sign and end with \r\n */
-    self->priv->known_traces_regex =
-        g_regex_new ("\\$.*\\r\\n",
-                     G_REGEX_RAW | G_REGEX_OPTIMIZE,
-                     0,
-                     NULL);
 }
 
 static void
@@ -200,8 +243,6 @@ finalize (GObject *object)
     if (self->priv->notify)
         self->priv->notify (self->priv->user_data);
 
-    g_regex_unref (self->priv->known_traces_regex);
-
     G_OBJECT_CLASS (mm_port_serial_gps_parent_class)->finalize (object);
 }
 
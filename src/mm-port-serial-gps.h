@@ -54,4 +54,7 @@ void mm_port_serial_gps_add_trace_handler (MMPortSerialGps *self,
                                            gpointer user_data,
                                            GDestroyNotify notify);
 
+/* Number of NMEA traces dropped because their checksum was wrong */
+guint mm_port_serial_gps_get_n_checksum_errors (MMPortSerialGps *self);
+
 #endif /* MM_PORT_SERIAL_GPS_H */
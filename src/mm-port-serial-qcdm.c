@@ -65,7 +65,8 @@ find_qcdm_start (GByteArray *response, gsize *start)
 }
 
 static MMPortSerialResponseType
-parse_qcdm (GByteArray *response,
+parse_qcdm (MMPortSerial *port,
+            GByteArray *response,
             gboolean want_log,
             GByteArray **parsed_response,
             GError **error)
@@ -85,7 +86,7 @@ parse_qcdm (GByteArray *response,
     }
 
     /* If there is anything before the start marker, remove it */
-    g_byte_array_remove_range (response, 0, start);
+    mm_port_serial_response_release (port, response, start);
     if (response->len == 0)
         return MM_PORT_SERIAL_RESPONSE_NONE;
 
@@ -133,7 +134,7 @@ parse_qcdm (GByteArray *response,
     /* Remove the data we used from the input buffer, leaving out any
      * additional data that may already been received (e.g. from the following
      * message). */
-    g_byte_array_remove_range (response, 0, used);
+    mm_port_serial_response_release (port, response, used);
     return MM_PORT_SERIAL_RESPONSE_BUFFER;
 }
 
@@ -143,7 +144,7 @@ parse_response (MMPortSerial *port,
                 GByteArray **parsed_response,
                 GError **error)
 {
-    return parse_qcdm (response, FALSE, parsed_response, error);
+    return parse_qcdm (port, response, FALSE, parsed_response, error);
 }
 
 /*****************************************************************************/
@@ -193,6 +194,7 @@ mm_port_serial_qcdm_command (MMPortSerialQcdm *self,
                             command,
                             timeout_seconds,
                             FALSE, /* never cached */
+                            0,
                             FALSE, /* always queued last */
                             cancellable,
                             (GAsyncReadyCallback)serial_command_ready,
@@ -294,7 +296,8 @@ parse_unsolicited (MMPortSerial *port, GByteArray *response)
     GByteArray *log_buffer = NULL;
     GSList *iter;
 
-    if (parse_qcdm (response,
+    if (parse_qcdm (port,
+                    response,
                     TRUE,
                     &log_buffer,
                     NULL) != MM_PORT_SERIAL_RESPONSE_BUFFER) {
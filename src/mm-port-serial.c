@@ -25,15 +25,18 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/ioctl.h>
+#include <sys/timerfd.h>
 #include <string.h>
 #include <linux/serial.h>
 
+#include <glib-unix.h>
 #include <gio/gunixsocketaddress.h>
 
 #include <ModemManager.h>
 #include <mm-errors-types.h>
 
 #include "mm-port-serial.h"
+#include "mm-port-capture.h"
 #include "mm-log.h"
 #include "mm-helper-enums-types.h"
 
@@ -44,7 +47,8 @@ static void     port_serial_close_force            (MMPortSerial *self);
 static void     port_serial_reopen_cancel          (MMPortSerial *self);
 static void     port_serial_set_cached_reply       (MMPortSerial *self,
                                                     const GByteArray *command,
-                                                    const GByteArray *response);
+                                                    const GByteArray *response,
+                                                    guint ttl_seconds);
 
 G_DEFINE_TYPE (MMPortSerial, mm_port_serial, MM_TYPE_PORT)
 
@@ -59,6 +63,7 @@ enum {
     PROP_FD,
     PROP_SPEW_CONTROL,
     PROP_FLASH_OK,
+    PROP_PIPELINE_DEPTH,
 
     LAST_PROP
 };
@@ -79,13 +84,33 @@ struct _MMPortSerialPrivate {
     guint32 open_count;
     gboolean forced_close;
     int fd;
+    /* Cached replies, by command, and sorted from most to least recently
+     * used */
     GHashTable *reply_cache;
+    GQueue reply_cache_lru;
     GQueue *queue;
+    /* Received data not consumed yet, given to the response parsers as a
+     * window on the response buffer. Consuming data just moves the start of
+     * the window, and the released bytes are only reclaimed when room is
+     * needed at the tail of the buffer. */
     GByteArray *response;
-
-    /* For real ports, iochannel, and we implement the eagain limit */
-    GIOChannel *iochannel;
-    guint iochannel_id;
+    GByteArray response_window;
+    /* Leading bytes of the response window already given to the response
+     * parser without any result; the parser only needs to look at the new
+     * ones (plus whatever context it needs) */
+    guint response_scanned;
+    guint64 n_bytes_read;
+    guint64 n_bytes_scanned;
+
+    /* For real ports, raw I/O on the fd, and we implement the eagain limit */
+    gboolean fd_io;
+    GSource *fd_source;
+
+    /* For TTYs with a send delay, a timerfd paces the writes */
+    gint pacing_fd;
+    GSource *pacing_source;
+    gboolean pacing;
+    guint64 pacing_credit;
 
     /* For unix-socket based ports, socket */
     GSocket *socket;
@@ -100,6 +125,13 @@ struct _MMPortSerialPrivate {
     guint64 send_delay;
     gboolean spew_control;
     gboolean flash_ok;
+    guint pipeline_depth;
+
+    /* Set if a pipelined command ever timed out; from then on, commands are
+     * sent one by one */
+    gboolean pipeline_disabled;
+    /* Commands at the head of the queue already sent and waiting for reply */
+    guint n_in_flight;
 
     guint queue_id;
     guint timeout_id;
@@ -125,28 +157,66 @@ typedef struct {
     GByteArray *command;
     guint32 timeout;
     gboolean allow_cached;
+    guint cache_ttl;
     guint32 eagain_count;
 
     guint32 idx;
     gboolean started;
     gboolean done;
+    /* When the command was first written, to account the reply latency */
+    gint64 start_time;
+
+    /* The command may be sent right after the previous one, without waiting
+     * for its reply */
+    gboolean pipelined;
+    /* The command was sent in a pipelined batch */
+    gboolean batched;
+    /* The command was cancelled while in flight; already completed, but its
+     * reply still needs to be discarded */
+    gboolean abandoned;
+    /* When leading a batch, the commands of the batch and how many of the
+     * following ones in the queue it includes */
+    GByteArray *batch;
+    guint n_batched;
 } CommandContext;
 
 static void
-command_context_complete_and_free (CommandContext *ctx, gboolean idle)
+command_context_free (CommandContext *ctx)
 {
-    if (idle)
-        g_simple_async_result_complete_in_idle (ctx->result);
-    else
-        g_simple_async_result_complete (ctx->result);
     g_object_unref (ctx->result);
     g_byte_array_unref (ctx->command);
+    if (ctx->batch)
+        g_byte_array_unref (ctx->batch);
     if (ctx->cancellable)
         g_object_unref (ctx->cancellable);
     g_object_unref (ctx->self);
     g_slice_free (CommandContext, ctx);
 }
 
+static void
+command_context_complete_and_free (CommandContext *ctx, gboolean idle)
+{
+    if (idle)
+        g_simple_async_result_complete_in_idle (ctx->result);
+    else
+        g_simple_async_result_complete (ctx->result);
+    command_context_free (ctx);
+}
+
+/* Number of commands at the head of the queue which were already (or are
+ * being) written to the port */
+static guint
+port_serial_queue_n_sent (MMPortSerial *self)
+{
+    CommandContext *ctx;
+
+    if (self->priv->n_in_flight)
+        return self->priv->n_in_flight;
+
+    ctx = (CommandContext *) g_queue_peek_head (self->priv->queue);
+    return ((ctx && ctx->started) ? 1 + ctx->n_batched : 0);
+}
+
 GByteArray *
 mm_port_serial_command_finish (MMPortSerial *self,
                                GAsyncResult *res,
@@ -163,6 +233,7 @@ mm_port_serial_command (MMPortSerial *self,
                         GByteArray *command,
                         guint32 timeout_seconds,
                         gboolean allow_cached,
+                        guint cache_ttl,
                         gboolean run_next,
                         GCancellable *cancellable,
                         GAsyncReadyCallback callback,
@@ -182,6 +253,7 @@ mm_port_serial_command (MMPortSerial *self,
                                              mm_port_serial_command);
     ctx->command = g_byte_array_ref (command);
     ctx->allow_cached = allow_cached;
+    ctx->cache_ttl = cache_ttl;
     ctx->timeout = timeout_seconds;
     ctx->cancellable = (cancellable ? g_object_ref (cancellable) : NULL);
 
@@ -202,12 +274,16 @@ mm_port_serial_command (MMPortSerial *self,
 
     /* Clear the cached value for this command if not asking for cached value */
     if (!allow_cached)
-        port_serial_set_cached_reply (self, ctx->command, NULL);
+        port_serial_set_cached_reply (self, ctx->command, NULL, 0);
+
+    ctx->pipelined = (self->priv->pipeline_depth > 1 &&
+                      MM_PORT_SERIAL_GET_CLASS (self)->command_can_pipeline &&
+                      MM_PORT_SERIAL_GET_CLASS (self)->command_can_pipeline (self, command));
 
-    /* If requested to run next, push to the head of the queue so that it really is
-     * the next one sent */
+    /* If requested to run next, push it right after the commands already being
+     * sent or waiting for a reply, so that it really is the next one sent */
     if (run_next)
-        g_queue_push_head (self->priv->queue, ctx);
+        g_queue_push_nth (self->priv->queue, ctx, port_serial_queue_n_sent (self));
     else
         g_queue_push_tail (self->priv->queue, ctx);
 
@@ -548,16 +624,53 @@ serial_debug (MMPortSerial *self, const char *prefix, const char *buf, gsize len
         MM_PORT_SERIAL_GET_CLASS (self)->debug_log (self, prefix, buf, len);
 }
 
+/* Commands are grouped in the statistics by a short key: the AT command
+ * name, or the QCDM command code */
+static void
+port_serial_get_command_key (MMPortSerial *self,
+                             const GByteArray *command,
+                             gchar key[MM_PORT_STATS_KEY_SIZE])
+{
+    guint i = 0;
+
+    switch (mm_port_get_port_type (MM_PORT (self))) {
+    case MM_PORT_TYPE_AT:
+        mm_port_stats_build_at_key (command->data, command->len, key);
+        return;
+    case MM_PORT_TYPE_QCDM: {
+        const guint8 *p = command->data;
+        gsize len = command->len;
+
+        /* Skip the leading HDLC flag, if any */
+        if (len > 0 && p[0] == 0x7E) {
+            p++;
+            len--;
+        }
+        if (len > 0)
+            i = g_snprintf (key, MM_PORT_STATS_KEY_SIZE, "0x%02X", p[0]);
+        break;
+    }
+    default:
+        break;
+    }
+
+    if (!i)
+        i = g_strlcpy (key, "raw", MM_PORT_STATS_KEY_SIZE);
+    key[i] = '\0';
+}
+
 static gboolean
 port_serial_process_command (MMPortSerial *self,
                              CommandContext *ctx,
                              GError **error)
 {
+    const GByteArray *data;
     const gchar *p;
     gsize written;
     gssize send_len;
+    guint32 idx;
 
-    if (self->priv->iochannel == NULL && self->priv->socket == NULL) {
+    if (!self->priv->fd_io && self->priv->socket == NULL) {
         g_set_error_literal (error, MM_SERIAL_ERROR, MM_SERIAL_ERROR_SEND_FAILED,
                              "Sending command failed: device is not enabled");
         return FALSE;
@@ -569,59 +682,61 @@ port_serial_process_command (MMPortSerial *self,
         return FALSE;
     }
 
+    /* A pipelined batch is written as if it were a single command */
+    data = (ctx->batch ? ctx->batch : ctx->command);
+
     /* Only print command the first time */
     if (ctx->started == FALSE) {
         ctx->started = TRUE;
-        serial_debug (self, "-->", (const char *) ctx->command->data, ctx->command->len);
+        ctx->start_time = g_get_monotonic_time ();
+        mm_port_stats_add_commands (mm_port_peek_stats (MM_PORT (self)), 1 + ctx->n_batched);
+        mm_port_capture_data (MM_PORT (self), MM_PORT_CAPTURE_DIRECTION_OUT, data->data, data->len);
+        serial_debug (self, "-->", (const char *) data->data, data->len);
     }
 
     if (self->priv->send_delay == 0 || mm_port_get_subsys (MM_PORT (self)) != MM_PORT_SUBSYS_TTY) {
         /* Send the whole command in one write */
-        send_len = (gssize)ctx->command->len;
-        p = (gchar *)ctx->command->data;
+        send_len = (gssize)(data->len - ctx->idx);
+        p = (gchar *)&data->data[ctx->idx];
     } else {
-        /* Send just one byte of the command */
-        send_len = 1;
-        p = (gchar *)&ctx->command->data[ctx->idx];
+        /* Send one byte of the command, or as many as the pacing timer
+         * expired since the last write, if the main loop was late */
+        send_len = (gssize) MIN (MAX (self->priv->pacing_credit, 1), data->len - ctx->idx);
+        p = (gchar *)&data->data[ctx->idx];
+        self->priv->pacing_credit = 0;
     }
 
-    /* GIOChannel based setup */
-    if (self->priv->iochannel) {
-        GIOStatus write_status;
+    idx = ctx->idx;
+
+    /* Raw fd based setup */
+    if (self->priv->fd_io) {
+        gssize bytes_written;
 
         /* Send N bytes of the command */
-        write_status = g_io_channel_write_chars (self->priv->iochannel, p, send_len, &written, error);
-        switch (write_status) {
-        case G_IO_STATUS_ERROR:
-            g_prefix_error (error, "Sending command failed: ");
+        bytes_written = write (self->priv->fd, p, send_len);
+        if (bytes_written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            g_set_error (error, MM_SERIAL_ERROR, MM_SERIAL_ERROR_SEND_FAILED,
+                         "Sending command failed: '%s'", strerror (errno));
             return FALSE;
+        }
 
-        case G_IO_STATUS_EOF:
-            /* We shouldn't get EOF when writing */
-            g_assert_not_reached ();
-            break;
-
-        case G_IO_STATUS_NORMAL:
-            if (written > 0) {
-                ctx->idx += written;
-                break;
-            }
-            /* If written == 0, treat as EAGAIN, so fall down */
-
-        case G_IO_STATUS_AGAIN:
-            /* We're in a non-blocking channel and therefore we're up to receive
-             * EAGAIN; just retry in this case. */
+        if (bytes_written > 0)
+            ctx->idx += bytes_written;
+        else {
+            /* We're in a non-blocking fd and therefore we're up to receive
+             * EAGAIN; just retry in this case. A write of 0 bytes is treated
+             * the same way. */
             ctx->eagain_count--;
             if (ctx->eagain_count <= 0) {
                 /* If we reach the limit of EAGAIN errors, treat as a timeout error. */
                 self->priv->n_consecutive_timeouts++;
+                mm_port_stats_add_timeout (mm_port_peek_stats (MM_PORT (self)));
                 g_signal_emit (self, signals[TIMED_OUT], 0, self->priv->n_consecutive_timeouts);
 
                 g_set_error (error, MM_SERIAL_ERROR, MM_SERIAL_ERROR_SEND_FAILED,
                              "Sending command failed: '%s'", strerror (errno));
                 return FALSE;
             }
-            break;
         }
     }
     /* Socket based setup */
@@ -648,6 +763,7 @@ port_serial_process_command (MMPortSerial *self,
             if (ctx->eagain_count <= 0) {
                 /* If we reach the limit of EAGAIN errors, treat as a timeout error. */
                 self->priv->n_consecutive_timeouts++;
+                mm_port_stats_add_timeout (mm_port_peek_stats (MM_PORT (self)));
                 g_signal_emit (self, signals[TIMED_OUT], 0, self->priv->n_consecutive_timeouts);
                 g_set_error (error, MM_SERIAL_ERROR, MM_SERIAL_ERROR_SEND_FAILED,
                              "Sending command failed: '%s'", strerror (errno));
@@ -663,37 +779,110 @@ port_serial_process_command (MMPortSerial *self,
     } else
         g_assert_not_reached ();
 
-    if (ctx->idx >= ctx->command->len)
+    mm_port_stats_add_bytes_out (mm_port_peek_stats (MM_PORT (self)), ctx->idx - idx);
+
+    if (ctx->idx >= data->len)
         ctx->done = TRUE;
 
     return TRUE;
 }
 
+typedef struct {
+    GByteArray *command;
+    GByteArray *response;
+    /* Monotonic time when the reply is no longer valid, 0 if never */
+    gint64 expires;
+    GList link;
+} CachedReply;
+
+static void
+cached_reply_free (CachedReply *cached)
+{
+    g_byte_array_unref (cached->command);
+    g_byte_array_unref (cached->response);
+    g_slice_free (CachedReply, cached);
+}
+
+static void
+port_serial_remove_cached_reply (MMPortSerial *self,
+                                 CachedReply *cached)
+{
+    g_queue_unlink (&self->priv->reply_cache_lru, &cached->link);
+    /* Frees the entry */
+    g_hash_table_remove (self->priv->reply_cache, cached->command);
+}
+
 static void
 port_serial_set_cached_reply (MMPortSerial *self,
                               const GByteArray *command,
-                              const GByteArray *response)
+                              const GByteArray *response,
+                              guint ttl_seconds)
 {
+    CachedReply *cached;
+
     g_return_if_fail (self != NULL);
     g_return_if_fail (MM_IS_PORT_SERIAL (self));
     g_return_if_fail (command != NULL);
 
-    if (response) {
-        GByteArray *cmd_copy = g_byte_array_sized_new (command->len);
-        GByteArray *rsp_copy = g_byte_array_sized_new (response->len);
+    cached = g_hash_table_lookup (self->priv->reply_cache, command);
 
-        g_byte_array_append (cmd_copy, command->data, command->len);
-        g_byte_array_append (rsp_copy, response->data, response->len);
-        g_hash_table_insert (self->priv->reply_cache, cmd_copy, rsp_copy);
-    } else
-        g_hash_table_remove (self->priv->reply_cache, command);
+    if (!response) {
+        if (cached)
+            port_serial_remove_cached_reply (self, cached);
+        return;
+    }
+
+    if (cached) {
+        g_queue_unlink (&self->priv->reply_cache_lru, &cached->link);
+        g_byte_array_unref (cached->response);
+    } else {
+        /* Make room for the new entry */
+        if (g_hash_table_size (self->priv->reply_cache) >= MM_PORT_SERIAL_REPLY_CACHE_MAX_ENTRIES)
+            port_serial_remove_cached_reply (self, (CachedReply *) self->priv->reply_cache_lru.tail->data);
+
+        cached = g_slice_new0 (CachedReply);
+        cached->link.data = cached;
+        cached->command = g_byte_array_sized_new (command->len);
+        g_byte_array_append (cached->command, command->data, command->len);
+        g_hash_table_insert (self->priv->reply_cache, cached->command, cached);
+    }
+
+    cached->response = g_byte_array_sized_new (response->len);
+    g_byte_array_append (cached->response, response->data, response->len);
+    cached->expires = (ttl_seconds ? g_get_monotonic_time () + (gint64) ttl_seconds * G_USEC_PER_SEC : 0);
+    g_queue_push_head_link (&self->priv->reply_cache_lru, &cached->link);
+}
+
+void
+mm_port_serial_set_cached_reply (MMPortSerial *self,
+                                 const GByteArray *command,
+                                 const GByteArray *response,
+                                 guint ttl_seconds)
+{
+    port_serial_set_cached_reply (self, command, response, ttl_seconds);
 }
 
 static const GByteArray *
 port_serial_get_cached_reply (MMPortSerial *self,
                               GByteArray *command)
 {
-    return (const GByteArray *)g_hash_table_lookup (self->priv->reply_cache, command);
+    CachedReply *cached;
+
+    cached = g_hash_table_lookup (self->priv->reply_cache, command);
+    if (!cached)
+        return NULL;
+
+    if (cached->expires && g_get_monotonic_time () >= cached->expires) {
+        port_serial_remove_cached_reply (self, cached);
+        return NULL;
+    }
+
+    /* Most recently used */
+    if (cached->link.prev) {
+        g_queue_unlink (&self->priv->reply_cache_lru, &cached->link);
+        g_queue_push_head_link (&self->priv->reply_cache_lru, &cached->link);
+    }
+    return cached->response;
 }
 
 static void
@@ -709,12 +898,21 @@ port_serial_schedule_queue_process (MMPortSerial *self, guint timeout_ms)
         return;
     }
 
+    if (self->priv->pacing) {
+        /* A command is being written, the pacing timer keeps on with it */
+        return;
+    }
+
     if (timeout_ms)
         self->priv->queue_id = g_timeout_add (timeout_ms, port_serial_queue_process, self);
     else
         self->priv->queue_id = g_idle_add (port_serial_queue_process, self);
 }
 
+static void port_serial_wait_response (MMPortSerial   *self,
+                                       CommandContext *ctx);
+static void port_serial_pacing_stop   (MMPortSerial   *self);
+
 static void
 port_serial_got_response (MMPortSerial *self,
                           GByteArray   *parsed_response,
@@ -723,6 +921,8 @@ port_serial_got_response (MMPortSerial *self,
     /* Either one or the other, not both */
     g_assert ((parsed_response && !error) || (!parsed_response && error));
 
+    port_serial_pacing_stop (self);
+
     if (self->priv->timeout_id) {
         g_source_remove (self->priv->timeout_id);
         self->priv->timeout_id = 0;
@@ -746,13 +946,30 @@ port_serial_got_response (MMPortSerial *self,
         CommandContext *ctx;
 
         ctx = (CommandContext *) g_queue_pop_head (self->priv->queue);
-        if (ctx) {
+        if (self->priv->n_in_flight > 0)
+            self->priv->n_in_flight--;
+
+        /* Only replies really received from the port account for latency */
+        if (ctx && ctx->started && ctx->done && !g_error_matches (error, MM_SERIAL_ERROR, MM_SERIAL_ERROR_RESPONSE_TIMEOUT)) {
+            gchar key[MM_PORT_STATS_KEY_SIZE];
+
+            port_serial_get_command_key (self, ctx->command, key);
+            mm_port_stats_add_reply (mm_port_peek_stats (MM_PORT (self)),
+                                     key,
+                                     g_get_monotonic_time () - ctx->start_time);
+        }
+
+        if (ctx && ctx->abandoned) {
+            /* Already completed when cancelled, we just got rid of its reply */
+            command_context_free (ctx);
+        } else if (ctx) {
             /* Complete the command context with the appropriate result */
             if (error)
                 g_simple_async_result_set_from_error (ctx->result, error);
             else {
-                if (ctx->allow_cached)
-                    port_serial_set_cached_reply (self, ctx->command, parsed_response);
+                /* Replies given from the cache keep their original expiry */
+                if (ctx->allow_cached && ctx->started)
+                    port_serial_set_cached_reply (self, ctx->command, parsed_response, ctx->cache_ttl);
                 g_simple_async_result_set_op_res_gpointer (ctx->result,
                                                            g_byte_array_ref (parsed_response),
                                                            (GDestroyNotify) g_byte_array_unref);
@@ -763,7 +980,11 @@ port_serial_got_response (MMPortSerial *self,
             command_context_complete_and_free (ctx, FALSE);
         }
 
-        if (!g_queue_is_empty (self->priv->queue))
+        /* If more pipelined commands were sent, wait for the reply of the
+         * next one; otherwise, keep on with the queue */
+        if (self->priv->n_in_flight > 0)
+            port_serial_wait_response (self, (CommandContext *) g_queue_peek_head (self->priv->queue));
+        else if (!g_queue_is_empty (self->priv->queue))
             port_serial_schedule_queue_process (self, 0);
     }
     g_object_unref (self);
@@ -779,6 +1000,7 @@ port_serial_timed_out (gpointer data)
 
     /* Update number of consecutive timeouts found */
     self->priv->n_consecutive_timeouts++;
+    mm_port_stats_add_timeout (mm_port_peek_stats (MM_PORT (self)));
 
     /* FIXME: This is not completely correct - if the response finally arrives and there's
      * some other command waiting for response right now, the other command will
@@ -790,7 +1012,24 @@ port_serial_timed_out (gpointer data)
     /* Make sure we have a valid reference when emitting the signal */
     g_object_ref (self);
     {
-        port_serial_got_response (self, NULL, error);
+        CommandContext *ctx;
+        gboolean batched;
+
+        /* If the command was sent pipelined, the replies of the following ones
+         * can't be told apart from a late reply of this one; so all the
+         * commands of the batch fail, and from now on commands are sent one by
+         * one. These were already written, so they're never sent again. */
+        ctx = (CommandContext *) g_queue_peek_head (self->priv->queue);
+        batched = (ctx && ctx->batched);
+        if (batched) {
+            mm_warn ("(%s) pipelined command timed out, disabling command pipelining",
+                     mm_port_get_device (MM_PORT (self)));
+            self->priv->pipeline_disabled = TRUE;
+        }
+
+        do {
+            port_serial_got_response (self, NULL, error);
+        } while (batched && self->priv->n_in_flight > 0);
 
         /* Emit a timed out signal, used by upper layers to identify a disconnected
          * serial port */
@@ -809,9 +1048,26 @@ port_serial_response_wait_cancelled (GCancellable *cancellable,
 {
     GError *error;
 
+    CommandContext *ctx;
+
     /* We don't want to call disconnect () while in the signal handler */
     self->priv->cancellable_id = 0;
 
+    /* If the command was sent pipelined, the replies of the following ones
+     * are already on their way; so complete the operation right away but
+     * keep on waiting for its reply, which will just be discarded. */
+    ctx = (CommandContext *) g_queue_peek_head (self->priv->queue);
+    if (ctx && ctx->batched) {
+        g_clear_object (&self->priv->cancellable);
+        ctx->abandoned = TRUE;
+        g_simple_async_result_set_error (ctx->result,
+                                         G_IO_ERROR,
+                                         G_IO_ERROR_CANCELLED,
+                                         "Waiting for the reply cancelled");
+        g_simple_async_result_complete_in_idle (ctx->result);
+        return;
+    }
+
     /* FIXME: This is not completely correct - if the response finally arrives and there's
      * some other command waiting for response right now, the other command will
      * get the output of the cancelled command. Not sure what to do here. */
@@ -822,12 +1078,193 @@ port_serial_response_wait_cancelled (GCancellable *cancellable,
     g_error_free (error);
 }
 
+static void
+port_serial_wait_response (MMPortSerial   *self,
+                           CommandContext *ctx)
+{
+    /* Setup the cancellable so that we can stop waiting for a response */
+    if (ctx->cancellable && !ctx->abandoned) {
+        gulong cancellable_id;
+        gboolean batched;
+
+        self->priv->cancellable = g_object_ref (ctx->cancellable);
+
+        /* If the GCancellable is already cancelled here, the callback will be
+         * called right away, and a GError will be propagated as response. In
+         * this case we need to completely avoid doing anything else with the
+         * MMPortSerial, as it may already be disposed.
+         * So, use an intermediate variable to store the cancellable id, and
+         * just return without further processing if we're already cancelled.
+         * Pipelined commands are an exception, as they keep on waiting for
+         * their reply even if cancelled.
+         */
+        batched = ctx->batched;
+        cancellable_id = g_cancellable_connect (ctx->cancellable,
+                                                (GCallback)port_serial_response_wait_cancelled,
+                                                self,
+                                                NULL);
+        if (!cancellable_id && !batched)
+            return;
+
+        self->priv->cancellable_id = cancellable_id;
+    }
+
+    /* If the command is finished being sent, schedule the timeout */
+    self->priv->timeout_id = g_timeout_add_seconds (ctx->timeout,
+                                                    port_serial_timed_out,
+                                                    self);
+}
+
+/* Append to the command at the head of the queue the pipelined ones right
+ * after it, so that they're all sent in a single write */
+static void
+port_serial_pipeline_batch (MMPortSerial   *self,
+                            CommandContext *ctx)
+{
+    GList *l;
+
+    if (!ctx->pipelined || self->priv->pipeline_disabled)
+        return;
+
+    for (l = g_queue_peek_head_link (self->priv->queue)->next;
+         l && ctx->n_batched + 1 < self->priv->pipeline_depth;
+         l = l->next) {
+        CommandContext *next = (CommandContext *) l->data;
+
+        if (!next->pipelined)
+            break;
+
+        /* Commands which won't really be sent end the batch */
+        if (next->cancellable && g_cancellable_is_cancelled (next->cancellable))
+            break;
+        if (next->allow_cached && port_serial_get_cached_reply (self, next->command))
+            break;
+
+        if (!ctx->batch) {
+            ctx->batch = g_byte_array_sized_new (ctx->command->len * self->priv->pipeline_depth);
+            g_byte_array_append (ctx->batch, ctx->command->data, ctx->command->len);
+        }
+        g_byte_array_append (ctx->batch, next->command->data, next->command->len);
+        ctx->n_batched++;
+    }
+}
+
+/*****************************************************************************/
+/* Paced writes
+ *
+ * Modems needing a delay between the bytes written get them one by one, every
+ * send_delay microseconds. A periodic timerfd drives the writes, so that the
+ * pace doesn't depend on the millisecond resolution of the main loop timeouts;
+ * if the main loop gets late, the expirations are accumulated as credit and
+ * the pending bytes are written together in the next write. */
+
+static gboolean
+port_serial_pacing_expired (gint         fd,
+                            GIOCondition condition,
+                            gpointer     data)
+{
+    MMPortSerial *self = MM_PORT_SERIAL (data);
+    guint64 expirations;
+
+    if (read (fd, &expirations, sizeof (expirations)) != sizeof (expirations))
+        return G_SOURCE_CONTINUE;
+
+    if (!self->priv->pacing)
+        return G_SOURCE_CONTINUE;
+
+    self->priv->pacing_credit += expirations;
+
+    /* Processing the queue may complete the command and unref the port */
+    g_object_ref (self);
+    port_serial_queue_process (self);
+    g_object_unref (self);
+
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+port_serial_pacing_start (MMPortSerial *self)
+{
+    struct itimerspec spec;
+
+    if (self->priv->pacing)
+        return TRUE;
+
+    if (self->priv->pacing_fd < 0) {
+        self->priv->pacing_fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (self->priv->pacing_fd < 0) {
+            mm_warn ("(%s) couldn't create pacing timer: %s",
+                     mm_port_get_device (MM_PORT (self)),
+                     g_strerror (errno));
+            return FALSE;
+        }
+
+        self->priv->pacing_source = g_unix_fd_source_new (self->priv->pacing_fd, G_IO_IN);
+        g_source_set_callback (self->priv->pacing_source,
+                               (GSourceFunc) port_serial_pacing_expired,
+                               self,
+                               NULL);
+        g_source_attach (self->priv->pacing_source, NULL);
+    }
+
+    memset (&spec, 0, sizeof (spec));
+    spec.it_interval.tv_sec = self->priv->send_delay / G_USEC_PER_SEC;
+    spec.it_interval.tv_nsec = (self->priv->send_delay % G_USEC_PER_SEC) * 1000;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime (self->priv->pacing_fd, 0, &spec, NULL) < 0) {
+        mm_warn ("(%s) couldn't arm pacing timer: %s",
+                 mm_port_get_device (MM_PORT (self)),
+                 g_strerror (errno));
+        return FALSE;
+    }
+
+    self->priv->pacing = TRUE;
+    self->priv->pacing_credit = 0;
+    return TRUE;
+}
+
+static void
+port_serial_pacing_stop (MMPortSerial *self)
+{
+    struct itimerspec spec;
+
+    if (!self->priv->pacing)
+        return;
+
+    /* Disarming also drops any expiration not read yet */
+    memset (&spec, 0, sizeof (spec));
+    timerfd_settime (self->priv->pacing_fd, 0, &spec, NULL);
+    self->priv->pacing = FALSE;
+    self->priv->pacing_credit = 0;
+}
+
+static void
+port_serial_pacing_cleanup (MMPortSerial *self)
+{
+    port_serial_pacing_stop (self);
+
+    if (self->priv->pacing_source) {
+        g_source_destroy (self->priv->pacing_source);
+        g_source_unref (self->priv->pacing_source);
+        self->priv->pacing_source = NULL;
+    }
+
+    if (self->priv->pacing_fd >= 0) {
+        close (self->priv->pacing_fd);
+        self->priv->pacing_fd = -1;
+    }
+}
+
+/*****************************************************************************/
+
 static gboolean
 port_serial_queue_process (gpointer data)
 {
     MMPortSerial *self = MM_PORT_SERIAL (data);
     CommandContext *ctx;
     GError *error = NULL;
+    GList *l;
+    guint i;
 
     self->priv->queue_id = 0;
 
@@ -842,6 +1279,8 @@ port_serial_queue_process (gpointer data)
         if (cached) {
             GByteArray *parsed_response;
 
+            mm_port_stats_add_cache_hit (mm_port_peek_stats (MM_PORT (self)));
+
             parsed_response = g_byte_array_sized_new (cached->len);
             g_byte_array_append (parsed_response, cached->data, cached->len);
             /* Note: may complete last operation and unref the MMPortSerial */
@@ -853,6 +1292,9 @@ port_serial_queue_process (gpointer data)
         /* Cached reply wasn't found, keep on */
     }
 
+    if (!ctx->started)
+        port_serial_pipeline_batch (self, ctx);
+
     /* If error, report it */
     if (!port_serial_process_command (self, ctx, &error)) {
         /* Note: may complete last operation and unref the MMPortSerial */
@@ -863,45 +1305,35 @@ port_serial_queue_process (gpointer data)
 
     /* Schedule the next byte of the command to be sent */
     if (!ctx->done) {
-        port_serial_schedule_queue_process (self,
-                                            (mm_port_get_subsys (MM_PORT (self)) == MM_PORT_SUBSYS_TTY ?
-                                             self->priv->send_delay / 1000 :
-                                             0));
+        if (self->priv->send_delay == 0 || mm_port_get_subsys (MM_PORT (self)) != MM_PORT_SUBSYS_TTY)
+            port_serial_schedule_queue_process (self, 0);
+        else if (!port_serial_pacing_start (self))
+            port_serial_schedule_queue_process (self, self->priv->send_delay / 1000);
         return G_SOURCE_REMOVE;
     }
 
-    /* Setup the cancellable so that we can stop waiting for a response */
-    if (ctx->cancellable) {
-        gulong cancellable_id;
+    port_serial_pacing_stop (self);
 
-        self->priv->cancellable = g_object_ref (ctx->cancellable);
-
-        /* If the GCancellable is already cancelled here, the callback will be
-         * called right away, and a GError will be propagated as response. In
-         * this case we need to completely avoid doing anything else with the
-         * MMPortSerial, as it may already be disposed.
-         * So, use an intermediate variable to store the cancellable id, and
-         * just return without further processing if we're already cancelled.
-         */
-        cancellable_id = g_cancellable_connect (ctx->cancellable,
-                                                (GCallback)port_serial_response_wait_cancelled,
-                                                self,
-                                                NULL);
-        if (!cancellable_id)
-            return G_SOURCE_REMOVE;
+    /* All commands in the batch are now waiting for their reply */
+    self->priv->n_in_flight = 1 + ctx->n_batched;
+    if (ctx->n_batched) {
+        ctx->batched = TRUE;
+        for (i = 0, l = g_queue_peek_head_link (self->priv->queue)->next; i < ctx->n_batched; i++, l = l->next) {
+            CommandContext *next = (CommandContext *) l->data;
 
-        self->priv->cancellable_id = cancellable_id;
+            next->started = TRUE;
+            next->done = TRUE;
+            next->batched = TRUE;
+            next->start_time = ctx->start_time;
+        }
     }
 
-    /* If the command is finished being sent, schedule the timeout */
-    self->priv->timeout_id = g_timeout_add_seconds (ctx->timeout,
-                                                    port_serial_timed_out,
-                                                    self);
+    port_serial_wait_response (self, ctx);
     return G_SOURCE_REMOVE;
 }
 
-static void
-parse_response_buffer (MMPortSerial *self)
+static gboolean
+parse_response_buffer_once (MMPortSerial *self)
 {
     GError *error = NULL;
     GByteArray *parsed_response = NULL;
@@ -913,7 +1345,7 @@ parse_response_buffer (MMPortSerial *self)
      */
     if (MM_PORT_SERIAL_GET_CLASS (self)->parse_unsolicited)
         MM_PORT_SERIAL_GET_CLASS (self)->parse_unsolicited (self,
-                                                            self->priv->response);
+                                                            &self->priv->response_window);
 
     /* Parse response in the subclass.
      *
@@ -922,37 +1354,157 @@ parse_response_buffer (MMPortSerial *self)
      * response buffer, and the response buffer is cleaned up accordingly.
      */
     g_assert (MM_PORT_SERIAL_GET_CLASS (self)->parse_response != NULL);
+    if (self->priv->response_scanned > self->priv->response_window.len)
+        self->priv->response_scanned = self->priv->response_window.len;
+    self->priv->n_bytes_scanned += (self->priv->response_window.len - self->priv->response_scanned);
     switch (MM_PORT_SERIAL_GET_CLASS (self)->parse_response (self,
-                                                             self->priv->response,
+                                                             &self->priv->response_window,
                                                              &parsed_response,
                                                              &error)) {
     case MM_PORT_SERIAL_RESPONSE_BUFFER:
         /* We have a valid response to process */
         g_assert (parsed_response);
         self->priv->n_consecutive_timeouts = 0;
+        self->priv->response_scanned = 0;
         /* Note: may complete last operation and unref the MMPortSerial */
         port_serial_got_response (self, parsed_response, NULL);
         g_byte_array_unref (parsed_response);
-        break;
+        return TRUE;
     case MM_PORT_SERIAL_RESPONSE_ERROR:
         /* We have an error to process */
         g_assert (error);
         self->priv->n_consecutive_timeouts = 0;
+        self->priv->response_scanned = 0;
         /* Note: may complete last operation and unref the MMPortSerial */
         port_serial_got_response (self, NULL, error);
         g_error_free (error);
-        break;
+        return TRUE;
     case MM_PORT_SERIAL_RESPONSE_NONE:
-        /* Nothing to do this time */
+        /* Nothing to do this time, but everything we have has been scanned */
+        self->priv->response_scanned = self->priv->response_window.len;
         break;
     }
+
+    return FALSE;
+}
+
+static void
+parse_response_buffer (MMPortSerial *self)
+{
+    /* When several pipelined commands are waiting for a reply, the buffer
+     * may already hold the replies of the following ones as well */
+    while (parse_response_buffer_once (self) &&
+           self->priv->n_in_flight > 0 &&
+           self->priv->response_window.len > 0);
+}
+
+guint
+mm_port_serial_get_n_in_flight (MMPortSerial *self)
+{
+    g_return_val_if_fail (MM_IS_PORT_SERIAL (self), 0);
+
+    return self->priv->n_in_flight;
+}
+
+guint
+mm_port_serial_get_response_scanned (MMPortSerial *self)
+{
+    g_return_val_if_fail (MM_IS_PORT_SERIAL (self), 0);
+
+    return self->priv->response_scanned;
+}
+
+void
+mm_port_serial_rewind_response_scanned (MMPortSerial *self,
+                                        guint         offset)
+{
+    g_return_if_fail (MM_IS_PORT_SERIAL (self));
+
+    if (offset < self->priv->response_scanned)
+        self->priv->response_scanned = offset;
+}
+
+/* Bytes are read straight into the free space at the tail of the response
+ * buffer, which is preallocated and only grows if the response parser leaves
+ * too much unprocessed data there */
+static void
+response_buffer_clear (MMPortSerial *self)
+{
+    g_byte_array_set_size (self->priv->response, 0);
+    self->priv->response_window.data = self->priv->response->data;
+    self->priv->response_window.len = 0;
+    self->priv->response_scanned = 0;
+}
+
+static guint8 *
+response_buffer_reserve (MMPortSerial *self,
+                         gsize len)
+{
+    GByteArray *window = &self->priv->response_window;
+    gsize head;
+
+    /* Released bytes are reclaimed once they're at least as many as the ones
+     * still in the window, so that each received byte is moved at most once
+     * on average */
+    head = window->data - self->priv->response->data;
+    if (head > 0 && head >= window->len) {
+        memmove (self->priv->response->data, window->data, window->len);
+        head = 0;
+    }
+
+    g_byte_array_set_size (self->priv->response, head + window->len + len);
+    self->priv->response->len = head + window->len;
+    window->data = &self->priv->response->data[head];
+    return &window->data[window->len];
+}
+
+void
+mm_port_serial_response_release (MMPortSerial *self,
+                                 GByteArray   *response,
+                                 guint         len)
+{
+    g_return_if_fail (MM_IS_PORT_SERIAL (self));
+    g_return_if_fail (len <= response->len);
+
+    if (!len)
+        return;
+
+    if (response == &self->priv->response_window) {
+        response->data += len;
+        response->len -= len;
+    } else
+        g_byte_array_remove_range (response, 0, len);
+
+    /* Whatever was already scanned moved towards the start of the buffer */
+    self->priv->response_scanned = (self->priv->response_scanned > len ?
+                                    self->priv->response_scanned - len :
+                                    0);
+}
+
+void
+mm_port_serial_response_reserve (MMPortSerial *self,
+                                 GByteArray   *response,
+                                 guint         len)
+{
+    guint old_len;
+
+    g_return_if_fail (MM_IS_PORT_SERIAL (self));
+
+    if (response == &self->priv->response_window) {
+        response_buffer_reserve (self, len);
+        return;
+    }
+
+    old_len = response->len;
+    g_byte_array_set_size (response, old_len + len);
+    response->len = old_len;
 }
 
 static gboolean
 common_input_available (MMPortSerial *self,
                         GIOCondition condition)
 {
-    char buf[SERIAL_BUF_SIZE + 1];
+    gchar *buf;
     gsize bytes_read;
     GIOStatus status = G_IO_STATUS_NORMAL;
     CommandContext *ctx;
@@ -965,15 +1517,13 @@ common_input_available (MMPortSerial *self,
         device = mm_port_get_device (MM_PORT (self));
         mm_dbg ("(%s) unexpected port hangup!", device);
 
-        if (self->priv->response->len)
-            g_byte_array_remove_range (self->priv->response, 0, self->priv->response->len);
+        response_buffer_clear (self);
         port_serial_close_force (self);
         return G_SOURCE_REMOVE;
     }
 
     if (condition & G_IO_ERR) {
-        if (self->priv->response->len)
-            g_byte_array_remove_range (self->priv->response, 0, self->priv->response->len);
+        response_buffer_clear (self);
         return G_SOURCE_CONTINUE;
     }
 
@@ -984,20 +1534,24 @@ common_input_available (MMPortSerial *self,
 
     while (iterate) {
         bytes_read = 0;
+        buf = (gchar *) response_buffer_reserve (self, SERIAL_BUF_SIZE);
+
+        if (self->priv->fd_io) {
+            gssize sbytes_read;
 
-        if (self->priv->iochannel) {
-            status = g_io_channel_read_chars (self->priv->iochannel,
-                                              buf,
-                                              SERIAL_BUF_SIZE,
-                                              &bytes_read,
-                                              &error);
-            if (status == G_IO_STATUS_ERROR) {
-                if (error) {
+            sbytes_read = read (self->priv->fd, buf, SERIAL_BUF_SIZE);
+            if (sbytes_read < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                    status = G_IO_STATUS_AGAIN;
+                else {
+                    status = G_IO_STATUS_ERROR;
                     mm_warn ("(%s): read error: %s",
                              mm_port_get_device (MM_PORT (self)),
-                             error->message);
+                             g_strerror (errno));
                 }
-                g_clear_error (&error);
+            } else {
+                bytes_read = (gsize) sbytes_read;
+                status = (sbytes_read > 0 ? G_IO_STATUS_NORMAL : G_IO_STATUS_EOF);
             }
         } else if (self->priv->socket) {
             gssize sbytes_read;
@@ -1028,14 +1582,18 @@ common_input_available (MMPortSerial *self,
             break;
 
         g_assert (bytes_read > 0);
+        mm_port_capture_data (MM_PORT (self), MM_PORT_CAPTURE_DIRECTION_IN, (const guint8 *) buf, bytes_read);
         serial_debug (self, "<--", buf, bytes_read);
-        g_byte_array_append (self->priv->response, (const guint8 *) buf, bytes_read);
+        mm_port_stats_add_bytes_in (mm_port_peek_stats (MM_PORT (self)), bytes_read);
+        /* Already in place, just account the new bytes */
+        self->priv->response_window.len += bytes_read;
+        self->priv->n_bytes_read += bytes_read;
 
         /* Make sure the response doesn't grow too long */
-        if ((self->priv->response->len > SERIAL_BUF_SIZE) && self->priv->spew_control) {
+        if ((self->priv->response_window.len > SERIAL_BUF_SIZE) && self->priv->spew_control) {
             /* Notify listeners and then trim the buffer */
-            g_signal_emit (self, signals[BUFFER_FULL], 0, self->priv->response);
-            g_byte_array_remove_range (self->priv->response, 0, (SERIAL_BUF_SIZE / 2));
+            g_signal_emit (self, signals[BUFFER_FULL], 0, &self->priv->response_window);
+            mm_port_serial_response_release (self, &self->priv->response_window, SERIAL_BUF_SIZE / 2);
         }
 
         /* See if we can parse anything. The response parsing may actually
@@ -1043,14 +1601,14 @@ common_input_available (MMPortSerial *self,
          * up fully disposing this serial port object. In order to cope with
          * that we make sure we have our own reference to the object while the
          * response buffer operation is run, and then we check ourselves whether
-         * we should be keeping this socket/iochannel source or not. */
+         * we should be keeping this socket/fd source or not. */
         g_object_ref (self);
         {
             parse_response_buffer (self);
 
-            /* If we didn't end up closing the iochannel/socket in the previous
+            /* If we didn't end up closing the fd/socket in the previous
              * operation, we keep this source. */
-            keep_source = ((self->priv->iochannel_id > 0 || self->priv->socket_source != NULL) ?
+            keep_source = ((self->priv->fd_source != NULL || self->priv->socket_source != NULL) ?
                            G_SOURCE_CONTINUE : G_SOURCE_REMOVE);
 
             /* If we're keeping the source and we still may have bytes to read,
@@ -1065,9 +1623,9 @@ common_input_available (MMPortSerial *self,
 }
 
 static gboolean
-iochannel_input_available (GIOChannel *iochannel,
-                           GIOCondition condition,
-                           gpointer data)
+fd_input_available (gint fd,
+                    GIOCondition condition,
+                    gpointer data)
 {
     return common_input_available (MM_PORT_SERIAL (data), condition);
 }
@@ -1083,11 +1641,12 @@ socket_input_available (GSocket *socket,
 static void
 data_watch_enable (MMPortSerial *self, gboolean enable)
 {
-    if (self->priv->iochannel_id) {
+    if (self->priv->fd_source) {
         if (enable)
-            g_warn_if_fail (self->priv->iochannel_id == 0);
-        g_source_remove (self->priv->iochannel_id);
-        self->priv->iochannel_id = 0;
+            g_warn_if_fail (self->priv->fd_source == NULL);
+        g_source_destroy (self->priv->fd_source);
+        g_source_unref (self->priv->fd_source);
+        self->priv->fd_source = NULL;
     }
 
     if (self->priv->socket_source) {
@@ -1099,11 +1658,14 @@ data_watch_enable (MMPortSerial *self, gboolean enable)
     }
 
     if (enable) {
-        if (self->priv->iochannel) {
-            self->priv->iochannel_id = g_io_add_watch (self->priv->iochannel,
-                                                       G_IO_IN | G_IO_ERR | G_IO_HUP,
-                                                       iochannel_input_available,
-                                                       self);
+        if (self->priv->fd_io) {
+            self->priv->fd_source = g_unix_fd_source_new (self->priv->fd,
+                                                          G_IO_IN | G_IO_ERR | G_IO_HUP);
+            g_source_set_callback (self->priv->fd_source,
+                                   (GSourceFunc)fd_input_available,
+                                   self,
+                                   NULL);
+            g_source_attach (self->priv->fd_source, NULL);
         } else if (self->priv->socket) {
             self->priv->socket_source = g_socket_create_source (self->priv->socket,
                                                                 G_IO_IN | G_IO_ERR | G_IO_HUP,
@@ -1124,7 +1686,7 @@ port_connected (MMPortSerial *self, GParamSpec *pspec, gpointer user_data)
 {
     gboolean connected;
 
-    if (!self->priv->iochannel && !self->priv->socket)
+    if (!self->priv->fd_io && !self->priv->socket)
         return;
 
     /* When the port is connected, drop the serial port lock so PPP can do
@@ -1261,22 +1823,14 @@ mm_port_serial_open (MMPortSerial *self, GError **error)
         mm_warn ("(%s): open blocked by driver for more than 7 seconds!", device);
 
     if (mm_port_get_subsys (MM_PORT (self)) != MM_PORT_SUBSYS_UNIX) {
-        /* Create new GIOChannel */
-        self->priv->iochannel = g_io_channel_unix_new (self->priv->fd);
-
-        /* We don't want UTF-8 encoding, we're playing with raw binary data */
-        g_io_channel_set_encoding (self->priv->iochannel, NULL, NULL);
-
-        /* We don't want to get the channel buffered */
-        g_io_channel_set_buffered (self->priv->iochannel, FALSE);
-
-        /* We don't want to get blocked while writing stuff */
-        if (!g_io_channel_set_flags (self->priv->iochannel,
-                                     G_IO_FLAG_NONBLOCK,
-                                     error)) {
-            g_prefix_error (error, "Cannot set non-blocking channel: ");
+        /* Raw binary data is read and written directly on the fd, with no
+         * buffering or encoding layer in between; we don't want to get blocked
+         * while writing stuff */
+        if (!g_unix_set_fd_nonblocking (self->priv->fd, TRUE, error)) {
+            g_prefix_error (error, "Cannot set non-blocking fd: ");
             goto error;
         }
+        self->priv->fd_io = TRUE;
     } else {
         GSocketAddress *address;
 
@@ -1335,10 +1889,7 @@ success:
 error:
     mm_warn ("(%s) failed to open serial device", device);
 
-    if (self->priv->iochannel) {
-        g_io_channel_unref (self->priv->iochannel);
-        self->priv->iochannel = NULL;
-    }
+    self->priv->fd_io = FALSE;
 
     if (self->priv->socket) {
         g_socket_close (self->priv->socket, NULL);
@@ -1395,7 +1946,7 @@ _close_internal (MMPortSerial *self, gboolean force)
 
     mm_port_serial_flash_cancel (self);
 
-    if (self->priv->iochannel || self->priv->socket) {
+    if (self->priv->fd_io || self->priv->socket) {
         GTimeVal tv_start, tv_end;
         struct serial_struct sinfo = { 0 };
 
@@ -1423,14 +1974,11 @@ _close_internal (MMPortSerial *self, gboolean force)
             tcflush (self->priv->fd, TCIOFLUSH);
         }
 
-        /* Destroy channel */
-        if (self->priv->iochannel) {
+        /* Stop fd I/O */
+        if (self->priv->fd_io) {
             data_watch_enable (self, FALSE);
-            /* unref() without g_io_channel_shutdown() to destroy the channel
-             * without closing the fd. The close() is called explicitly after.
-             */
-            g_io_channel_unref (self->priv->iochannel);
-            self->priv->iochannel = NULL;
+            port_serial_pacing_cleanup (self);
+            self->priv->fd_io = FALSE;
         }
 
         /* Close fd, if any */
@@ -1451,6 +1999,12 @@ _close_internal (MMPortSerial *self, gboolean force)
 
         mm_dbg ("(%s) serial port closed", device);
 
+        if (self->priv->n_bytes_read)
+            mm_dbg ("(%s) response parsers scanned %" G_GUINT64_FORMAT " bytes out of %" G_GUINT64_FORMAT " bytes read",
+                    device, self->priv->n_bytes_scanned, self->priv->n_bytes_read);
+        self->priv->n_bytes_read = 0;
+        self->priv->n_bytes_scanned = 0;
+
         /* Some ports don't respond to data and when close is called
          * the serial layer waits up to 30 second (closing_wait) for
          * that data to send before giving up and returning from close().
@@ -1465,6 +2019,10 @@ _close_internal (MMPortSerial *self, gboolean force)
         CommandContext *ctx;
 
         ctx = g_queue_peek_nth (self->priv->queue, i);
+        if (ctx->abandoned) {
+            command_context_free (ctx);
+            continue;
+        }
         g_simple_async_result_set_error (ctx->result,
                                          MM_SERIAL_ERROR,
                                          MM_SERIAL_ERROR_SEND_FAILED,
@@ -1472,6 +2030,7 @@ _close_internal (MMPortSerial *self, gboolean force)
         command_context_complete_and_free (ctx, TRUE);
     }
     g_queue_clear (self->priv->queue);
+    self->priv->n_in_flight = 0;
 
     if (self->priv->timeout_id) {
         g_source_remove (self->priv->timeout_id);
@@ -1928,59 +2487,52 @@ ba_equal (gconstpointer v1, gconstpointer v2)
     const GByteArray *a = v1;
     const GByteArray *b = v2;
 
-    if (!a && b)
-        return -1;
-    else if (a && !b)
-        return 1;
-    else if (!a && !b)
-        return 0;
-
-    g_assert (a && b);
-    if (a->len < b->len)
-        return -1;
-    else if (a->len > b->len)
-        return 1;
-
-    g_assert (a->len == b->len);
-    return !memcmp (a->data, b->data, a->len);
+    return (a->len == b->len && !memcmp (a->data, b->data, a->len));
 }
 
 static guint
 ba_hash (gconstpointer v)
 {
-    /* 31 bit hash function */
+    /* 32-bit FNV-1a */
     const GByteArray *array = v;
-    guint32 i, h = (const signed char) array->data[0];
+    guint32 h = 2166136261U;
+    guint i;
 
-    for (i = 1; i < array->len; i++)
-        h = (h << 5) - h + (const signed char) array->data[i];
+    for (i = 0; i < array->len; i++) {
+        h ^= array->data[i];
+        h *= 16777619U;
+    }
 
     return h;
 }
 
-static void
-ba_free (gpointer v)
-{
-    g_byte_array_unref ((GByteArray *) v);
-}
-
 static void
 mm_port_serial_init (MMPortSerial *self)
 {
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, MM_TYPE_PORT_SERIAL, MMPortSerialPrivate);
 
-    self->priv->reply_cache = g_hash_table_new_full (ba_hash, ba_equal, ba_free, ba_free);
+    /* Entries own their command, used as key */
+    self->priv->reply_cache = g_hash_table_new_full (ba_hash, ba_equal, NULL, (GDestroyNotify) cached_reply_free);
+    g_queue_init (&self->priv->reply_cache_lru);
 
     self->priv->fd = -1;
+    self->priv->pacing_fd = -1;
     self->priv->baud = 57600;
     self->priv->bits = 8;
     self->priv->parity = 'n';
     self->priv->stopbits = 1;
     self->priv->flow_control = MM_FLOW_CONTROL_UNKNOWN;
     self->priv->send_delay = 1000;
+    self->priv->pipeline_depth = 1;
 
     self->priv->queue = g_queue_new ();
-    self->priv->response = g_byte_array_sized_new (500);
+    /* The response window never grows much beyond SERIAL_BUF_SIZE when spew
+     * control is enabled, so allocate the buffer once with room for as many
+     * released bytes and one more full read at its tail, and let it be
+     * reused */
+    self->priv->response = g_byte_array_sized_new (4 * SERIAL_BUF_SIZE);
+    self->priv->response_window.data = self->priv->response->data;
+    self->priv->response_window.len = 0;
 }
 
 static void
@@ -2019,6 +2571,9 @@ set_property (GObject *object,
     case PROP_FLASH_OK:
         self->priv->flash_ok = g_value_get_boolean (value);
         break;
+    case PROP_PIPELINE_DEPTH:
+        self->priv->pipeline_depth = g_value_get_uint (value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -2061,6 +2616,9 @@ get_property (GObject *object,
     case PROP_FLASH_OK:
         g_value_set_boolean (value, self->priv->flash_ok);
         break;
+    case PROP_PIPELINE_DEPTH:
+        g_value_set_uint (value, self->priv->pipeline_depth);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -2076,8 +2634,9 @@ finalize (GObject *object)
     mm_port_serial_flash_cancel (MM_PORT_SERIAL (object));
 
     /* These are disposed during port closing */
-    g_assert (self->priv->iochannel     == NULL);
-    g_assert (self->priv->iochannel_id  == 0);
+    g_assert (self->priv->fd_io         == FALSE);
+    g_assert (self->priv->fd_source     == NULL);
+    g_assert (self->priv->pacing_source == NULL);
     g_assert (self->priv->socket        == NULL);
     g_assert (self->priv->socket_source == NULL);
 
@@ -2087,6 +2646,7 @@ finalize (GObject *object)
     if (self->priv->queue_id)
         g_source_remove (self->priv->queue_id);
 
+    /* The LRU links are owned by the entries */
     g_hash_table_destroy (self->priv->reply_cache);
     g_byte_array_unref (self->priv->response);
     g_queue_free (self->priv->queue);
@@ -2183,6 +2743,16 @@ mm_port_serial_class_init (MMPortSerialClass *klass)
                                TRUE,
                                G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
 
+    g_object_class_install_property
+        (object_class, PROP_PIPELINE_DEPTH,
+         g_param_spec_uint (MM_PORT_SERIAL_PIPELINE_DEPTH,
+                            "PipelineDepth",
+                            "Maximum number of pipelinable commands sent "
+                            "without waiting for the previous replies, "
+                            "1 to disable pipelining",
+                            1, MM_PORT_SERIAL_PIPELINE_DEPTH_MAX, 1,
+                            G_PARAM_READWRITE));
+
     /* Signals */
     signals[BUFFER_FULL] =
         g_signal_new ("buffer-full",
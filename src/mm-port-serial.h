@@ -40,6 +40,15 @@
 #define MM_PORT_SERIAL_FD           "fd" /* Construct-only */
 #define MM_PORT_SERIAL_SPEW_CONTROL "spew-control" /* Construct-only */
 #define MM_PORT_SERIAL_FLASH_OK     "flash-ok" /* Construct-only */
+#define MM_PORT_SERIAL_PIPELINE_DEPTH "pipeline-depth"
+
+/* Maximum number of commands written to the port without waiting for the
+ * reply of the previous ones */
+#define MM_PORT_SERIAL_PIPELINE_DEPTH_MAX 16
+
+/* Maximum number of cached replies kept, the least recently used ones are
+ * dropped first */
+#define MM_PORT_SERIAL_REPLY_CACHE_MAX_ENTRIES 32
 
 typedef enum {
     MM_PORT_SERIAL_RESPONSE_NONE,
@@ -62,6 +71,12 @@ struct _MMPortSerialClass {
     /* Called for subclasses to parse unsolicited responses.  If any recognized
      * unsolicited response is found, it should be removed from the 'response'
      * byte array before returning.
+     *
+     * Note that 'response', here and in parse_response(), is a window on the
+     * response buffer of the port, not a GByteArray allocated by GLib: it
+     * may be modified in place and shrunk by lowering its length, but data
+     * must be removed from its start with mm_port_serial_response_release(),
+     * and room to grow it made with mm_port_serial_response_reserve().
      */
     void     (*parse_unsolicited) (MMPortSerial *self, GByteArray *response);
 
@@ -95,6 +110,15 @@ struct _MMPortSerialClass {
      * should get ignored. */
     void     (*config)            (MMPortSerial *self);
 
+    /* Called to know whether the command may be written to the port while the
+     * replies to previous commands are still pending. Only used if the
+     * pipeline depth of the port is greater than 1. Replies must then be
+     * given by parse_response() one by one, in the same order as the
+     * commands were sent.
+     */
+    gboolean (*command_can_pipeline) (MMPortSerial *self,
+                                      const GByteArray *command);
+
     void (*debug_log)             (MMPortSerial *self,
                                    const char *prefix,
                                    const char *buf,
@@ -144,6 +168,7 @@ void        mm_port_serial_command        (MMPortSerial *self,
                                            GByteArray *command,
                                            guint32 timeout_seconds,
                                            gboolean allow_cached,
+                                           guint cache_ttl,
                                            gboolean run_next,
                                            GCancellable *cancellable,
                                            GAsyncReadyCallback callback,
@@ -152,9 +177,39 @@ GByteArray *mm_port_serial_command_finish (MMPortSerial *self,
                                            GAsyncResult *res,
                                            GError **error);
 
+/* Store the reply to give to @command when sent allowing cached replies, as
+ * if it had already been received from the device; the reply expires after
+ * @ttl_seconds, if not 0. A NULL @response removes the cached reply. */
+void        mm_port_serial_set_cached_reply (MMPortSerial     *self,
+                                             const GByteArray *command,
+                                             const GByteArray *response,
+                                             guint             ttl_seconds);
+
 gboolean mm_port_serial_set_flow_control (MMPortSerial   *self,
                                           MMFlowControl   flow_control,
                                           GError        **error);
 
 MMFlowControl mm_port_serial_get_flow_control (MMPortSerial *self);
+
+/* For subclasses: number of commands already sent and waiting for a reply */
+guint mm_port_serial_get_n_in_flight (MMPortSerial *self);
+
+/* For subclasses: number of leading bytes in the response buffer already
+ * given to parse_response() without result. Subclasses modifying the
+ * buffer contents before that offset must rewind it. */
+guint mm_port_serial_get_response_scanned    (MMPortSerial *self);
+void  mm_port_serial_rewind_response_scanned (MMPortSerial *self,
+                                              guint         offset);
+
+/* For subclasses: removes @len bytes from the start of the @response given
+ * to the parsers, which just moves the start of the window, and rewinds the
+ * scanned offset accordingly. Reserves room for @len more bytes at the end
+ * of @response, which may move its data. Both also work with standalone
+ * byte arrays, e.g. in unit tests. */
+void  mm_port_serial_response_release (MMPortSerial *self,
+                                       GByteArray   *response,
+                                       guint         len);
+void  mm_port_serial_response_reserve (MMPortSerial *self,
+                                       GByteArray   *response,
+                                       guint         len);
 #endif /* MM_PORT_SERIAL_H */
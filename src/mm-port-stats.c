@@ -0,0 +1,228 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <string.h>
+
+#include "mm-port-stats.h"
+
+/* Commands with keys beyond this limit are all accounted together, so that
+ * a misbehaving client can't make the table grow without bounds */
+#define MAX_KEYS  64
+#define OTHER_KEY "other"
+#define RAW_KEY   "raw"
+
+typedef struct {
+    guint32 buckets[MM_PORT_STATS_N_BUCKETS];
+} CommandStats;
+
+struct _MMPortStats {
+    guint64     n_commands;
+    guint64     n_bytes_in;
+    guint64     n_bytes_out;
+    guint64     n_timeouts;
+    guint64     n_cache_hits;
+    /* key -> CommandStats */
+    GHashTable *commands;
+};
+
+/*****************************************************************************/
+
+void
+mm_port_stats_add_bytes_in (MMPortStats *self,
+                            gsize        n_bytes)
+{
+    self->n_bytes_in += n_bytes;
+}
+
+void
+mm_port_stats_add_bytes_out (MMPortStats *self,
+                             gsize        n_bytes)
+{
+    self->n_bytes_out += n_bytes;
+}
+
+void
+mm_port_stats_add_timeout (MMPortStats *self)
+{
+    self->n_timeouts++;
+}
+
+void
+mm_port_stats_add_cache_hit (MMPortStats *self)
+{
+    self->n_cache_hits++;
+}
+
+guint
+mm_port_stats_get_latency_bucket (gint64 latency_us)
+{
+    guint64 latency_ms;
+    guint   bucket;
+
+    if (latency_us < 1000)
+        return 0;
+
+    latency_ms = (guint64) latency_us / 1000;
+    for (bucket = 1; latency_ms > 1 && bucket < MM_PORT_STATS_N_BUCKETS - 1; bucket++)
+        latency_ms >>= 1;
+    return bucket;
+}
+
+void
+mm_port_stats_build_at_key (const guint8 *command,
+                            gsize         len,
+                            gchar         key[MM_PORT_STATS_KEY_SIZE])
+{
+    gsize i;
+
+    if (len < 2 || g_ascii_toupper (command[0]) != 'A' || g_ascii_toupper (command[1]) != 'T') {
+        g_strlcpy (key, RAW_KEY, MM_PORT_STATS_KEY_SIZE);
+        return;
+    }
+
+    key[0] = 'A';
+    key[1] = 'T';
+    i = 2;
+
+    if (i < len && command[i] != '\0' && strchr ("+^$&%*", command[i])) {
+        /* Extended command: its name may include digits, e.g. AT*E2NAP */
+        key[i] = command[i];
+        for (i++; i < len && i < MM_PORT_STATS_KEY_SIZE - 1 && g_ascii_isalnum (command[i]); i++)
+            key[i] = g_ascii_toupper (command[i]);
+    } else if (i < len && g_ascii_isalpha (command[i])) {
+        /* Basic command: a single letter, so that any dial string (which may
+         * include letters, e.g. ATDT or ATDP) is accounted as ATD */
+        key[i] = g_ascii_toupper (command[i]);
+        i++;
+    }
+
+    key[i] = '\0';
+}
+
+void
+mm_port_stats_add_commands (MMPortStats *self,
+                            guint        n_commands)
+{
+    self->n_commands += n_commands;
+}
+
+void
+mm_port_stats_add_reply (MMPortStats *self,
+                         const gchar *key,
+                         gint64       latency_us)
+{
+    CommandStats *command;
+
+    command = g_hash_table_lookup (self->commands, key);
+    if (!command) {
+        if (g_hash_table_size (self->commands) >= MAX_KEYS)
+            key = OTHER_KEY;
+        command = g_hash_table_lookup (self->commands, key);
+        if (!command) {
+            command = g_slice_new0 (CommandStats);
+            g_hash_table_insert (self->commands, g_strdup (key), command);
+        }
+    }
+
+    command->buckets[mm_port_stats_get_latency_bucket (latency_us)]++;
+}
+
+/*****************************************************************************/
+
+guint64
+mm_port_stats_get_n_commands (MMPortStats *self)
+{
+    return self->n_commands;
+}
+
+guint64
+mm_port_stats_get_n_bytes_in (MMPortStats *self)
+{
+    return self->n_bytes_in;
+}
+
+guint64
+mm_port_stats_get_n_bytes_out (MMPortStats *self)
+{
+    return self->n_bytes_out;
+}
+
+guint64
+mm_port_stats_get_n_timeouts (MMPortStats *self)
+{
+    return self->n_timeouts;
+}
+
+guint64
+mm_port_stats_get_n_cache_hits (MMPortStats *self)
+{
+    return self->n_cache_hits;
+}
+
+GVariant *
+mm_port_stats_get_dictionary (MMPortStats *self,
+                              const gchar *port_name)
+{
+    GVariantBuilder  builder;
+    GVariantBuilder  latencies;
+    GHashTableIter   iter;
+    const gchar     *key;
+    CommandStats    *command;
+
+    g_variant_builder_init (&latencies, G_VARIANT_TYPE ("a(sau)"));
+    g_hash_table_iter_init (&iter, self->commands);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &command)) {
+        GVariantBuilder buckets;
+        guint           i;
+
+        g_variant_builder_init (&buckets, G_VARIANT_TYPE ("au"));
+        for (i = 0; i < MM_PORT_STATS_N_BUCKETS; i++)
+            g_variant_builder_add (&buckets, "u", command->buckets[i]);
+        g_variant_builder_add (&latencies, "(sau)", key, &buckets);
+    }
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+    g_variant_builder_add (&builder, "{sv}", "port",       g_variant_new_string (port_name));
+    g_variant_builder_add (&builder, "{sv}", "commands",   g_variant_new_uint64 (self->n_commands));
+    g_variant_builder_add (&builder, "{sv}", "bytes-in",   g_variant_new_uint64 (self->n_bytes_in));
+    g_variant_builder_add (&builder, "{sv}", "bytes-out",  g_variant_new_uint64 (self->n_bytes_out));
+    g_variant_builder_add (&builder, "{sv}", "timeouts",   g_variant_new_uint64 (self->n_timeouts));
+    g_variant_builder_add (&builder, "{sv}", "cache-hits", g_variant_new_uint64 (self->n_cache_hits));
+    g_variant_builder_add (&builder, "{sv}", "latencies",  g_variant_builder_end (&latencies));
+    return g_variant_builder_end (&builder);
+}
+
+/*****************************************************************************/
+
+static void
+command_stats_free (CommandStats *command)
+{
+    g_slice_free (CommandStats, command);
+}
+
+MMPortStats *
+mm_port_stats_new (void)
+{
+    MMPortStats *self;
+
+    self = g_slice_new0 (MMPortStats);
+    self->commands = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) command_stats_free);
+    return self;
+}
+
+void
+mm_port_stats_free (MMPortStats *self)
+{
+    g_hash_table_unref (self->commands);
+    g_slice_free (MMPortStats, self);
+}
@@ -0,0 +1,70 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_PORT_STATS_H
+#define MM_PORT_STATS_H
+
+#include <glib.h>
+
+/* Lightweight traffic statistics kept by each port.
+ *
+ * Besides the global counters, replies are grouped by a short key of the
+ * command they belong to (e.g. the AT command name), and their latency is
+ * accounted in a histogram with log2 buckets: bucket 0 holds replies received in less than
+ * 1ms, and bucket N (N > 0) those received in [2^(N-1), 2^N) ms; the last
+ * bucket holds all the ones above.
+ */
+
+#define MM_PORT_STATS_N_BUCKETS 16
+
+/* Size of the buffer used to build command keys, including the NUL byte */
+#define MM_PORT_STATS_KEY_SIZE  32
+
+typedef struct _MMPortStats MMPortStats;
+
+MMPortStats *mm_port_stats_new  (void);
+void         mm_port_stats_free (MMPortStats *self);
+
+void     mm_port_stats_add_bytes_in     (MMPortStats *self,
+                                         gsize        n_bytes);
+void     mm_port_stats_add_bytes_out    (MMPortStats *self,
+                                         gsize        n_bytes);
+void     mm_port_stats_add_timeout      (MMPortStats *self);
+void     mm_port_stats_add_cache_hit    (MMPortStats *self);
+void     mm_port_stats_add_commands     (MMPortStats *self,
+                                         guint        n_commands);
+void     mm_port_stats_add_reply        (MMPortStats *self,
+                                         const gchar *key,
+                                         gint64       latency_us);
+
+guint    mm_port_stats_get_latency_bucket (gint64 latency_us);
+
+/* Builds the key of an AT command: the command name only, e.g. "ATD" or
+ * "AT+CMGS", so that no argument (dialed number, PDU...) ever ends up in
+ * the statistics. Anything not starting with "AT" is accounted as "raw". */
+void     mm_port_stats_build_at_key     (const guint8 *command,
+                                         gsize         len,
+                                         gchar         key[MM_PORT_STATS_KEY_SIZE]);
+
+guint64  mm_port_stats_get_n_commands   (MMPortStats *self);
+guint64  mm_port_stats_get_n_bytes_in   (MMPortStats *self);
+guint64  mm_port_stats_get_n_bytes_out  (MMPortStats *self);
+guint64  mm_port_stats_get_n_timeouts   (MMPortStats *self);
+guint64  mm_port_stats_get_n_cache_hits (MMPortStats *self);
+
+/* Returns a floating a{sv} dictionary, as exported in the
+ * org.freedesktop.ModemManager1.Modem.GetPortStatistics() method */
+GVariant *mm_port_stats_get_dictionary (MMPortStats *self,
+                                        const gchar *port_name);
+
+#endif /* MM_PORT_STATS_H */
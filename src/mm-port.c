@@ -39,6 +39,7 @@ struct _MMPortPrivate {
     MMPortType ptype;
     gboolean connected;
     MMKernelDevice *kernel_device;
+    MMPortStats *stats;
 };
 
 /*****************************************************************************/
@@ -103,12 +104,21 @@ mm_port_peek_kernel_device (MMPort *self)
     return self->priv->kernel_device;
 }
 
+MMPortStats *
+mm_port_peek_stats (MMPort *self)
+{
+    g_return_val_if_fail (MM_IS_PORT (self), NULL);
+
+    return self->priv->stats;
+}
+
 /*****************************************************************************/
 
 static void
 mm_port_init (MMPort *self)
 {
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, MM_TYPE_PORT, MMPortPrivate);
+    self->priv->stats = mm_port_stats_new ();
 }
 
 static void
@@ -180,6 +190,7 @@ finalize (GObject *object)
     MMPort *self = MM_PORT (object);
 
     g_free (self->priv->device);
+    mm_port_stats_free (self->priv->stats);
 
     G_OBJECT_CLASS (mm_port_parent_class)->finalize (object);
 }
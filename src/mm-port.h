@@ -21,6 +21,7 @@
 #include <glib-object.h>
 
 #include "mm-kernel-device.h"
+#include "mm-port-stats.h"
 
 typedef enum { /*< underscore_name=mm_port_subsys >*/
     MM_PORT_SUBSYS_UNKNOWN = 0x0,
@@ -79,5 +80,6 @@ MMPortType      mm_port_get_port_type      (MMPort *self);
 gboolean        mm_port_get_connected      (MMPort *self);
 void            mm_port_set_connected      (MMPort *self, gboolean connected);
 MMKernelDevice *mm_port_peek_kernel_device (MMPort *self);
+MMPortStats    *mm_port_peek_stats         (MMPort *self);
 
 #endif /* MM_PORT_H */
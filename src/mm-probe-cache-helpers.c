@@ -0,0 +1,157 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "mm-probe-cache-helpers.h"
+#include "mm-log.h"
+
+/*****************************************************************************/
+
+gchar *
+mm_probe_cache_build_device_group (const gchar *uid,
+                                   guint16      vid,
+                                   guint16      pid)
+{
+    g_return_val_if_fail (uid != NULL, NULL);
+
+    return g_strdup_printf ("device %04x:%04x %s", vid, pid, uid);
+}
+
+/* Port names are not stable across re-enumerations, so the USB interface
+ * number is given whenever available. The subsystem is needed as e.g. the
+ * cdc-wdm and wwan net ports share the same interface. */
+gchar *
+mm_probe_cache_build_port_group (const gchar *uid,
+                                 guint16      vid,
+                                 guint16      pid,
+                                 const gchar *subsystem,
+                                 const gchar *iface)
+{
+    g_return_val_if_fail (uid != NULL, NULL);
+    g_return_val_if_fail (subsystem != NULL, NULL);
+    g_return_val_if_fail (iface != NULL, NULL);
+
+    return g_strdup_printf ("port %04x:%04x %s %s %s", vid, pid, uid, subsystem, iface);
+}
+
+/*****************************************************************************/
+
+GKeyFile *
+mm_probe_cache_load (const gchar  *path,
+                     GError      **error)
+{
+    GKeyFile *cache;
+    GError   *inner_error = NULL;
+
+    cache = g_key_file_new ();
+    if (g_key_file_load_from_file (cache, path, G_KEY_FILE_NONE, &inner_error))
+        return cache;
+
+    /* Don't keep whatever was parsed before the error */
+    g_key_file_unref (cache);
+    cache = g_key_file_new ();
+
+    if (g_error_matches (inner_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_error_free (inner_error);
+    else
+        g_propagate_error (error, inner_error);
+    return cache;
+}
+
+gboolean
+mm_probe_cache_save (GKeyFile     *cache,
+                     const gchar  *path,
+                     GError      **error)
+{
+    gchar    *data;
+    gsize     len;
+    gboolean  saved;
+
+    data = g_key_file_to_data (cache, &len, NULL);
+    saved = g_file_set_contents (path, data, len, error);
+    g_free (data);
+    return saved;
+}
+
+/*****************************************************************************/
+
+void
+mm_probe_cache_remove_device (GKeyFile    *cache,
+                              const gchar *uid,
+                              guint16      vid,
+                              guint16      pid)
+{
+    gchar  *group;
+    gchar  *port_prefix;
+    gchar **groups;
+    guint   i;
+
+    group = mm_probe_cache_build_device_group (uid, vid, pid);
+    g_key_file_remove_group (cache, group, NULL);
+    g_free (group);
+
+    port_prefix = g_strdup_printf ("port %04x:%04x %s ", vid, pid, uid);
+    groups = g_key_file_get_groups (cache, NULL);
+    for (i = 0; groups[i]; i++) {
+        if (g_str_has_prefix (groups[i], port_prefix))
+            g_key_file_remove_group (cache, groups[i], NULL);
+    }
+    g_strfreev (groups);
+    g_free (port_prefix);
+}
+
+MMProbeCacheRevision
+mm_probe_cache_check_revision (GKeyFile    *cache,
+                               const gchar *uid,
+                               guint16      vid,
+                               guint16      pid,
+                               const gchar *plugin_name,
+                               const gchar *revision)
+{
+    MMProbeCacheRevision  result = MM_PROBE_CACHE_REVISION_UNCHANGED;
+    gchar                *group;
+    gchar                *cached_plugin;
+    gchar                *cached_revision;
+
+    group = mm_probe_cache_build_device_group (uid, vid, pid);
+    if (!g_key_file_has_group (cache, group)) {
+        g_free (group);
+        return MM_PROBE_CACHE_REVISION_UNCHANGED;
+    }
+
+    cached_plugin = g_key_file_get_string (cache, group, MM_PROBE_CACHE_DEVICE_KEY_PLUGIN, NULL);
+    cached_revision = g_key_file_get_string (cache, group, MM_PROBE_CACHE_DEVICE_KEY_REVISION, NULL);
+
+    if (g_strcmp0 (cached_plugin, plugin_name) != 0) {
+        /* Results were stored by a different plugin, not ours to validate */
+    } else if (!cached_revision) {
+        if (revision) {
+            g_key_file_set_string (cache, group, MM_PROBE_CACHE_DEVICE_KEY_REVISION, revision);
+            result = MM_PROBE_CACHE_REVISION_STORED;
+        }
+    } else if (g_strcmp0 (cached_revision, revision) != 0) {
+        /* Firmware changed, so port layout and plugin choice may have changed as
+         * well; the device will be fully probed the next time it's exposed */
+        mm_info ("Firmware revision of device '%s' changed ('%s' -> '%s'): dropping cached probing results",
+                 uid, cached_revision, revision ? revision : "unknown");
+        mm_probe_cache_remove_device (cache, uid, vid, pid);
+        result = MM_PROBE_CACHE_REVISION_CHANGED;
+    }
+
+    g_free (cached_revision);
+    g_free (cached_plugin);
+    g_free (group);
+    return result;
+}
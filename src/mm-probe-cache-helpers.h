@@ -0,0 +1,74 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_PROBE_CACHE_HELPERS_H
+#define MM_PROBE_CACHE_HELPERS_H
+
+#include <glib.h>
+
+/* Key file layout of the probe cache, independent of the daemon objects so
+ * that it can be unit tested */
+
+#define MM_PROBE_CACHE_DEVICE_KEY_PLUGIN   "plugin"
+#define MM_PROBE_CACHE_DEVICE_KEY_REVISION "revision"
+#define MM_PROBE_CACHE_DEVICE_KEY_N_PORTS  "ports"
+
+#define MM_PROBE_CACHE_PORT_KEY_PROBED  "probed"
+#define MM_PROBE_CACHE_PORT_KEY_AT      "at"
+#define MM_PROBE_CACHE_PORT_KEY_VENDOR  "vendor"
+#define MM_PROBE_CACHE_PORT_KEY_PRODUCT "product"
+#define MM_PROBE_CACHE_PORT_KEY_ICERA   "icera"
+#define MM_PROBE_CACHE_PORT_KEY_XMM     "xmm"
+#define MM_PROBE_CACHE_PORT_KEY_QCDM    "qcdm"
+#define MM_PROBE_CACHE_PORT_KEY_QMI     "qmi"
+#define MM_PROBE_CACHE_PORT_KEY_MBIM    "mbim"
+
+gchar *mm_probe_cache_build_device_group (const gchar *uid,
+                                          guint16      vid,
+                                          guint16      pid);
+gchar *mm_probe_cache_build_port_group   (const gchar *uid,
+                                          guint16      vid,
+                                          guint16      pid,
+                                          const gchar *subsystem,
+                                          const gchar *iface);
+
+/* A missing file is not an error and gives an empty cache; on any other error
+ * the returned cache is empty as well */
+GKeyFile *mm_probe_cache_load (const gchar  *path,
+                               GError      **error);
+gboolean  mm_probe_cache_save (GKeyFile     *cache,
+                               const gchar  *path,
+                               GError      **error);
+
+/* Removes the device group and all the port groups of the device */
+void mm_probe_cache_remove_device (GKeyFile    *cache,
+                                   const gchar *uid,
+                                   guint16      vid,
+                                   guint16      pid);
+
+typedef enum {
+    MM_PROBE_CACHE_REVISION_UNCHANGED,
+    MM_PROBE_CACHE_REVISION_STORED,
+    MM_PROBE_CACHE_REVISION_CHANGED,
+} MMProbeCacheRevision;
+
+/* Stores the revision if none was cached yet, or drops the device if it
+ * changed. Devices stored by a different plugin are left untouched. */
+MMProbeCacheRevision mm_probe_cache_check_revision (GKeyFile    *cache,
+                                                    const gchar *uid,
+                                                    guint16      vid,
+                                                    guint16      pid,
+                                                    const gchar *plugin_name,
+                                                    const gchar *revision);
+
+#endif /* MM_PROBE_CACHE_HELPERS_H */
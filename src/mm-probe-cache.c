@@ -0,0 +1,330 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include <ModemManager.h>
+#define _LIBMM_INSIDE_MM
+#include <libmm-glib.h>
+
+#include "mm-probe-cache.h"
+#include "mm-probe-cache-helpers.h"
+#include "mm-log.h"
+
+static gchar    *cache_path;
+static GKeyFile *cache;
+
+/*****************************************************************************/
+
+static gchar *
+build_device_group_for_port (MMKernelDevice *port)
+{
+    const gchar *uid;
+
+    uid = mm_kernel_device_get_physdev_uid (port);
+    if (!uid)
+        return NULL;
+
+    return mm_probe_cache_build_device_group (uid,
+                                              mm_kernel_device_get_physdev_vid (port),
+                                              mm_kernel_device_get_physdev_pid (port));
+}
+
+static gchar *
+build_port_group (MMKernelDevice *port)
+{
+    const gchar *uid;
+    const gchar *iface;
+
+    uid = mm_kernel_device_get_physdev_uid (port);
+    if (!uid)
+        return NULL;
+
+    /* Ports without a USB interface number are not cached: their kernel
+     * name may be given to a different port on the next enumeration, and
+     * the results of one would then be applied to the other */
+    iface = mm_kernel_device_get_property (port, "ID_USB_INTERFACE_NUM");
+    if (!iface)
+        return NULL;
+
+    return mm_probe_cache_build_port_group (uid,
+                                            mm_kernel_device_get_physdev_vid (port),
+                                            mm_kernel_device_get_physdev_pid (port),
+                                            mm_kernel_device_get_subsystem (port),
+                                            iface);
+}
+
+static void
+cache_save (void)
+{
+    GError *error = NULL;
+
+    if (!mm_probe_cache_save (cache, cache_path, &error)) {
+        mm_warn ("Couldn't write probe cache to '%s': %s", cache_path, error->message);
+        g_error_free (error);
+    }
+}
+
+/*****************************************************************************/
+
+gchar *
+mm_probe_cache_get_plugin (MMKernelDevice *port)
+{
+    gchar *group;
+    gchar *plugin;
+
+    if (!cache)
+        return NULL;
+
+    group = build_device_group_for_port (port);
+    if (!group)
+        return NULL;
+
+    plugin = g_key_file_get_string (cache, group, MM_PROBE_CACHE_DEVICE_KEY_PLUGIN, NULL);
+    g_free (group);
+    return plugin;
+}
+
+guint
+mm_probe_cache_get_n_ports (MMKernelDevice *port)
+{
+    gchar *group;
+    gint   n_ports;
+
+    if (!cache)
+        return 0;
+
+    group = build_device_group_for_port (port);
+    if (!group)
+        return 0;
+
+    n_ports = g_key_file_get_integer (cache, group, MM_PROBE_CACHE_DEVICE_KEY_N_PORTS, NULL);
+    g_free (group);
+    return (guint) MAX (n_ports, 0);
+}
+
+gboolean
+mm_probe_cache_load_probe (MMPortProbe     *probe,
+                           const gchar     *plugin_name,
+                           MMPortProbeFlag  flags)
+{
+    MMKernelDevice  *port;
+    MMPortProbeFlag  probed;
+    gchar           *plugin;
+    gchar           *group;
+    gchar           *str;
+    gboolean         matches;
+
+    if (!cache)
+        return FALSE;
+
+    port = mm_port_probe_peek_port (probe);
+
+    /* Only the plugin which ended up handling the device may rely on the
+     * cached results, any other one must probe as usual */
+    plugin = mm_probe_cache_get_plugin (port);
+    matches = !g_strcmp0 (plugin, plugin_name);
+    g_free (plugin);
+    if (!matches)
+        return FALSE;
+
+    group = build_port_group (port);
+    if (!group)
+        return FALSE;
+
+    probed = (MMPortProbeFlag) g_key_file_get_integer (cache, group, MM_PROBE_CACHE_PORT_KEY_PROBED, NULL);
+    if ((probed & flags) != flags) {
+        g_free (group);
+        return FALSE;
+    }
+
+    mm_dbg ("(%s/%s) loading port probing results from cache",
+            mm_kernel_device_get_subsystem (port),
+            mm_kernel_device_get_name (port));
+
+    /* Same order as the probing sequence, so that each result only
+     * overrides what the previous ones didn't set */
+    if (probed & MM_PORT_PROBE_AT)
+        mm_port_probe_set_result_at (probe, g_key_file_get_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_AT, NULL));
+    if (probed & MM_PORT_PROBE_AT_VENDOR) {
+        str = g_key_file_get_string (cache, group, MM_PROBE_CACHE_PORT_KEY_VENDOR, NULL);
+        mm_port_probe_set_result_at_vendor (probe, str);
+        g_free (str);
+    }
+    if (probed & MM_PORT_PROBE_AT_PRODUCT) {
+        str = g_key_file_get_string (cache, group, MM_PROBE_CACHE_PORT_KEY_PRODUCT, NULL);
+        mm_port_probe_set_result_at_product (probe, str);
+        g_free (str);
+    }
+    if (probed & MM_PORT_PROBE_AT_ICERA)
+        mm_port_probe_set_result_at_icera (probe, g_key_file_get_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_ICERA, NULL));
+    if (probed & MM_PORT_PROBE_AT_XMM)
+        mm_port_probe_set_result_at_xmm (probe, g_key_file_get_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_XMM, NULL));
+    if (probed & MM_PORT_PROBE_QCDM)
+        mm_port_probe_set_result_qcdm (probe, g_key_file_get_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_QCDM, NULL));
+    if (probed & MM_PORT_PROBE_QMI)
+        mm_port_probe_set_result_qmi (probe, g_key_file_get_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_QMI, NULL));
+    if (probed & MM_PORT_PROBE_MBIM)
+        mm_port_probe_set_result_mbim (probe, g_key_file_get_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_MBIM, NULL));
+
+    g_free (group);
+    return TRUE;
+}
+
+/*****************************************************************************/
+
+static void
+store_probe (MMPortProbe *probe)
+{
+    MMPortProbeFlag  probed;
+    gchar           *group;
+
+    probed = mm_port_probe_get_probed_flags (probe);
+    if (probed == MM_PORT_PROBE_NONE)
+        return;
+
+    group = build_port_group (mm_port_probe_peek_port (probe));
+    if (!group)
+        return;
+
+    g_key_file_remove_group (cache, group, NULL);
+    g_key_file_set_integer (cache, group, MM_PROBE_CACHE_PORT_KEY_PROBED, (gint) probed);
+    if (probed & MM_PORT_PROBE_AT)
+        g_key_file_set_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_AT, mm_port_probe_is_at (probe));
+    if ((probed & MM_PORT_PROBE_AT_VENDOR) && mm_port_probe_get_vendor (probe))
+        g_key_file_set_string (cache, group, MM_PROBE_CACHE_PORT_KEY_VENDOR, mm_port_probe_get_vendor (probe));
+    if ((probed & MM_PORT_PROBE_AT_PRODUCT) && mm_port_probe_get_product (probe))
+        g_key_file_set_string (cache, group, MM_PROBE_CACHE_PORT_KEY_PRODUCT, mm_port_probe_get_product (probe));
+    if (probed & MM_PORT_PROBE_AT_ICERA)
+        g_key_file_set_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_ICERA, mm_port_probe_is_icera (probe));
+    if (probed & MM_PORT_PROBE_AT_XMM)
+        g_key_file_set_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_XMM, mm_port_probe_is_xmm (probe));
+    if (probed & MM_PORT_PROBE_QCDM)
+        g_key_file_set_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_QCDM, mm_port_probe_is_qcdm (probe));
+    if (probed & MM_PORT_PROBE_QMI)
+        g_key_file_set_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_QMI, mm_port_probe_is_qmi (probe));
+    if (probed & MM_PORT_PROBE_MBIM)
+        g_key_file_set_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_MBIM, mm_port_probe_is_mbim (probe));
+    g_free (group);
+}
+
+void
+mm_probe_cache_store_device (MMDevice    *device,
+                             const gchar *plugin_name)
+{
+    const gchar *uid;
+    guint16      vid;
+    guint16      pid;
+    gchar       *group;
+    gchar       *revision;
+    gchar       *previous;
+    gchar       *current;
+    GList       *probes;
+    GList       *l;
+
+    if (!cache || mm_device_is_virtual (device))
+        return;
+
+    uid = mm_device_get_uid (device);
+    vid = mm_device_get_vendor (device);
+    pid = mm_device_get_product (device);
+    probes = mm_device_peek_port_probe_list (device);
+    if (!uid || !probes)
+        return;
+
+    previous = g_key_file_to_data (cache, NULL, NULL);
+
+    /* The revision is only kept if the device keeps on being handled by the
+     * same plugin, otherwise it needs to be validated again */
+    group = mm_probe_cache_build_device_group (uid, vid, pid);
+    revision = g_key_file_get_string (cache, group, MM_PROBE_CACHE_DEVICE_KEY_REVISION, NULL);
+    if (revision) {
+        gchar *plugin;
+
+        plugin = g_key_file_get_string (cache, group, MM_PROBE_CACHE_DEVICE_KEY_PLUGIN, NULL);
+        if (g_strcmp0 (plugin, plugin_name) != 0) {
+            g_free (revision);
+            revision = NULL;
+        }
+        g_free (plugin);
+    }
+
+    mm_probe_cache_remove_device (cache, uid, vid, pid);
+    g_key_file_set_string (cache, group, MM_PROBE_CACHE_DEVICE_KEY_PLUGIN, plugin_name);
+    g_key_file_set_integer (cache, group, MM_PROBE_CACHE_DEVICE_KEY_N_PORTS, (gint) g_list_length (probes));
+    if (revision)
+        g_key_file_set_string (cache, group, MM_PROBE_CACHE_DEVICE_KEY_REVISION, revision);
+    for (l = probes; l; l = g_list_next (l))
+        store_probe (MM_PORT_PROBE (l->data));
+
+    /* Avoid rewriting the file when the results didn't change, which is the
+     * usual case for already known devices */
+    current = g_key_file_to_data (cache, NULL, NULL);
+    if (g_strcmp0 (previous, current) != 0) {
+        mm_dbg ("Storing probing results of device '%s' in cache (plugin '%s')", uid, plugin_name);
+        cache_save ();
+    }
+
+    g_free (current);
+    g_free (previous);
+    g_free (revision);
+    g_free (group);
+}
+
+void
+mm_probe_cache_validate_revision (const gchar *uid,
+                                  guint16      vid,
+                                  guint16      pid,
+                                  const gchar *plugin_name,
+                                  const gchar *revision)
+{
+    if (!cache || !uid)
+        return;
+
+    if (mm_probe_cache_check_revision (cache, uid, vid, pid, plugin_name, revision) != MM_PROBE_CACHE_REVISION_UNCHANGED)
+        cache_save ();
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_probe_cache_is_enabled (void)
+{
+    return !!cache;
+}
+
+void
+mm_probe_cache_init (const gchar *path)
+{
+    GError *error = NULL;
+
+    g_assert (!cache);
+
+    cache_path = g_strdup (path);
+    cache = mm_probe_cache_load (cache_path, &error);
+    if (error) {
+        mm_warn ("Couldn't load probe cache from '%s': %s", cache_path, error->message);
+        g_error_free (error);
+        return;
+    }
+
+    mm_dbg ("Probe cache loaded from '%s'", cache_path);
+}
+
+void
+mm_probe_cache_shutdown (void)
+{
+    g_clear_pointer (&cache, g_key_file_unref);
+    g_clear_pointer (&cache_path, g_free);
+}
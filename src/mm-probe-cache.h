@@ -0,0 +1,52 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_PROBE_CACHE_H
+#define MM_PROBE_CACHE_H
+
+#include <glib.h>
+
+#include "mm-kernel-device.h"
+#include "mm-device.h"
+#include "mm-port-probe.h"
+
+/* Optional persistent cache of port probing results.
+ *
+ * Devices are identified by VID/PID and physical device UID, ports by
+ * subsystem and USB interface number. The cache stores the probing results
+ * of each port and the plugin that ended up handling the device, so that a
+ * known device doesn't need to be probed again after a reboot or a USB
+ * re-enumeration. The firmware revision reported by the modem is stored
+ * afterwards, and the entry is discarded if the revision ever changes. */
+
+void         mm_probe_cache_init       (const gchar *path);
+void         mm_probe_cache_shutdown   (void);
+gboolean     mm_probe_cache_is_enabled (void);
+
+/* Lookups, by any of the kernel ports of the device */
+gchar   *mm_probe_cache_get_plugin  (MMKernelDevice *port);
+guint    mm_probe_cache_get_n_ports (MMKernelDevice *port);
+gboolean mm_probe_cache_load_probe  (MMPortProbe     *probe,
+                                     const gchar     *plugin_name,
+                                     MMPortProbeFlag  flags);
+
+/* Updates */
+void mm_probe_cache_store_device     (MMDevice    *device,
+                                      const gchar *plugin_name);
+void mm_probe_cache_validate_revision (const gchar *uid,
+                                       guint16      vid,
+                                       guint16      pid,
+                                       const gchar *plugin_name,
+                                       const gchar *revision);
+
+#endif /* MM_PROBE_CACHE_H */
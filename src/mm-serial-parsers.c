@@ -50,50 +50,356 @@ response_clean (GString *response)
 }
 
 
+/*****************************************************************************/
+/* Final result code scanner
+ *
+ * The builtin final result codes are all detected in a single pass over the
+ * response, instead of matching one regex after the other. The rules follow
+ * exactly the ones of the regexes originally used:
+ *
+ *   OK:                  "\r\nOK(\r\n)+$"
+ *   CONNECT:             "\r\nCONNECT.*\r\n"
+ *   SMS prompt:          "\r\n>\s*$"
+ *   +CME ERROR:          "\r\n\+CME ERROR:\s*(\d+)\r\n$"
+ *   +CMS ERROR:          "\r\n\+CMS ERROR:\s*(\d+)\r\n$"
+ *   +CME ERROR (string): "\r\n\+CME ERROR:\s*([^\n\r]+)\r\n$"
+ *   +CMS ERROR (string): "\r\n\+CMS ERROR:\s*([^\n\r]+)\r\n$"
+ *   MODEM ERROR:         "\r\nMODEM ERROR:\s*(\d+)\r\n$"
+ *   Unknown error:       "\r\n(ERROR)|(COMMAND NOT SUPPORT)\r\n$"
+ *   Connection failed:   "\r\n(NO CARRIER)|(BUSY)|(NO ANSWER)|(NO DIALTONE)\r\n$"
+ *   NA:                  "\r\nNA\r\n"
+ *
+ * Note that some of them are not anchored to the end of the response, so the
+ * whole response needs to be scanned once when there is no successful final
+ * result code at the tail.
+ */
+
+typedef enum {
+    FINAL_RESULT_NONE,
+    FINAL_RESULT_OK,
+    FINAL_RESULT_CONNECT,
+    FINAL_RESULT_SMS_PROMPT,
+} FinalResult;
+
+/* Sorted by priority */
+typedef enum {
+    FINAL_ERROR_NONE,
+    FINAL_ERROR_CME,
+    FINAL_ERROR_CMS,
+    FINAL_ERROR_CME_STR,
+    FINAL_ERROR_CMS_STR,
+    FINAL_ERROR_EZX,
+    FINAL_ERROR_UNKNOWN,
+    FINAL_ERROR_CONNECT_FAILED,
+    FINAL_ERROR_NA,
+} FinalError;
+
+typedef struct {
+    FinalResult  result;
+    gsize        ok_start;
+    FinalError   error;
+    /* Error code or string, not NUL-terminated */
+    const gchar *error_value;
+    gsize        error_value_len;
+} FinalResultScan;
+
+#define CME_ERROR_PREFIX   "+CME ERROR:"
+#define CMS_ERROR_PREFIX   "+CMS ERROR:"
+#define EZX_ERROR_PREFIX   "MODEM ERROR:"
+
+#define STR_HAS_PREFIX_AT(str, len, pos, prefix)             \
+    (((len) - (pos)) >= (sizeof (prefix) - 1) &&              \
+     memcmp ((str) + (pos), prefix, sizeof (prefix) - 1) == 0)
+
+#define STR_HAS_SUFFIX(str, len, suffix)                                   \
+    ((len) >= (sizeof (suffix) - 1) &&                                      \
+     memcmp ((str) + (len) - (sizeof (suffix) - 1), suffix, sizeof (suffix) - 1) == 0)
+
+static inline gboolean
+is_crlf_at (const gchar *str,
+            gsize        len,
+            gsize        pos)
+{
+    return (pos + 1 < len && str[pos] == '\r' && str[pos + 1] == '\n');
+}
+
+/* "\r\nOK(\r\n)+$" */
+static gboolean
+scan_tail_ok (const gchar *str,
+              gsize        len,
+              gsize       *ok_start)
+{
+    gsize end = len;
+
+    while (end >= 2 && str[end - 2] == '\r' && str[end - 1] == '\n')
+        end -= 2;
+
+    if (end == len || end < 4 || memcmp (str + end - 4, "\r\nOK", 4) != 0)
+        return FALSE;
+
+    *ok_start = end - 4;
+    return TRUE;
+}
+
+/* "\r\n>\s*$" */
+static gboolean
+scan_tail_sms_prompt (const gchar *str,
+                      gsize        len)
+{
+    while (len > 0 && g_ascii_isspace (str[len - 1]))
+        len--;
+
+    return STR_HAS_SUFFIX (str, len, "\r\n>");
+}
+
+/* "\r\n<prefix>\s*(\d+)\r\n$" */
+static gboolean
+scan_tail_numeric_error (const gchar  *str,
+                         gsize         len,
+                         const gchar  *prefix,
+                         gsize         prefix_len,
+                         const gchar **value,
+                         gsize        *value_len)
+{
+    gsize end;
+    gsize i;
+
+    if (!STR_HAS_SUFFIX (str, len, "\r\n"))
+        return FALSE;
+
+    end = len - 2;
+    for (i = end; i > 0 && g_ascii_isdigit (str[i - 1]); i--);
+    if (i == end)
+        return FALSE;
+
+    *value = str + i;
+    *value_len = end - i;
+
+    while (i > 0 && g_ascii_isspace (str[i - 1]))
+        i--;
+
+    return (i >= prefix_len + 2 &&
+            is_crlf_at (str, len, i - prefix_len - 2) &&
+            memcmp (str + i - prefix_len, prefix, prefix_len) == 0);
+}
+
+/* "\r\n<prefix>\s*([^\n\r]+)\r\n$" */
 static gboolean
-remove_eval_cb (const GMatchInfo *match_info,
-                GString *result,
-                gpointer user_data)
+scan_tail_string_error (const gchar  *str,
+                        gsize         len,
+                        const gchar  *prefix,
+                        gsize         prefix_len,
+                        const gchar **value,
+                        gsize        *value_len)
 {
-    int *result_len = (int *) user_data;
-    int start;
-    int end;
+    gsize end;
+    gsize line_start;
+    gsize prefix_end;
+    gsize i;
+
+    if (!STR_HAS_SUFFIX (str, len, "\r\n"))
+        return FALSE;
 
-    if (g_match_info_fetch_pos  (match_info, 0, &start, &end))
-        *result_len -= (end - start);
+    /* The captured string is always a suffix of the last line */
+    end = len - 2;
+    for (line_start = end;
+         line_start > 0 && str[line_start - 1] != '\r' && str[line_start - 1] != '\n';
+         line_start--);
+    if (line_start == end)
+        return FALSE;
 
+    /* The leftmost match would be the one where the prefix is given in a
+     * previous line, as whitespaces also include line breaks */
+    for (i = line_start; i > 0 && g_ascii_isspace (str[i - 1]); i--);
+    if (i < line_start &&
+        i >= prefix_len + 2 &&
+        is_crlf_at (str, len, i - prefix_len - 2) &&
+        memcmp (str + i - prefix_len, prefix, prefix_len) == 0)
+        prefix_end = i;
+    else if (line_start >= 2 &&
+             is_crlf_at (str, len, line_start - 2) &&
+             line_start + prefix_len < end &&
+             memcmp (str + line_start, prefix, prefix_len) == 0)
+        prefix_end = line_start + prefix_len;
+    else
+        return FALSE;
+
+    /* Skip leading whitespaces, but leave at least one char to capture */
+    for (i = prefix_end; i < end - 1 && g_ascii_isspace (str[i]); i++);
+
+    *value = str + i;
+    *value_len = end - i;
     return TRUE;
 }
 
+/* "\r\nCONNECT.*\r\n", given the line contents between 'start' and 'end' */
+static gboolean
+is_connect_line (const gchar *str,
+                 gsize        len,
+                 gsize        start,
+                 gsize        end)
+{
+    return (start >= 2 &&
+            is_crlf_at (str, len, start - 2) &&
+            (end - start) >= strlen ("CONNECT") &&
+            memcmp (str + start, "CONNECT", strlen ("CONNECT")) == 0);
+}
+
+/* The longest token not anchored to the end of the response which may be
+ * matched in the single pass, including the leading <CR><LF>, i.e.
+ * "\r\nNO CARRIER" */
+#define MAX_UNANCHORED_TOKEN_LEN 12
+
 static void
-remove_matches (GRegex *r, GString *string)
+final_result_scan (const gchar     *str,
+                   gsize            len,
+                   gsize            scanned,
+                   FinalResultScan *scan)
 {
-    char *str;
-    int result_len = string->len;
+    gboolean unknown_error = FALSE;
+    gboolean connect_failed = FALSE;
+    gboolean na = FALSE;
+    gsize    line_start = G_MAXSIZE;
+    gsize    i;
+
+    memset (scan, 0, sizeof (FinalResultScan));
+
+    /* Successful replies ending the response need no full scan */
+    if (scan_tail_ok (str, len, &scan->ok_start)) {
+        scan->result = FINAL_RESULT_OK;
+        return;
+    }
 
-    str = g_regex_replace_eval (r, string->str, string->len, 0, 0,
-                                remove_eval_cb, &result_len, NULL);
+    if (scan_tail_sms_prompt (str, len)) {
+        scan->result = FINAL_RESULT_SMS_PROMPT;
+        return;
+    }
+
+    /* Single pass over the response, looking for the final result codes which
+     * are not anchored to the end of the response. If the leading 'scanned'
+     * bytes were already given in a previous call without any final result
+     * code found, there cannot be any full token in there, so we only need to
+     * look again at the ones which may have been cut. */
+    i = MIN (scanned, len);
+    i = (i > MAX_UNANCHORED_TOKEN_LEN ? i - MAX_UNANCHORED_TOKEN_LEN : 0);
+    for (; i < len; i++) {
+        switch (str[i]) {
+        case '\r':
+            if (is_crlf_at (str, len, i)) {
+                /* End of line; the start of the line is looked for only once,
+                 * as it may have been received long ago */
+                if (line_start == G_MAXSIZE)
+                    for (line_start = i;
+                         line_start > 0 && str[line_start - 1] != '\r' && str[line_start - 1] != '\n';
+                         line_start--);
+                if (is_connect_line (str, len, line_start, i)) {
+                    scan->result = FINAL_RESULT_CONNECT;
+                    return;
+                }
+
+                /* Start of line */
+                if (STR_HAS_PREFIX_AT (str, len, i + 2, "ERROR"))
+                    unknown_error = TRUE;
+                else if (STR_HAS_PREFIX_AT (str, len, i + 2, "NO CARRIER"))
+                    connect_failed = TRUE;
+                else if (STR_HAS_PREFIX_AT (str, len, i + 2, "NA\r\n"))
+                    na = TRUE;
+            }
+            line_start = i + 1;
+            break;
+        case '\n':
+            line_start = i + 1;
+            break;
+        case 'B':
+            connect_failed = connect_failed || STR_HAS_PREFIX_AT (str, len, i, "BUSY");
+            break;
+        case 'N':
+            connect_failed = connect_failed || STR_HAS_PREFIX_AT (str, len, i, "NO ANSWER");
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (scan_tail_numeric_error (str, len,
+                                 CME_ERROR_PREFIX, strlen (CME_ERROR_PREFIX),
+                                 &scan->error_value, &scan->error_value_len))
+        scan->error = FINAL_ERROR_CME;
+    else if (scan_tail_numeric_error (str, len,
+                                      CMS_ERROR_PREFIX, strlen (CMS_ERROR_PREFIX),
+                                      &scan->error_value, &scan->error_value_len))
+        scan->error = FINAL_ERROR_CMS;
+    else if (scan_tail_string_error (str, len,
+                                     CME_ERROR_PREFIX, strlen (CME_ERROR_PREFIX),
+                                     &scan->error_value, &scan->error_value_len))
+        scan->error = FINAL_ERROR_CME_STR;
+    else if (scan_tail_string_error (str, len,
+                                     CMS_ERROR_PREFIX, strlen (CMS_ERROR_PREFIX),
+                                     &scan->error_value, &scan->error_value_len))
+        scan->error = FINAL_ERROR_CMS_STR;
+    else if (scan_tail_numeric_error (str, len,
+                                      EZX_ERROR_PREFIX, strlen (EZX_ERROR_PREFIX),
+                                      &scan->error_value, &scan->error_value_len))
+        scan->error = FINAL_ERROR_EZX;
+    else if (unknown_error || STR_HAS_SUFFIX (str, len, "COMMAND NOT SUPPORT\r\n"))
+        scan->error = FINAL_ERROR_UNKNOWN;
+    else if (connect_failed || STR_HAS_SUFFIX (str, len, "NO DIALTONE\r\n"))
+        scan->error = FINAL_ERROR_CONNECT_FAILED;
+    else if (na)
+        scan->error = FINAL_ERROR_NA;
+}
+
+static GError *
+final_result_scan_build_error (const FinalResultScan *scan)
+{
+    GError *error = NULL;
+    gchar  *value;
+
+    value = g_strndup (scan->error_value, scan->error_value_len);
+
+    switch (scan->error) {
+    case FINAL_ERROR_CME:
+        error = mm_mobile_equipment_error_for_code (atoi (value));
+        break;
+    case FINAL_ERROR_CMS:
+        error = mm_message_error_for_code (atoi (value));
+        break;
+    case FINAL_ERROR_CME_STR:
+        error = mm_mobile_equipment_error_for_string (value);
+        break;
+    case FINAL_ERROR_CMS_STR:
+        error = mm_message_error_for_string (value);
+        break;
+    case FINAL_ERROR_EZX:
+    case FINAL_ERROR_UNKNOWN:
+        error = mm_mobile_equipment_error_for_code (MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN);
+        break;
+    case FINAL_ERROR_CONNECT_FAILED:
+        /* Only the NO CARRIER alternative was ever captured by the original
+         * regex, so all connection failures end up reported as NO CARRIER */
+        error = mm_connection_error_for_code (MM_CONNECTION_ERROR_NO_CARRIER);
+        break;
+    case FINAL_ERROR_NA:
+        /* Assume NA means 'Not Allowed' :) */
+        error = g_error_new (MM_MOBILE_EQUIPMENT_ERROR,
+                             MM_MOBILE_EQUIPMENT_ERROR_NOT_ALLOWED,
+                             "Not Allowed");
+        break;
+    case FINAL_ERROR_NONE:
+    default:
+        g_assert_not_reached ();
+    }
 
-    g_string_truncate (string, 0);
-    g_string_append_len (string, str, result_len);
-    g_free (str);
+    g_free (value);
+    return error;
 }
 
+/*****************************************************************************/
+
 typedef struct {
-    /* Regular expressions for successful replies */
-    GRegex *regex_ok;
-    GRegex *regex_connect;
-    GRegex *regex_sms;
+    /* Regular expressions for custom successful replies */
     GRegex *regex_custom_successful;
-    /* Regular expressions for error replies */
-    GRegex *regex_cme_error;
-    GRegex *regex_cms_error;
-    GRegex *regex_cme_error_str;
-    GRegex *regex_cms_error_str;
-    GRegex *regex_ezx_error;
-    GRegex *regex_unknown_error;
-    GRegex *regex_connect_failed;
-    GRegex *regex_na;
+    /* Regular expressions for custom error replies */
     GRegex *regex_custom_error;
     /* User-provided parser filter */
     mm_serial_parser_v1_filter_fn filter_callback;
@@ -104,23 +410,9 @@ gpointer
 mm_serial_parser_v1_new (void)
 {
     MMSerialParserV1 *parser;
-    GRegexCompileFlags flags = G_REGEX_DOLLAR_ENDONLY | G_REGEX_RAW | G_REGEX_OPTIMIZE;
 
     parser = g_slice_new (MMSerialParserV1);
 
-    parser->regex_ok = g_regex_new ("\\r\\nOK(\\r\\n)+$", flags, 0, NULL);
-    parser->regex_connect = g_regex_new ("\\r\\nCONNECT.*\\r\\n", flags, 0, NULL);
-    parser->regex_sms = g_regex_new ("\\r\\n>\\s*$", flags, 0, NULL);
-    parser->regex_cme_error = g_regex_new ("\\r\\n\\+CME ERROR:\\s*(\\d+)\\r\\n$", flags, 0, NULL);
-    parser->regex_cms_error = g_regex_new ("\\r\\n\\+CMS ERROR:\\s*(\\d+)\\r\\n$", flags, 0, NULL);
-    parser->regex_cme_error_str = g_regex_new ("\\r\\n\\+CME ERROR:\\s*([^\\n\\r]+)\\r\\n$", flags, 0, NULL);
-    parser->regex_cms_error_str = g_regex_new ("\\r\\n\\+CMS ERROR:\\s*([^\\n\\r]+)\\r\\n$", flags, 0, NULL);
-    parser->regex_ezx_error = g_regex_new ("\\r\\n\\MODEM ERROR:\\s*(\\d+)\\r\\n$", flags, 0, NULL);
-    parser->regex_unknown_error = g_regex_new ("\\r\\n(ERROR)|(COMMAND NOT SUPPORT)\\r\\n$", flags, 0, NULL);
-    parser->regex_connect_failed = g_regex_new ("\\r\\n(NO CARRIER)|(BUSY)|(NO ANSWER)|(NO DIALTONE)\\r\\n$", flags, 0, NULL);
-    /* Samsung Z810 may reply "NA" to report a not-available error */
-    parser->regex_na = g_regex_new ("\\r\\nNA\\r\\n", flags, 0, NULL);
-
     parser->regex_custom_successful = NULL;
     parser->regex_custom_error = NULL;
     parser->filter_callback = NULL;
@@ -163,20 +455,23 @@ mm_serial_parser_v1_add_filter (gpointer data,
 gboolean
 mm_serial_parser_v1_parse (gpointer data,
                            GString *response,
+                           gsize scanned,
                            GError **error)
 {
     MMSerialParserV1 *parser = (MMSerialParserV1 *) data;
-    GMatchInfo *match_info;
+    FinalResultScan scan;
     GError *local_error = NULL;
     gboolean found = FALSE;
-    char *str = NULL;
 
     g_return_val_if_fail (parser != NULL, FALSE);
     g_return_val_if_fail (response != NULL, FALSE);
 
     /* Skip NUL bytes if they are found leading the response */
-    while (response->len > 0 && response->str[0] == '\0')
+    while (response->len > 0 && response->str[0] == '\0') {
         g_string_erase (response, 0, 1);
+        if (scanned > 0)
+            scanned--;
+    }
 
     if (G_UNLIKELY (!response->len))
         return FALSE;
@@ -201,29 +496,18 @@ mm_serial_parser_v1_parse (gpointer data,
         found = g_regex_match_full (parser->regex_custom_successful,
                                     response->str, response->len,
                                     0, 0, NULL, NULL);
+        if (found) {
+            response_clean (response);
+            return TRUE;
+        }
     }
 
-    if (!found) {
-        found = g_regex_match_full (parser->regex_ok,
-                                    response->str, response->len,
-                                    0, 0, NULL, NULL);
-        if (found)
-            remove_matches (parser->regex_ok, response);
-    }
-
-    if (!found) {
-        found = g_regex_match_full (parser->regex_connect,
-                                    response->str, response->len,
-                                    0, 0, NULL, NULL);
-    }
-
-    if (!found) {
-        found = g_regex_match_full (parser->regex_sms,
-                                    response->str, response->len,
-                                    0, 0, NULL, NULL);
-    }
+    final_result_scan (response->str, response->len, scanned, &scan);
 
-    if (found) {
+    if (scan.result != FINAL_RESULT_NONE) {
+        /* The trailing OK is not part of the response */
+        if (scan.result == FINAL_RESULT_OK)
+            g_string_truncate (response, scan.ok_start);
         response_clean (response);
         return TRUE;
     }
@@ -232,131 +516,27 @@ mm_serial_parser_v1_parse (gpointer data,
 
     /* Custom error matches first, if any */
     if (parser->regex_custom_error) {
+        GMatchInfo *match_info = NULL;
+
         found = g_regex_match_full (parser->regex_custom_error,
                                     response->str, response->len,
                                     0, 0, &match_info, NULL);
         if (found) {
+            gchar *str;
+
             str = g_match_info_fetch (match_info, 1);
             g_assert (str);
             local_error = mm_mobile_equipment_error_for_code (atoi (str));
-            goto done;
+            g_free (str);
         }
         g_match_info_free (match_info);
     }
 
-    /* Numeric CME errors */
-    found = g_regex_match_full (parser->regex_cme_error,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
-        local_error = mm_mobile_equipment_error_for_code (atoi (str));
-        goto done;
-    }
-    g_match_info_free (match_info);
-
-    /* Numeric CMS errors */
-    found = g_regex_match_full (parser->regex_cms_error,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
-        local_error = mm_message_error_for_code (atoi (str));
-        goto done;
-    }
-    g_match_info_free (match_info);
-
-    /* String CME errors */
-    found = g_regex_match_full (parser->regex_cme_error_str,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
-        local_error = mm_mobile_equipment_error_for_string (str);
-        goto done;
+    if (!found && scan.error != FINAL_ERROR_NONE) {
+        found = TRUE;
+        local_error = final_result_scan_build_error (&scan);
     }
-    g_match_info_free (match_info);
-
-    /* String CMS errors */
-    found = g_regex_match_full (parser->regex_cms_error_str,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
-        local_error = mm_message_error_for_string (str);
-        goto done;
-    }
-    g_match_info_free (match_info);
-
-    /* Motorola EZX errors */
-    found = g_regex_match_full (parser->regex_ezx_error,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
-        local_error = mm_mobile_equipment_error_for_code (MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN);
-        goto done;
-    }
-    g_match_info_free (match_info);
-
-    /* Last resort; unknown error */
-    found = g_regex_match_full (parser->regex_unknown_error,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        local_error = mm_mobile_equipment_error_for_code (MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN);
-        goto done;
-    }
-    g_match_info_free (match_info);
-
-    /* Connection failures */
-    found = g_regex_match_full (parser->regex_connect_failed,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        MMConnectionError code;
-
-        str = g_match_info_fetch (match_info, 1);
-        g_assert (str);
-
-        if (!strcmp (str, "NO CARRIER"))
-            code = MM_CONNECTION_ERROR_NO_CARRIER;
-        else if (!strcmp (str, "BUSY"))
-            code = MM_CONNECTION_ERROR_BUSY;
-        else if (!strcmp (str, "NO ANSWER"))
-            code = MM_CONNECTION_ERROR_NO_ANSWER;
-        else if (!strcmp (str, "NO DIALTONE"))
-            code = MM_CONNECTION_ERROR_NO_DIALTONE;
-        else {
-            /* uhm... make something up (yes, ok, lie!). */
-            code = MM_CONNECTION_ERROR_NO_CARRIER;
-        }
-
-        local_error = mm_connection_error_for_code (code);
-        goto done;
-    }
-    g_match_info_free (match_info);
 
-    /* NA error */
-    found = g_regex_match_full (parser->regex_na,
-                                response->str, response->len,
-                                0, 0, &match_info, NULL);
-    if (found) {
-        /* Assume NA means 'Not Allowed' :) */
-        local_error = g_error_new (MM_MOBILE_EQUIPMENT_ERROR,
-                                   MM_MOBILE_EQUIPMENT_ERROR_NOT_ALLOWED,
-                                   "Not Allowed");
-        goto done;
-    }
-
-done:
-    g_free (str);
-    g_match_info_free (match_info);
     if (found)
         response_clean (response);
 
@@ -385,18 +565,6 @@ mm_serial_parser_v1_destroy (gpointer data)
 
     g_return_if_fail (parser != NULL);
 
-    g_regex_unref (parser->regex_ok);
-    g_regex_unref (parser->regex_connect);
-    g_regex_unref (parser->regex_sms);
-    g_regex_unref (parser->regex_cme_error);
-    g_regex_unref (parser->regex_cms_error);
-    g_regex_unref (parser->regex_cme_error_str);
-    g_regex_unref (parser->regex_cms_error_str);
-    g_regex_unref (parser->regex_ezx_error);
-    g_regex_unref (parser->regex_unknown_error);
-    g_regex_unref (parser->regex_connect_failed);
-    g_regex_unref (parser->regex_na);
-
     if (parser->regex_custom_successful)
         g_regex_unref (parser->regex_custom_successful);
     if (parser->regex_custom_error)
@@ -15,9 +15,24 @@
 
 #include <config.h>
 #include <string.h>
+#include <stdlib.h>
+#include <pty.h>
+#include <unistd.h>
+#include <termios.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
 #include <glib.h>
+#include <gio/gio.h>
+
+#include <ModemManager.h>
+#include <mm-errors-types.h>
 
 #include "mm-port-serial-at.h"
+#include "mm-serial-parsers.h"
+#include "mm-error-helpers.h"
 #include "mm-log.h"
 
 typedef struct {
@@ -64,6 +79,1101 @@ at_serial_echo_removal (void)
     }
 }
 
+/*****************************************************************************/
+/* Serial parser v1
+ *
+ * The reference parser is the regex-based one originally used in the v1
+ * parser, kept here to validate that the final result code scanner classifies
+ * all responses in exactly the same way.
+ */
+
+typedef struct {
+    GRegex *regex_ok;
+    GRegex *regex_connect;
+    GRegex *regex_sms;
+    GRegex *regex_cme_error;
+    GRegex *regex_cms_error;
+    GRegex *regex_cme_error_str;
+    GRegex *regex_cms_error_str;
+    GRegex *regex_ezx_error;
+    GRegex *regex_unknown_error;
+    GRegex *regex_connect_failed;
+    GRegex *regex_na;
+} ReferenceParser;
+
+static void
+reference_parser_init (ReferenceParser *parser)
+{
+    GRegexCompileFlags flags = G_REGEX_DOLLAR_ENDONLY | G_REGEX_RAW | G_REGEX_OPTIMIZE;
+
+    parser->regex_ok = g_regex_new ("\\r\\nOK(\\r\\n)+$", flags, 0, NULL);
+    parser->regex_connect = g_regex_new ("\\r\\nCONNECT.*\\r\\n", flags, 0, NULL);
+    parser->regex_sms = g_regex_new ("\\r\\n>\\s*$", flags, 0, NULL);
+    parser->regex_cme_error = g_regex_new ("\\r\\n\\+CME ERROR:\\s*(\\d+)\\r\\n$", flags, 0, NULL);
+    parser->regex_cms_error = g_regex_new ("\\r\\n\\+CMS ERROR:\\s*(\\d+)\\r\\n$", flags, 0, NULL);
+    parser->regex_cme_error_str = g_regex_new ("\\r\\n\\+CME ERROR:\\s*([^\\n\\r]+)\\r\\n$", flags, 0, NULL);
+    parser->regex_cms_error_str = g_regex_new ("\\r\\n\\+CMS ERROR:\\s*([^\\n\\r]+)\\r\\n$", flags, 0, NULL);
+    parser->regex_ezx_error = g_regex_new ("\\r\\n\\MODEM ERROR:\\s*(\\d+)\\r\\n$", flags, 0, NULL);
+    parser->regex_unknown_error = g_regex_new ("\\r\\n(ERROR)|(COMMAND NOT SUPPORT)\\r\\n$", flags, 0, NULL);
+    parser->regex_connect_failed = g_regex_new ("\\r\\n(NO CARRIER)|(BUSY)|(NO ANSWER)|(NO DIALTONE)\\r\\n$", flags, 0, NULL);
+    parser->regex_na = g_regex_new ("\\r\\nNA\\r\\n", flags, 0, NULL);
+}
+
+static void
+reference_parser_clear (ReferenceParser *parser)
+{
+    g_regex_unref (parser->regex_ok);
+    g_regex_unref (parser->regex_connect);
+    g_regex_unref (parser->regex_sms);
+    g_regex_unref (parser->regex_cme_error);
+    g_regex_unref (parser->regex_cms_error);
+    g_regex_unref (parser->regex_cme_error_str);
+    g_regex_unref (parser->regex_cms_error_str);
+    g_regex_unref (parser->regex_ezx_error);
+    g_regex_unref (parser->regex_unknown_error);
+    g_regex_unref (parser->regex_connect_failed);
+    g_regex_unref (parser->regex_na);
+}
+
+static void
+reference_response_clean (GString *response)
+{
+    char *s;
+
+    s = response->str + response->len - 1;
+    while ((s > response->str) && (*s == '\n') && (*(s - 1) == '\r')) {
+        g_string_truncate (response, response->len - 2);
+        s -= 2;
+    }
+
+    s = response->str;
+    while ((response->len >= 2) && (*s == '\r') && (*(s + 1) == '\r')) {
+        g_string_erase (response, 0, 1);
+        s = response->str;
+    }
+
+    s = response->str;
+    while ((response->len >= 2) && (*s == '\r') && (*(s + 1) == '\n')) {
+        g_string_erase (response, 0, 2);
+        s = response->str;
+    }
+}
+
+static gboolean
+reference_match (GRegex      *regex,
+                 GString      *response,
+                 gchar       **str)
+{
+    GMatchInfo *match_info = NULL;
+    gboolean    found;
+
+    found = g_regex_match_full (regex, response->str, response->len, 0, 0, &match_info, NULL);
+    if (found && str)
+        *str = g_match_info_fetch (match_info, 1);
+    g_match_info_free (match_info);
+    return found;
+}
+
+static gboolean
+reference_parser_parse (ReferenceParser  *parser,
+                        GString          *response,
+                        GError          **error)
+{
+    GError *local_error = NULL;
+    gchar  *str = NULL;
+
+    while (response->len > 0 && response->str[0] == '\0')
+        g_string_erase (response, 0, 1);
+
+    if (!response->len)
+        return FALSE;
+
+    if (reference_match (parser->regex_ok, response, NULL)) {
+        gchar *cleaned;
+
+        cleaned = g_regex_replace_literal (parser->regex_ok, response->str, response->len, 0, "", 0, NULL);
+        g_string_assign (response, cleaned);
+        g_free (cleaned);
+        reference_response_clean (response);
+        return TRUE;
+    }
+
+    if (reference_match (parser->regex_connect, response, NULL) ||
+        reference_match (parser->regex_sms, response, NULL)) {
+        reference_response_clean (response);
+        return TRUE;
+    }
+
+    if (reference_match (parser->regex_cme_error, response, &str))
+        local_error = mm_mobile_equipment_error_for_code (atoi (str));
+    else if (reference_match (parser->regex_cms_error, response, &str))
+        local_error = mm_message_error_for_code (atoi (str));
+    else if (reference_match (parser->regex_cme_error_str, response, &str))
+        local_error = mm_mobile_equipment_error_for_string (str);
+    else if (reference_match (parser->regex_cms_error_str, response, &str))
+        local_error = mm_message_error_for_string (str);
+    else if (reference_match (parser->regex_ezx_error, response, NULL) ||
+             reference_match (parser->regex_unknown_error, response, NULL))
+        local_error = mm_mobile_equipment_error_for_code (MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN);
+    else if (reference_match (parser->regex_connect_failed, response, &str)) {
+        if (!strcmp (str, "NO CARRIER"))
+            local_error = mm_connection_error_for_code (MM_CONNECTION_ERROR_NO_CARRIER);
+        else if (!strcmp (str, "BUSY"))
+            local_error = mm_connection_error_for_code (MM_CONNECTION_ERROR_BUSY);
+        else if (!strcmp (str, "NO ANSWER"))
+            local_error = mm_connection_error_for_code (MM_CONNECTION_ERROR_NO_ANSWER);
+        else if (!strcmp (str, "NO DIALTONE"))
+            local_error = mm_connection_error_for_code (MM_CONNECTION_ERROR_NO_DIALTONE);
+        else
+            local_error = mm_connection_error_for_code (MM_CONNECTION_ERROR_NO_CARRIER);
+    } else if (reference_match (parser->regex_na, response, NULL))
+        local_error = g_error_new (MM_MOBILE_EQUIPMENT_ERROR,
+                                   MM_MOBILE_EQUIPMENT_ERROR_NOT_ALLOWED,
+                                   "Not Allowed");
+    g_free (str);
+
+    if (!local_error)
+        return FALSE;
+
+    reference_response_clean (response);
+    g_propagate_error (error, local_error);
+    return TRUE;
+}
+
+static const gchar *parser_responses[] = {
+    /* Successful responses */
+    "\r\nOK\r\n",
+    "\r\nOK\r\n\r\n",
+    "AT\r\r\nOK\r\n",
+    "\r\n+CGMI: Generic\r\n\r\nOK\r\n",
+    "\r\n+CREG: 2,1,\"1F3C\",\"4C2C4F\",2\r\n\r\nOK\r\n",
+    "\r\n+CEREG: 2,1,\"1F3C\",\"01A4F10C\",7\r\n\r\nOK\r\n",
+    "\r\n+COPS: (2,\"T - Mobile\",\"T - Mobile\",\"31026\",0),(1,\"AT&T\",\"AT&T\",\"310410\",0),,(0,1,3),(0,2)\r\n\r\nOK\r\n",
+    "\r\n+CGDCONT: 1,\"IP\",\"internet\",\"\",0,0\r\n+CGDCONT: 2,\"IPV4V6\",\"ims\",\"\",0,0\r\n\r\nOK\r\n",
+    "\r\n+CPMS: (\"ME\",\"MT\",\"SM\",\"SR\"),(\"ME\",\"MT\",\"SM\"),(\"ME\",\"MT\",\"SM\")\r\n\r\nOK\r\n",
+    "\r\n+CIND: (\"battchg\",(0-5)),(\"signal\",(0-5)),(\"service\",(0,1))\r\n\r\nOK\r\n",
+    "\r\n+CMGL: 0,1,,23\r\n0791947122723033040C919471027402690000211041220240000AC834FD0D0AB3D365F90C\r\n\r\nOK\r\n",
+    "\r\n+CLCC: 1,1,4,0,0,\"123456789\",161\r\n\r\nOK\r\n",
+    "\r\nNO CARRIER IS NOT AN ERROR HERE\r\n\r\nOK\r\n",
+    "\r\nERROR\r\n\r\nOK\r\n",
+    "\r\nCONNECT\r\n",
+    "\r\nCONNECT 115200\r\n",
+    "\r\nCONNECT 115200\r\n\r\n+CME ERROR: 3\r\n",
+    "\r\n> ",
+    "\r\n>",
+    "\r\n> \r\n",
+    /* Error responses */
+    "\r\nERROR\r\n",
+    "\r\n+CME ERROR: 10\r\n",
+    "\r\n+CME ERROR:10\r\n",
+    "\r\n+CME ERROR: SIM not inserted\r\n",
+    "\r\n+CME ERROR:  SIM PIN required\r\n",
+    "\r\n+CME ERROR: \r\n",
+    "\r\n+CME ERROR:\r\n13\r\n",
+    "\r\n+CMS ERROR: 303\r\n",
+    "\r\n+CMS ERROR: operation not supported\r\n",
+    "\r\nMODEM ERROR: 4\r\n",
+    "\r\nCOMMAND NOT SUPPORT\r\n",
+    "\r\nNO CARRIER\r\n",
+    "\r\nBUSY\r\n",
+    "\r\nNO ANSWER\r\n",
+    "\r\nNO DIALTONE\r\n",
+    "\r\nNA\r\n",
+    "\r\n+CPIN: SIM PIN\r\n\r\nNA\r\n",
+    /* Incomplete responses */
+    "\r\n",
+    "\r\nO",
+    "\r\nOK",
+    "\r\nOK\r",
+    "\r\n+CSQ: 20,99\r\n",
+    "\r\n+COPS: (2,\"NO ANSWER network\"",
+    "\r\n+CMGL: 0,1,,23\r\n0791947122723033040C",
+    "\r\n+CME ERROR: 10",
+    "+CME ERROR: 10\r\n",
+    "OK\r\n",
+};
+
+static gboolean
+test_parser_compare (ReferenceParser *reference,
+                     gpointer         parser,
+                     const gchar     *str,
+                     gsize            len,
+                     gsize            scanned)
+{
+    GString  *expected;
+    GString  *response;
+    GError   *expected_error = NULL;
+    GError   *error = NULL;
+    gboolean  expected_found;
+    gboolean  found;
+
+    expected = g_string_new_len (str, len);
+    response = g_string_new_len (str, len);
+
+    expected_found = reference_parser_parse (reference, expected, &expected_error);
+    found = mm_serial_parser_v1_parse (parser, response, scanned, &error);
+
+    g_assert_cmpint (found, ==, expected_found);
+    g_assert_cmpuint (response->len, ==, expected->len);
+    g_assert (memcmp (response->str, expected->str, expected->len) == 0);
+    if (expected_error) {
+        g_assert (error);
+        g_assert_cmpuint (error->domain, ==, expected_error->domain);
+        g_assert_cmpint  (error->code,   ==, expected_error->code);
+        g_assert_cmpstr  (error->message, ==, expected_error->message);
+    } else
+        g_assert_no_error (error);
+
+    g_clear_error (&expected_error);
+    g_clear_error (&error);
+    g_string_free (expected, TRUE);
+    g_string_free (response, TRUE);
+
+    return found;
+}
+
+static void
+at_serial_parser_v1 (void)
+{
+    ReferenceParser reference;
+    gpointer        parser;
+    guint           i;
+
+    reference_parser_init (&reference);
+    parser = mm_serial_parser_v1_new ();
+
+    for (i = 0; i < G_N_ELEMENTS (parser_responses); i++) {
+        gsize len;
+        gsize j;
+
+        /* Validate also every partial read of the response */
+        len = strlen (parser_responses[i]);
+        for (j = 1; j <= len; j++)
+            test_parser_compare (&reference, parser, parser_responses[i], j, 0);
+    }
+
+    mm_serial_parser_v1_destroy (parser);
+    reference_parser_clear (&reference);
+}
+
+static void
+at_serial_parser_v1_incremental (void)
+{
+    static const gsize chunk_sizes[] = { 1, 2, 3, 7, 16 };
+    ReferenceParser    reference;
+    gpointer           parser;
+    guint              i;
+    guint              k;
+
+    reference_parser_init (&reference);
+    parser = mm_serial_parser_v1_new ();
+
+    /* Feed the responses in chunks, as read from the port, telling the parser
+     * which bytes were already scanned in the previous reads */
+    for (i = 0; i < G_N_ELEMENTS (parser_responses); i++) {
+        for (k = 0; k < G_N_ELEMENTS (chunk_sizes); k++) {
+            gsize len;
+            gsize scanned = 0;
+
+            len = strlen (parser_responses[i]);
+            while (scanned < len) {
+                gsize available;
+
+                available = MIN (scanned + chunk_sizes[k], len);
+                if (test_parser_compare (&reference, parser, parser_responses[i], available, scanned))
+                    break;
+                scanned = available;
+            }
+        }
+    }
+
+    mm_serial_parser_v1_destroy (parser);
+    reference_parser_clear (&reference);
+}
+
+/*****************************************************************************/
+
+typedef struct {
+    const gchar *reply;
+    const gchar *parsed;
+    gint         error_code;
+} PipelinedReply;
+
+static const PipelinedReply pipelined_replies[] = {
+    { "\r\nGeneric\r\n\r\nOK\r\n",       "Generic", 0 },
+    { "AT+CGMM\r\r\nModel X\r\n\r\nOK\r\n", "Model X", 0 },
+    { "\r\n+CME ERROR: 10\r\n",             NULL,      MM_MOBILE_EQUIPMENT_ERROR_SIM_NOT_INSERTED },
+    { "\r\nOK\r\n",                        "",        0 },
+    { "\r\n+CGSN: 123456789012345\r\n\r\nOK\r\n", "+CGSN: 123456789012345", 0 },
+};
+
+static void
+at_serial_pipelined_response (void)
+{
+    static const gsize chunk_sizes[] = { 1, 2, 5, 16, 1024 };
+    gpointer           parser;
+    GString           *all;
+    guint              i;
+    guint              k;
+
+    parser = mm_serial_parser_v1_new ();
+
+    all = g_string_new ("");
+    for (i = 0; i < G_N_ELEMENTS (pipelined_replies); i++)
+        g_string_append (all, pipelined_replies[i].reply);
+
+    /* Feed the replies to all the commands in chunks, as read from the port;
+     * each one must be given on its own, in order */
+    for (k = 0; k < G_N_ELEMENTS (chunk_sizes); k++) {
+        GByteArray *response;
+        gsize       fed = 0;
+        gsize       scanned = 0;
+
+        response = g_byte_array_new ();
+        i = 0;
+        while (fed < all->len) {
+            gsize available;
+
+            available = MIN (chunk_sizes[k], all->len - fed);
+            g_byte_array_append (response, (const guint8 *) &all->str[fed], available);
+            fed += available;
+
+            while (i < G_N_ELEMENTS (pipelined_replies)) {
+                GString *parsed = NULL;
+                GError  *error = NULL;
+                gsize    used = 0;
+                guint    removed;
+
+                removed = response->len;
+                mm_port_serial_at_remove_echo (response);
+                removed -= response->len;
+                scanned = (scanned > removed ? scanned - removed : 0);
+                if (!mm_port_serial_at_parse_pipelined_response (response,
+                                                                 scanned,
+                                                                 mm_serial_parser_v1_parse,
+                                                                 parser,
+                                                                 &used,
+                                                                 &parsed,
+                                                                 &error)) {
+                    scanned = response->len;
+                    break;
+                }
+                g_assert_cmpuint (used, >, 0);
+                g_byte_array_remove_range (response, 0, used);
+
+                if (pipelined_replies[i].parsed) {
+                    g_assert_no_error (error);
+                    g_assert (parsed);
+                    g_assert_cmpstr (parsed->str, ==, pipelined_replies[i].parsed);
+                    g_string_free (parsed, TRUE);
+                } else {
+                    g_assert_error (error, MM_MOBILE_EQUIPMENT_ERROR, pipelined_replies[i].error_code);
+                    g_assert (!parsed);
+                    g_error_free (error);
+                }
+                scanned = 0;
+                i++;
+            }
+        }
+
+        g_assert_cmpuint (i, ==, G_N_ELEMENTS (pipelined_replies));
+        g_assert_cmpuint (response->len, ==, 0);
+        g_byte_array_unref (response);
+    }
+
+    g_string_free (all, TRUE);
+    mm_serial_parser_v1_destroy (parser);
+}
+
+/*****************************************************************************/
+
+static const gchar *urc_patterns[] = {
+    "\\r\\n\\+CREG:\\s*(\\d)\\r\\n",
+    "\\r\\n\\+CREG:\\s*(\\d),(\\d+)\\r\\n",
+    "\\r\\n\\^RSSI:\\s*(\\d+)\\r\\n",
+    "\\r\\n\\^RSSILVL:\\s*(\\d+)\\r+\\n",
+    "\\r\\n(\\^NDISSTAT:.+)\\r+\\n",
+    "\\r\\n\\^MODE:\\s*(\\d*),?(\\d*)\\r+\\n",
+    "\\r\\n\\+CMTI:\\s*\"(\\S+)\",(\\d+)\\r\\n",
+    "\\r\\nRING\\r\\n",
+    "\\r\\n\\+CRING:\\s*(.*)\\r\\n",
+    "\\+CIEV: (\\d+),(\\d)",
+    "\\r\\n\\+CUSATEND\\r\\n",
+    "(\\r\\n)?\\+CGEV:\\s*(.*)\\r\\n",
+};
+
+static const gchar *urc_fragments[] = {
+    "\r\n", "\r", "\n", "\r\n+CREG: 1\r\n", "\r\n+CREG: 1,2\r\n", "+CREG: 5\r\n",
+    "\r\n^RSSI: 17\r\n", "\r\n^RSSILVL: 3\r\r\n", "\r\n^NDISSTAT: 1,,,\"IPV4\"\r\n",
+    "\r\n^MODE: 5,4\r\n", "\r\n+CMTI: \"SM\",3\r\n", "\r\nRING\r\n", "\r\nRINGING\r\n",
+    "\r\n+CRING: VOICE\r\n", "+CIEV: 2,1", "\r\n+CUSATEND\r\n", "\r\n+CUSATENDED\r\n",
+    "+CGEV: ME DETACH\r\n", "\r\nOK\r\n", "+CREG", ": 2\r\n", "^RSSI", "AT+CREG?",
+    "\r\n+CSQ: 20,99\r\n", "x",
+};
+
+static GString *urc_log;
+
+static void
+urc_log_cb (MMPortSerialAt *port,
+            GMatchInfo     *match_info,
+            gpointer        user_data)
+{
+    gchar *str;
+
+    str = g_match_info_fetch (match_info, 0);
+    g_string_append_printf (urc_log, "%u:%s|", GPOINTER_TO_UINT (user_data), str);
+    g_free (str);
+}
+
+static gboolean
+reference_remove_eval_cb (const GMatchInfo *match_info,
+                          GString          *result,
+                          gpointer          user_data)
+{
+    gint *result_len = (gint *) user_data;
+    gint  start;
+    gint  end;
+
+    if (g_match_info_fetch_pos (match_info, 0, &start, &end))
+        *result_len -= (end - start);
+    return FALSE;
+}
+
+/* The original handler loop: every regex over the whole buffer */
+static void
+reference_parse_unsolicited (GRegex     **regexes,
+                             GByteArray  *response)
+{
+    gint i;
+
+    /* Handlers are prepended, so the last one added runs first */
+    for (i = G_N_ELEMENTS (urc_patterns) - 1; i >= 0; i--) {
+        GMatchInfo *match_info;
+        gboolean    matches;
+
+        matches = g_regex_match_full (regexes[i], (const gchar *) response->data, response->len, 0, 0, &match_info, NULL);
+        while (g_match_info_matches (match_info)) {
+            urc_log_cb (NULL, match_info, GUINT_TO_POINTER (i));
+            g_match_info_next (match_info, NULL);
+        }
+        g_match_info_free (match_info);
+
+        if (matches) {
+            gchar *str;
+            gint   result_len = response->len;
+
+            str = g_regex_replace_eval (regexes[i], (const gchar *) response->data, response->len, 0, 0,
+                                        reference_remove_eval_cb, &result_len, NULL);
+            g_byte_array_set_size (response, 0);
+            g_byte_array_append (response, (const guint8 *) str, result_len);
+            g_free (str);
+        }
+    }
+}
+
+static void
+at_serial_unsolicited_dispatch (void)
+{
+    MMPortSerialAt *port;
+    GRegex         *regexes[G_N_ELEMENTS (urc_patterns)];
+    GRand          *rand;
+    GString        *expected_log;
+    guint           i;
+
+    port = mm_port_serial_at_new ("ttyFOO", MM_PORT_SUBSYS_TTY);
+    g_object_set (port, MM_PORT_SERIAL_AT_REMOVE_ECHO, FALSE, NULL);
+
+    for (i = 0; i < G_N_ELEMENTS (urc_patterns); i++) {
+        regexes[i] = g_regex_new (urc_patterns[i], G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        g_assert (regexes[i]);
+        mm_port_serial_at_add_unsolicited_msg_handler (port, regexes[i], urc_log_cb, GUINT_TO_POINTER (i), NULL);
+    }
+
+    urc_log = g_string_new ("");
+    expected_log = g_string_new ("");
+    rand = g_rand_new_with_seed (1);
+
+    for (i = 0; i < 20000; i++) {
+        GByteArray *response;
+        GByteArray *expected;
+        guint       n;
+        guint       j;
+
+        response = g_byte_array_new ();
+        n = g_rand_int_range (rand, 1, 8);
+        for (j = 0; j < n; j++) {
+            const gchar *fragment;
+
+            fragment = urc_fragments[g_rand_int_range (rand, 0, G_N_ELEMENTS (urc_fragments))];
+            g_byte_array_append (response, (const guint8 *) fragment, strlen (fragment));
+        }
+        expected = g_byte_array_new ();
+        g_byte_array_append (expected, response->data, response->len);
+
+        g_string_truncate (urc_log, 0);
+        reference_parse_unsolicited (regexes, expected);
+        g_string_assign (expected_log, urc_log->str);
+
+        g_string_truncate (urc_log, 0);
+        MM_PORT_SERIAL_GET_CLASS (port)->parse_unsolicited (MM_PORT_SERIAL (port), response);
+
+        g_assert_cmpstr (urc_log->str, ==, expected_log->str);
+        g_assert_cmpuint (response->len, ==, expected->len);
+        g_assert (memcmp (response->data, expected->data, response->len) == 0);
+
+        g_byte_array_unref (response);
+        g_byte_array_unref (expected);
+    }
+
+    g_rand_free (rand);
+    g_string_free (expected_log, TRUE);
+    g_string_free (urc_log, TRUE);
+    for (i = 0; i < G_N_ELEMENTS (urc_patterns); i++)
+        g_regex_unref (regexes[i]);
+    g_object_unref (port);
+}
+
+/*****************************************************************************/
+/* Tests against a fake modem behind a pty; the port runs in a child process,
+ * and the parent plays the modem */
+
+typedef struct {
+    int master;
+    int slave;
+    gboolean valid;
+    pid_t child;
+} TestData;
+
+static gboolean
+wait_for_child (TestData *d, guint32 timeout)
+{
+    GTimeVal start, now;
+    int status, ret;
+
+    g_get_current_time (&start);
+    do {
+        status = 0;
+        ret = waitpid (d->child, &status, WNOHANG);
+        g_get_current_time (&now);
+        if (d->child && (now.tv_sec - start.tv_sec > timeout)) {
+            /* Kill it */
+            if (g_test_verbose ())
+                g_message ("Killing running child process %d", d->child);
+            kill (d->child, SIGKILL);
+            d->child = 0;
+        }
+        if (ret == 0)
+            sleep (1);
+    } while ((ret <= 0) || (!WIFEXITED (status) && !WIFSIGNALED (status)));
+
+    d->child = 0;
+    return (WIFEXITED (status) && WEXITSTATUS (status) == 0) ? TRUE : FALSE;
+}
+
+/* Reads until @n_commands AT commands are received, and returns all of them */
+static gchar *
+server_wait_commands (int fd, guint n_commands)
+{
+    GString *commands;
+    guint n = 0;
+
+    commands = g_string_new ("");
+    while (n < n_commands) {
+        struct timeval timeout = { 3, 0 };
+        fd_set in;
+        ssize_t bytes_read;
+        char c;
+
+        FD_ZERO (&in);
+        FD_SET (fd, &in);
+        g_assert_cmpint (select (fd + 1, &in, NULL, NULL, &timeout), ==, 1);
+
+        while ((bytes_read = read (fd, &c, 1)) == 1) {
+            g_string_append_c (commands, c);
+            if (c == '\r')
+                n++;
+        }
+        g_assert (bytes_read < 0 && errno == EAGAIN);
+    }
+
+    if (g_test_verbose ()) {
+        gchar *escaped;
+
+        escaped = g_strescape (commands->str, NULL);
+        g_print ("<<< %s\n", escaped);
+        g_free (escaped);
+    }
+
+    return g_string_free (commands, FALSE);
+}
+
+/* Makes sure that no further command is received for a while */
+static void
+server_expect_no_command (int fd)
+{
+    struct timeval timeout = { 0, 300000 };
+    fd_set in;
+
+    FD_ZERO (&in);
+    FD_SET (fd, &in);
+    g_assert_cmpint (select (fd + 1, &in, NULL, NULL, &timeout), ==, 0);
+}
+
+static void
+server_send_reply (int fd, const gchar *reply)
+{
+    gsize len;
+    gsize i = 0;
+
+    if (g_test_verbose ()) {
+        gchar *escaped;
+
+        escaped = g_strescape (reply, NULL);
+        g_print (">>> %s\n", escaped);
+        g_free (escaped);
+    }
+
+    len = strlen (reply);
+    while (i < len) {
+        ssize_t written;
+
+        written = write (fd, &reply[i], len - i);
+        if (written < 0 && errno == EAGAIN) {
+            usleep (1000);
+            continue;
+        }
+        g_assert_cmpint (written, >, 0);
+        i += written;
+    }
+}
+
+typedef enum {
+    EXPECT_REPLY,
+    EXPECT_TIMEOUT,
+    EXPECT_CANCELLED,
+} ExpectedResult;
+
+typedef struct {
+    const gchar *command;
+    /* Only queued once all the previous commands are completed */
+    gboolean queue_later;
+    ExpectedResult result;
+    const gchar *reply;
+    gboolean allow_cached;
+    guint cache_ttl;
+    /* If queued later, how long to wait before */
+    guint delay_ms;
+} ScriptCommand;
+
+typedef void (*ScriptSetupFn) (MMPortSerialAt *port);
+
+typedef struct {
+    MMPortSerialAt *port;
+    GMainLoop *loop;
+    GCancellable *cancellable;
+    const ScriptCommand *commands;
+    guint n_commands;
+    guint n_queued;
+    guint n_completed;
+} ScriptContext;
+
+static void script_queue_commands (ScriptContext *ctx);
+
+static gboolean
+script_cancel_cb (ScriptContext *ctx)
+{
+    g_cancellable_cancel (ctx->cancellable);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean
+script_queue_commands_cb (ScriptContext *ctx)
+{
+    script_queue_commands (ctx);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+script_command_ready (MMPortSerialAt *port,
+                      GAsyncResult *res,
+                      ScriptContext *ctx)
+{
+    const ScriptCommand *command;
+    const gchar *reply;
+    GError *error = NULL;
+
+    /* Commands are always completed in the same order they're queued */
+    g_assert_cmpuint (ctx->n_completed, <, ctx->n_queued);
+    command = &ctx->commands[ctx->n_completed++];
+
+    reply = mm_port_serial_at_command_finish (port, res, &error);
+    switch (command->result) {
+    case EXPECT_REPLY:
+        g_assert_no_error (error);
+        g_assert_cmpstr (reply, ==, command->reply);
+        break;
+    case EXPECT_TIMEOUT:
+        g_assert_error (error, MM_SERIAL_ERROR, MM_SERIAL_ERROR_RESPONSE_TIMEOUT);
+        g_error_free (error);
+        break;
+    case EXPECT_CANCELLED:
+        g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+        g_error_free (error);
+        break;
+    }
+
+    if (ctx->n_completed == ctx->n_commands) {
+        g_main_loop_quit (ctx->loop);
+        return;
+    }
+
+    /* The next command is now the one waiting for a reply; if expected to
+     * get cancelled, do it a bit later */
+    if (ctx->commands[ctx->n_completed].result == EXPECT_CANCELLED)
+        g_timeout_add (100, (GSourceFunc) script_cancel_cb, ctx);
+
+    if (ctx->n_completed < ctx->n_queued)
+        return;
+
+    if (ctx->commands[ctx->n_queued].delay_ms)
+        g_timeout_add (ctx->commands[ctx->n_queued].delay_ms, (GSourceFunc) script_queue_commands_cb, ctx);
+    else
+        script_queue_commands (ctx);
+}
+
+static void
+script_queue_commands (ScriptContext *ctx)
+{
+    do {
+        const ScriptCommand *command = &ctx->commands[ctx->n_queued++];
+
+        mm_port_serial_at_command_full (ctx->port,
+                                        command->command,
+                                        2,
+                                        FALSE,
+                                        command->allow_cached,
+                                        command->cache_ttl,
+                                        (command->result == EXPECT_CANCELLED ? ctx->cancellable : NULL),
+                                        (GAsyncReadyCallback) script_command_ready,
+                                        ctx);
+    } while (ctx->n_queued < ctx->n_commands && !ctx->commands[ctx->n_queued].queue_later);
+}
+
+/* Runs the commands of the script in a port pipelining up to 4 commands, and
+ * checks their results */
+static void
+script_run (int fd, ScriptSetupFn setup, const ScriptCommand *commands, guint n_commands)
+{
+    ScriptContext ctx;
+    gboolean success;
+    GError *error = NULL;
+
+    memset (&ctx, 0, sizeof (ctx));
+    ctx.commands = commands;
+    ctx.n_commands = n_commands;
+    ctx.loop = g_main_loop_new (NULL, FALSE);
+    ctx.cancellable = g_cancellable_new ();
+
+    ctx.port = MM_PORT_SERIAL_AT (g_object_new (MM_TYPE_PORT_SERIAL_AT,
+                                                MM_PORT_DEVICE, "pty",
+                                                MM_PORT_SUBSYS, MM_PORT_SUBSYS_TTY,
+                                                MM_PORT_TYPE, MM_PORT_TYPE_AT,
+                                                MM_PORT_SERIAL_FD, fd,
+                                                MM_PORT_SERIAL_SEND_DELAY, (guint64) 0,
+                                                MM_PORT_SERIAL_PIPELINE_DEPTH, 4,
+                                                MM_PORT_SERIAL_AT_INIT_SEQUENCE_ENABLED, FALSE,
+                                                NULL));
+    mm_port_serial_at_set_response_parser (ctx.port,
+                                           mm_serial_parser_v1_parse,
+                                           mm_serial_parser_v1_new (),
+                                           mm_serial_parser_v1_destroy);
+
+    success = mm_port_serial_open (MM_PORT_SERIAL (ctx.port), &error);
+    g_assert_no_error (error);
+    g_assert (success);
+
+    if (setup)
+        setup (ctx.port);
+
+    script_queue_commands (&ctx);
+    g_main_loop_run (ctx.loop);
+
+    mm_port_serial_close (MM_PORT_SERIAL (ctx.port));
+    g_object_unref (ctx.port);
+    g_object_unref (ctx.cancellable);
+    g_main_loop_unref (ctx.loop);
+}
+
+static void
+script_fork (TestData *d, ScriptSetupFn setup, const ScriptCommand *commands, guint n_commands)
+{
+    pid_t cpid;
+
+    signal (SIGCHLD, SIG_DFL);
+    cpid = fork ();
+    g_assert (cpid >= 0);
+
+    if (cpid == 0) {
+        /* In the child */
+        script_run (d->slave, setup, commands, n_commands);
+        exit (0);
+    }
+
+    /* Parent */
+    d->child = cpid;
+}
+
+static void
+server_expect_commands (int fd, guint n_commands, const gchar *expected)
+{
+    gchar *commands;
+
+    commands = server_wait_commands (fd, n_commands);
+    g_assert_cmpstr (commands, ==, expected);
+    g_free (commands);
+}
+
+static const ScriptCommand pipeline_batch_script[] = {
+    { "+CGMI", FALSE, EXPECT_REPLY, "Vendor" },
+    { "+CGMM", FALSE, EXPECT_REPLY, "Model" },
+    { "+CSQ",  FALSE, EXPECT_REPLY, "+CSQ: 20,99" },
+    { "+CGMR", FALSE, EXPECT_REPLY, "Revision" },
+};
+
+/* Test that the commands safe to pipeline are sent without waiting for the
+ * reply of the previous ones, and that they get their own reply */
+static void
+test_pipeline_batch (TestData *d)
+{
+    script_fork (d, NULL, pipeline_batch_script, G_N_ELEMENTS (pipeline_batch_script));
+
+    /* The first command which isn't safe to pipeline ends the batch */
+    server_expect_commands (d->master, 2, "AT+CGMI\rAT+CGMM\r");
+    server_expect_no_command (d->master);
+    server_send_reply (d->master, "\r\nVendor\r\n\r\nOK\r\n\r\nModel\r\n\r\nOK\r\n");
+
+    server_expect_commands (d->master, 1, "AT+CSQ\r");
+    server_expect_no_command (d->master);
+    server_send_reply (d->master, "\r\n+CSQ: 20,99\r\n\r\nOK\r\n");
+
+    server_expect_commands (d->master, 1, "AT+CGMR\r");
+    server_send_reply (d->master, "\r\nRevision\r\n\r\nOK\r\n");
+
+    /* We expect the child to exit normally */
+    g_assert (wait_for_child (d, 5));
+}
+
+static const ScriptCommand pipeline_timeout_script[] = {
+    { "+CGMI", FALSE, EXPECT_REPLY,   "Vendor" },
+    { "+CGMM", FALSE, EXPECT_TIMEOUT, NULL },
+    { "+CGMR", FALSE, EXPECT_TIMEOUT, NULL },
+    { "+CGSN", TRUE,  EXPECT_REPLY,   "123456789012345" },
+    { "+CGMI", FALSE, EXPECT_REPLY,   "Vendor" },
+};
+
+/* Test that when a pipelined command times out, the other commands of the
+ * batch fail as well without being sent again, and that the following
+ * commands are sent one by one */
+static void
+test_pipeline_timeout (TestData *d)
+{
+    script_fork (d, NULL, pipeline_timeout_script, G_N_ELEMENTS (pipeline_timeout_script));
+
+    server_expect_commands (d->master, 3, "AT+CGMI\rAT+CGMM\rAT+CGMR\r");
+    server_send_reply (d->master, "\r\nVendor\r\n\r\nOK\r\n");
+
+    server_expect_commands (d->master, 1, "AT+CGSN\r");
+    server_expect_no_command (d->master);
+    server_send_reply (d->master, "\r\n123456789012345\r\n\r\nOK\r\n");
+
+    server_expect_commands (d->master, 1, "AT+CGMI\r");
+    server_send_reply (d->master, "\r\nVendor\r\n\r\nOK\r\n");
+
+    /* We expect the child to exit normally */
+    g_assert (wait_for_child (d, 10));
+}
+
+static const ScriptCommand pipeline_cancel_script[] = {
+    { "+CGMI", FALSE, EXPECT_REPLY,     "Vendor" },
+    { "+CGMM", FALSE, EXPECT_CANCELLED, NULL },
+    { "+CGMR", FALSE, EXPECT_REPLY,     "Revision" },
+};
+
+/* Test that the reply of a pipelined command cancelled while waiting for it
+ * is discarded, instead of being given to the next command */
+static void
+test_pipeline_cancel (TestData *d)
+{
+    script_fork (d, NULL, pipeline_cancel_script, G_N_ELEMENTS (pipeline_cancel_script));
+
+    server_expect_commands (d->master, 3, "AT+CGMI\rAT+CGMM\rAT+CGMR\r");
+    server_send_reply (d->master, "\r\nVendor\r\n\r\nOK\r\n");
+
+    /* Let the child cancel the second command before it gets its reply */
+    usleep (500000);
+    server_send_reply (d->master, "\r\nModel\r\n\r\nOK\r\n\r\nRevision\r\n\r\nOK\r\n");
+
+    /* We expect the child to exit normally */
+    g_assert (wait_for_child (d, 5));
+}
+
+static void
+cache_eviction_setup (MMPortSerialAt *port)
+{
+    gchar command[8];
+    gchar reply[16];
+    guint i;
+
+    /* Fill the cache, then update the first entry, so that the second one is
+     * the least recently used when another one is added */
+    for (i = 0; i <= MM_PORT_SERIAL_REPLY_CACHE_MAX_ENTRIES; i++) {
+        if (i == MM_PORT_SERIAL_REPLY_CACHE_MAX_ENTRIES)
+            mm_port_serial_at_set_cached_reply (port, "+C00", "Reply 00");
+        g_snprintf (command, sizeof (command), "+C%02u", i);
+        g_snprintf (reply, sizeof (reply), "Reply %02u", i);
+        mm_port_serial_at_set_cached_reply (port, command, reply);
+    }
+}
+
+static const ScriptCommand cache_eviction_script[] = {
+    { "+C00", FALSE, EXPECT_REPLY, "Reply 00", TRUE },
+    { "+C32", FALSE, EXPECT_REPLY, "Reply 32", TRUE },
+    { "+C01", FALSE, EXPECT_REPLY, "Fresh",    TRUE },
+    { "+C31", FALSE, EXPECT_REPLY, "Reply 31", TRUE },
+};
+
+/* Test that when the cache is full, the least recently used reply is
+ * dropped */
+static void
+test_cache_eviction (TestData *d)
+{
+    g_assert_cmpuint (MM_PORT_SERIAL_REPLY_CACHE_MAX_ENTRIES, ==, 32);
+    script_fork (d, cache_eviction_setup, cache_eviction_script, G_N_ELEMENTS (cache_eviction_script));
+
+    server_expect_commands (d->master, 1, "AT+C01\r");
+    server_send_reply (d->master, "\r\nFresh\r\n\r\nOK\r\n");
+    server_expect_no_command (d->master);
+
+    /* We expect the child to exit normally */
+    g_assert (wait_for_child (d, 5));
+}
+
+static const ScriptCommand cache_expiry_script[] = {
+    { "+CPIN?", FALSE, EXPECT_REPLY, "+CPIN: SIM PIN", TRUE, 1 },
+    { "+CPIN?", TRUE,  EXPECT_REPLY, "+CPIN: SIM PIN", TRUE, 1, 600 },
+    { "+CPIN?", TRUE,  EXPECT_REPLY, "+CPIN: READY",   TRUE, 1, 600 },
+};
+
+/* Test that cached replies are only given until they expire, and that
+ * giving them doesn't extend their life */
+static void
+test_cache_expiry (TestData *d)
+{
+    script_fork (d, NULL, cache_expiry_script, G_N_ELEMENTS (cache_expiry_script));
+
+    server_expect_commands (d->master, 1, "AT+CPIN?\r");
+    server_send_reply (d->master, "\r\n+CPIN: SIM PIN\r\n\r\nOK\r\n");
+
+    server_expect_commands (d->master, 1, "AT+CPIN?\r");
+    server_send_reply (d->master, "\r\n+CPIN: READY\r\n\r\nOK\r\n");
+
+    /* We expect the child to exit normally */
+    g_assert (wait_for_child (d, 5));
+}
+
+static void
+cache_same_hash_setup (MMPortSerialAt *port)
+{
+    mm_port_serial_at_set_cached_reply (port, "+X339C0F", "Cached");
+}
+
+/* Both commands, "AT+X339C0F\r" and "AT+Y000003F0\r", have the same hash */
+static const ScriptCommand cache_same_hash_script[] = {
+    { "+Y000003F0", FALSE, EXPECT_REPLY, "Fresh",  TRUE },
+    { "+X339C0F",   FALSE, EXPECT_REPLY, "Cached", TRUE },
+};
+
+/* Test that the cached reply of a command isn't given to another one with
+ * the same hash but a different length */
+static void
+test_cache_same_hash (TestData *d)
+{
+    script_fork (d, cache_same_hash_setup, cache_same_hash_script, G_N_ELEMENTS (cache_same_hash_script));
+
+    server_expect_commands (d->master, 1, "AT+Y000003F0\r");
+    server_send_reply (d->master, "\r\nFresh\r\n\r\nOK\r\n");
+    server_expect_no_command (d->master);
+
+    /* We expect the child to exit normally */
+    g_assert (wait_for_child (d, 5));
+}
+
+static const ScriptCommand cache_invalidation_script[] = {
+    { "+CPIN?",        FALSE, EXPECT_REPLY, "+CPIN: SIM PIN", TRUE, 5 },
+    { "+CPIN?",        TRUE,  EXPECT_REPLY, "+CPIN: SIM PIN", TRUE, 5 },
+    { "+CPIN=\"1234\"", TRUE,  EXPECT_REPLY, "" },
+    { "+CPIN?",        TRUE,  EXPECT_REPLY, "+CPIN: READY",   TRUE, 5 },
+};
+
+/* Test that setting a value drops the cached reply of its query */
+static void
+test_cache_invalidation (TestData *d)
+{
+    script_fork (d, NULL, cache_invalidation_script, G_N_ELEMENTS (cache_invalidation_script));
+
+    server_expect_commands (d->master, 1, "AT+CPIN?\r");
+    server_send_reply (d->master, "\r\n+CPIN: SIM PIN\r\n\r\nOK\r\n");
+
+    server_expect_commands (d->master, 1, "AT+CPIN=\"1234\"\r");
+    server_send_reply (d->master, "\r\nOK\r\n");
+
+    server_expect_commands (d->master, 1, "AT+CPIN?\r");
+    server_send_reply (d->master, "\r\n+CPIN: READY\r\n\r\nOK\r\n");
+
+    /* We expect the child to exit normally */
+    g_assert (wait_for_child (d, 5));
+}
+
+static void
+test_pty_create (TestData *d)
+{
+    struct termios stbuf;
+    int ret;
+
+    ret = openpty (&d->master, &d->slave, NULL, NULL, NULL);
+    g_assert (ret == 0);
+    d->valid = TRUE;
+
+    /* set raw mode on the slave using kernel default parameters */
+    memset (&stbuf, 0, sizeof (stbuf));
+    tcgetattr (d->slave, &stbuf);
+    tcflush (d->slave, TCIOFLUSH);
+    cfmakeraw (&stbuf);
+    tcsetattr (d->slave, TCSANOW, &stbuf);
+    fcntl (d->slave, F_SETFL, O_NONBLOCK);
+
+    fcntl (d->master, F_SETFL, O_NONBLOCK);
+}
+
+static void
+test_pty_cleanup (TestData *d)
+{
+    /* For some reason the cleanup function gets called more times
+     * than the setup function does...
+     */
+    if (d->valid) {
+        if (d->child)
+            kill (d->child, SIGKILL);
+        if (d->master >= 0)
+            close (d->master);
+        if (d->slave >= 0)
+            close (d->slave);
+        memset (d, 0, sizeof (*d));
+    }
+}
+
+/*****************************************************************************/
+
 void
 _mm_log (const char *loc,
          const char *func,
@@ -84,11 +1194,26 @@ _mm_log (const char *loc,
     g_free (msg);
 }
 
+typedef void (*TCFunc) (TestData *, gconstpointer);
+#define TESTCASE_PTY(s, t) g_test_add (s, TestData, NULL, (TCFunc)test_pty_create, (TCFunc)t, (TCFunc)test_pty_cleanup);
+
 int main (int argc, char **argv)
 {
     g_test_init (&argc, &argv, NULL);
 
     g_test_add_func ("/ModemManager/AT-serial/echo-removal", at_serial_echo_removal);
+    g_test_add_func ("/ModemManager/AT-serial/parser-v1",    at_serial_parser_v1);
+    g_test_add_func ("/ModemManager/AT-serial/parser-v1-incremental", at_serial_parser_v1_incremental);
+    g_test_add_func ("/ModemManager/AT-serial/pipelined-response", at_serial_pipelined_response);
+    g_test_add_func ("/ModemManager/AT-serial/unsolicited-dispatch", at_serial_unsolicited_dispatch);
+
+    TESTCASE_PTY ("/ModemManager/AT-serial/pipeline-batch",   test_pipeline_batch);
+    TESTCASE_PTY ("/ModemManager/AT-serial/pipeline-timeout", test_pipeline_timeout);
+    TESTCASE_PTY ("/ModemManager/AT-serial/pipeline-cancel",  test_pipeline_cancel);
+    TESTCASE_PTY ("/ModemManager/AT-serial/cache-eviction",     test_cache_eviction);
+    TESTCASE_PTY ("/ModemManager/AT-serial/cache-expiry",       test_cache_expiry);
+    TESTCASE_PTY ("/ModemManager/AT-serial/cache-same-hash",    test_cache_same_hash);
+    TESTCASE_PTY ("/ModemManager/AT-serial/cache-invalidation", test_cache_invalidation);
 
     return g_test_run ();
 }
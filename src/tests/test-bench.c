@@ -0,0 +1,144 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <glib.h>
+
+#include "test-bench.h"
+
+#define DEFAULT_ITERATIONS 10000
+
+/*****************************************************************************/
+/* Allocation counting.
+ *
+ * With glibc we can interpose the allocator entry points in the benchmark
+ * program and forward them to the real implementation; GLib allocates with
+ * the system allocator, so this counts the g_malloc() and friends done by
+ * the parsers. */
+
+static guint64 n_allocations;
+
+#if defined (__GLIBC__)
+
+#define COUNT_ALLOCATIONS 1
+
+extern void *__libc_malloc  (size_t size);
+extern void *__libc_calloc  (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+void *
+malloc (size_t size)
+{
+    n_allocations++;
+    return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb,
+        size_t size)
+{
+    n_allocations++;
+    return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void   *ptr,
+         size_t  size)
+{
+    n_allocations++;
+    return __libc_realloc (ptr, size);
+}
+
+#endif
+
+/*****************************************************************************/
+
+typedef struct {
+    gchar           *path;
+    MMTestBenchFunc  func;
+    gconstpointer    data;
+} TestBench;
+
+static void
+test_bench_free (TestBench *bench)
+{
+    g_free (bench->path);
+    g_slice_free (TestBench, bench);
+}
+
+static guint
+test_bench_get_iterations (void)
+{
+    const gchar *str;
+    guint64      iterations;
+
+    str = g_getenv ("MM_TEST_BENCH_ITERATIONS");
+    if (!str)
+        return DEFAULT_ITERATIONS;
+
+    iterations = g_ascii_strtoull (str, NULL, 10);
+    if (!iterations || iterations > G_MAXUINT)
+        return DEFAULT_ITERATIONS;
+    return (guint) iterations;
+}
+
+static void
+test_bench_run (gconstpointer user_data)
+{
+    const TestBench *bench = user_data;
+    guint            iterations;
+    guint            i;
+    guint64          allocations;
+    gdouble          ns_per_op;
+
+    /* Always run it once; this also leaves lazily initialized state (e.g.
+     * the regex cache) out of the measurement */
+    bench->func (bench->data);
+
+    if (!g_test_perf ())
+        return;
+
+    iterations = test_bench_get_iterations ();
+
+    allocations = n_allocations;
+    g_test_timer_start ();
+    for (i = 0; i < iterations; i++)
+        bench->func (bench->data);
+    ns_per_op = g_test_timer_elapsed () * 1e9 / iterations;
+    allocations = n_allocations - allocations;
+
+    g_test_minimized_result (ns_per_op, "%s: %.1f ns/op", bench->path, ns_per_op);
+#if defined (COUNT_ALLOCATIONS)
+    g_test_minimized_result ((gdouble) allocations / iterations, "%s: %.2f allocs/op",
+                             bench->path, (gdouble) allocations / iterations);
+    g_print ("bench\t%s\t%u\t%.1f\t%.2f\n", bench->path, iterations, ns_per_op, (gdouble) allocations / iterations);
+#else
+    g_print ("bench\t%s\t%u\t%.1f\t-\n", bench->path, iterations, ns_per_op);
+#endif
+}
+
+void
+mm_test_bench_add (const gchar     *path,
+                   MMTestBenchFunc  func,
+                   gconstpointer    data)
+{
+    TestBench *bench;
+
+    bench = g_slice_new (TestBench);
+    bench->path = g_strdup (path);
+    bench->func = func;
+    bench->data = data;
+
+    g_test_add_data_func_full (bench->path, bench, test_bench_run, (GDestroyNotify) test_bench_free);
+}
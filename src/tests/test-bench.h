@@ -0,0 +1,39 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef TEST_BENCH_H
+#define TEST_BENCH_H
+
+#include <glib.h>
+
+/* Parser micro-benchmarks.
+ *
+ * Each benchmark is a test case which runs its function once in the default
+ * mode, so that the fixtures are always exercised, and which is timed only
+ * when running with '-m perf' (e.g. 'make perf-report'). In that case the
+ * results are reported as minimized performance results (ns/op and
+ * allocations/op, when they can be counted), and also printed in a single
+ * tab-separated line:
+ *   bench <TAB> path <TAB> iterations <TAB> ns/op <TAB> allocs/op
+ *
+ * The number of iterations may be changed with the MM_TEST_BENCH_ITERATIONS
+ * environment variable.
+ */
+
+typedef void (* MMTestBenchFunc) (gconstpointer data);
+
+void mm_test_bench_add (const gchar     *path,
+                        MMTestBenchFunc  func,
+                        gconstpointer    data);
+
+#endif /* TEST_BENCH_H */
@@ -19,6 +19,7 @@
 
 #include "mm-modem-helpers.h"
 #include "mm-log.h"
+#include "test-bench.h"
 
 static void
 test_gsm7_default_chars (void)
@@ -309,6 +310,73 @@ test_gsm7_pack_7_chars_offset (void)
     g_free (packed);
 }
 
+static void
+test_gsm7_pack_unpack_offsets (void)
+{
+    guint8 unpacked[40];
+    guint offset;
+    guint len;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (unpacked); i++)
+        unpacked[i] = (i * 37 + 11) & 0x7F;
+
+    /* Lengths with and without whole groups of 8 septets, and trailing ones */
+    for (offset = 0; offset < 8; offset++) {
+        for (len = 0; len <= G_N_ELEMENTS (unpacked); len++) {
+            guint8 *packed;
+            guint8 *unpacked_again;
+            guint32 packed_len = 0;
+            guint32 unpacked_len = 0;
+
+            packed = mm_charset_gsm_pack (unpacked, len, offset, &packed_len);
+            g_assert (packed);
+            g_assert_cmpuint (packed_len, ==, (len * 7 + offset + 7) / 8);
+            /* Leading bits are left clear */
+            if (packed_len)
+                g_assert_cmpuint (packed[0] & ((1 << offset) - 1), ==, 0);
+
+            unpacked_again = mm_charset_gsm_unpack (packed, len, offset, &unpacked_len);
+            g_assert (unpacked_again);
+            g_assert_cmpuint (unpacked_len, ==, len);
+            g_assert_cmpint (memcmp (unpacked, unpacked_again, len), ==, 0);
+
+            g_free (unpacked_again);
+            g_free (packed);
+        }
+    }
+}
+
+static void
+test_ucs2_hex (void)
+{
+    gchar *hex;
+    gchar *utf8;
+
+    hex = mm_modem_charset_utf8_to_hex ("T-Mobile €", MM_MODEM_CHARSET_UCS2);
+    g_assert_cmpstr (hex, ==, "0054002D004D006F00620069006C0065002020AC");
+    utf8 = mm_modem_charset_hex_to_utf8 (hex, MM_MODEM_CHARSET_UCS2);
+    g_assert_cmpstr (utf8, ==, "T-Mobile €");
+    g_free (utf8);
+    g_free (hex);
+
+    hex = mm_modem_charset_utf8_to_hex ("", MM_MODEM_CHARSET_UCS2);
+    g_assert_cmpstr (hex, ==, "");
+    g_free (hex);
+
+    /* Lowercase hex digits are fine too */
+    utf8 = mm_modem_charset_hex_to_utf8 ("041f04400438043204350442", MM_MODEM_CHARSET_UCS2);
+    g_assert_cmpstr (utf8, ==, "Привет");
+    g_free (utf8);
+
+    /* Outside of the BMP */
+    g_assert (mm_modem_charset_utf8_to_hex ("\xf0\x9f\x98\x80", MM_MODEM_CHARSET_UCS2) == NULL);
+    /* Surrogates aren't valid UCS-2 */
+    g_assert (mm_modem_charset_hex_to_utf8 ("D83DDE00", MM_MODEM_CHARSET_UCS2) == NULL);
+    /* Incomplete UCS-2 char */
+    g_assert (mm_modem_charset_hex_to_utf8 ("004100", MM_MODEM_CHARSET_UCS2) == NULL);
+}
+
 static void
 test_take_convert_ucs2_hex_utf8 (void)
 {
@@ -404,6 +472,81 @@ test_charset_can_covert_to (void)
     }
 }
 
+/*****************************************************************************/
+/* Throughput benchmarks, with SMS-sized inputs: each operation converts a
+ * full 160-septet GSM 7-bit text or a 70-char UCS-2 one */
+
+#define BENCH_GSM7_LEN 160
+
+static const gchar bench_ucs2_utf8[] =
+    "Ваш баланс: 123,45 руб. Пакет «Интернет» активен до 31.12. Спасибо!! ☺";
+
+static guint8 bench_gsm7_unpacked[BENCH_GSM7_LEN];
+static guint8 *bench_gsm7_packed;
+static gchar *bench_ucs2_hex;
+
+static void
+bench_setup (void)
+{
+    static const gchar text[] = "Hello @ £5 {ok} ÄÖÜ € ";
+    guint8 *gsm;
+    guint32 gsm_len = 0;
+    guint32 packed_len = 0;
+    guint i;
+
+    gsm = mm_charset_utf8_to_unpacked_gsm (text, &gsm_len);
+    for (i = 0; i < BENCH_GSM7_LEN; i++)
+        bench_gsm7_unpacked[i] = gsm[i % gsm_len];
+    g_free (gsm);
+
+    bench_gsm7_packed = mm_charset_gsm_pack (bench_gsm7_unpacked, BENCH_GSM7_LEN, 0, &packed_len);
+    bench_ucs2_hex = mm_modem_charset_utf8_to_hex (bench_ucs2_utf8, MM_MODEM_CHARSET_UCS2);
+    g_assert (bench_ucs2_hex);
+}
+
+static void
+bench_cleanup (void)
+{
+    g_free (bench_gsm7_packed);
+    g_free (bench_ucs2_hex);
+}
+
+static void
+bench_gsm7_pack (gconstpointer data)
+{
+    guint32 packed_len = 0;
+
+    g_free (mm_charset_gsm_pack (bench_gsm7_unpacked, BENCH_GSM7_LEN, 0, &packed_len));
+}
+
+static void
+bench_gsm7_unpack (gconstpointer data)
+{
+    guint32 unpacked_len = 0;
+
+    g_free (mm_charset_gsm_unpack (bench_gsm7_packed, BENCH_GSM7_LEN, 0, &unpacked_len));
+}
+
+static void
+bench_gsm7_unpacked_to_utf8 (gconstpointer data)
+{
+    g_free (mm_charset_gsm_unpacked_to_utf8 (bench_gsm7_unpacked, BENCH_GSM7_LEN));
+}
+
+static void
+bench_ucs2_hex_to_utf8 (gconstpointer data)
+{
+    g_free (mm_modem_charset_hex_to_utf8 (bench_ucs2_hex, MM_MODEM_CHARSET_UCS2));
+}
+
+static void
+bench_ucs2_utf8_to_hex (gconstpointer data)
+{
+    g_free (mm_modem_charset_utf8_to_hex (bench_ucs2_utf8, MM_MODEM_CHARSET_UCS2));
+}
+
+/*****************************************************************************/
+
 void
 _mm_log (const char *loc,
          const char *func,
@@ -426,6 +569,8 @@ _mm_log (const char *loc,
 
 int main (int argc, char **argv)
 {
+    gint result;
+
     setlocale (LC_ALL, "");
 
     g_test_init (&argc, &argv, NULL);
@@ -442,6 +587,9 @@ int main (int argc, char **argv)
     g_test_add_func ("/MM/charsets/gsm7/pack/24-chars",          test_gsm7_pack_24_chars);
     g_test_add_func ("/MM/charsets/gsm7/pack/last-septet-alone", test_gsm7_pack_last_septet_alone);
     g_test_add_func ("/MM/charsets/gsm7/pack/7-chars-offset",    test_gsm7_pack_7_chars_offset);
+    g_test_add_func ("/MM/charsets/gsm7/pack-unpack/offsets",    test_gsm7_pack_unpack_offsets);
+
+    g_test_add_func ("/MM/charsets/ucs2/hex", test_ucs2_hex);
 
     g_test_add_func ("/MM/charsets/take-convert/ucs2/hex",         test_take_convert_ucs2_hex_utf8);
     g_test_add_func ("/MM/charsets/take-convert/ucs2/bad-ascii",   test_take_convert_ucs2_bad_ascii);
@@ -449,5 +597,16 @@ int main (int argc, char **argv)
 
     g_test_add_func ("/MM/charsets/can-convert-to", test_charset_can_covert_to);
 
-    return g_test_run ();
+    bench_setup ();
+    mm_test_bench_add ("/MM/bench/charsets/gsm7/pack",              bench_gsm7_pack,             NULL);
+    mm_test_bench_add ("/MM/bench/charsets/gsm7/unpack",            bench_gsm7_unpack,           NULL);
+    mm_test_bench_add ("/MM/bench/charsets/gsm7/unpacked-to-utf8",  bench_gsm7_unpacked_to_utf8, NULL);
+    mm_test_bench_add ("/MM/bench/charsets/ucs2/hex-to-utf8",       bench_ucs2_hex_to_utf8,      NULL);
+    mm_test_bench_add ("/MM/bench/charsets/ucs2/utf8-to-hex",       bench_ucs2_utf8_to_hex,      NULL);
+
+    result = g_test_run ();
+
+    bench_cleanup ();
+
+    return result;
 }
@@ -0,0 +1,170 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+#include <stdarg.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <ModemManager.h>
+#include <mm-errors-types.h>
+
+#include "mm-port-serial-gps.h"
+#include "mm-log.h"
+
+#define GGA "$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76\r\n"
+#define RMC "$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43\r\n"
+#define GSA "$GPGSA,A,3,10,07,05,02,29,04,08,13,,,,,1.72,1.03,1.38*0A\r\n"
+#define VTG "$GPVTG,31.66,T,,M,0.02,N,0.04,K,A*09\r\n"
+
+/* Wrong checksum, and a checksum with a single digit */
+#define GSA_BAD_CHECKSUM "$GPGSA,A,3,10,07,05,02,29,04,08,13,,,,,1.72,1.03,1.38*0B\r\n"
+#define VTG_BAD_CHECKSUM "$GPVTG,31.66,T,,M,0.02,N,0.04,K,A*9\r\n"
+
+/* No checksum at all */
+#define PROPRIETARY "$PSTIS,\r\n"
+
+static const gchar stream[] =
+    "garbage"
+    GGA
+    GSA_BAD_CHECKSUM
+    RMC
+    "\r\nOK\r\n"
+    PROPRIETARY
+    VTG_BAD_CHECKSUM
+    GSA
+    VTG
+    "$GPGGA,0927";
+
+static const gchar *expected_traces[] = { GGA, RMC, PROPRIETARY, GSA, VTG };
+
+static void
+trace_received (MMPortSerialGps *port,
+                const gchar     *trace,
+                GPtrArray       *traces)
+{
+    g_ptr_array_add (traces, g_strdup (trace));
+}
+
+static void
+check_traces (GPtrArray *traces)
+{
+    guint i;
+
+    g_assert_cmpuint (traces->len, ==, G_N_ELEMENTS (expected_traces));
+    for (i = 0; i < traces->len; i++)
+        g_assert_cmpstr (g_ptr_array_index (traces, i), ==, expected_traces[i]);
+}
+
+/* Runs the response parser of the port on the given buffer, as done when
+ * new data is read */
+static void
+parse (MMPortSerialGps *port,
+       GByteArray      *buffer,
+       GString         *parsed)
+{
+    GByteArray *parsed_response = NULL;
+    GError     *error = NULL;
+
+    switch (MM_PORT_SERIAL_GET_CLASS (port)->parse_response (MM_PORT_SERIAL (port), buffer, &parsed_response, &error)) {
+    case MM_PORT_SERIAL_RESPONSE_BUFFER:
+        g_assert (parsed_response);
+        g_string_append_len (parsed, (const gchar *) parsed_response->data, parsed_response->len);
+        g_byte_array_unref (parsed_response);
+        break;
+    case MM_PORT_SERIAL_RESPONSE_NONE:
+        g_assert (!parsed_response);
+        break;
+    case MM_PORT_SERIAL_RESPONSE_ERROR:
+    default:
+        g_assert_not_reached ();
+    }
+    g_assert_no_error (error);
+}
+
+static void
+gps_serial_nmea_framing (void)
+{
+    static const gsize chunk_sizes[] = { G_N_ELEMENTS (stream), 1, 2, 7, 64 };
+    guint              k;
+
+    for (k = 0; k < G_N_ELEMENTS (chunk_sizes); k++) {
+        MMPortSerialGps *port;
+        GPtrArray       *traces;
+        GByteArray      *buffer;
+        GString         *parsed;
+        gsize            len;
+        gsize            fed;
+
+        port = mm_port_serial_gps_new ("ttyFOO");
+        traces = g_ptr_array_new_with_free_func (g_free);
+        mm_port_serial_gps_add_trace_handler (port, (MMPortSerialGpsTraceFn) trace_received, traces, NULL);
+
+        buffer = g_byte_array_new ();
+        parsed = g_string_new ("");
+        len = strlen (stream);
+        for (fed = 0; fed < len; fed += chunk_sizes[k]) {
+            g_byte_array_append (buffer, (const guint8 *) &stream[fed], MIN (chunk_sizes[k], len - fed));
+            parse (port, buffer, parsed);
+        }
+
+        check_traces (traces);
+        g_assert_cmpuint (mm_port_serial_gps_get_n_checksum_errors (port), ==, 2);
+
+        /* Lines without traces in between traces are given as response;
+         * when they're read before the next trace they're just garbage */
+        if (k == 0)
+            g_assert_cmpstr (parsed->str, ==, "\r\nOK\r\n");
+
+        /* The incomplete trace is left in the buffer */
+        g_assert_cmpuint (buffer->len, ==, strlen ("$GPGGA,0927"));
+        g_assert (memcmp (buffer->data, "$GPGGA,0927", buffer->len) == 0);
+
+        g_string_free (parsed, TRUE);
+        g_byte_array_unref (buffer);
+        g_object_unref (port);
+        g_ptr_array_unref (traces);
+    }
+}
+
+/*****************************************************************************/
+
+void
+_mm_log (const char *loc,
+         const char *func,
+         guint32 level,
+         const char *fmt,
+         ...)
+{
+    va_list args;
+    gchar *msg;
+
+    if (!g_test_verbose ())
+        return;
+
+    va_start (args, fmt);
+    msg = g_strdup_vprintf (fmt, args);
+    va_end (args);
+    g_print ("%s\n", msg);
+    g_free (msg);
+}
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/ModemManager/GPS-serial/nmea-framing", gps_serial_nmea_framing);
+
+    return g_test_run ();
+}
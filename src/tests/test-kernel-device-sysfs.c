@@ -0,0 +1,283 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "mm-kernel-device-generic-sysfs.h"
+#include "mm-log.h"
+
+/* Fake sysfs tree with a single USB device */
+typedef struct {
+    gchar *root;
+    gchar *physdev;
+} FakeSysfs;
+
+static void
+fake_sysfs_write (FakeSysfs   *sysfs,
+                  const gchar *attribute,
+                  const gchar *value)
+{
+    gchar *path;
+
+    path = g_build_filename (sysfs->physdev, attribute, NULL);
+    g_assert (g_file_set_contents (path, value, -1, NULL));
+    g_free (path);
+}
+
+static void
+fake_sysfs_plug (FakeSysfs   *sysfs,
+                 const gchar *devnum,
+                 const gchar *vid,
+                 const gchar *pid,
+                 const gchar *product)
+{
+    fake_sysfs_write (sysfs, "busnum",       "1\n");
+    fake_sysfs_write (sysfs, "devnum",       devnum);
+    fake_sysfs_write (sysfs, "idVendor",     vid);
+    fake_sysfs_write (sysfs, "idProduct",    pid);
+    fake_sysfs_write (sysfs, "bcdDevice",    "0100\n");
+    fake_sysfs_write (sysfs, "manufacturer", "Modems Inc.\n");
+    fake_sysfs_write (sysfs, "product",      product);
+}
+
+static FakeSysfs *
+fake_sysfs_new (void)
+{
+    FakeSysfs *sysfs;
+    GError    *error = NULL;
+    gchar     *bus;
+    gchar     *link;
+
+    sysfs = g_slice_new0 (FakeSysfs);
+    sysfs->root = g_dir_make_tmp ("test-kernel-device-sysfs-XXXXXX", &error);
+    g_assert_no_error (error);
+
+    sysfs->physdev = g_build_filename (sysfs->root, "devices", "usb1", "1-2", NULL);
+    g_assert_cmpint (g_mkdir_with_parents (sysfs->physdev, 0755), ==, 0);
+
+    bus = g_build_filename (sysfs->root, "bus", "usb", NULL);
+    g_assert_cmpint (g_mkdir_with_parents (bus, 0755), ==, 0);
+    link = g_build_filename (sysfs->physdev, "subsystem", NULL);
+    g_assert_cmpint (symlink (bus, link), ==, 0);
+    g_free (link);
+    g_free (bus);
+
+    fake_sysfs_plug (sysfs, "2\n", "1199\n", "68a3\n", "First modem\n");
+    return sysfs;
+}
+
+static void
+fake_sysfs_free (FakeSysfs *sysfs)
+{
+    static const gchar *attributes[] = {
+        "busnum", "devnum", "idVendor", "idProduct", "bcdDevice", "manufacturer", "product", "subsystem"
+    };
+    gchar *path;
+    guint  i;
+
+    for (i = 0; i < G_N_ELEMENTS (attributes); i++) {
+        path = g_build_filename (sysfs->physdev, attributes[i], NULL);
+        g_unlink (path);
+        g_free (path);
+    }
+    g_rmdir (sysfs->physdev);
+    path = g_build_filename (sysfs->root, "devices", "usb1", NULL);
+    g_rmdir (path);
+    g_free (path);
+    path = g_build_filename (sysfs->root, "devices", NULL);
+    g_rmdir (path);
+    g_free (path);
+    path = g_build_filename (sysfs->root, "bus", "usb", NULL);
+    g_rmdir (path);
+    g_free (path);
+    path = g_build_filename (sysfs->root, "bus", NULL);
+    g_rmdir (path);
+    g_free (path);
+    g_rmdir (sysfs->root);
+
+    g_free (sysfs->physdev);
+    g_free (sysfs->root);
+    g_slice_free (FakeSysfs, sysfs);
+}
+
+/*****************************************************************************/
+
+static void
+test_attributes (void)
+{
+    FakeSysfs        *sysfs;
+    MMSysfsAttribute  attributes[] = {
+        { "idVendor",  NULL },
+        { "product",   NULL },
+        { "missing",   NULL },
+    };
+
+    sysfs = fake_sysfs_new ();
+
+    mm_kernel_device_generic_sysfs_read (sysfs->physdev, attributes, G_N_ELEMENTS (attributes));
+    g_assert_cmpuint (mm_sysfs_attribute_as_hex16 (&attributes[0]), ==, 0x1199);
+    g_assert_cmpstr (attributes[1].value, ==, "First modem");
+    g_assert (!attributes[2].value);
+    g_assert_cmpuint (mm_sysfs_attribute_as_hex (&attributes[2]), ==, 0);
+    mm_kernel_device_generic_sysfs_clear (attributes, G_N_ELEMENTS (attributes));
+    g_assert (!attributes[0].value);
+    g_assert (!attributes[1].value);
+
+    fake_sysfs_free (sysfs);
+}
+
+static void
+test_physdev_hit (void)
+{
+    FakeSysfs                 *sysfs;
+    const MMPhysdevAttributes *first;
+    const MMPhysdevAttributes *second;
+
+    sysfs = fake_sysfs_new ();
+
+    first = mm_kernel_device_generic_physdev_get (sysfs->physdev, "tty", "ttyUSB0");
+    g_assert_cmpuint (first->busnum, ==, 1);
+    g_assert_cmpuint (first->devnum, ==, 2);
+    g_assert_cmpuint (first->vid, ==, 0x1199);
+    g_assert_cmpuint (first->pid, ==, 0x68a3);
+    g_assert_cmpuint (first->revision, ==, 0x0100);
+    g_assert_cmpstr (first->manufacturer, ==, "Modems Inc.");
+    g_assert_cmpstr (first->product, ==, "First modem");
+    g_assert (first->subsystem);
+    g_assert_cmpuint (first->n_ports, ==, 1);
+
+    /* Same device, so the sibling port gets the cached attributes, even if
+     * they changed in sysfs */
+    fake_sysfs_write (sysfs, "product", "Changed\n");
+    second = mm_kernel_device_generic_physdev_get (sysfs->physdev, "net", "wwan0");
+    g_assert (second == first);
+    g_assert_cmpstr (second->product, ==, "First modem");
+    g_assert_cmpuint (second->n_ports, ==, 2);
+
+    /* Preloading the same port again doesn't count it twice */
+    second = mm_kernel_device_generic_physdev_get (sysfs->physdev, "tty", "ttyUSB0");
+    g_assert (second == first);
+    g_assert_cmpuint (second->n_ports, ==, 2);
+
+    mm_kernel_device_generic_physdev_release_port ("tty", "ttyUSB0");
+    mm_kernel_device_generic_physdev_release_port ("net", "wwan0");
+
+    fake_sysfs_free (sysfs);
+}
+
+static void
+test_physdev_release (void)
+{
+    FakeSysfs                 *sysfs;
+    const MMPhysdevAttributes *attributes;
+
+    sysfs = fake_sysfs_new ();
+
+    attributes = mm_kernel_device_generic_physdev_get (sysfs->physdev, "tty", "ttyUSB0");
+    g_assert_cmpuint (attributes->vid, ==, 0x1199);
+    attributes = mm_kernel_device_generic_physdev_get (sysfs->physdev, "tty", "ttyUSB1");
+    g_assert_cmpuint (attributes->n_ports, ==, 2);
+
+    /* Unknown ports are ignored */
+    mm_kernel_device_generic_physdev_release_port ("tty", "ttyUSB9");
+    g_assert_cmpuint (attributes->n_ports, ==, 2);
+
+    /* Once all ports are removed, a different device in the same USB port
+     * gets its own attributes, even with the same device number */
+    mm_kernel_device_generic_physdev_release_port ("tty", "ttyUSB0");
+    mm_kernel_device_generic_physdev_release_port ("tty", "ttyUSB1");
+    fake_sysfs_plug (sysfs, "2\n", "2c7c\n", "0125\n", "Second modem\n");
+
+    attributes = mm_kernel_device_generic_physdev_get (sysfs->physdev, "tty", "ttyUSB0");
+    g_assert_cmpuint (attributes->vid, ==, 0x2c7c);
+    g_assert_cmpuint (attributes->pid, ==, 0x0125);
+    g_assert_cmpstr (attributes->product, ==, "Second modem");
+    g_assert_cmpuint (attributes->n_ports, ==, 1);
+
+    mm_kernel_device_generic_physdev_release_port ("tty", "ttyUSB0");
+
+    fake_sysfs_free (sysfs);
+}
+
+static void
+test_physdev_readd (void)
+{
+    FakeSysfs                 *sysfs;
+    const MMPhysdevAttributes *attributes;
+
+    sysfs = fake_sysfs_new ();
+
+    attributes = mm_kernel_device_generic_physdev_get (sysfs->physdev, "tty", "ttyUSB0");
+    g_assert_cmpuint (attributes->vid, ==, 0x1199);
+    g_assert_cmpuint (attributes->devnum, ==, 2);
+
+    /* The remove event is missed, and a different device is plugged in the
+     * same USB port: its new device number tells the entry is stale */
+    fake_sysfs_plug (sysfs, "3\n", "2c7c\n", "0125\n", "Second modem\n");
+
+    attributes = mm_kernel_device_generic_physdev_get (sysfs->physdev, "tty", "ttyUSB0");
+    g_assert_cmpuint (attributes->devnum, ==, 3);
+    g_assert_cmpuint (attributes->vid, ==, 0x2c7c);
+    g_assert_cmpuint (attributes->pid, ==, 0x0125);
+    g_assert_cmpstr (attributes->product, ==, "Second modem");
+    g_assert_cmpuint (attributes->n_ports, ==, 1);
+
+    /* Its sibling ports get the new attributes from the cache */
+    fake_sysfs_write (sysfs, "product", "Changed\n");
+    attributes = mm_kernel_device_generic_physdev_get (sysfs->physdev, "tty", "ttyUSB1");
+    g_assert_cmpstr (attributes->product, ==, "Second modem");
+    g_assert_cmpuint (attributes->n_ports, ==, 2);
+
+    mm_kernel_device_generic_physdev_release_port ("tty", "ttyUSB0");
+    mm_kernel_device_generic_physdev_release_port ("tty", "ttyUSB1");
+
+    fake_sysfs_free (sysfs);
+}
+
+/*****************************************************************************/
+
+void
+_mm_log (const char *loc,
+         const char *func,
+         guint32 level,
+         const char *fmt,
+         ...)
+{
+    va_list args;
+    gchar *msg;
+
+    if (!g_test_verbose ())
+        return;
+
+    va_start (args, fmt);
+    msg = g_strdup_vprintf (fmt, args);
+    va_end (args);
+    g_print ("%s\n", msg);
+    g_free (msg);
+}
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/kernel-device-sysfs/attributes",       test_attributes);
+    g_test_add_func ("/MM/kernel-device-sysfs/physdev-hit",      test_physdev_hit);
+    g_test_add_func ("/MM/kernel-device-sysfs/physdev-release",  test_physdev_release);
+    g_test_add_func ("/MM/kernel-device-sysfs/physdev-readd",    test_physdev_readd);
+
+    return g_test_run ();
+}
@@ -0,0 +1,140 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include <ModemManager.h>
+#include <mm-errors-types.h>
+
+#include "mm-log.h"
+
+#define N_THREADS  4
+#define N_MESSAGES 500
+
+static volatile gint n_finished;
+
+/* Messages are logged both with our own logging functions and through GLib,
+ * as done e.g. from the GDBus worker thread */
+static gpointer
+log_thread (gpointer data)
+{
+    guint id = GPOINTER_TO_UINT (data);
+    guint i;
+
+    for (i = 0; i < N_MESSAGES; i++) {
+        if (i % 2)
+            g_message ("thread %u message %u\n", id, i);
+        else
+            mm_dbg ("thread %u message %u", id, i);
+    }
+
+    g_atomic_int_inc (&n_finished);
+    return NULL;
+}
+
+static void
+log_async_start_stop (const gchar *policy)
+{
+    GThread  *threads[N_THREADS];
+    GError   *error = NULL;
+    gchar    *path;
+    gchar    *contents;
+    gchar   **lines;
+    guint     next[N_THREADS] = { 0 };
+    guint     n_toggles = 0;
+    guint     i;
+    gint      fd;
+
+    fd = g_file_open_tmp ("test-log-XXXXXX", &path, &error);
+    g_assert_no_error (error);
+    close (fd);
+
+    g_assert (mm_log_setup ("DEBUG", path, FALSE, FALSE, FALSE, NULL, &error));
+    g_assert_no_error (error);
+
+    /* Keep switching between synchronous and asynchronous logging while the
+     * threads log */
+    g_atomic_int_set (&n_finished, 0);
+    for (i = 0; i < N_THREADS; i++)
+        threads[i] = g_thread_new ("log", log_thread, GUINT_TO_POINTER (i));
+    while (g_atomic_int_get (&n_finished) < N_THREADS) {
+        g_assert (mm_log_set_async_policy ((n_toggles++ % 2) ? NULL : policy, &error));
+        g_assert_no_error (error);
+        g_usleep (1000);
+    }
+    for (i = 0; i < N_THREADS; i++)
+        g_thread_join (threads[i]);
+
+    mm_log_shutdown ();
+
+    g_assert (g_file_get_contents (path, &contents, NULL, &error));
+    g_assert_no_error (error);
+    lines = g_strsplit (contents, "\n", -1);
+    for (i = 0; lines[i]; i++) {
+        const gchar *str;
+        guint id;
+        guint n;
+
+        str = strstr (lines[i], "thread ");
+        if (!str)
+            continue;
+        g_assert (sscanf (str, "thread %u message %u", &id, &n) == 2);
+        g_assert_cmpuint (id, <, N_THREADS);
+
+        /* The messages of each thread are always written in order; when
+         * blocking, none is lost either */
+        if (g_str_equal (policy, "block"))
+            g_assert_cmpuint (n, ==, next[id]);
+        else
+            g_assert_cmpuint (n, >=, next[id]);
+        next[id] = n + 1;
+    }
+
+    if (g_str_equal (policy, "block")) {
+        for (i = 0; i < N_THREADS; i++)
+            g_assert_cmpuint (next[i], ==, N_MESSAGES);
+    }
+
+    g_strfreev (lines);
+    g_free (contents);
+    unlink (path);
+    g_free (path);
+}
+
+static void
+test_log_async_block (void)
+{
+    log_async_start_stop ("block");
+}
+
+static void
+test_log_async_drop (void)
+{
+    log_async_start_stop ("drop");
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/log/async-block", test_log_async_block);
+    g_test_add_func ("/MM/log/async-drop",  test_log_async_drop);
+
+    return g_test_run ();
+}
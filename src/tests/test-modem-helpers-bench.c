@@ -0,0 +1,312 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+#include <stdarg.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#define _LIBMM_INSIDE_MM
+#include <libmm-glib.h>
+
+#include "mm-modem-helpers.h"
+#include "mm-log.h"
+#include "test-bench.h"
+
+/* Sample responses, taken from the test-modem-helpers fixtures */
+
+/*****************************************************************************/
+/* +CREG, +CGREG, +CEREG */
+
+static GPtrArray *solicited_creg;
+static GPtrArray *unsolicited_creg;
+
+typedef struct {
+    const gchar *path;
+    const gchar *line_path;
+    const gchar *reply;
+    gboolean     solicited;
+} CregBench;
+
+static const CregBench creg_benchs[] = {
+    { "/MM/bench/creg/solicited/creg2",    "/MM/bench/creg-line/solicited/creg2",    "+CREG: 0,1,84CD,00D30173",                TRUE  },
+    { "/MM/bench/creg/solicited/cgreg2",   "/MM/bench/creg-line/solicited/cgreg2",   "+CGREG: 2,1,\"8BE3\",\"00002B5D\",3",     TRUE  },
+    { "/MM/bench/creg/solicited/cereg2",   "/MM/bench/creg-line/solicited/cereg2",   "\r\n+CEREG: 2,1, 1F00, 79D903 ,7\r\n",    TRUE  },
+    { "/MM/bench/creg/unsolicited/creg1",  "/MM/bench/creg-line/unsolicited/creg1",  "\r\n+CREG: 3\r\n",                         FALSE },
+    { "/MM/bench/creg/unsolicited/creg2",  "/MM/bench/creg-line/unsolicited/creg2",  "\r\n+CREG: 1,84CD,00D30156\r\n",           FALSE },
+    { "/MM/bench/creg/unsolicited/cereg2", "/MM/bench/creg-line/unsolicited/cereg2", "\r\n+CEREG: 1, 1F00, 79D903 ,7\r\n",       FALSE },
+};
+
+static void
+bench_creg (gconstpointer data)
+{
+    const CregBench              *bench = data;
+    GPtrArray                    *array;
+    MMModem3gppRegistrationState  state;
+    MMModemAccessTechnology       act;
+    gulong                        lac;
+    gulong                        ci;
+    gboolean                      cgreg;
+    gboolean                      cereg;
+    guint                         i;
+
+    array = bench->solicited ? solicited_creg : unsolicited_creg;
+    for (i = 0; i < array->len; i++) {
+        GMatchInfo *info = NULL;
+
+        if (g_regex_match (g_ptr_array_index (array, i), bench->reply, 0, &info)) {
+            g_assert (mm_3gpp_parse_creg_response (info, &state, &lac, &ci, &act, &cgreg, &cereg, NULL));
+            g_match_info_free (info);
+            return;
+        }
+        g_match_info_free (info);
+    }
+    g_assert_not_reached ();
+}
+
+static void
+bench_creg_line (gconstpointer data)
+{
+    const CregBench  *bench = data;
+    MM3gppCregResult  result;
+
+    g_assert (mm_3gpp_parse_creg_line (bench->reply, -1, bench->solicited, &result, NULL));
+}
+
+/*****************************************************************************/
+/* +COPS=? */
+
+static void
+bench_cops (gconstpointer data)
+{
+    GList *list;
+
+    list = mm_3gpp_parse_cops_test_response ((const gchar *) data, NULL);
+    g_assert (list);
+    mm_3gpp_network_info_list_free (list);
+}
+
+/*****************************************************************************/
+/* +CGDCONT? */
+
+static void
+bench_cgdcont (gconstpointer data)
+{
+    GList *list;
+
+    list = mm_3gpp_parse_cgdcont_read_response ((const gchar *) data, NULL);
+    g_assert (list);
+    mm_3gpp_pdp_context_list_free (list);
+}
+
+/*****************************************************************************/
+/* +CESQ */
+
+static void
+bench_cesq (gconstpointer data)
+{
+    guint rxlev;
+    guint ber;
+    guint rscp;
+    guint ecn0;
+    guint rsrq;
+    guint rsrp;
+
+    g_assert (mm_3gpp_parse_cesq_response ((const gchar *) data, &rxlev, &ber, &rscp, &ecn0, &rsrq, &rsrp, NULL));
+}
+
+/*****************************************************************************/
+/* +CLCC */
+
+static void
+bench_clcc (gconstpointer data)
+{
+    GList *list = NULL;
+
+    g_assert (mm_3gpp_parse_clcc_response ((const gchar *) data, &list, NULL));
+    mm_3gpp_call_info_list_free (list);
+}
+
+/*****************************************************************************/
+/* +CMGL */
+
+static void
+bench_cmgl (gconstpointer data)
+{
+    GList *list;
+
+    list = mm_3gpp_parse_pdu_cmgl_response ((const gchar *) data, NULL);
+    g_assert (list);
+    mm_3gpp_pdu_info_list_free (list);
+}
+
+/*****************************************************************************/
+/* +CIND=? */
+
+static void
+bench_cind (gconstpointer data)
+{
+    GHashTable *table;
+
+    table = mm_3gpp_parse_cind_test_response ((const gchar *) data, NULL);
+    g_assert (table);
+    g_hash_table_unref (table);
+}
+
+/*****************************************************************************/
+/* +CPMS=? */
+
+static void
+bench_cpms (gconstpointer data)
+{
+    GArray *mem1 = NULL;
+    GArray *mem2 = NULL;
+    GArray *mem3 = NULL;
+
+    g_assert (mm_3gpp_parse_cpms_test_response ((const gchar *) data, &mem1, &mem2, &mem3));
+    g_array_unref (mem1);
+    g_array_unref (mem2);
+    g_array_unref (mem3);
+}
+
+/*****************************************************************************/
+/* NMEA traces, one per op; MM_TEST_BENCH_ITERATIONS=1000000 gives the time
+ * needed to go through a million of them */
+
+static MMLocationGpsRaw  *location_gps_raw;
+static MMLocationGpsNmea *location_gps_nmea;
+
+static void
+bench_nmea (gconstpointer data)
+{
+    mm_location_gps_raw_add_trace (location_gps_raw, (const gchar *) data);
+}
+
+static const gchar *nmea_location_updates[] = {
+    "$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43\r\n",
+    "$GPRMC,092751.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*42\r\n",
+};
+
+/* A new trace added to the NMEA location and the location then exported,
+ * as done on every GPS location update; with no trace, just the export, as
+ * done on every GetLocation() call */
+static void
+bench_nmea_location (gconstpointer data)
+{
+    static guint  n_updates;
+    GVariant     *variant;
+
+    if (data)
+        mm_location_gps_nmea_add_trace (location_gps_nmea, nmea_location_updates[n_updates++ % G_N_ELEMENTS (nmea_location_updates)]);
+    variant = mm_location_gps_nmea_get_string_variant (location_gps_nmea);
+    g_variant_unref (variant);
+}
+
+/*****************************************************************************/
+
+void
+_mm_log (const char *loc,
+         const char *func,
+         guint32 level,
+         const char *fmt,
+         ...)
+{
+    va_list args;
+    gchar *msg;
+
+    if (!g_test_verbose ())
+        return;
+
+    va_start (args, fmt);
+    msg = g_strdup_vprintf (fmt, args);
+    va_end (args);
+    g_print ("%s\n", msg);
+    g_free (msg);
+}
+
+int main (int argc, char **argv)
+{
+    gint  result;
+    guint i;
+
+    g_test_init (&argc, &argv, NULL);
+
+    solicited_creg = mm_3gpp_creg_regex_get (TRUE);
+    unsolicited_creg = mm_3gpp_creg_regex_get (FALSE);
+
+    for (i = 0; i < G_N_ELEMENTS (creg_benchs); i++) {
+        mm_test_bench_add (creg_benchs[i].path, bench_creg, &creg_benchs[i]);
+        mm_test_bench_add (creg_benchs[i].line_path, bench_creg_line, &creg_benchs[i]);
+    }
+
+    mm_test_bench_add ("/MM/bench/cops/test", bench_cops,
+                       "+COPS: (1,\"T-Mobile\",\"TMO\",\"31026\",0),(1,\"AT&T\",\"AT&T\",\"310410\",2),"
+                       "(1,\"AT&T\",\"AT&T\",\"310410\",0),,(0,1,2,3,4),)");
+
+    mm_test_bench_add ("/MM/bench/cgdcont/read", bench_cgdcont,
+                       "+CGDCONT: 1,\"IP\",\"nate.sktelecom.com\",\"\",0,0\r\n"
+                       "+CGDCONT: 2,\"IP\",\"epc.tmobile.com\",\"\",0,0\r\n"
+                       "+CGDCONT: 3,\"IPV4V6\",\"ims\",\"\",0,0\r\n");
+
+    mm_test_bench_add ("/MM/bench/cesq/lte",   bench_cesq, "+CESQ: 99,99,255,255,20,80");
+    mm_test_bench_add ("/MM/bench/cesq/umts",  bench_cesq, "+CESQ: 99,99,95,40,255,255");
+
+    mm_test_bench_add ("/MM/bench/clcc/multiple", bench_clcc,
+                       "+CLCC: 1,1,0,0,1\r\n"
+                       "+CLCC: 2,1,0,0,1,\"123456789\",161\r\n"
+                       "+CLCC: 3,1,0,0,1,\"987654321\",161,\"Alice\"\r\n"
+                       "+CLCC: 4,1,0,0,1,\"000000000\",161,\"Bob\",1\r\n"
+                       "+CLCC: 5,1,5,0,0,\"555555555\",161,\"Mallory\",2,0\r\n");
+
+    mm_test_bench_add ("/MM/bench/cmgl/pdu", bench_cmgl,
+                       "+CMGL: 0,1,,147\r\n07914306073011F00405812261F700003130916191314095C27"
+                       "4D96D2FBBD3E437280CB2BEC961F3DB5D76818EF2F0381D9E83E06F39A8CC2E9FD372F"
+                       "77BEE0249CBE37A594E0E83E2F532085E2F93CB73D0B93CA7A7DFEEB01C447F93DF731"
+                       "0BD3E07CDCB727B7A9C7ECF41E432C8FC96B7C32079189E26874179D0F8DD7E93C3A0B"
+                       "21B246AA641D637396C7EBBCB22D0FD7E77B5D376B3AB3C07");
+
+    mm_test_bench_add ("/MM/bench/cind/test", bench_cind,
+                       "+CIND: (\"battchg\",(0-5)),(\"signal\",(0-5)),(\"batterywarning\",(0-1)),"
+                       "(\"chargerconnected\",(0-1)),(\"service\",(0-1)),(\"sounder\",(0-1)),"
+                       "(\"message\",(0-1)),(\"call\",(0-1)),(\"roam\",(0-1)),(\"smsfull\",(0-1)),"
+                       "(\"callsetup\",(0-3)),(\"callheld\",(0-2))");
+
+    mm_test_bench_add ("/MM/bench/cpms/test", bench_cpms,
+                       "+CPMS: (\"ME\",\"MT\"),(\"ME\",\"SM\",\"MT\"),(\"SM\",\"MT\")");
+
+    location_gps_raw = mm_location_gps_raw_new ();
+    mm_test_bench_add ("/MM/bench/nmea/gga", bench_nmea,
+                       "$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76\r\n");
+    mm_test_bench_add ("/MM/bench/nmea/rmc", bench_nmea,
+                       "$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43\r\n");
+    mm_test_bench_add ("/MM/bench/nmea/gsa", bench_nmea,
+                       "$GPGSA,A,3,10,07,05,02,29,04,08,13,,,,,1.72,1.03,1.38*0A\r\n");
+
+    location_gps_nmea = mm_location_gps_nmea_new ();
+    mm_location_gps_nmea_add_trace (location_gps_nmea, "$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76\r\n");
+    mm_location_gps_nmea_add_trace (location_gps_nmea, "$GPGSA,A,3,10,07,05,02,29,04,08,13,,,,,1.72,1.03,1.38*0A\r\n");
+    mm_location_gps_nmea_add_trace (location_gps_nmea, "$GPGSV,3,1,11,10,63,137,17,07,61,098,15,05,59,290,20,08,54,157,30*70\r\n");
+    mm_location_gps_nmea_add_trace (location_gps_nmea, "$GPVTG,31.66,T,,M,0.02,N,0.04,K,A*09\r\n");
+    mm_test_bench_add ("/MM/bench/nmea/location/update", bench_nmea_location, nmea_location_updates);
+    mm_test_bench_add ("/MM/bench/nmea/location/get",    bench_nmea_location, NULL);
+
+    result = g_test_run ();
+
+    g_object_unref (location_gps_nmea);
+    g_object_unref (location_gps_raw);
+    mm_3gpp_creg_regex_destroy (solicited_creg);
+    mm_3gpp_creg_regex_destroy (unsolicited_creg);
+
+    return result;
+}
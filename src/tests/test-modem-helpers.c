@@ -1031,6 +1031,7 @@ test_normalize_operator (void)
 typedef struct {
     GPtrArray *solicited_creg;
     GPtrArray *unsolicited_creg;
+    GPtrArray *line_creg;
 } RegTestData;
 
 static RegTestData *
@@ -1041,6 +1042,7 @@ reg_test_data_new (void)
     data = g_malloc0 (sizeof (RegTestData));
     data->solicited_creg = mm_3gpp_creg_regex_get (TRUE);
     data->unsolicited_creg = mm_3gpp_creg_regex_get (FALSE);
+    data->line_creg = mm_3gpp_creg_line_regex_get ();
     return data;
 }
 
@@ -1049,6 +1051,7 @@ reg_test_data_free (RegTestData *data)
 {
     mm_3gpp_creg_regex_destroy (data->solicited_creg);
     mm_3gpp_creg_regex_destroy (data->unsolicited_creg);
+    mm_3gpp_creg_regex_destroy (data->line_creg);
     g_free (data);
 }
 
@@ -1063,6 +1066,39 @@ typedef struct {
     gboolean cereg;
 } CregResult;
 
+static void
+test_creg_line (const char *reply,
+                gboolean solicited,
+                RegTestData *data,
+                const CregResult *result)
+{
+    MM3gppCregResult line_result;
+    GError *error = NULL;
+    gboolean success;
+    guint i;
+
+    /* Unsolicited messages must also be caught by the line regexes */
+    if (!solicited) {
+        for (i = 0; i < data->line_creg->len; i++) {
+            if (g_regex_match (g_ptr_array_index (data->line_creg, i), reply, 0, NULL))
+                break;
+        }
+        g_assert_cmpuint (i, <, data->line_creg->len);
+    }
+
+    success = mm_3gpp_parse_creg_line (reply, -1, solicited, &line_result, &error);
+    g_assert_no_error (error);
+    g_assert (success);
+    g_assert_cmpuint (line_result.state, ==, result->state);
+    g_assert_cmpuint (line_result.domain == MM_3GPP_CREG_DOMAIN_PS, ==, result->cgreg);
+    g_assert_cmpuint (line_result.domain == MM_3GPP_CREG_DOMAIN_EPS, ==, result->cereg);
+    if (line_result.state != MM_MODEM_3GPP_REGISTRATION_STATE_UNKNOWN) {
+        g_assert_cmpuint (line_result.lac, ==, result->lac);
+        g_assert_cmpuint (line_result.ci, ==, result->ci);
+        g_assert_cmpuint (line_result.act, ==, result->act);
+    }
+}
+
 static void
 test_creg_match (const char *test,
                  gboolean solicited,
@@ -1123,6 +1159,8 @@ test_creg_match (const char *test,
     g_assert_cmpuint (access_tech, ==, result->act);
     g_assert_cmpuint (cgreg, ==, result->cgreg);
     g_assert_cmpuint (cereg, ==, result->cereg);
+
+    test_creg_line (reply, solicited, data, result);
 }
 
 static void
@@ -1529,6 +1567,97 @@ test_cgreg2_thuraya_unsolicited (void *f, gpointer d)
     test_creg_match ("Thuraya unsolicited CREG=2", FALSE, reply, data, &result);
 }
 
+static void
+test_c5greg1_unsolicited (void *f, gpointer d)
+{
+    RegTestData *data = (RegTestData *) d;
+    const char *reply = "\r\n+C5GREG: 2\r\n";
+    const CregResult result = { 2, 0, 0, MM_MODEM_ACCESS_TECHNOLOGY_UNKNOWN, 0, FALSE, FALSE };
+
+    test_creg_line (reply, FALSE, data, &result);
+}
+
+static void
+test_c5greg2_solicited (void *f, gpointer d)
+{
+    RegTestData *data = (RegTestData *) d;
+    const char *reply = "+C5GREG: 2,1,\"1F00\",\"0079D903\",11,0,\"\"";
+    const CregResult result = { 1, 0x1F00, 0x79D903, MM_MODEM_ACCESS_TECHNOLOGY_UNKNOWN, 0, FALSE, FALSE };
+
+    test_creg_line (reply, TRUE, data, &result);
+}
+
+static void
+test_c5greg2_unsolicited (void *f, gpointer d)
+{
+    RegTestData *data = (RegTestData *) d;
+    const char *reply = "\r\n+C5GREG: 5,\"1F00\",\"0079D903\",7,1,\"01.000001\"\r\n";
+    const CregResult result = { 5, 0x1F00, 0x79D903, MM_MODEM_ACCESS_TECHNOLOGY_LTE, 0, FALSE, FALSE };
+
+    test_creg_line (reply, FALSE, data, &result);
+}
+
+static void
+test_creg2_one_digit_lac_unsolicited (void *f, gpointer d)
+{
+    RegTestData *data = (RegTestData *) d;
+    const char *reply = "\r\n+CREG: 2,\"5\",\"00001234\",7\r\n";
+    const CregResult result = { 2, 0x5, 0x1234, MM_MODEM_ACCESS_TECHNOLOGY_LTE, 0, FALSE, FALSE };
+
+    test_creg_line (reply, FALSE, data, &result);
+}
+
+static void
+test_creg2_one_digit_lac_solicited (void *f, gpointer d)
+{
+    RegTestData *data = (RegTestData *) d;
+    const char *reply = "+CREG: 2,1,5,1A2B";
+    const CregResult result = { 1, 0x5, 0x1A2B, MM_MODEM_ACCESS_TECHNOLOGY_UNKNOWN, 0, FALSE, FALSE };
+
+    test_creg_line (reply, TRUE, data, &result);
+}
+
+static void
+test_creg_line_regex_solicited (void *f, gpointer d)
+{
+    RegTestData *data = (RegTestData *) d;
+    static const gchar *replies[] = {
+        "\r\n+CREG: 0,1\r\n\r\nOK\r\n",
+        "\r\n+CGREG: 2,0\r\n\r\nOK\r\n",
+        "\r\n+CEREG: 1,5\r\n\r\nOK\r\n",
+        "\r\n+CREG: (0-2)\r\n\r\nOK\r\n",
+        "\r\n+CREG: 1,\"0502\r\n",
+    };
+    guint i;
+    guint j;
+
+    /* Replies to the read and test commands must be left for the command */
+    for (i = 0; i < G_N_ELEMENTS (replies); i++) {
+        for (j = 0; j < data->line_creg->len; j++)
+            g_assert (!g_regex_match (g_ptr_array_index (data->line_creg, j), replies[i], 0, NULL));
+    }
+}
+
+static void
+test_creg_line_invalid (void *f, gpointer d)
+{
+    MM3gppCregResult result;
+    GError *error = NULL;
+
+    g_assert (!mm_3gpp_parse_creg_line ("+CREG: (0-2)", -1, TRUE, &result, &error));
+    g_assert_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED);
+    g_clear_error (&error);
+
+    g_assert (!mm_3gpp_parse_creg_line ("+COPS: 0", -1, TRUE, &result, &error));
+    g_assert_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED);
+    g_clear_error (&error);
+
+    /* The length limits the parsed line */
+    g_assert (!mm_3gpp_parse_creg_line ("+CREG: 1", 6, TRUE, &result, &error));
+    g_assert_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED);
+    g_clear_error (&error);
+}
+
 /*****************************************************************************/
 /* Test CSCS responses */
 
@@ -4431,6 +4560,58 @@ test_parse_uint_list (void)
 
 /*****************************************************************************/
 
+typedef struct {
+    const gchar *str;
+    guint        n_commands;
+    const gchar *expected[5];
+} SplitCompoundResponseTest;
+
+static const SplitCompoundResponseTest split_compound_response_tests[] = {
+    { "Generic\r\n\r\nModel X\r\n\r\nREV 1.0\r\n\r\n358123456789012", 4,
+      { "Generic", "Model X", "REV 1.0", "358123456789012", NULL } },
+    { "+CGMI: \"QUALCOMM INCORPORATED\"\r\n\r\n+CGMM: \"1234\"", 2,
+      { "+CGMI: \"QUALCOMM INCORPORATED\"", "+CGMM: \"1234\"", NULL } },
+    /* Multi-line responses */
+    { "Generic\r\n\r\nModel X\r\n\r\nREV 1.0\r\nBuilt Jan 1\r\n\r\n358123456789012", 4,
+      { "Generic", "Model X", "REV 1.0\r\nBuilt Jan 1", "358123456789012", NULL } },
+    /* Extra empty lines */
+    { "Generic\r\n\r\n\r\nModel X", 2,
+      { "Generic", "Model X", NULL } },
+    { "Generic", 1, { "Generic", NULL } },
+    /* Wrong number of responses */
+    { "Generic\r\n\r\nModel X\r\n\r\nREV 1.0", 4, { NULL } },
+    { "Generic\r\n\r\nModel X\r\n\r\nREV 1.0", 2, { NULL } },
+    { "Generic\r\nModel X\r\nREV 1.0\r\n358123456789012", 4, { NULL } },
+    { "", 1, { NULL } },
+    { NULL, 1, { NULL } },
+};
+
+static void
+test_split_compound_response (void)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (split_compound_response_tests); i++) {
+        gchar **replies;
+        guint   j;
+
+        replies = mm_split_compound_response (split_compound_response_tests[i].str,
+                                              split_compound_response_tests[i].n_commands);
+        if (!split_compound_response_tests[i].expected[0]) {
+            g_assert (!replies);
+            continue;
+        }
+
+        g_assert (replies);
+        g_assert_cmpuint (g_strv_length (replies), ==, split_compound_response_tests[i].n_commands);
+        for (j = 0; j < split_compound_response_tests[i].n_commands; j++)
+            g_assert_cmpstr (replies[j], ==, split_compound_response_tests[i].expected[j]);
+        g_strfreev (replies);
+    }
+}
+
+/*****************************************************************************/
+
 typedef struct {
     const guint8 bcd[10];
     gsize bcd_len;
@@ -4465,6 +4646,202 @@ test_bcd_to_string (void *f, gpointer d)
     }
 }
 
+/*****************************************************************************/
+/* Regex cache */
+
+static void
+test_regex_cache (void *f, gpointer d)
+{
+    GRegex *a;
+    GRegex *b;
+    GRegex *c;
+    GError *error = NULL;
+
+    a = mm_regex_cache_get ("\\+CREG:\\s*(\\d)", G_REGEX_RAW, 0, NULL);
+    b = mm_regex_cache_get ("\\+CREG:\\s*(\\d)", G_REGEX_RAW, 0, NULL);
+    c = mm_regex_cache_get ("\\+CREG:\\s*(\\d)", G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+    g_assert (a != NULL);
+    g_assert (a == b);
+    g_assert (c != NULL);
+    g_assert (c != a);
+    g_regex_unref (a);
+    g_regex_unref (b);
+    g_regex_unref (c);
+
+    /* Still valid, the cache keeps its own reference */
+    g_assert (g_regex_match (a, "+CREG: 1", 0, NULL));
+
+    g_assert (mm_regex_cache_get ("\\+CREG:(", 0, 0, &error) == NULL);
+    g_assert (error != NULL);
+    g_assert (error->domain == G_REGEX_ERROR);
+    g_error_free (error);
+}
+
+#define REGEX_CACHE_PERF_ITERATIONS 100000
+
+static void
+regex_cache_perf_report (const gchar *name)
+{
+    gdouble ns;
+
+    ns = g_test_timer_elapsed () * 1e9 / REGEX_CACHE_PERF_ITERATIONS;
+    g_test_minimized_result (ns, "%s: %.1f ns/op", name, ns);
+}
+
+static void
+test_regex_cache_perf (void *f, gpointer d)
+{
+    const gchar *pattern = "\\+CGDCONT:\\s*(\\d+)\\s*,([^, \\)]*)\\s*,([^, \\)]*)\\s*,([^, \\)]*)";
+    const gchar *cops = "+COPS: (2,\"T-Mobile\",\"TMO\",\"31026\",0),(1,\"AT&T\",\"AT&T\",\"310410\",0),,(0,1,2,3,4),(0,1,2)";
+    const gchar *cgdcont = "+CGDCONT: 1,\"IP\",\"internet\",\"0.0.0.0\",0,0\r\n+CGDCONT: 2,\"IPV6\",\"ims\",\"\",0,0";
+    const gchar *cpms = "+CPMS: (\"ME\",\"MT\"),(\"ME\",\"SM\",\"MT\"),(\"SM\",\"MT\")";
+    const gchar *cind = "+CIND: (\"signal\",(0-5)),(\"service\",(0-1)),(\"roam\",(0-1))";
+    guint i;
+
+    if (!g_test_perf ())
+        return;
+
+    /* Compiling on every call, as parsers used to do, vs getting the regex
+     * from the cache */
+    g_test_timer_start ();
+    for (i = 0; i < REGEX_CACHE_PERF_ITERATIONS; i++)
+        g_regex_unref (g_regex_new (pattern, G_REGEX_RAW, 0, NULL));
+    regex_cache_perf_report ("g_regex_new()");
+
+    g_test_timer_start ();
+    for (i = 0; i < REGEX_CACHE_PERF_ITERATIONS; i++)
+        g_regex_unref (mm_regex_cache_get (pattern, G_REGEX_RAW, 0, NULL));
+    regex_cache_perf_report ("mm_regex_cache_get()");
+
+    g_test_timer_start ();
+    for (i = 0; i < REGEX_CACHE_PERF_ITERATIONS; i++)
+        mm_3gpp_network_info_list_free (mm_3gpp_parse_cops_test_response (cops, NULL));
+    regex_cache_perf_report ("+COPS=? parser");
+
+    g_test_timer_start ();
+    for (i = 0; i < REGEX_CACHE_PERF_ITERATIONS; i++)
+        mm_3gpp_pdp_context_list_free (mm_3gpp_parse_cgdcont_read_response (cgdcont, NULL));
+    regex_cache_perf_report ("+CGDCONT? parser");
+
+    g_test_timer_start ();
+    for (i = 0; i < REGEX_CACHE_PERF_ITERATIONS; i++) {
+        GArray *mem1 = NULL;
+        GArray *mem2 = NULL;
+        GArray *mem3 = NULL;
+
+        g_assert (mm_3gpp_parse_cpms_test_response (cpms, &mem1, &mem2, &mem3));
+        g_array_unref (mem1);
+        g_array_unref (mem2);
+        g_array_unref (mem3);
+    }
+    regex_cache_perf_report ("+CPMS=? parser");
+
+    g_test_timer_start ();
+    for (i = 0; i < REGEX_CACHE_PERF_ITERATIONS; i++)
+        g_hash_table_unref (mm_3gpp_parse_cind_test_response (cind, NULL));
+    regex_cache_perf_report ("+CIND=? parser");
+}
+
+/*****************************************************************************/
+/* GPS location updates */
+
+static void
+test_gps_trace_update_epoch (void *f, gpointer d)
+{
+    gchar epoch[MM_GPS_EPOCH_MAX_LEN + 1] = "";
+
+    /* The first GGA or RMC trace of a cycle starts it */
+    g_assert (mm_gps_trace_update_epoch ("$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76", epoch));
+    g_assert_cmpstr (epoch, ==, "092750.000");
+    g_assert (!mm_gps_trace_update_epoch ("$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43", epoch));
+    g_assert (!mm_gps_trace_update_epoch ("$GNGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*68", epoch));
+
+    /* Other traces don't tell the cycle */
+    g_assert (!mm_gps_trace_update_epoch ("$GPGSV,3,1,11,10,63,137,17,07,61,098,15,05,59,290,20,08,54,157,30*70", epoch));
+    g_assert (!mm_gps_trace_update_epoch ("$GPVTG,31.66,T,,M,0.02,N,0.04,K,A*09", epoch));
+    g_assert_cmpstr (epoch, ==, "092750.000");
+
+    /* Neither do GGA and RMC traces without time */
+    g_assert (!mm_gps_trace_update_epoch ("$GPGGA,,,,,,0,,,,,,,,*66", epoch));
+    g_assert (!mm_gps_trace_update_epoch ("$GPRMC,0927510000000000000,A*43", epoch));
+    g_assert (!mm_gps_trace_update_epoch ("$GPGGA,092751.000", epoch));
+    g_assert (!mm_gps_trace_update_epoch ("$GP", epoch));
+    g_assert_cmpstr (epoch, ==, "092750.000");
+
+    /* The next cycle, even if the time is shorter */
+    g_assert (mm_gps_trace_update_epoch ("$GPRMC,092751,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43", epoch));
+    g_assert_cmpstr (epoch, ==, "092751");
+    g_assert (mm_gps_trace_update_epoch ("$GPGGA,092751.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*77", epoch));
+    g_assert_cmpstr (epoch, ==, "092751.000");
+}
+
+#define MS 1000
+
+static void
+test_gps_update_ready (void *f, gpointer d)
+{
+    gint64 delay_us = -1;
+
+    /* Nothing published yet: once the traces stop coming */
+    g_assert (!mm_gps_update_ready (1000 * MS, FALSE, 990 * MS, 0, 0, &delay_us));
+    g_assert_cmpint (delay_us, ==, 40 * MS);
+    g_assert (mm_gps_update_ready (1040 * MS, FALSE, 990 * MS, 0, 0, &delay_us));
+    g_assert_cmpint (delay_us, ==, 0);
+
+    /* Right away if a new cycle already started */
+    g_assert (mm_gps_update_ready (1000 * MS, TRUE, 1000 * MS, 0, 0, &delay_us));
+
+    /* Without a refresh rate, every cycle is published */
+    g_assert (mm_gps_update_ready (1000 * MS, TRUE, 1000 * MS, 999 * MS, 0, &delay_us));
+
+    /* Otherwise, deferred until the refresh rate allows it, even if a new
+     * cycle started */
+    g_assert (!mm_gps_update_ready (1200 * MS, TRUE, 1200 * MS, 1000 * MS, 500, &delay_us));
+    g_assert_cmpint (delay_us, ==, 300 * MS);
+    g_assert (!mm_gps_update_ready (1480 * MS, FALSE, 1200 * MS, 1000 * MS, 500, &delay_us));
+    g_assert_cmpint (delay_us, ==, 20 * MS);
+    g_assert (mm_gps_update_ready (1500 * MS, FALSE, 1200 * MS, 1000 * MS, 500, &delay_us));
+
+    /* The cycle must be complete as well */
+    g_assert (!mm_gps_update_ready (1500 * MS, FALSE, 1490 * MS, 1000 * MS, 500, &delay_us));
+    g_assert_cmpint (delay_us, ==, 40 * MS);
+
+    /* Long refresh rates don't overflow */
+    g_assert (!mm_gps_update_ready (1000 * MS, TRUE, 0, 1000 * MS, G_MAXUINT, &delay_us));
+    g_assert_cmpint (delay_us, ==, (gint64) G_MAXUINT * MS);
+}
+
+#undef MS
+
+static void
+test_gps_refresh_rate_normalize (void *f, gpointer d)
+{
+    guint rate_secs;
+    guint rate_ms;
+
+    mm_gps_refresh_rate_normalize (30, FALSE, &rate_secs, &rate_ms);
+    g_assert_cmpuint (rate_secs, ==, 30);
+    g_assert_cmpuint (rate_ms, ==, 30000);
+
+    mm_gps_refresh_rate_normalize (0, FALSE, &rate_secs, &rate_ms);
+    g_assert_cmpuint (rate_secs, ==, 0);
+    g_assert_cmpuint (rate_ms, ==, 0);
+
+    /* Rates in milliseconds are truncated to whole seconds */
+    mm_gps_refresh_rate_normalize (1500, TRUE, &rate_secs, &rate_ms);
+    g_assert_cmpuint (rate_secs, ==, 1);
+    g_assert_cmpuint (rate_ms, ==, 1500);
+
+    mm_gps_refresh_rate_normalize (200, TRUE, &rate_secs, &rate_ms);
+    g_assert_cmpuint (rate_secs, ==, 0);
+    g_assert_cmpuint (rate_ms, ==, 200);
+
+    /* Rates in seconds are clamped to what fits in milliseconds */
+    mm_gps_refresh_rate_normalize (G_MAXUINT, FALSE, &rate_secs, &rate_ms);
+    g_assert_cmpuint (rate_secs, ==, G_MAXUINT);
+    g_assert_cmpuint (rate_ms, ==, (G_MAXUINT / 1000) * 1000);
+}
+
 /*****************************************************************************/
 
 void
@@ -4601,6 +4978,14 @@ int main (int argc, char **argv)
     g_test_suite_add (suite, TESTCASE (test_creg_cgreg_multi_unsolicited, reg_data));
     g_test_suite_add (suite, TESTCASE (test_creg_cgreg_multi2_unsolicited, reg_data));
 
+    g_test_suite_add (suite, TESTCASE (test_c5greg1_unsolicited, reg_data));
+    g_test_suite_add (suite, TESTCASE (test_c5greg2_solicited, reg_data));
+    g_test_suite_add (suite, TESTCASE (test_c5greg2_unsolicited, reg_data));
+    g_test_suite_add (suite, TESTCASE (test_creg2_one_digit_lac_unsolicited, reg_data));
+    g_test_suite_add (suite, TESTCASE (test_creg2_one_digit_lac_solicited, reg_data));
+    g_test_suite_add (suite, TESTCASE (test_creg_line_regex_solicited, reg_data));
+    g_test_suite_add (suite, TESTCASE (test_creg_line_invalid, NULL));
+
     g_test_suite_add (suite, TESTCASE (test_cscs_icon225_support_response, NULL));
     g_test_suite_add (suite, TESTCASE (test_cscs_sierra_mercury_support_response, NULL));
     g_test_suite_add (suite, TESTCASE (test_cscs_buslink_support_response, NULL));
@@ -4712,8 +5097,17 @@ int main (int argc, char **argv)
 
     g_test_suite_add (suite, TESTCASE (test_parse_uint_list, NULL));
 
+    g_test_suite_add (suite, TESTCASE (test_split_compound_response, NULL));
+
     g_test_suite_add (suite, TESTCASE (test_bcd_to_string, NULL));
 
+    g_test_suite_add (suite, TESTCASE (test_gps_trace_update_epoch, NULL));
+    g_test_suite_add (suite, TESTCASE (test_gps_update_ready, NULL));
+    g_test_suite_add (suite, TESTCASE (test_gps_refresh_rate_normalize, NULL));
+
+    g_test_suite_add (suite, TESTCASE (test_regex_cache, NULL));
+    g_test_suite_add (suite, TESTCASE (test_regex_cache_perf, NULL));
+
     result = g_test_run ();
 
     reg_test_data_free (reg_data);
@@ -0,0 +1,384 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include <ModemManager.h>
+#include <mm-errors-types.h>
+
+#include "mm-port-capture.h"
+#include "mm-port-capture-decoder.h"
+#include "mm-port-serial-at.h"
+#include "mm-port-serial-qcdm.h"
+#include "mm-log.h"
+#include "libqcdm/src/utils.h"
+
+#define AT_COMMAND  "AT+CGMI\r"
+#define AT_REPLY_1  "\r\nSierra"
+#define AT_REPLY_2  " Wireless\r\n\r\nOK\r\n"
+
+static gchar *
+create_tmp_path (void)
+{
+    GError *error = NULL;
+    gchar  *path;
+    gint    fd;
+
+    /* The capture file must not exist, so that it gets the file header */
+    fd = g_file_open_tmp ("test-port-capture-XXXXXX", &path, &error);
+    g_assert_no_error (error);
+    close (fd);
+    unlink (path);
+    return path;
+}
+
+static void
+capture_start (const gchar *path)
+{
+    GError *error = NULL;
+
+    g_assert (mm_port_capture_start (path, &error));
+    g_assert_no_error (error);
+    g_assert (mm_port_capture_is_enabled ());
+}
+
+static void
+capture_bytes (gpointer                port,
+               MMPortCaptureDirection  direction,
+               const gchar            *data,
+               gsize                   len)
+{
+    mm_port_capture_data (MM_PORT (port), direction, (const guint8 *) data, len);
+}
+
+static void
+capture (gpointer                port,
+         MMPortCaptureDirection  direction,
+         const gchar            *data)
+{
+    capture_bytes (port, direction, data, strlen (data));
+}
+
+static guint16
+read_le16 (const guint8 *data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+static guint32
+read_le32 (const guint8 *data)
+{
+    return read_le16 (data) | ((guint32) read_le16 (&data[2]) << 16);
+}
+
+static gint64
+read_le64 (const guint8 *data)
+{
+    return (gint64) (read_le32 (data) | ((guint64) read_le32 (&data[4]) << 32));
+}
+
+/* Decodes the whole file, and returns the transcript lines without the
+ * timestamps */
+static gchar **
+decode (const gchar  *path,
+        gboolean      hex,
+        GError      **error)
+{
+    FILE     *file;
+    GString  *transcript;
+    GString  *stripped;
+    gchar   **lines;
+    guint     i;
+
+    file = fopen (path, "rb");
+    g_assert (file);
+    transcript = g_string_new (NULL);
+    mm_port_capture_decode (file, hex, transcript, error);
+    fclose (file);
+
+    stripped = g_string_new (NULL);
+    lines = g_strsplit (transcript->str, "\n", -1);
+    for (i = 0; lines[i] && lines[i][0]; i++) {
+        const gchar *line = lines[i];
+
+        if (line[0] == '[') {
+            line = strstr (line, "] ");
+            g_assert (line);
+            line += 2;
+        }
+        g_string_append_printf (stripped, "%s%s", i ? "\n" : "", line);
+    }
+    g_strfreev (lines);
+    g_string_free (transcript, TRUE);
+
+    lines = g_strsplit (stripped->str, "\n", -1);
+    g_string_free (stripped, TRUE);
+    return lines;
+}
+
+static void
+assert_lines (gchar       **lines,
+              const gchar **expected)
+{
+    guint i;
+
+    for (i = 0; expected[i]; i++)
+        g_assert_cmpstr (lines[i], ==, expected[i]);
+    g_assert_cmpstr (lines[i], ==, NULL);
+}
+
+/*****************************************************************************/
+
+static void
+test_format (void)
+{
+    MMPortSerialAt *port;
+    gchar          *path;
+    gchar          *contents;
+    gsize           len;
+    const guint8   *port_record;
+    const guint8   *record;
+    gint64          before;
+    gint64          after;
+    GError         *error = NULL;
+
+    g_assert_cmpuint (sizeof (MMPortCaptureFileHeader), ==, 12);
+    g_assert_cmpuint (sizeof (MMPortCaptureRecordHeader), ==, 16);
+
+    path = create_tmp_path ();
+    port = mm_port_serial_at_new ("ttyUSB2", MM_PORT_SUBSYS_TTY);
+
+    before = g_get_real_time ();
+    capture_start (path);
+    capture (port, MM_PORT_CAPTURE_DIRECTION_OUT, AT_COMMAND);
+    mm_port_capture_stop ();
+    after = g_get_real_time ();
+    g_assert (!mm_port_capture_is_enabled ());
+
+    g_assert (g_file_get_contents (path, &contents, &len, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (len, ==, 12 + 16 + strlen ("ttyUSB2") + 16 + strlen (AT_COMMAND));
+
+    /* File header: magic and little endian version */
+    g_assert (memcmp (contents, "MMPCAP\r\n", 8) == 0);
+    g_assert_cmpuint (read_le32 ((const guint8 *) &contents[8]), ==, MM_PORT_CAPTURE_VERSION);
+
+    /* PORT record: type, port type, id, length, timestamp, name */
+    port_record = (const guint8 *) &contents[12];
+    g_assert_cmpuint (port_record[0], ==, MM_PORT_CAPTURE_RECORD_PORT);
+    g_assert_cmpuint (port_record[1], ==, MM_PORT_TYPE_AT);
+    g_assert_cmpuint (read_le16 (&port_record[2]), ==, 0);
+    g_assert_cmpuint (read_le32 (&port_record[4]), ==, strlen ("ttyUSB2"));
+    g_assert_cmpint (read_le64 (&port_record[8]), >=, before);
+    g_assert_cmpint (read_le64 (&port_record[8]), <=, after);
+    g_assert (memcmp (&port_record[16], "ttyUSB2", strlen ("ttyUSB2")) == 0);
+
+    /* DATA record: type, direction, id, length, timestamp, raw bytes */
+    record = port_record + 16 + strlen ("ttyUSB2");
+    g_assert_cmpuint (record[0], ==, MM_PORT_CAPTURE_RECORD_DATA);
+    g_assert_cmpuint (record[1], ==, MM_PORT_CAPTURE_DIRECTION_OUT);
+    g_assert_cmpuint (read_le16 (&record[2]), ==, 0);
+    g_assert_cmpuint (read_le32 (&record[4]), ==, strlen (AT_COMMAND));
+    g_assert_cmpint (read_le64 (&record[8]), >=, read_le64 (&port_record[8]));
+    g_assert_cmpint (read_le64 (&record[8]), <=, after);
+    g_assert (memcmp (&record[16], AT_COMMAND, strlen (AT_COMMAND)) == 0);
+
+    g_free (contents);
+    g_object_unref (port);
+    unlink (path);
+    g_free (path);
+}
+
+static void
+test_decode (void)
+{
+    MMPortSerialAt   *at;
+    MMPortSerialQcdm *qcdm;
+    gchar            *path;
+    gchar           **lines;
+    gchar             cmd[16] = { 0x00 }; /* version info */
+    gchar             frame[32];
+    gsize             frame_len;
+    GError           *error = NULL;
+    const gchar      *expected[] = {
+        "ttyUSB2 --> 'AT+CGMI<CR>'",
+        "ttyUSB2 <-- 'Sierra Wireless<CR><LF>'",
+        "ttyUSB2 <-- 'OK<CR><LF>'",
+        "ttyUSB0 --> QCDM command 0: 00",
+        /* second session, with the ids given in the opposite order */
+        "ttyUSB0 --> QCDM command 0: 00",
+        "ttyUSB2 --> 'AT+CGMI<CR>'",
+        NULL
+    };
+
+    path = create_tmp_path ();
+    at = mm_port_serial_at_new ("ttyUSB2", MM_PORT_SUBSYS_TTY);
+    qcdm = mm_port_serial_qcdm_new ("ttyUSB0");
+
+    frame_len = dm_encapsulate_buffer (cmd, 1, sizeof (cmd), frame, sizeof (frame));
+    g_assert_cmpuint (frame_len, >, 3);
+
+    /* Data split in several reads is reassembled into lines and frames, and
+     * empty lines skipped */
+    capture_start (path);
+    capture (at, MM_PORT_CAPTURE_DIRECTION_OUT, AT_COMMAND);
+    capture (at, MM_PORT_CAPTURE_DIRECTION_IN, AT_REPLY_1);
+    capture (at, MM_PORT_CAPTURE_DIRECTION_IN, AT_REPLY_2);
+    capture_bytes (qcdm, MM_PORT_CAPTURE_DIRECTION_OUT, frame, 2);
+    capture_bytes (qcdm, MM_PORT_CAPTURE_DIRECTION_OUT, &frame[2], frame_len - 2);
+    mm_port_capture_stop ();
+
+    /* New session appended to the same file, with new PORT records */
+    capture_start (path);
+    capture_bytes (qcdm, MM_PORT_CAPTURE_DIRECTION_OUT, frame, frame_len);
+    capture (at, MM_PORT_CAPTURE_DIRECTION_OUT, AT_COMMAND);
+    mm_port_capture_stop ();
+
+    lines = decode (path, FALSE, &error);
+    g_assert_no_error (error);
+    assert_lines (lines, expected);
+    g_strfreev (lines);
+
+    g_object_unref (qcdm);
+    g_object_unref (at);
+    unlink (path);
+    g_free (path);
+}
+
+static void
+test_decode_hex (void)
+{
+    MMPortSerialAt *at;
+    gchar          *path;
+    gchar         **lines;
+    GError         *error = NULL;
+    const gchar    *expected[] = {
+        "ttyUSB2 --> raw: 41:54:0d",
+        "ttyUSB2 --> 'AT<CR>'",
+        "ttyUSB2 <-- raw: 0d:0a:4f:4b",
+        "ttyUSB2 <-- raw: 0d:0a",
+        "ttyUSB2 <-- 'OK<CR><LF>'",
+        NULL
+    };
+
+    path = create_tmp_path ();
+    at = mm_port_serial_at_new ("ttyUSB2", MM_PORT_SUBSYS_TTY);
+
+    capture_start (path);
+    capture (at, MM_PORT_CAPTURE_DIRECTION_OUT, "AT\r");
+    capture (at, MM_PORT_CAPTURE_DIRECTION_IN, "\r\nOK");
+    capture (at, MM_PORT_CAPTURE_DIRECTION_IN, "\r\n");
+    mm_port_capture_stop ();
+
+    lines = decode (path, TRUE, &error);
+    g_assert_no_error (error);
+    assert_lines (lines, expected);
+    g_strfreev (lines);
+
+    g_object_unref (at);
+    unlink (path);
+    g_free (path);
+}
+
+static void
+test_decode_errors (void)
+{
+    MMPortSerialAt *at;
+    gchar          *path;
+    gchar          *contents;
+    gsize           len;
+    gchar         **lines;
+    GError         *error = NULL;
+    const gchar    *expected[] = {
+        "ttyUSB2 --> 'AT<CR>'",
+        NULL
+    };
+
+    path = create_tmp_path ();
+    at = mm_port_serial_at_new ("ttyUSB2", MM_PORT_SUBSYS_TTY);
+
+    capture_start (path);
+    capture (at, MM_PORT_CAPTURE_DIRECTION_OUT, "AT\r");
+    capture (at, MM_PORT_CAPTURE_DIRECTION_IN, "\r\nOK\r\n");
+    mm_port_capture_stop ();
+
+    /* Truncated last record: what was decoded before is kept */
+    g_assert (g_file_get_contents (path, &contents, &len, NULL));
+    g_assert (g_file_set_contents (path, contents, len - 1, NULL));
+    lines = decode (path, FALSE, &error);
+    g_assert_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED);
+    g_clear_error (&error);
+    assert_lines (lines, expected);
+    g_strfreev (lines);
+
+    /* Wrong magic */
+    contents[0] = 'X';
+    g_assert (g_file_set_contents (path, contents, len, NULL));
+    lines = decode (path, FALSE, &error);
+    g_assert_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED);
+    g_clear_error (&error);
+    g_strfreev (lines);
+
+    /* Unknown format version */
+    contents[0] = 'M';
+    contents[8] = MM_PORT_CAPTURE_VERSION + 1;
+    g_assert (g_file_set_contents (path, contents, len, NULL));
+    lines = decode (path, FALSE, &error);
+    g_assert_error (error, MM_CORE_ERROR, MM_CORE_ERROR_UNSUPPORTED);
+    g_clear_error (&error);
+    g_strfreev (lines);
+
+    g_free (contents);
+    g_object_unref (at);
+    unlink (path);
+    g_free (path);
+}
+
+/*****************************************************************************/
+
+void
+_mm_log (const char *loc,
+         const char *func,
+         guint32 level,
+         const char *fmt,
+         ...)
+{
+    va_list args;
+    gchar *msg;
+
+    if (!g_test_verbose ())
+        return;
+
+    va_start (args, fmt);
+    msg = g_strdup_vprintf (fmt, args);
+    va_end (args);
+    g_print ("%s\n", msg);
+    g_free (msg);
+}
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/port-capture/format",        test_format);
+    g_test_add_func ("/MM/port-capture/decode",        test_decode);
+    g_test_add_func ("/MM/port-capture/decode-hex",    test_decode_hex);
+    g_test_add_func ("/MM/port-capture/decode-errors", test_decode_errors);
+
+    return g_test_run ();
+}
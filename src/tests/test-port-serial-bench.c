@@ -0,0 +1,194 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pty.h>
+#include <unistd.h>
+#include <termios.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <glib-unix.h>
+#include <glib-object.h>
+
+#include <ModemManager.h>
+#include <mm-errors-types.h>
+
+#include "mm-port-serial-at.h"
+#include "mm-log.h"
+#include "test-bench.h"
+
+/* Round trips of AT commands through a pty: the port writes the command and
+ * reads the reply given by a fake modem, which answers every command with
+ * an OK as soon as it gets the whole of it. */
+
+#define PACED_SEND_DELAY 100 /* us */
+
+static const gchar    command[] = "+CSQ";
+static MMPortSerialAt *port;
+static gint            master = -1;
+static gint            slave = -1;
+static guint           master_id;
+
+/*****************************************************************************/
+/* Fake modem */
+
+static gboolean
+master_input_available (gint         fd,
+                        GIOCondition condition,
+                        gpointer     user_data)
+{
+    static const gchar reply[] = "\r\nOK\r\n";
+    gchar              buf[256];
+    gssize             len;
+    gssize             i;
+
+    len = read (fd, buf, sizeof (buf));
+    for (i = 0; i < len; i++) {
+        if (buf[i] == '\r')
+            g_assert_cmpint (write (fd, reply, strlen (reply)), ==, strlen (reply));
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+setup_port (void)
+{
+    struct termios stbuf;
+    GError        *error = NULL;
+    gboolean       success;
+
+    g_assert_cmpint (openpty (&master, &slave, NULL, NULL, NULL), ==, 0);
+
+    /* raw mode on the slave, so that there is no echo */
+    memset (&stbuf, 0, sizeof (stbuf));
+    tcgetattr (slave, &stbuf);
+    cfmakeraw (&stbuf);
+    tcsetattr (slave, TCSANOW, &stbuf);
+    fcntl (master, F_SETFL, O_NONBLOCK);
+
+    master_id = g_unix_fd_add (master, G_IO_IN, master_input_available, NULL);
+
+    port = MM_PORT_SERIAL_AT (g_object_new (MM_TYPE_PORT_SERIAL_AT,
+                                            MM_PORT_DEVICE, "pty",
+                                            MM_PORT_SUBSYS, MM_PORT_SUBSYS_TTY,
+                                            MM_PORT_TYPE, MM_PORT_TYPE_AT,
+                                            MM_PORT_SERIAL_FD, slave,
+                                            MM_PORT_SERIAL_AT_INIT_SEQUENCE_ENABLED, FALSE,
+                                            MM_PORT_SERIAL_AT_REMOVE_ECHO, FALSE,
+                                            NULL));
+
+    success = mm_port_serial_open (MM_PORT_SERIAL (port), &error);
+    g_assert_no_error (error);
+    g_assert (success);
+}
+
+static void
+cleanup_port (void)
+{
+    /* The slave is closed along with the port */
+    mm_port_serial_close (MM_PORT_SERIAL (port));
+    g_object_unref (port);
+    g_source_remove (master_id);
+    close (master);
+}
+
+/*****************************************************************************/
+
+static void
+command_ready (MMPortSerialAt *_port,
+               GAsyncResult   *res,
+               gboolean       *done)
+{
+    const gchar *response;
+    GError      *error = NULL;
+
+    response = mm_port_serial_at_command_finish (_port, res, &error);
+    g_assert_no_error (error);
+    g_assert_cmpstr (response, ==, "");
+    *done = TRUE;
+}
+
+static void
+run_command (guint64 send_delay)
+{
+    gboolean done = FALSE;
+
+    g_object_set (port, MM_PORT_SERIAL_SEND_DELAY, send_delay, NULL);
+    mm_port_serial_at_command (port, command, 3, FALSE, FALSE, NULL,
+                               (GAsyncReadyCallback) command_ready, &done);
+    while (!done)
+        g_main_context_iteration (NULL, TRUE);
+}
+
+/* The whole command in a single write */
+static void
+bench_command (gconstpointer data)
+{
+    run_command (0);
+}
+
+/* One byte every PACED_SEND_DELAY us; "AT<command><CR>" can't take less than
+ * the time needed to write all its bytes after the first one */
+static void
+bench_command_paced (gconstpointer data)
+{
+    gint64 start;
+    gint64 elapsed;
+
+    start = g_get_monotonic_time ();
+    run_command (PACED_SEND_DELAY);
+    elapsed = g_get_monotonic_time () - start;
+    g_assert_cmpint (elapsed, >=, (gint64) (strlen (command) + 2) * PACED_SEND_DELAY);
+}
+
+/*****************************************************************************/
+
+void
+_mm_log (const char *loc,
+         const char *func,
+         guint32 level,
+         const char *fmt,
+         ...)
+{
+    va_list args;
+    gchar *msg;
+
+    if (!g_test_verbose ())
+        return;
+
+    va_start (args, fmt);
+    msg = g_strdup_vprintf (fmt, args);
+    va_end (args);
+    g_print ("%s\n", msg);
+    g_free (msg);
+}
+
+int main (int argc, char **argv)
+{
+    gint result;
+
+    g_test_init (&argc, &argv, NULL);
+
+    setup_port ();
+
+    mm_test_bench_add ("/MM/bench/port-serial/command",       bench_command,       NULL);
+    mm_test_bench_add ("/MM/bench/port-serial/command-paced", bench_command_paced, NULL);
+
+    result = g_test_run ();
+
+    cleanup_port ();
+
+    return result;
+}
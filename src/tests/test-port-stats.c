@@ -0,0 +1,158 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+#include <stdarg.h>
+#include <glib.h>
+
+#include "mm-port-stats.h"
+#include "mm-log.h"
+
+static void
+check_at_key (const gchar *command,
+              const gchar *expected)
+{
+    gchar key[MM_PORT_STATS_KEY_SIZE];
+
+    mm_port_stats_build_at_key ((const guint8 *) command, strlen (command), key);
+    g_assert_cmpstr (key, ==, expected);
+}
+
+static void
+test_at_key (void)
+{
+    check_at_key ("AT+CGMI\r",          "AT+CGMI");
+    check_at_key ("at+cgmi\r",          "AT+CGMI");
+    check_at_key ("AT+CGDCONT=1,\"IP\",\"internet\"\r", "AT+CGDCONT");
+    check_at_key ("AT+CREG?\r",         "AT+CREG");
+    check_at_key ("AT+CREG=?\r",        "AT+CREG");
+    check_at_key ("AT^SYSINFO\r",       "AT^SYSINFO");
+    check_at_key ("AT$QCPDPP=1\r",      "AT$QCPDPP");
+    check_at_key ("AT*E2NAP=1\r",       "AT*E2NAP");
+    check_at_key ("AT&F\r",             "AT&F");
+    check_at_key ("ATE0\r",             "ATE");
+    check_at_key ("ATE0V1\r",           "ATE");
+    check_at_key ("ATS0=0\r",           "ATS");
+    check_at_key ("ATZ\r",              "ATZ");
+    check_at_key ("AT\r",               "AT");
+    check_at_key ("AT+CPIN=\"1234\"\r", "AT+CPIN");
+}
+
+static void
+test_at_key_dial (void)
+{
+    /* Numbers must never be part of the key */
+    check_at_key ("ATD+15551234567;\r", "ATD");
+    check_at_key ("ATD5551234\r",       "ATD");
+    check_at_key ("ATDT5551234\r",      "ATD");
+    check_at_key ("ATDP5551234W1\r",    "ATD");
+    check_at_key ("atd*99#\r",          "ATD");
+    check_at_key ("AT+CMGS=23\r",       "AT+CMGS");
+    check_at_key ("AT+CMGS=\"+15551234567\"\r", "AT+CMGS");
+    check_at_key ("AT+CMGS=23\r0011000B915155214365F70000AA0AE8329BFD4697D9EC37\x1a", "AT+CMGS");
+}
+
+static void
+test_at_key_raw (void)
+{
+    /* SMS PDU bodies are sent on their own, and must not leak either */
+    check_at_key ("0011000B915155214365F70000AA0AE8329BFD4697D9EC37\x1a", "raw");
+    check_at_key ("Hello there\x1a", "raw");
+    check_at_key ("A/",              "raw");
+    check_at_key ("A",               "raw");
+    check_at_key ("",                "raw");
+}
+
+static void
+test_at_key_length (void)
+{
+    gchar  command[64];
+    gchar  key[MM_PORT_STATS_KEY_SIZE];
+
+    memset (command, 'X', sizeof (command));
+    memcpy (command, "AT+", 3);
+    mm_port_stats_build_at_key ((const guint8 *) command, sizeof (command), key);
+    g_assert_cmpuint (strlen (key), ==, MM_PORT_STATS_KEY_SIZE - 1);
+    g_assert (g_str_has_prefix (key, "AT+XXX"));
+}
+
+static void
+test_dial_keys_shared (void)
+{
+    MMPortStats *stats;
+    GVariant    *dictionary;
+    GVariant    *latencies;
+    const gchar *key;
+    guint        i;
+
+    stats = mm_port_stats_new ();
+
+    /* Every dial is accounted under the same key, so that the table doesn't
+     * fill up with one entry per number */
+    for (i = 0; i < 100; i++) {
+        gchar  command[32];
+        gchar  command_key[MM_PORT_STATS_KEY_SIZE];
+        gsize  len;
+
+        len = g_snprintf (command, sizeof (command), "ATD+1555%07u;\r", i);
+        mm_port_stats_build_at_key ((const guint8 *) command, len, command_key);
+        mm_port_stats_add_reply (stats, command_key, 1500);
+    }
+
+    dictionary = g_variant_ref_sink (mm_port_stats_get_dictionary (stats, "ttyUSB0"));
+    latencies = g_variant_lookup_value (dictionary, "latencies", G_VARIANT_TYPE ("a(sau)"));
+    g_assert (latencies);
+    g_assert_cmpuint (g_variant_n_children (latencies), ==, 1);
+    g_variant_get_child (latencies, 0, "(&s@au)", &key, NULL);
+    g_assert_cmpstr (key, ==, "ATD");
+    g_variant_unref (latencies);
+    g_variant_unref (dictionary);
+
+    mm_port_stats_free (stats);
+}
+
+/*****************************************************************************/
+
+void
+_mm_log (const char *loc,
+         const char *func,
+         guint32 level,
+         const char *fmt,
+         ...)
+{
+    va_list args;
+    gchar *msg;
+
+    if (!g_test_verbose ())
+        return;
+
+    va_start (args, fmt);
+    msg = g_strdup_vprintf (fmt, args);
+    va_end (args);
+    g_print ("%s\n", msg);
+    g_free (msg);
+}
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/port-stats/at-key",              test_at_key);
+    g_test_add_func ("/MM/port-stats/at-key-dial",         test_at_key_dial);
+    g_test_add_func ("/MM/port-stats/at-key-raw",          test_at_key_raw);
+    g_test_add_func ("/MM/port-stats/at-key-length",       test_at_key_length);
+    g_test_add_func ("/MM/port-stats/dial-keys-shared",    test_dial_keys_shared);
+
+    return g_test_run ();
+}
@@ -0,0 +1,367 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include "mm-probe-cache-helpers.h"
+#include "mm-log.h"
+
+#define UID       "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-2"
+#define OTHER_UID "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-3"
+#define VID       0x1199
+#define PID       0x68a2
+#define PLUGIN    "sierra"
+
+static gchar *
+create_tmp_path (const gchar *contents)
+{
+    GError *error = NULL;
+    gchar  *path;
+    gint    fd;
+
+    fd = g_file_open_tmp ("test-probe-cache-XXXXXX", &path, &error);
+    g_assert_no_error (error);
+    close (fd);
+
+    if (contents) {
+        g_assert (g_file_set_contents (path, contents, -1, &error));
+        g_assert_no_error (error);
+    } else
+        unlink (path);
+
+    return path;
+}
+
+/* Stores a device with two ports the way the daemon does it */
+static void
+store_device (GKeyFile    *cache,
+              const gchar *uid,
+              const gchar *revision)
+{
+    gchar *group;
+
+    group = mm_probe_cache_build_device_group (uid, VID, PID);
+    g_key_file_set_string (cache, group, MM_PROBE_CACHE_DEVICE_KEY_PLUGIN, PLUGIN);
+    g_key_file_set_integer (cache, group, MM_PROBE_CACHE_DEVICE_KEY_N_PORTS, 2);
+    if (revision)
+        g_key_file_set_string (cache, group, MM_PROBE_CACHE_DEVICE_KEY_REVISION, revision);
+    g_free (group);
+
+    group = mm_probe_cache_build_port_group (uid, VID, PID, "tty", "03");
+    g_key_file_set_integer (cache, group, MM_PROBE_CACHE_PORT_KEY_PROBED, 0x3);
+    g_key_file_set_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_AT, TRUE);
+    g_key_file_set_string (cache, group, MM_PROBE_CACHE_PORT_KEY_VENDOR, "Sierra Wireless, Incorporated");
+    g_free (group);
+
+    group = mm_probe_cache_build_port_group (uid, VID, PID, "usbmisc", "08");
+    g_key_file_set_integer (cache, group, MM_PROBE_CACHE_PORT_KEY_PROBED, 0x40);
+    g_key_file_set_boolean (cache, group, MM_PROBE_CACHE_PORT_KEY_QMI, TRUE);
+    g_free (group);
+}
+
+static gboolean
+has_device_group (GKeyFile    *cache,
+                  const gchar *uid)
+{
+    gchar    *group;
+    gboolean  found;
+
+    group = mm_probe_cache_build_device_group (uid, VID, PID);
+    found = g_key_file_has_group (cache, group);
+    g_free (group);
+    return found;
+}
+
+static guint
+count_port_groups (GKeyFile    *cache,
+                   const gchar *uid)
+{
+    gchar **groups;
+    gchar  *prefix;
+    guint   n = 0;
+    guint   i;
+
+    prefix = g_strdup_printf ("port %04x:%04x %s ", VID, PID, uid);
+    groups = g_key_file_get_groups (cache, NULL);
+    for (i = 0; groups[i]; i++) {
+        if (g_str_has_prefix (groups[i], prefix))
+            n++;
+    }
+    g_strfreev (groups);
+    g_free (prefix);
+    return n;
+}
+
+/*****************************************************************************/
+
+static void
+test_build_groups (void)
+{
+    gchar *group;
+
+    group = mm_probe_cache_build_device_group (UID, VID, PID);
+    g_assert_cmpstr (group, ==, "device 1199:68a2 " UID);
+    g_free (group);
+
+    /* VID/PID always printed with 4 lowercase hex digits */
+    group = mm_probe_cache_build_device_group ("abc", 0x5, 0xABCD);
+    g_assert_cmpstr (group, ==, "device 0005:abcd abc");
+    g_free (group);
+
+    group = mm_probe_cache_build_port_group (UID, VID, PID, "tty", "03");
+    g_assert_cmpstr (group, ==, "port 1199:68a2 " UID " tty 03");
+    g_free (group);
+
+    /* Ports sharing the same interface are told apart by subsystem */
+    group = mm_probe_cache_build_port_group (UID, VID, PID, "net", "08");
+    g_assert_cmpstr (group, ==, "port 1199:68a2 " UID " net 08");
+    g_free (group);
+}
+
+static void
+test_save_load (void)
+{
+    GKeyFile *cache;
+    GKeyFile *loaded;
+    GError   *error = NULL;
+    gchar    *path;
+    gchar    *group;
+    gchar    *str;
+    gchar    *data;
+    gchar    *loaded_data;
+
+    path = create_tmp_path (NULL);
+
+    cache = g_key_file_new ();
+    store_device (cache, UID, "SWI9X30C_02.24.05.06");
+    g_assert (mm_probe_cache_save (cache, path, &error));
+    g_assert_no_error (error);
+
+    loaded = mm_probe_cache_load (path, &error);
+    g_assert_no_error (error);
+    g_assert (loaded);
+
+    /* Contents are kept as they were */
+    data = g_key_file_to_data (cache, NULL, NULL);
+    loaded_data = g_key_file_to_data (loaded, NULL, NULL);
+    g_assert_cmpstr (data, ==, loaded_data);
+    g_free (loaded_data);
+    g_free (data);
+
+    group = mm_probe_cache_build_device_group (UID, VID, PID);
+    str = g_key_file_get_string (loaded, group, MM_PROBE_CACHE_DEVICE_KEY_PLUGIN, NULL);
+    g_assert_cmpstr (str, ==, PLUGIN);
+    g_free (str);
+    str = g_key_file_get_string (loaded, group, MM_PROBE_CACHE_DEVICE_KEY_REVISION, NULL);
+    g_assert_cmpstr (str, ==, "SWI9X30C_02.24.05.06");
+    g_free (str);
+    g_assert_cmpint (g_key_file_get_integer (loaded, group, MM_PROBE_CACHE_DEVICE_KEY_N_PORTS, NULL), ==, 2);
+    g_free (group);
+
+    group = mm_probe_cache_build_port_group (UID, VID, PID, "tty", "03");
+    g_assert_cmpint (g_key_file_get_integer (loaded, group, MM_PROBE_CACHE_PORT_KEY_PROBED, NULL), ==, 0x3);
+    g_assert (g_key_file_get_boolean (loaded, group, MM_PROBE_CACHE_PORT_KEY_AT, NULL));
+    str = g_key_file_get_string (loaded, group, MM_PROBE_CACHE_PORT_KEY_VENDOR, NULL);
+    g_assert_cmpstr (str, ==, "Sierra Wireless, Incorporated");
+    g_free (str);
+    g_free (group);
+
+    group = mm_probe_cache_build_port_group (UID, VID, PID, "usbmisc", "08");
+    g_assert (g_key_file_get_boolean (loaded, group, MM_PROBE_CACHE_PORT_KEY_QMI, NULL));
+    g_free (group);
+
+    g_key_file_unref (loaded);
+    g_key_file_unref (cache);
+    unlink (path);
+    g_free (path);
+}
+
+static void
+test_load_missing (void)
+{
+    GKeyFile *cache;
+    GError   *error = NULL;
+    gchar    *path;
+    gchar   **groups;
+
+    path = create_tmp_path (NULL);
+
+    /* Missing file is not an error, just an empty cache */
+    cache = mm_probe_cache_load (path, &error);
+    g_assert_no_error (error);
+    g_assert (cache);
+    groups = g_key_file_get_groups (cache, NULL);
+    g_assert_cmpuint (g_strv_length (groups), ==, 0);
+    g_strfreev (groups);
+    g_key_file_unref (cache);
+
+    g_free (path);
+}
+
+static void
+test_load_corrupt (void)
+{
+    GKeyFile *cache;
+    GError   *error = NULL;
+    gchar    *path;
+    gchar   **groups;
+
+    /* A valid group followed by garbage: nothing must be kept */
+    path = create_tmp_path ("[device 1199:68a2 " UID "]\n"
+                            "plugin=" PLUGIN "\n"
+                            "this is not a key file\n"
+                            "\x01\x02\xff\n");
+
+    cache = mm_probe_cache_load (path, &error);
+    g_assert_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_PARSE);
+    g_clear_error (&error);
+    g_assert (cache);
+    groups = g_key_file_get_groups (cache, NULL);
+    g_assert_cmpuint (g_strv_length (groups), ==, 0);
+    g_strfreev (groups);
+
+    /* And the empty cache can be written back over the corrupt file */
+    g_assert (mm_probe_cache_save (cache, path, NULL));
+    g_key_file_unref (cache);
+
+    cache = mm_probe_cache_load (path, &error);
+    g_assert_no_error (error);
+    g_key_file_unref (cache);
+
+    unlink (path);
+    g_free (path);
+}
+
+static void
+test_revision_stored (void)
+{
+    GKeyFile *cache;
+    gchar    *group;
+    gchar    *str;
+
+    cache = g_key_file_new ();
+    store_device (cache, UID, NULL);
+
+    /* Unknown devices are ignored */
+    g_assert_cmpint (mm_probe_cache_check_revision (cache, OTHER_UID, VID, PID, PLUGIN, "1.0"), ==,
+                     MM_PROBE_CACHE_REVISION_UNCHANGED);
+    g_assert (!has_device_group (cache, OTHER_UID));
+
+    /* Devices stored by another plugin aren't ours to validate */
+    g_assert_cmpint (mm_probe_cache_check_revision (cache, UID, VID, PID, "generic", "1.0"), ==,
+                     MM_PROBE_CACHE_REVISION_UNCHANGED);
+
+    /* First revision gets stored */
+    g_assert_cmpint (mm_probe_cache_check_revision (cache, UID, VID, PID, PLUGIN, "1.0"), ==,
+                     MM_PROBE_CACHE_REVISION_STORED);
+    group = mm_probe_cache_build_device_group (UID, VID, PID);
+    str = g_key_file_get_string (cache, group, MM_PROBE_CACHE_DEVICE_KEY_REVISION, NULL);
+    g_assert_cmpstr (str, ==, "1.0");
+    g_free (str);
+    g_free (group);
+
+    /* Same revision, nothing to do */
+    g_assert_cmpint (mm_probe_cache_check_revision (cache, UID, VID, PID, PLUGIN, "1.0"), ==,
+                     MM_PROBE_CACHE_REVISION_UNCHANGED);
+    g_assert (has_device_group (cache, UID));
+    g_assert_cmpuint (count_port_groups (cache, UID), ==, 2);
+
+    g_key_file_unref (cache);
+}
+
+static void
+test_revision_changed (void)
+{
+    GKeyFile *cache;
+    GKeyFile *loaded;
+    GError   *error = NULL;
+    gchar    *path;
+
+    path = create_tmp_path (NULL);
+
+    cache = g_key_file_new ();
+    store_device (cache, UID, "1.0");
+    store_device (cache, OTHER_UID, "1.0");
+    g_assert (mm_probe_cache_save (cache, path, NULL));
+    g_key_file_unref (cache);
+
+    cache = mm_probe_cache_load (path, &error);
+    g_assert_no_error (error);
+
+    /* Firmware upgrade drops the device and all its ports, but nothing else */
+    g_assert_cmpint (mm_probe_cache_check_revision (cache, UID, VID, PID, PLUGIN, "2.0"), ==,
+                     MM_PROBE_CACHE_REVISION_CHANGED);
+    g_assert (!has_device_group (cache, UID));
+    g_assert_cmpuint (count_port_groups (cache, UID), ==, 0);
+    g_assert (has_device_group (cache, OTHER_UID));
+    g_assert_cmpuint (count_port_groups (cache, OTHER_UID), ==, 2);
+
+    /* Revision no longer reported is a change as well */
+    g_assert_cmpint (mm_probe_cache_check_revision (cache, OTHER_UID, VID, PID, PLUGIN, NULL), ==,
+                     MM_PROBE_CACHE_REVISION_CHANGED);
+    g_assert (!has_device_group (cache, OTHER_UID));
+
+    /* And the removal survives a reload */
+    g_assert (mm_probe_cache_save (cache, path, NULL));
+    g_key_file_unref (cache);
+    loaded = mm_probe_cache_load (path, &error);
+    g_assert_no_error (error);
+    g_assert (!has_device_group (loaded, UID));
+    g_assert (!has_device_group (loaded, OTHER_UID));
+    g_assert_cmpuint (count_port_groups (loaded, UID), ==, 0);
+    g_assert_cmpuint (count_port_groups (loaded, OTHER_UID), ==, 0);
+    g_key_file_unref (loaded);
+
+    unlink (path);
+    g_free (path);
+}
+
+/*****************************************************************************/
+
+void
+_mm_log (const char *loc,
+         const char *func,
+         guint32 level,
+         const char *fmt,
+         ...)
+{
+    va_list args;
+    gchar *msg;
+
+    if (!g_test_verbose ())
+        return;
+
+    va_start (args, fmt);
+    msg = g_strdup_vprintf (fmt, args);
+    va_end (args);
+    g_print ("%s\n", msg);
+    g_free (msg);
+}
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/probe-cache/build-groups",     test_build_groups);
+    g_test_add_func ("/MM/probe-cache/save-load",        test_save_load);
+    g_test_add_func ("/MM/probe-cache/load-missing",     test_load_missing);
+    g_test_add_func ("/MM/probe-cache/load-corrupt",     test_load_corrupt);
+    g_test_add_func ("/MM/probe-cache/revision-stored",  test_revision_stored);
+    g_test_add_func ("/MM/probe-cache/revision-changed", test_revision_changed);
+
+    return g_test_run ();
+}
@@ -186,6 +186,44 @@ qcdm_verinfo_expect_success_cb (MMPortSerialQcdm *port,
     g_main_loop_quit (loop);
 }
 
+static void
+qcdm_verinfo_expect_stats_cb (MMPortSerialQcdm *port,
+                              GAsyncResult *res,
+                              GMainLoop *loop)
+{
+    GError *error = NULL;
+    GByteArray *response;
+    MMPortStats *stats;
+    GVariant *dictionary;
+    GVariant *latencies;
+    const gchar *key;
+
+    response = mm_port_serial_qcdm_command_finish (port, res, &error);
+
+    g_assert_no_error (error);
+    g_assert (response->len > 0);
+
+    /* The command and its reply are accounted in the port statistics */
+    stats = mm_port_peek_stats (MM_PORT (port));
+    g_assert_cmpuint (mm_port_stats_get_n_commands (stats), ==, 1);
+    g_assert_cmpuint (mm_port_stats_get_n_timeouts (stats), ==, 0);
+    g_assert_cmpuint (mm_port_stats_get_n_cache_hits (stats), ==, 0);
+    g_assert_cmpuint (mm_port_stats_get_n_bytes_out (stats), >, 0);
+    g_assert_cmpuint (mm_port_stats_get_n_bytes_in (stats), >=, response->len);
+    g_byte_array_unref (response);
+
+    dictionary = g_variant_ref_sink (mm_port_stats_get_dictionary (stats, "qcdm"));
+    latencies = g_variant_lookup_value (dictionary, "latencies", G_VARIANT_TYPE ("a(sau)"));
+    g_assert (latencies);
+    g_assert_cmpuint (g_variant_n_children (latencies), ==, 1);
+    g_variant_get_child (latencies, 0, "(&s@au)", &key, NULL);
+    g_assert_cmpstr (key, ==, "0x00");
+    g_variant_unref (latencies);
+    g_variant_unref (dictionary);
+
+    g_main_loop_quit (loop);
+}
+
 static void
 qcdm_request_verinfo (MMPortSerialQcdm *port,
                       GAsyncReadyCallback cb,
@@ -267,6 +305,43 @@ test_verinfo (TestData *d)
     g_assert (wait_for_child (d, 3));
 }
 
+/* Test that a Version Info request and its response are accounted in the
+ * port statistics.
+ */
+static void
+test_statistics (TestData *d)
+{
+    char req[512];
+    gsize req_len;
+    pid_t cpid;
+    const char rsp[] = {
+        0x00, 0x41, 0x75, 0x67, 0x20, 0x31, 0x39, 0x20, 0x32, 0x30, 0x30, 0x38,
+        0x32, 0x30, 0x3a, 0x34, 0x38, 0x3a, 0x34, 0x37, 0x4f, 0x63, 0x74, 0x20,
+        0x32, 0x39, 0x20, 0x32, 0x30, 0x30, 0x37, 0x31, 0x39, 0x3a, 0x30, 0x30,
+        0x3a, 0x30, 0x30, 0x53, 0x43, 0x4e, 0x52, 0x5a, 0x2e, 0x2e, 0x2e, 0x2a,
+        0x06, 0x04, 0xb9, 0x0b, 0x02, 0x00, 0xb2, 0x19, 0xc4, 0x7e
+    };
+
+    signal (SIGCHLD, SIG_DFL);
+    cpid = fork ();
+    g_assert (cpid >= 0);
+
+    if (cpid == 0) {
+        /* In the child */
+        qcdm_test_child (d->slave, (GAsyncReadyCallback)qcdm_verinfo_expect_stats_cb);
+        exit (0);
+    }
+    /* Parent */
+    d->child = cpid;
+
+    req_len = server_wait_request (d->master, req, sizeof (req));
+    g_assert (req_len == 1);
+    g_assert_cmpint (req[0], ==, 0x00);
+
+    server_send_response (d->master, rsp, sizeof (rsp));
+    g_assert (wait_for_child (d, 3));
+}
+
 static void
 qcdm_verinfo_expect_fail_cb (MMPortSerialQcdm *port,
                              GAsyncResult *res,
@@ -468,6 +543,7 @@ int main (int argc, char **argv)
     TESTCASE_PTY ("/MM/QCDM/Sierra-Cns-Rejected", test_sierra_cns_rejected);
     TESTCASE_PTY ("/MM/QCDM/Random-Data-Rejected", test_random_data_rejected);
     TESTCASE_PTY ("/MM/QCDM/Leading-Frame-Markers", test_leading_frame_markers);
+    TESTCASE_PTY ("/MM/QCDM/Statistics", test_statistics);
 
     return g_test_run ();
 }
@@ -0,0 +1,299 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <glib-object.h>
+
+#define _LIBMM_INSIDE_MM
+#include <libmm-glib.h>
+
+#include "mm-kernel-device-generic-rules.h"
+#include "mm-log.h"
+#include "test-bench.h"
+
+/* Applies the full set of shipped udev rules (core and plugins) to a pool
+ * of synthetic devices, as done for every port notified by the kernel when
+ * running without udev. */
+
+#define N_DEVICES 1000
+
+typedef struct {
+    MMUdevRulesDevice  device;
+    gchar             *name;
+    gchar             *sysfs_path;
+} BenchDevice;
+
+static GArray      *rules;
+static BenchDevice  devices[N_DEVICES];
+static guint        device_i;
+
+/*****************************************************************************/
+/* Rules setup, all rule files are linked in a single directory */
+
+static void
+link_rule_files (const gchar *tmp_dir,
+                 const gchar *dir_path)
+{
+    GDir        *dir;
+    const gchar *name;
+
+    dir = g_dir_open (dir_path, 0, NULL);
+    if (!dir)
+        return;
+
+    while ((name = g_dir_read_name (dir)) != NULL) {
+        gchar *target;
+        gchar *link_path;
+
+        if (!strstr (name, "-mm-") || !g_str_has_suffix (name, ".rules"))
+            continue;
+
+        target = g_build_filename (dir_path, name, NULL);
+        link_path = g_build_filename (tmp_dir, name, NULL);
+        g_assert_cmpint (symlink (target, link_path), ==, 0);
+        g_free (link_path);
+        g_free (target);
+    }
+    g_dir_close (dir);
+}
+
+static gchar *
+setup_rules_dir (void)
+{
+    GDir        *plugins_dir;
+    const gchar *name;
+    gchar       *tmp_dir;
+    GError      *error = NULL;
+
+    tmp_dir = g_dir_make_tmp ("mm-udev-rules-bench-XXXXXX", &error);
+    g_assert_no_error (error);
+
+    link_rule_files (tmp_dir, TESTUDEVRULESDIR);
+
+    plugins_dir = g_dir_open (TESTPLUGINSDIR, 0, &error);
+    g_assert_no_error (error);
+    while ((name = g_dir_read_name (plugins_dir)) != NULL) {
+        gchar *plugin_dir;
+
+        plugin_dir = g_build_filename (TESTPLUGINSDIR, name, NULL);
+        if (g_file_test (plugin_dir, G_FILE_TEST_IS_DIR))
+            link_rule_files (tmp_dir, plugin_dir);
+        g_free (plugin_dir);
+    }
+    g_dir_close (plugins_dir);
+
+    return tmp_dir;
+}
+
+static void
+cleanup_rules_dir (gchar *tmp_dir)
+{
+    GDir        *dir;
+    const gchar *name;
+
+    dir = g_dir_open (tmp_dir, 0, NULL);
+    if (dir) {
+        while ((name = g_dir_read_name (dir)) != NULL) {
+            gchar *path;
+
+            path = g_build_filename (tmp_dir, name, NULL);
+            g_unlink (path);
+            g_free (path);
+        }
+        g_dir_close (dir);
+    }
+    g_rmdir (tmp_dir);
+    g_free (tmp_dir);
+}
+
+/*****************************************************************************/
+/* Synthetic devices, using the vendor ids found in the rules and some
+ * unknown ones */
+
+static GArray *
+collect_vendor_ids (void)
+{
+    GArray *vids;
+    guint   i;
+
+    vids = g_array_new (FALSE, FALSE, sizeof (guint16));
+    for (i = 0; i < rules->len; i++) {
+        MMUdevRule *rule;
+        guint       j;
+
+        rule = &g_array_index (rules, MMUdevRule, i);
+        if (!rule->conditions)
+            continue;
+
+        for (j = 0; j < rule->conditions->len; j++) {
+            MMUdevRuleMatch *match;
+            guint16          vid;
+
+            match = &g_array_index (rule->conditions, MMUdevRuleMatch, j);
+            if (match->parameter_id != MM_UDEV_RULE_MATCH_PARAMETER_VENDOR_ID || !match->uint_valid)
+                continue;
+            vid = (guint16) match->uint_value;
+            g_array_append_val (vids, vid);
+        }
+    }
+    g_assert_cmpuint (vids->len, >, 0);
+    return vids;
+}
+
+static void
+setup_devices (void)
+{
+    static const gchar *drivers[] = { "option", "qmi_wwan", "cdc_acm", "cdc_mbim" };
+    GArray             *vids;
+    guint               i;
+
+    vids = collect_vendor_ids ();
+
+    for (i = 0; i < N_DEVICES; i++) {
+        BenchDevice *bench_device = &devices[i];
+        guint        usb_port;
+        guint        iface;
+
+        usb_port = 1 + (i / 8);
+        iface = i % 8;
+
+        switch (i % 3) {
+        case 0:
+            bench_device->name = g_strdup_printf ("ttyUSB%u", i);
+            bench_device->sysfs_path = g_strdup_printf ("/sys/devices/pci0000:00/0000:00:14.0/usb1/1-%u/1-%u:1.%u/%s/tty/%s",
+                                                        usb_port, usb_port, iface, bench_device->name, bench_device->name);
+            break;
+        case 1:
+            bench_device->name = g_strdup_printf ("cdc-wdm%u", i);
+            bench_device->sysfs_path = g_strdup_printf ("/sys/devices/pci0000:00/0000:00:14.0/usb1/1-%u/1-%u:1.%u/usbmisc/%s",
+                                                        usb_port, usb_port, iface, bench_device->name);
+            break;
+        default:
+            bench_device->name = g_strdup_printf ("wwan%u", i);
+            bench_device->sysfs_path = g_strdup_printf ("/sys/devices/pci0000:00/0000:00:14.0/usb1/1-%u/1-%u:1.%u/net/%s",
+                                                        usb_port, usb_port, iface, bench_device->name);
+            break;
+        }
+
+        bench_device->device.name = bench_device->name;
+        bench_device->device.sysfs_path = bench_device->sysfs_path;
+        bench_device->device.driver = drivers[i % G_N_ELEMENTS (drivers)];
+        /* One out of every four devices with an unknown vendor */
+        bench_device->device.physdev_vid = (i % 4 == 3) ? (0xf000 + i) : g_array_index (vids, guint16, (i * 7) % vids->len);
+        bench_device->device.physdev_pid = (guint16) (i * 13);
+        bench_device->device.interface_class = 0xff;
+        bench_device->device.interface_subclass = 0xff;
+        bench_device->device.interface_protocol = 0xff;
+        bench_device->device.interface_number = iface;
+    }
+
+    g_array_unref (vids);
+}
+
+static void
+cleanup_devices (void)
+{
+    guint i;
+
+    for (i = 0; i < N_DEVICES; i++) {
+        g_free (devices[i].name);
+        g_free (devices[i].sysfs_path);
+    }
+}
+
+/*****************************************************************************/
+
+static const gchar *
+get_property (const gchar *name,
+              GHashTable  *properties)
+{
+    return g_hash_table_lookup (properties, name);
+}
+
+static void
+set_property (const gchar *name,
+              const gchar *value,
+              gboolean     static_value,
+              GHashTable  *properties)
+{
+    /* Names are always owned by the rules */
+    g_hash_table_insert (properties, (gpointer) name, g_strdup (value));
+}
+
+/* Each operation applies the rules to one device of the pool */
+static void
+bench_apply (gconstpointer data)
+{
+    GHashTable *properties;
+
+    properties = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+    mm_kernel_device_generic_rules_apply (rules,
+                                          &devices[device_i++ % N_DEVICES].device,
+                                          (MMUdevRulesGetPropertyFunc) get_property,
+                                          (MMUdevRulesSetPropertyFunc) set_property,
+                                          properties);
+    g_hash_table_unref (properties);
+}
+
+/*****************************************************************************/
+
+void
+_mm_log (const char *loc,
+         const char *func,
+         guint32 level,
+         const char *fmt,
+         ...)
+{
+    va_list args;
+    gchar *msg;
+
+    if (!g_test_verbose ())
+        return;
+
+    va_start (args, fmt);
+    msg = g_strdup_vprintf (fmt, args);
+    va_end (args);
+    g_print ("%s\n", msg);
+    g_free (msg);
+}
+
+int main (int argc, char **argv)
+{
+    GError *error = NULL;
+    gchar  *rules_dir;
+    gint    result;
+
+    g_test_init (&argc, &argv, NULL);
+
+    rules_dir = setup_rules_dir ();
+    rules = mm_kernel_device_generic_rules_load (rules_dir, &error);
+    g_assert_no_error (error);
+    g_assert (rules);
+    cleanup_rules_dir (rules_dir);
+
+    setup_devices ();
+
+    mm_test_bench_add ("/MM/bench/udev-rules/apply", bench_apply, NULL);
+
+    result = g_test_run ();
+
+    cleanup_devices ();
+    g_array_unref (rules);
+
+    return result;
+}
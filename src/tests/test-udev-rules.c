@@ -43,6 +43,80 @@ test_load_cleanup_core (void)
 
 /************************************************************/
 
+static const gchar *
+get_property (const gchar *name,
+              GHashTable  *properties)
+{
+    return g_hash_table_lookup (properties, name);
+}
+
+static void
+set_property (const gchar *name,
+              const gchar *value,
+              gboolean     static_value,
+              GHashTable  *properties)
+{
+    g_hash_table_insert (properties, g_strdup (name), g_strdup (value));
+}
+
+static GHashTable *
+apply_rules (GArray                  *rules,
+             const MMUdevRulesDevice *device)
+{
+    GHashTable *properties;
+
+    properties = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    mm_kernel_device_generic_rules_apply (rules,
+                                          device,
+                                          (MMUdevRulesGetPropertyFunc) get_property,
+                                          (MMUdevRulesSetPropertyFunc) set_property,
+                                          properties);
+    return properties;
+}
+
+static void
+test_apply_core (void)
+{
+    GArray            *rules;
+    GHashTable        *properties;
+    GError            *error = NULL;
+    MMUdevRulesDevice  device = {
+        .name        = "ttyUSB0",
+        .driver      = "option",
+        .sysfs_path  = "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.0/ttyUSB0/tty/ttyUSB0",
+        .physdev_vid = 0x051d,
+        .physdev_pid = 0x0002,
+    };
+
+    rules = mm_kernel_device_generic_rules_load (TESTUDEVRULESDIR, &error);
+    g_assert_no_error (error);
+    g_assert (rules);
+
+    /* Blacklisted vendor */
+    properties = apply_rules (rules, &device);
+    g_assert_cmpstr (g_hash_table_lookup (properties, "ID_MM_TTY_BLACKLIST"), ==, "1");
+    g_assert_cmpstr (g_hash_table_lookup (properties, "ID_MM_CANDIDATE"), ==, "1");
+    g_hash_table_unref (properties);
+
+    /* Unknown vendor */
+    device.physdev_vid = 0xfffe;
+    properties = apply_rules (rules, &device);
+    g_assert (!g_hash_table_lookup (properties, "ID_MM_TTY_BLACKLIST"));
+    g_assert_cmpstr (g_hash_table_lookup (properties, "ID_MM_CANDIDATE"), ==, "1");
+    g_hash_table_unref (properties);
+
+    /* Blacklisted vendor, but not a USB device */
+    device.physdev_vid = 0x051d;
+    device.sysfs_path = "/sys/devices/platform/serial8250/tty/ttyS0";
+    properties = apply_rules (rules, &device);
+    g_assert (!g_hash_table_lookup (properties, "ID_MM_TTY_BLACKLIST"));
+    g_hash_table_unref (properties);
+
+    g_array_unref (rules);
+}
+
+/************************************************************/
+
 void
 _mm_log (const char *loc,
          const char *func,
@@ -70,6 +144,7 @@ int main (int argc, char **argv)
     g_test_init (&argc, &argv, NULL);
 
     g_test_add_func ("/MM/test-udev-rules/load-cleanup-core", test_load_cleanup_core);
+    g_test_add_func ("/MM/test-udev-rules/apply-core", test_apply_core);
 
     return g_test_run ();
 }
@@ -0,0 +1,119 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <locale.h>
+#include <string.h>
+#include <errno.h>
+
+#include <glib.h>
+
+#include <ModemManager.h>
+
+#include <mm-log.h>
+#include <mm-port-capture-decoder.h>
+
+#define PROGRAM_NAME    "mmcapture"
+#define PROGRAM_VERSION PACKAGE_VERSION
+
+/* Context */
+static gchar    *path;
+static gboolean  hex_flag;
+static gboolean  version_flag;
+
+static GOptionEntry main_entries[] = {
+    { "file", 'f', 0, G_OPTION_ARG_FILENAME, &path,
+      "Specify path to the port capture file",
+      "[PATH]"
+    },
+    { "hex", 'x', 0, G_OPTION_ARG_NONE, &hex_flag,
+      "Also dump the raw bytes of every record",
+      NULL
+    },
+    { "version", 'V', 0, G_OPTION_ARG_NONE, &version_flag,
+      "Print version",
+      NULL
+    },
+    { NULL }
+};
+
+static void
+print_version_and_exit (void)
+{
+    g_print ("\n"
+             PROGRAM_NAME " " PROGRAM_VERSION "\n"
+             "License GPLv2+: GNU GPL version 2 or later <http://gnu.org/licenses/gpl-2.0.html>\n"
+             "This is free software: you are free to change and redistribute it.\n"
+             "There is NO WARRANTY, to the extent permitted by law.\n"
+             "\n");
+    exit (EXIT_SUCCESS);
+}
+
+/* Logging from the ports library isn't relevant here */
+void
+_mm_log (const char *loc,
+         const char *func,
+         guint32 level,
+         const char *fmt,
+         ...)
+{
+}
+
+int main (int argc, char **argv)
+{
+    GOptionContext *context;
+    FILE           *file;
+    GString        *transcript;
+    GError         *error = NULL;
+    gboolean        success;
+
+    setlocale (LC_ALL, "");
+
+    /* Setup option context, process it and destroy it */
+    context = g_option_context_new ("- ModemManager port capture decoder");
+    g_option_context_add_main_entries (context, main_entries, NULL);
+    g_option_context_parse (context, &argc, &argv, NULL);
+    g_option_context_free (context);
+
+    if (version_flag)
+        print_version_and_exit ();
+
+    /* No file path given? */
+    if (!path) {
+        g_printerr ("error: no capture file path specified\n");
+        exit (EXIT_FAILURE);
+    }
+
+    file = fopen (path, "rb");
+    if (!file) {
+        g_printerr ("error: couldn't open capture file: %s\n", g_strerror (errno));
+        exit (EXIT_FAILURE);
+    }
+
+    transcript = g_string_new (NULL);
+    success = mm_port_capture_decode (file, hex_flag, transcript, &error);
+    fclose (file);
+
+    g_print ("%s", transcript->str);
+    g_string_free (transcript, TRUE);
+
+    if (!success) {
+        g_printerr ("error: %s\n", error->message);
+        g_error_free (error);
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}